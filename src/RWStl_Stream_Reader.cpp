@@ -1,4 +1,12 @@
 #include "RWStl_Stream_Reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "trace_events.h"
+
 namespace {
 
 // Binary STL sizes
@@ -10,12 +18,103 @@ static const size_t THE_STL_MIN_FILE_SIZE =
 // The length of buffer to read (in bytes)
 static const size_t THE_BUFFER_SIZE = 1024;
 
+// Number of binary facets read at once
+static const size_t THE_FACETS_PER_CHUNK = 4096;
+
+//! Read little-endian 32-bit value.
+static uint32_t readUInt32(const char *theData) {
+  const unsigned char *aData = reinterpret_cast<const unsigned char *>(theData);
+  return uint32_t(aData[0]) | (uint32_t(aData[1]) << 8) |
+         (uint32_t(aData[2]) << 16) | (uint32_t(aData[3]) << 24);
+}
+
+//! Read little-endian float.
+static float readFloat(const char *theData) {
+  const uint32_t aBits = readUInt32(theData);
+  float aValue;
+  memcpy(&aValue, &aBits, sizeof(aValue));
+  return aValue + 0.0f; // -0.0 -> 0.0
+}
+
+//! Hash of the exact node position.
+static size_t hashNode(const gp_Vec3f &theNode) {
+  uint32_t aBits[3];
+  memcpy(aBits, theNode.GetData(), sizeof(aBits));
+  uint64_t aHash = aBits[0] * 0x9E3779B97F4A7C15ULL;
+  aHash ^= aBits[1] + 0xBF58476D1CE4E5B9ULL + (aHash << 6) + (aHash >> 2);
+  aHash ^= aBits[2] + 0x94D049BB133111EBULL + (aHash << 6) + (aHash >> 2);
+  return size_t(aHash ^ (aHash >> 31));
+}
+
+//! Open-addressing table of 1-based node indices keyed by node position.
+//! Takes 4-8 bytes per node instead of a map node with a copy of position.
+class NodeMergeTable {
+public:
+  NodeMergeTable(NCollection_Vector<gp_Vec3f> &theNodes,
+                 size_t theExpectedNodes)
+      : myNodes(theNodes), myNbItems(0) {
+    size_t aCapacity = 64;
+    while (aCapacity * 3 < theExpectedNodes * 4) {
+      aCapacity *= 2;
+    }
+    myTable.assign(aCapacity, 0);
+  }
+
+  //! Return index of the node, appending it if there is no equal one.
+  Standard_Integer Add(const gp_Vec3f &theNode) {
+    if ((myNbItems + 1) * 4 > myTable.size() * 3) {
+      grow();
+    }
+
+    const size_t aMask = myTable.size() - 1;
+    for (size_t aCell = hashNode(theNode) & aMask;;
+         aCell = (aCell + 1) & aMask) {
+      const Standard_Integer anIndex = myTable[aCell];
+      if (anIndex == 0) {
+        myNodes.Append(theNode);
+        myTable[aCell] = myNodes.Length();
+        ++myNbItems;
+        return myTable[aCell];
+      }
+      if (myNodes.Value(anIndex - 1).IsEqual(theNode)) {
+        return anIndex;
+      }
+    }
+  }
+
+private:
+  void grow() {
+    std::vector<Standard_Integer> anOld;
+    anOld.swap(myTable);
+    myTable.assign(anOld.size() * 2, 0);
+    const size_t aMask = myTable.size() - 1;
+    for (Standard_Integer anIndex : anOld) {
+      if (anIndex == 0) {
+        continue;
+      }
+      size_t aCell = hashNode(myNodes.Value(anIndex - 1)) & aMask;
+      while (myTable[aCell] != 0) {
+        aCell = (aCell + 1) & aMask;
+      }
+      myTable[aCell] = anIndex;
+    }
+  }
+
+private:
+  NCollection_Vector<gp_Vec3f> &myNodes;
+  std::vector<Standard_Integer> myTable;
+  size_t myNbItems;
+};
+
 } // namespace
 
 IMPLEMENT_STANDARD_RTTIEXT(RWStl_Stream_Reader, RWStl_Reader)
 
+RWStl_Stream_Reader::RWStl_Stream_Reader() : myNbTriangles(0) {}
+
 Standard_EXPORT Standard_Boolean RWStl_Stream_Reader::Read(
     Standard_IStream &inputStream, const Message_ProgressRange &readProgress) {
+  TRACE_SCOPE("parse STL");
   inputStream.seekg(0, std::ios_base::end);
   auto end = inputStream.tellg();
   inputStream.seekg(0, std::ios_base::beg);
@@ -25,7 +124,7 @@ Standard_EXPORT Standard_Boolean RWStl_Stream_Reader::Read(
   Standard_ReadLineBuffer aBuffer(THE_BUFFER_SIZE);
 
   // Note: here we are trying to handle rare but realistic case of
-  // STL files which are composed of several STL data blocks
+  // ASCII STL files which are composed of several solids
   // running translation in cycle.
   // For this reason use infinite (logarithmic) progress scale,
   // but in special mode so that the first cycle will take ~ 70% of it
@@ -36,17 +135,85 @@ Standard_EXPORT Standard_Boolean RWStl_Stream_Reader::Read(
         break;
       }
     } else {
-      if (!ReadBinary(inputStream, aPS.Next(2))) {
+      if (!readBinaryBlock(inputStream, end, aPS.Next(2))) {
         break;
       }
+      // bytes after the declared facets are not another block
+      // but trailing data, like padding of some exporters
+      return Standard_True;
     }
     inputStream >> std::ws; // skip any white spaces
   }
   return inputStream.fail();
 }
 
+Standard_Boolean
+RWStl_Stream_Reader::readBinaryBlock(Standard_IStream &theStream,
+                                     std::streampos theEnd,
+                                     const Message_ProgressRange &theProgress) {
+  char aHeader[THE_STL_HEADER_SIZE];
+  if (!theStream.read(aHeader, THE_STL_HEADER_SIZE)) {
+    return Standard_False;
+  }
+
+  // do not trust the header of truncated files
+  const size_t aNbAvailable =
+      size_t(theEnd - theStream.tellg()) / THE_STL_SIZEOF_FACET;
+  const size_t aNbFacets =
+      std::min((size_t)readUInt32(aHeader + 80), aNbAvailable);
+  if (aNbFacets == 0) {
+    return Standard_False;
+  }
+
+  // closed meshes have about half as many nodes as facets
+  NodeMergeTable aMergeTable(myNodes, aNbFacets / 2 + 1);
+  if (myTriangulation.IsNull()) {
+    myTriangulation = new Poly_Triangulation();
+    myTriangulation->ResizeTriangles((Standard_Integer)aNbFacets,
+                                     Standard_False);
+  } else {
+    myTriangulation->ResizeTriangles(
+        myNbTriangles + (Standard_Integer)aNbFacets, Standard_True);
+  }
+
+  Message_ProgressScope aPS(theProgress, "Reading binary STL",
+                            double(aNbFacets));
+  std::vector<char> aChunk(THE_FACETS_PER_CHUNK * THE_STL_SIZEOF_FACET);
+  for (size_t aFacetIter = 0; aFacetIter < aNbFacets;) {
+    const size_t aNbChunkFacets =
+        std::min(THE_FACETS_PER_CHUNK, aNbFacets - aFacetIter);
+    if (!aPS.More() ||
+        !theStream.read(aChunk.data(),
+                        aNbChunkFacets * THE_STL_SIZEOF_FACET)) {
+      return Standard_False;
+    }
+
+    for (size_t aChunkIter = 0; aChunkIter < aNbChunkFacets; ++aChunkIter) {
+      // skip facet normal, 12 bytes
+      const char *aFacet =
+          aChunk.data() + aChunkIter * THE_STL_SIZEOF_FACET + 12;
+      Standard_Integer aNodes[3];
+      for (int aNodeIter = 0; aNodeIter < 3; ++aNodeIter) {
+        const char *aCoords = aFacet + aNodeIter * 12;
+        aNodes[aNodeIter] = aMergeTable.Add(gp_Vec3f(readFloat(aCoords),
+                                                     readFloat(aCoords + 4),
+                                                     readFloat(aCoords + 8)));
+      }
+      if (aNodes[0] != aNodes[1] && aNodes[1] != aNodes[2] &&
+          aNodes[0] != aNodes[2]) {
+        myTriangulation->SetTriangle(
+            ++myNbTriangles, Poly_Triangle(aNodes[0], aNodes[1], aNodes[2]));
+      }
+    }
+    aFacetIter += aNbChunkFacets;
+    aPS.Next(double(aNbChunkFacets));
+  }
+  return Standard_True;
+}
+
 Standard_Integer RWStl_Stream_Reader::AddNode(const gp_XYZ &thePnt) {
-  myNodes.Append(thePnt);
+  myNodes.Append(gp_Vec3f((float)thePnt.X(), (float)thePnt.Y(),
+                          (float)thePnt.Z()));
   return myNodes.Size();
 }
 
@@ -57,20 +224,34 @@ void RWStl_Stream_Reader::AddTriangle(Standard_Integer theNode1,
 }
 
 Handle(Poly_Triangulation) RWStl_Stream_Reader::GetTriangulation() {
-  if (myTriangles.IsEmpty())
-    return Handle(Poly_Triangulation)();
+  TRACE_SCOPE("build triangulation");
+  Handle(Poly_Triangulation) aPoly = myTriangulation;
+  myTriangulation.Nullify();
+  if (aPoly.IsNull()) {
+    if (myTriangles.IsEmpty()) {
+      return Handle(Poly_Triangulation)();
+    }
 
-  Handle(Poly_Triangulation) aPoly = new Poly_Triangulation(
-      myNodes.Length(), myTriangles.Length(), Standard_False);
-  for (Standard_Integer aNodeIter = 0; aNodeIter < myNodes.Size();
-       ++aNodeIter) {
-    aPoly->SetNode(aNodeIter + 1, myNodes[aNodeIter]);
+    aPoly = new Poly_Triangulation();
+    aPoly->ResizeTriangles(myTriangles.Length(), Standard_False);
+    for (Standard_Integer aTriIter = 0; aTriIter < myTriangles.Size();
+         ++aTriIter) {
+      aPoly->SetTriangle(aTriIter + 1, myTriangles[aTriIter]);
+    }
+    myTriangles.Clear();
+  } else if (myNbTriangles < aPoly->NbTriangles()) {
+    // degenerated facets have been skipped
+    aPoly->ResizeTriangles(myNbTriangles, Standard_True);
   }
+  myNbTriangles = 0;
 
-  for (Standard_Integer aTriIter = 0; aTriIter < myTriangles.Size();
-       ++aTriIter) {
-    aPoly->SetTriangle(aTriIter + 1, myTriangles[aTriIter]);
+  // each stage releases its input before the next one allocates
+  aPoly->ResizeNodes(myNodes.Length(), Standard_False);
+  for (Standard_Integer aNodeIter = 0; aNodeIter < myNodes.Size();
+       ++aNodeIter) {
+    const gp_Vec3f &aNode = myNodes[aNodeIter];
+    aPoly->SetNode(aNodeIter + 1, gp_Pnt(aNode.x(), aNode.y(), aNode.z()));
   }
-
+  myNodes.Clear();
   return aPoly;
-}
\ No newline at end of file
+}
@@ -4,10 +4,21 @@
 #include <NCollection_Vector.hxx>
 #include <Poly_Triangulation.hxx>
 #include <RWStl_Reader.hxx>
+#include <gp_Vec3f.hxx>
 
+//! STL reader collecting a single triangulation.
+//! Binary data is parsed by the reader itself: triangles are written in place
+//! into the resulting triangulation, allocated by the facet count from the
+//! header, and coincident nodes are merged with a compact table of indices,
+//! so that peak memory stays close to the size of the result.
+//! Bytes following the declared number of facets are ignored, as by
+//! StlStreamDecoder. ASCII data is parsed by RWStl_Reader.
 class RWStl_Stream_Reader : public RWStl_Reader {
 public:
   DEFINE_STANDARD_RTTIEXT(RWStl_Stream_Reader, RWStl_Reader)
+
+  RWStl_Stream_Reader();
+
   Standard_EXPORT Standard_Boolean
   Read(Standard_IStream &inputStream,
        const Message_ProgressRange &readProgress = Message_ProgressRange());
@@ -20,10 +31,20 @@ public:
   virtual void AddTriangle(Standard_Integer theNode1, Standard_Integer theNode2,
                            Standard_Integer theNode3) Standard_OVERRIDE;
 
-  //! Creates Poly_Triangulation from collected data
+  //! Creates Poly_Triangulation from collected data.
+  //! Collected data is released, so it could be called only once.
   Handle(Poly_Triangulation) GetTriangulation();
 
 private:
-  NCollection_Vector<gp_XYZ> myNodes;
-  NCollection_Vector<Poly_Triangle> myTriangles;
-};
\ No newline at end of file
+  //! Read one binary STL block.
+  //! @param theEnd [in] position of the stream end
+  Standard_Boolean readBinaryBlock(Standard_IStream &theStream,
+                                   std::streampos theEnd,
+                                   const Message_ProgressRange &theProgress);
+
+private:
+  NCollection_Vector<gp_Vec3f> myNodes;          //!< staged nodes
+  NCollection_Vector<Poly_Triangle> myTriangles; //!< staged ASCII triangles
+  Handle(Poly_Triangulation) myTriangulation; //!< binary triangles in place
+  Standard_Integer myNbTriangles; //!< number of triangles in myTriangulation
+};
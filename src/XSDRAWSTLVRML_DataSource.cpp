@@ -22,6 +22,8 @@
 #include <TColStd_DataMapOfIntegerReal.hxx>
 #include <TColgp_SequenceOfXYZ.hxx>
 
+#include "trace_events.h"
+
 IMPLEMENT_STANDARD_RTTIEXT(XSDRAWSTLVRML_DataSource, MeshVS_DataSource)
 
 //================================================================
@@ -30,59 +32,20 @@ IMPLEMENT_STANDARD_RTTIEXT(XSDRAWSTLVRML_DataSource, MeshVS_DataSource)
 //================================================================
 XSDRAWSTLVRML_DataSource::XSDRAWSTLVRML_DataSource(
     const Handle(Poly_Triangulation) & aMesh) {
+  TRACE_SCOPE("data source build");
   myMesh = aMesh;
 
   if (!myMesh.IsNull()) {
+    // coordinates, connectivity and normals are taken from the triangulation
+    // on request, so that the mesh is not duplicated in memory
     const Standard_Integer aNbNodes = myMesh->NbNodes();
-    myNodeCoords = new TColStd_HArray2OfReal(1, aNbNodes, 1, 3);
-    std::cout << "Nodes : " << aNbNodes << std::endl;
-
-    for (Standard_Integer i = 1; i <= aNbNodes; i++) {
+    for (Standard_Integer i = 1; i <= aNbNodes; i++)
       myNodes.Add(i);
-      gp_Pnt xyz = myMesh->Node(i);
-
-      myNodeCoords->SetValue(i, 1, xyz.X());
-      myNodeCoords->SetValue(i, 2, xyz.Y());
-      myNodeCoords->SetValue(i, 3, xyz.Z());
-    }
 
     const Standard_Integer aNbTris = myMesh->NbTriangles();
-    myElemNormals = new TColStd_HArray2OfReal(1, aNbTris, 1, 3);
-    myElemNodes = new TColStd_HArray2OfInteger(1, aNbTris, 1, 3);
-
-    std::cout << "Elements : " << aNbTris << std::endl;
-
-    for (Standard_Integer i = 1; i <= aNbTris; i++) {
+    for (Standard_Integer i = 1; i <= aNbTris; i++)
       myElements.Add(i);
-
-      const Poly_Triangle aTri = myMesh->Triangle(i);
-
-      Standard_Integer V[3];
-      aTri.Get(V[0], V[1], V[2]);
-
-      const gp_Pnt aP1 = myMesh->Node(V[0]);
-      const gp_Pnt aP2 = myMesh->Node(V[1]);
-      const gp_Pnt aP3 = myMesh->Node(V[2]);
-
-      gp_Vec aV1(aP1, aP2);
-      gp_Vec aV2(aP2, aP3);
-
-      gp_Vec aN = aV1.Crossed(aV2);
-      if (aN.SquareMagnitude() > Precision::SquareConfusion())
-        aN.Normalize();
-      else
-        aN.SetCoord(0.0, 0.0, 0.0);
-
-      for (Standard_Integer j = 0; j < 3; j++) {
-        myElemNodes->SetValue(i, j + 1, V[j]);
-      }
-
-      myElemNormals->SetValue(i, 1, aN.X());
-      myElemNormals->SetValue(i, 2, aN.Y());
-      myElemNormals->SetValue(i, 3, aN.Z());
-    }
   }
-  std::cout << "Construction is finished" << std::endl;
 }
 
 //================================================================
@@ -101,10 +64,13 @@ Standard_Boolean XSDRAWSTLVRML_DataSource::GetGeom(
       Type = MeshVS_ET_Face;
       NbNodes = 3;
 
-      for (Standard_Integer i = 1, k = 1; i <= 3; i++) {
-        Standard_Integer IdxNode = myElemNodes->Value(ID, i);
-        for (Standard_Integer j = 1; j <= 3; j++, k++)
-          Coords(k) = myNodeCoords->Value(IdxNode, j);
+      Standard_Integer V[3];
+      myMesh->Triangle(ID).Get(V[0], V[1], V[2]);
+      for (Standard_Integer i = 0, k = 1; i < 3; i++) {
+        const gp_Pnt aP = myMesh->Node(V[i]);
+        Coords(k++) = aP.X();
+        Coords(k++) = aP.Y();
+        Coords(k++) = aP.Z();
       }
 
       return Standard_True;
@@ -114,9 +80,10 @@ Standard_Boolean XSDRAWSTLVRML_DataSource::GetGeom(
     Type = MeshVS_ET_Node;
     NbNodes = 1;
 
-    Coords(1) = myNodeCoords->Value(ID, 1);
-    Coords(2) = myNodeCoords->Value(ID, 2);
-    Coords(3) = myNodeCoords->Value(ID, 3);
+    const gp_Pnt aP = myMesh->Node(ID);
+    Coords(1) = aP.X();
+    Coords(2) = aP.Y();
+    Coords(3) = aP.Z();
     return Standard_True;
   } else
     return Standard_False;
@@ -161,9 +128,8 @@ Standard_Boolean XSDRAWSTLVRML_DataSource::GetNodesByElement(
 
   if (ID >= 1 && ID <= myElements.Extent() && theNodeIDs.Length() >= 3) {
     Standard_Integer aLow = theNodeIDs.Lower();
-    theNodeIDs(aLow) = myElemNodes->Value(ID, 1);
-    theNodeIDs(aLow + 1) = myElemNodes->Value(ID, 2);
-    theNodeIDs(aLow + 2) = myElemNodes->Value(ID, 3);
+    myMesh->Triangle(ID).Get(theNodeIDs(aLow), theNodeIDs(aLow + 1),
+                             theNodeIDs(aLow + 2));
     return Standard_True;
   }
   return Standard_False;
@@ -200,10 +166,38 @@ Standard_Boolean XSDRAWSTLVRML_DataSource::GetNormal(const Standard_Integer Id,
     return Standard_False;
 
   if (Id >= 1 && Id <= myElements.Extent() && Max >= 3) {
-    nx = myElemNormals->Value(Id, 1);
-    ny = myElemNormals->Value(Id, 2);
-    nz = myElemNormals->Value(Id, 3);
+    Standard_Integer V[3];
+    myMesh->Triangle(Id).Get(V[0], V[1], V[2]);
+
+    const gp_Pnt aP1 = myMesh->Node(V[0]);
+    const gp_Pnt aP2 = myMesh->Node(V[1]);
+    const gp_Pnt aP3 = myMesh->Node(V[2]);
+
+    gp_Vec aV1(aP1, aP2);
+    gp_Vec aV2(aP2, aP3);
+
+    gp_Vec aN = aV1.Crossed(aV2);
+    if (aN.SquareMagnitude() > Precision::SquareConfusion())
+      aN.Normalize();
+    else
+      aN.SetCoord(0.0, 0.0, 0.0);
+
+    nx = aN.X();
+    ny = aN.Y();
+    nz = aN.Z();
     return Standard_True;
   } else
     return Standard_False;
 }
+
+//================================================================
+// Function : EstimatedDataSize
+// Purpose  :
+//================================================================
+Standard_Size XSDRAWSTLVRML_DataSource::EstimatedDataSize() const {
+  Standard_Size aSize = sizeof(*this);
+
+  // packed maps keep one bit per item plus block headers
+  aSize += (Standard_Size)(myNodes.Extent() + myElements.Extent()) / 8;
+  return aSize;
+}
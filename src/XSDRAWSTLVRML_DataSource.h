@@ -72,6 +72,13 @@ public:
   //! There is default method, for advance reflection this method can be redefined.
   Standard_EXPORT virtual Standard_Boolean GetNormal (const Standard_Integer Id, const Standard_Integer Max, Standard_Real& nx, Standard_Real& ny, Standard_Real& nz) const Standard_OVERRIDE;
 
+  //! Returns source triangulation.
+  const Handle(Poly_Triangulation)& Triangulation() const { return myMesh; }
+
+  //! Returns estimated size in bytes of node and element maps held by the data source,
+  //! not including source triangulation.
+  Standard_EXPORT Standard_Size EstimatedDataSize() const;
+
 
 
 
@@ -88,9 +95,6 @@ private:
   Handle(Poly_Triangulation) myMesh;
   TColStd_PackedMapOfInteger myNodes;
   TColStd_PackedMapOfInteger myElements;
-  Handle(TColStd_HArray2OfInteger) myElemNodes;
-  Handle(TColStd_HArray2OfReal) myNodeCoords;
-  Handle(TColStd_HArray2OfReal) myElemNormals;
 
 
 };
@@ -1,16 +1,102 @@
 #include "../RWStl_Stream_Reader.h"
+#include "../XSDRAWSTLVRML_DataSource.h"
+#include "../alloc_profiler.h"
+#include "../trace_events.h"
+#include <AIS_InteractiveContext.hxx>
+#include <Aspect_DisplayConnection.hxx>
 #include <BRepBuilderAPI_MakeFace.hxx>
 #include <BRepBuilderAPI_MakePolygon.hxx>
 #include <BRepBuilderAPI_MakeVertex.hxx>
 #include <BRepBuilderAPI_Sewing.hxx>
 #include <BRep_Builder.hxx>
+#include <MeshVS_DisplayModeFlags.hxx>
+#include <MeshVS_Drawer.hxx>
+#include <MeshVS_DrawerAttribute.hxx>
+#include <MeshVS_Mesh.hxx>
+#include <MeshVS_MeshPrsBuilder.hxx>
+#include <OpenGl_GraphicDriver.hxx>
 #include <TopoDS_Compound.hxx>
 #include <TopoDS_Face.hxx>
 #include <TopoDS_Vertex.hxx>
 #include <TopoDS_Wire.hxx>
+#include <V3d_Viewer.hxx>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iostream>
+#include <sstream>
 #include <string>
+#include <tuple>
+
+#if defined(__GLIBC__)
+#include <errno.h>
+#include <malloc.h>
+
+// Process-wide heap counters, maintained by replacing malloc family over
+// glibc, so that allocations made within OCCT libraries are counted too.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+static std::atomic<long long> g_heapLive(0);
+static std::atomic<long long> g_heapPeak(0);
+
+static void* countAlloc(void* ptr) {
+  if (ptr != nullptr) {
+    const long long live = g_heapLive += malloc_usable_size(ptr);
+    long long peak = g_heapPeak.load();
+    while (live > peak && !g_heapPeak.compare_exchange_weak(peak, live)) {
+    }
+  }
+  return ptr;
+}
+
+extern "C" {
+void* malloc(size_t size) { return countAlloc(__libc_malloc(size)); }
+
+void* calloc(size_t count, size_t size) {
+  return countAlloc(__libc_calloc(count, size));
+}
+
+void* realloc(void* ptr, size_t size) {
+  const size_t oldSize = ptr != nullptr ? malloc_usable_size(ptr) : 0;
+  void* newPtr = __libc_realloc(ptr, size);
+  if (newPtr != nullptr || size == 0) {
+    g_heapLive -= oldSize;
+  }
+  return countAlloc(newPtr);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  return countAlloc(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  *ptr = memalign(alignment, size);
+  return *ptr != nullptr ? 0 : ENOMEM;
+}
+
+void free(void* ptr) {
+  if (ptr != nullptr) {
+    g_heapLive -= malloc_usable_size(ptr);
+  }
+  __libc_free(ptr);
+}
+}
+#endif
 
 void testLoadStl(std::string fileName) {
   std::ifstream ifs;
@@ -64,7 +150,135 @@ void testLoadStl(std::string fileName) {
   return;
 }
 
+void appendFloat(std::string& data, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  for (int i = 0; i < 4; i++) {
+    data.push_back(char((bits >> (i * 8)) & 0xFF));
+  }
+}
+
+//! Generate binary STL of UV sphere with shared nodes.
+std::string makeSphereStl(int nSlices, int nStacks, uint32_t& nFacets) {
+  auto node = [&](int slice, int stack) {
+    if (stack == 0 || stack == nStacks) {
+      return std::make_tuple(0.0f, 0.0f, stack == 0 ? 1.0f : -1.0f);
+    }
+    const double phi = M_PI * stack / nStacks;
+    const double theta = 2.0 * M_PI * (slice % nSlices) / nSlices;
+    return std::make_tuple(float(std::sin(phi) * std::cos(theta)),
+                           float(std::sin(phi) * std::sin(theta)),
+                           float(std::cos(phi)));
+  };
+
+  std::string facets;
+  nFacets = 0;
+  auto addFacet = [&](std::tuple<float, float, float> p1,
+                      std::tuple<float, float, float> p2,
+                      std::tuple<float, float, float> p3) {
+    for (int i = 0; i < 3; i++) {
+      appendFloat(facets, 0.0f);
+    }
+    for (const auto& p : {p1, p2, p3}) {
+      appendFloat(facets, std::get<0>(p));
+      appendFloat(facets, std::get<1>(p));
+      appendFloat(facets, std::get<2>(p));
+    }
+    facets.append(2, '\0');
+    nFacets++;
+  };
+  for (int stack = 0; stack < nStacks; stack++) {
+    for (int slice = 0; slice < nSlices; slice++) {
+      if (stack != 0) {
+        addFacet(node(slice, stack), node(slice, stack + 1),
+                 node(slice + 1, stack));
+      }
+      if (stack != nStacks - 1) {
+        addFacet(node(slice + 1, stack), node(slice, stack + 1),
+                 node(slice + 1, stack + 1));
+      }
+    }
+  }
+
+  std::string data(80, '\0');
+  for (int i = 0; i < 4; i++) {
+    data.push_back(char((nFacets >> (i * 8)) & 0xFF));
+  }
+  return data + facets;
+}
+
+//! Peak heap usage of the whole load path, from reading to the displayed
+//! presentation, should stay close to the size of the result.
+void testPeakMemory() {
+#if defined(__GLIBC__)
+  const int nSlices = 256, nStacks = 128;
+  uint32_t nFacets = 0;
+  std::istringstream is(makeSphereStl(nSlices, nStacks, nFacets));
+  // context without window, as created by the headless viewer
+  Handle(Aspect_DisplayConnection) disp;
+  Handle(OpenGl_GraphicDriver) driver = new OpenGl_GraphicDriver(disp, false);
+  Handle(AIS_InteractiveContext) ctx =
+      new AIS_InteractiveContext(new V3d_Viewer(driver));
+
+  const long long baseline = g_heapLive.load();
+  long long peakSize = 0;
+  // peak of each stage is reported, then reset to the live size
+  auto finishStage = [&](const char* stage) {
+    const long long stagePeak = g_heapPeak.load() - baseline;
+    std::cout << stage << " peak " << stagePeak << " bytes" << std::endl;
+    peakSize = std::max(peakSize, stagePeak);
+    g_heapPeak = g_heapLive.load();
+  };
+  g_heapPeak = baseline;
+
+  Handle(Poly_Triangulation) triangulation;
+  {
+    RWStl_Stream_Reader reader;
+    reader.Read(is);
+    triangulation = reader.GetTriangulation();
+  }
+  finishStage("STL read");
+  assert(!triangulation.IsNull());
+  assert(triangulation->NbTriangles() == (int)nFacets);
+  assert(triangulation->NbNodes() == nSlices * (nStacks - 1) + 2);
+
+  // same setup as ModelFactory::CreateStlMesh()
+  Handle(XSDRAWSTLVRML_DataSource) dataSource =
+      new XSDRAWSTLVRML_DataSource(triangulation);
+  finishStage("data source");
+
+  Handle(MeshVS_Mesh) mesh = new MeshVS_Mesh();
+  mesh->SetDataSource(dataSource);
+  mesh->AddBuilder(new MeshVS_MeshPrsBuilder(mesh), Standard_True);
+  mesh->GetDrawer()->SetBoolean(MeshVS_DA_DisplayNodes, Standard_False);
+  mesh->GetDrawer()->SetBoolean(MeshVS_DA_ShowEdges, Standard_False);
+  mesh->SetMeshSelMethod(MeshVS_MSM_BOX);
+  ctx->Display(mesh, MeshVS_DMF_Shading, 0, false);
+  finishStage("presentation");
+
+  const long long finalSize = g_heapLive.load() - baseline;
+  std::cout << "STL load peak " << peakSize << " bytes, result " << finalSize
+            << " bytes" << std::endl;
+  assert(peakSize * 2 <= finalSize * 3);
+  ctx->Remove(mesh, false);
+#endif
+}
+
 int main() {
+  const char* traceFile = std::getenv("TRACE_FILE");
+  TraceRecorder::set_Enabled(traceFile != nullptr);
+  const char* profileFile = std::getenv("ALLOC_PROFILE_FILE");
+  AllocProfiler::set_Enabled(profileFile != nullptr);
+
   testLoadStl("binary.stl");
   testLoadStl("ascii.stl");
+  testPeakMemory();
+
+  if (traceFile != nullptr) {
+    TraceRecorder::DumpToFile(traceFile);
+  }
+  if (profileFile != nullptr) {
+    AllocProfiler::set_Enabled(false);
+    AllocProfiler::DumpToFile(profileFile);
+  }
 }
\ No newline at end of file
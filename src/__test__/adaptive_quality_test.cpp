@@ -0,0 +1,122 @@
+#include "../adaptive_quality.h"
+
+#include <cassert>
+#include <iostream>
+
+// simulate navigation frames of the given cost per quality level,
+// each requested right after the previous one
+double navigate(AdaptiveQuality& quality, double time, const double* costs,
+                int nbFrames) {
+  for (int i = 0; i < nbFrames; i++) {
+    const double request = time;
+    time += costs[quality.Level()];
+    quality.NavigationFrame(time, request);
+  }
+  return time;
+}
+
+void testDisabled() {
+  AdaptiveQuality quality(16.0);
+  const double costs[] = {100, 100, 100, 100, 100};
+  navigate(quality, 0.0, costs, 50);
+  assert(quality.Level() == 0);
+  assert(quality.IdleDelay(0.0) == 0.0);
+}
+
+void testRaise() {
+  AdaptiveQuality quality(16.0);
+  quality.SetEnabled(true);
+  const double costs[] = {60, 50, 30, 12, 6};
+  double time = navigate(quality, 0.0, costs, 40);
+  // the cheapest level within the target is reached and kept
+  assert(quality.Level() == 3);
+  time = navigate(quality, time, costs, 100);
+  assert(quality.Level() == 3);
+
+  // full quality once navigation stops, the level is kept for the next one
+  quality.NavigationStopped();
+  assert(quality.Level() == 0);
+  quality.NavigationFrame(time + 1000.0 + costs[0], time + 1000.0);
+  assert(quality.Level() == 3);
+
+  quality.Reset();
+  assert(quality.Level() == 0);
+}
+
+void testMaxLevel() {
+  AdaptiveQuality quality(16.0);
+  quality.SetEnabled(true);
+  const double costs[] = {100, 100, 100, 100, 100};
+  navigate(quality, 0.0, costs, 100);
+  assert(quality.Level() == AdaptiveQuality::THE_NB_LEVELS - 1);
+}
+
+void testLowerAfterHoldOff() {
+  AdaptiveQuality quality(16.0);
+  quality.SetEnabled(true);
+  double costs[] = {40, 40, 40, 40, 40};
+  double time = navigate(quality, 0.0, costs, 5);
+  assert(quality.Level() == 1);
+
+  // scene became lighter; the failed level is not retried at once
+  for (int i = 0; i < 5; i++) {
+    costs[i] = 4;
+  }
+  time = navigate(quality, time, costs, 30);
+  assert(quality.Level() == 1);
+  time = navigate(quality, time, costs, 40);
+  assert(quality.Level() == 0);
+}
+
+void testWaitingForInput() {
+  AdaptiveQuality quality(16.0);
+  quality.SetEnabled(true);
+  // cheap frames requested long after the previous one has finished
+  double time = 0.0;
+  for (int i = 0; i < 50; i++) {
+    const double request = time + 40.0;
+    time = request + 5.0;
+    quality.NavigationFrame(time, request);
+  }
+  assert(quality.Level() == 0);
+}
+
+void testIdleDelay() {
+  AdaptiveQuality quality(16.0);
+  quality.SetEnabled(true);
+  assert(quality.IdleDelay(0.0) == 0.0);
+  quality.NavigationFrame(1000.0, 990.0);
+  assert(quality.IdleDelay(1000.0) > 0.0);
+  assert(quality.IdleDelay(1050.0) < quality.IdleDelay(1000.0));
+  assert(quality.IdleDelay(10000.0) == 0.0);
+  quality.NavigationStopped();
+  assert(quality.IdleDelay(1000.0) == 0.0);
+}
+
+void testLevels() {
+  for (int level = 1; level < AdaptiveQuality::THE_NB_LEVELS; level++) {
+    assert(AdaptiveQuality::RenderScale(level) <=
+           AdaptiveQuality::RenderScale(level - 1));
+    assert(AdaptiveQuality::CullingSize(level) >=
+           AdaptiveQuality::CullingSize(level - 1));
+    assert(!AdaptiveQuality::HasMsaa(level));
+  }
+  assert(AdaptiveQuality::RenderScale(0) == 1.0f);
+  assert(AdaptiveQuality::CullingSize(0) == 0.0);
+  assert(AdaptiveQuality::HasMsaa(0));
+  // out of range levels are clamped
+  assert(AdaptiveQuality::RenderScale(100) ==
+         AdaptiveQuality::RenderScale(AdaptiveQuality::THE_NB_LEVELS - 1));
+}
+
+int main() {
+  testDisabled();
+  testRaise();
+  testMaxLevel();
+  testLowerAfterHoldOff();
+  testWaitingForInput();
+  testIdleDelay();
+  testLevels();
+  std::cout << "adaptive quality tests passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include "../alloc_profiler.h"
+#include "../trace_events.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+void testScopes() {
+  AllocProfiler::Clear();
+  AllocProfiler::set_Enabled(true);
+
+  std::unique_ptr<std::vector<char>> kept;
+  {
+    TRACE_SCOPE("outer");
+    kept.reset(new std::vector<char>(100000));
+    {
+      TRACE_SCOPE("inner");
+      std::vector<char> temp(400000);
+    }
+  }
+  AllocProfiler::set_Enabled(false);
+
+  AllocProfiler::ScopeStats outer, inner;
+  assert(AllocProfiler::get_ScopeStats("outer", outer));
+  assert(AllocProfiler::get_ScopeStats("inner", inner));
+  assert(outer.Count == 2 && outer.Bytes >= 100000);
+  assert(outer.Live == outer.Bytes);
+  assert(inner.Count == 1 && inner.Bytes == 400000);
+  assert(inner.Live == 0 && inner.Peak == 400000);
+  assert(AllocProfiler::get_PeakBytes() >= 500000);
+
+  // block allocated within the scope is accounted there when freed outside
+  AllocProfiler::set_Enabled(true);
+  kept.reset();
+  AllocProfiler::set_Enabled(false);
+  assert(AllocProfiler::get_ScopeStats("outer", outer));
+  assert(outer.Live == 0);
+}
+
+void testThreads() {
+  AllocProfiler::Clear();
+  AllocProfiler::set_Enabled(true);
+
+  const size_t nThreads = 4;
+  const size_t nAllocs = 1000;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nThreads; i++) {
+    threads.emplace_back([=]() {
+      TRACE_SCOPE("worker");
+      std::vector<std::unique_ptr<int>> values;
+      values.reserve(nAllocs);
+      for (size_t j = 0; j < nAllocs; j++) {
+        values.emplace_back(new int((int)j));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  AllocProfiler::set_Enabled(false);
+
+  AllocProfiler::ScopeStats worker;
+  assert(AllocProfiler::get_ScopeStats("worker", worker));
+  assert(worker.Count == nThreads * (nAllocs + 1));
+  assert(worker.Live == 0);
+}
+
+int main() {
+  assert(AllocProfiler::IsAvailable());
+  testScopes();
+  testThreads();
+
+  const std::string json = AllocProfiler::ToJson();
+  assert(json.find("\"name\":\"worker\"") != std::string::npos);
+  std::cout << json << std::endl;
+  if (const char* profileFile = std::getenv("ALLOC_PROFILE_FILE")) {
+    assert(AllocProfiler::DumpToFile(profileFile));
+  }
+}
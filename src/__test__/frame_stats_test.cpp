@@ -0,0 +1,84 @@
+#include "../frame_stats.h"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+
+void testPercentiles() {
+  SampleRing ring(100);
+  assert(ring.Size() == 0);
+  assert(ring.Percentile(50) == 0.0 && ring.Mean() == 0.0);
+  assert(ring.Max() == 0.0);
+
+  // added in reverse order, percentiles should not depend on it
+  for (int i = 100; i >= 1; i--) {
+    ring.Add(i);
+  }
+  assert(ring.Size() == 100);
+  assert(ring.Percentile(0) == 1.0);
+  assert(ring.Percentile(50) == 50.0);
+  assert(ring.Percentile(90) == 90.0);
+  assert(ring.Percentile(99) == 99.0);
+  assert(ring.Percentile(100) == 100.0);
+  assert(ring.Max() == 100.0);
+  assert(ring.Mean() == 50.5);
+
+  // nearest rank of a small set
+  SampleRing small(8);
+  small.Add(3);
+  small.Add(1);
+  small.Add(2);
+  assert(small.Percentile(50) == 2.0);
+  assert(small.Percentile(34) == 2.0);
+  assert(small.Percentile(33) == 1.0);
+  assert(small.Percentile(99) == 3.0);
+
+  ring.Clear();
+  assert(ring.Size() == 0 && ring.Percentile(50) == 0.0);
+}
+
+void testOverwrite() {
+  SampleRing ring(4);
+  for (int i = 1; i <= 10; i++) {
+    ring.Add(i);
+  }
+  // only the last 4 samples are kept
+  assert(ring.Size() == 4);
+  assert(ring.Percentile(0) == 7.0);
+  assert(ring.Max() == 10.0);
+  assert(ring.Mean() == 8.5);
+}
+
+void testFrameStats() {
+  FrameStats stats;
+  stats.InputEvent(0.0);
+  stats.InputEvent(1.0);  // coalesced into the same frame
+  stats.UpdateRequested();
+  stats.UpdateRequested();
+  stats.TickStarted(5.0);
+  stats.RenderStarted(6.0);
+  stats.FrameFinished(15.0, 100, 2, false);
+  stats.TickStarted(20.0);
+  stats.RenderStarted(21.0);
+  stats.FrameFinished(30.0, 100, 2, true);
+
+  const std::string json = stats.ToJson();
+  assert(json.find("\"requests\":2,\"ticks\":2,\"frames\":2,\"inputs\":2") !=
+         std::string::npos);
+  // latency is measured from the first input to the first frame
+  assert(json.find("\"latency\":{\"count\":1,\"mean\":15") !=
+         std::string::npos);
+  assert(json.find("\"framesPerBurst\":{\"count\":1,\"mean\":2") !=
+         std::string::npos);
+
+  stats.Reset();
+  assert(stats.ToJson().find("\"frames\":0") != std::string::npos);
+}
+
+int main() {
+  testPercentiles();
+  testOverwrite();
+  testFrameStats();
+  std::cout << "frame stats tests passed" << std::endl;
+  return 0;
+}
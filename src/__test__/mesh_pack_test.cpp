@@ -0,0 +1,96 @@
+#include "../mesh_pack.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../stl_file.h"
+
+void testNormals() {
+  const float normals[][3] = {{0, 0, 1},   {0, 0, -1}, {1, 0, 0},
+                              {0, -1, 0},  {0.6f, 0, -0.8f},
+                              {0.48f, -0.6f, 0.64f}};
+  for (const float* normal : normals) {
+    int16_t oct[2];
+    float decoded[3];
+    MeshPack::EncodeNormal(normal, oct);
+    MeshPack::DecodeNormal(oct, decoded);
+    for (int axis = 0; axis < 3; axis++) {
+      assert(std::fabs(decoded[axis] - normal[axis]) < 1e-3f);
+    }
+  }
+}
+
+void testRoundTrip(std::string fileName) {
+  std::ifstream ifs;
+  ifs.open(fileName, std::ios_base::binary);
+  StlFile stlFile;
+  assert(stlFile.LoadFromStream(ifs));
+  ifs.close();
+
+  std::vector<float> vertexes;
+  std::vector<unsigned int> indexes;
+  stlFile.ToIndexedData(vertexes, indexes);
+  std::vector<float> normals;
+  MeshPackWriter::ComputeNormals(vertexes, indexes, normals);
+
+  std::ostringstream os;
+  assert(MeshPackWriter::Write(os, vertexes.data(), vertexes.size() / 3,
+                               normals.data(), indexes.data(),
+                               indexes.size() / 3));
+  // aligned copy, like a buffer returned by malloc or mmap
+  const std::string packed = os.str();
+  std::vector<uint64_t> buffer(packed.size() / 8 + 1);
+  memcpy(buffer.data(), packed.data(), packed.size());
+  const char* data = reinterpret_cast<const char*>(buffer.data());
+
+  MeshPackReader reader;
+  assert(reader.Open(data, packed.size()));
+  assert(reader.get_VertexCount() == vertexes.size() / 3);
+  assert(reader.get_TriangleCount() == indexes.size() / 3);
+  assert(reader.HasNormals());
+
+  std::vector<unsigned int> decodedIndexes(indexes.size());
+  assert(reader.DecodeIndexes(decodedIndexes.data()));
+  assert(decodedIndexes == indexes);
+
+  // positions are within half of the quantization step
+  std::vector<float> decodedVertexes(vertexes.size());
+  reader.DecodePositions(decodedVertexes.data());
+  for (size_t i = 0; i < vertexes.size(); i++) {
+    const float step = reader.get_Scale()[i % 3];
+    assert(std::fabs(decodedVertexes[i] - vertexes[i]) <= step * 0.5f + 1e-5f);
+  }
+
+  // interleaved buffer
+  std::vector<float> interleaved(vertexes.size() * 2);
+  reader.DecodePositions(interleaved.data(), 6);
+  reader.DecodeNormals(interleaved.data() + 3, 6);
+  assert(interleaved[0] == decodedVertexes[0]);
+  assert(std::fabs(interleaved[3] - normals[0]) < 1e-3f);
+
+  // truncated data is rejected rather than read out of bounds
+  assert(!reader.Open(data, packed.size() - 1) ||
+         !reader.DecodeIndexes(decodedIndexes.data()));
+  assert(!reader.Open(data, 16));
+
+  std::ostringstream stlOs;
+  assert(MeshPackWriter::Write(stlOs, stlFile));
+  assert(reader.Open(data, packed.size()));
+  std::cout << fileName << ": " << stlFile.get_TriangleCount()
+            << " facets, " << stlFile.get_TriangleCount() * 50 + 84
+            << " bytes as STL, " << stlOs.str().size()
+            << " bytes as mesh pack" << std::endl;
+}
+
+int main() {
+  testNormals();
+  testRoundTrip("binary.stl");
+  testRoundTrip("ascii.stl");
+  return 0;
+}
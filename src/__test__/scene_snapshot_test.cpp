@@ -0,0 +1,203 @@
+#include "../scene_snapshot.h"
+
+#include <AIS_ConnectedInteractive.hxx>
+#include <AIS_Shape.hxx>
+#include <Aspect_DisplayConnection.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRep_Tool.hxx>
+#include <MeshVS_Mesh.hxx>
+#include <OpenGl_GraphicDriver.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <V3d_Viewer.hxx>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../XSDRAWSTLVRML_DataSource.h"
+#include "../geometry_registry.h"
+#include "../model_factory.h"
+
+//! Context without window, as created by the headless viewer.
+static Handle(AIS_InteractiveContext) createContext() {
+  Handle(Aspect_DisplayConnection) disp;
+  Handle(OpenGl_GraphicDriver) driver = new OpenGl_GraphicDriver(disp, false);
+  Handle(V3d_Viewer) viewer = new V3d_Viewer(driver);
+  return new AIS_InteractiveContext(viewer);
+}
+
+//! Scene of a meshed box, its instance and a hidden tetrahedron mesh.
+static void createScene(const Handle(AIS_InteractiveContext)& ctx,
+                        SceneObjectMap& objects) {
+  ModelFactory* factory = ModelFactory::GetInstance();
+  TopoDS_Shape box = BRepPrimAPI_MakeBox(10.0, 20.0, 30.0).Shape();
+  factory->Triangulate(box, factory->MeshParams());
+  Handle(AIS_InteractiveObject) boxPrs = factory->CreateMeshedShape(box);
+
+  gp_Trsf trsf;
+  trsf.SetTranslation(gp_Vec(100.0, 0.0, 0.0));
+  Handle(AIS_InteractiveObject) instance =
+      GeometryRegistry::Instantiate(boxPrs, trsf);
+
+  const std::vector<float> vertexes = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                                       0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  const std::vector<unsigned int> indexes = {0, 2, 1, 0, 1, 3,
+                                             0, 3, 2, 1, 2, 3};
+  Handle(AIS_InteractiveObject) mesh =
+      factory->CreateStlMesh(factory->MakeTriangulation(vertexes, indexes));
+
+  objects.Add("box", boxPrs);
+  objects.Add("instance", instance);
+  objects.Add("mesh", mesh);
+  ctx->Display(boxPrs, AIS_Shaded, 0, false);
+  ctx->Display(instance, AIS_Shaded, 0, false);
+  ctx->Display(mesh, mesh->DisplayMode(), 0, false);
+  ctx->Erase(mesh, false);
+}
+
+static std::string writeScene(const SceneObjectMap& objects,
+                              const Handle(AIS_InteractiveContext)& ctx,
+                              const Handle(Graphic3d_Camera)& camera) {
+  std::ostringstream stream;
+  bool isOk = SceneSnapshot::Write(stream, objects, ctx, camera);
+  assert(isOk);
+  return stream.str();
+}
+
+static int nbTriangles(const TopoDS_Shape& shape) {
+  int nbTriangles = 0;
+  for (TopExp_Explorer faceExp(shape, TopAbs_FACE); faceExp.More();
+       faceExp.Next()) {
+    TopLoc_Location loc;
+    const Handle(Poly_Triangulation)& triangulation =
+        BRep_Tool::Triangulation(TopoDS::Face(faceExp.Current()), loc);
+    assert(!triangulation.IsNull());
+    nbTriangles += triangulation->NbTriangles();
+  }
+  return nbTriangles;
+}
+
+void testRoundTrip() {
+  Handle(AIS_InteractiveContext) ctx = createContext();
+  SceneObjectMap objects;
+  createScene(ctx, objects);
+  Handle(Graphic3d_Camera) camera = new Graphic3d_Camera();
+  camera->SetEyeAndCenter(gp_Pnt(50.0, -200.0, 80.0),
+                          gp_Pnt(50.0, 10.0, 15.0));
+  camera->SetScale(42.0);
+
+  const std::string data = writeScene(objects, ctx, camera);
+  assert(SceneSnapshot::IsSnapshot(data.data(), data.size()));
+
+  SceneSnapshot snapshot;
+  bool isOk = snapshot.Read(data.data(), data.size());
+  assert(isOk);
+  const std::vector<SceneSnapshot::Object>& restored = snapshot.Objects();
+  assert(restored.size() == 3);
+  assert(restored[0].Name == "box" && restored[0].IsVisible);
+  assert(restored[1].Name == "instance" && restored[1].IsVisible);
+  assert(restored[2].Name == "mesh" && !restored[2].IsVisible);
+  assert(restored[0].DisplayMode == AIS_Shaded);
+
+  // shared master is restored once and keeps its triangulation
+  Handle(AIS_Shape) boxPrs = Handle(AIS_Shape)::DownCast(restored[0].Prs);
+  assert(!boxPrs.IsNull());
+  const Handle(AIS_Shape) origBox =
+      Handle(AIS_Shape)::DownCast(objects.FindFromKey("box"));
+  assert(nbTriangles(boxPrs->Shape()) == nbTriangles(origBox->Shape()));
+  Handle(AIS_ConnectedInteractive) instance =
+      Handle(AIS_ConnectedInteractive)::DownCast(restored[1].Prs);
+  assert(!instance.IsNull() && instance->ConnectedTo() == boxPrs);
+  assert(instance->LocalTransformation().TranslationPart().IsEqual(
+      gp_XYZ(100.0, 0.0, 0.0), 1.0e-12));
+
+  Handle(MeshVS_Mesh) mesh = Handle(MeshVS_Mesh)::DownCast(restored[2].Prs);
+  assert(!mesh.IsNull());
+  Handle(XSDRAWSTLVRML_DataSource) dataSource =
+      Handle(XSDRAWSTLVRML_DataSource)::DownCast(mesh->GetDataSource());
+  assert(!dataSource.IsNull());
+  assert(dataSource->Triangulation()->NbNodes() == 4);
+  assert(dataSource->Triangulation()->NbTriangles() == 4);
+
+  Handle(Graphic3d_Camera) restoredCamera = new Graphic3d_Camera();
+  snapshot.RestoreCamera(restoredCamera);
+  assert(restoredCamera->Eye().IsEqual(camera->Eye(), 1.0e-9));
+  assert(restoredCamera->Center().IsEqual(camera->Center(), 1.0e-9));
+  assert(std::abs(restoredCamera->Scale() - 42.0) < 1.0e-9);
+}
+
+void testRestoreAspect() {
+  Handle(AIS_InteractiveContext) ctx = createContext();
+  SceneObjectMap objects;
+  createScene(ctx, objects);
+  Handle(Graphic3d_Camera) camera = new Graphic3d_Camera();
+  camera->SetProjectionType(Graphic3d_Camera::Projection_Perspective);
+  camera->SetEyeAndCenter(gp_Pnt(50.0, -200.0, 80.0),
+                          gp_Pnt(50.0, 10.0, 15.0));
+  const std::string data = writeScene(objects, ctx, camera);
+
+  SceneSnapshot snapshot;
+  bool isOk = snapshot.Read(data.data(), data.size());
+  assert(isOk);
+
+  // camera of non-square view keeps its aspect and Z range
+  Handle(Graphic3d_Camera) viewCamera = new Graphic3d_Camera();
+  viewCamera->SetAspect(16.0 / 9.0);
+  viewCamera->SetZRange(0.5, 5000.0);
+  snapshot.RestoreCamera(viewCamera);
+  assert(std::abs(viewCamera->Aspect() - 16.0 / 9.0) < 1.0e-12);
+  assert(std::abs(viewCamera->ZNear() - 0.5) < 1.0e-12);
+  assert(std::abs(viewCamera->ZFar() - 5000.0) < 1.0e-12);
+  assert(viewCamera->ProjectionType() ==
+         Graphic3d_Camera::Projection_Perspective);
+  assert(viewCamera->Eye().IsEqual(camera->Eye(), 1.0e-9));
+  assert(viewCamera->Center().IsEqual(camera->Center(), 1.0e-9));
+  assert(std::abs(viewCamera->FOVy() - camera->FOVy()) < 1.0e-9);
+}
+
+void testCorrupted() {
+  Handle(AIS_InteractiveContext) ctx = createContext();
+  SceneObjectMap objects;
+  createScene(ctx, objects);
+  const std::string data = writeScene(objects, ctx, new Graphic3d_Camera());
+
+  // truncated data is rejected whatever table or section it ends in
+  for (size_t len = 0; len < data.size(); len += 7) {
+    SceneSnapshot snapshot;
+    assert(!snapshot.Read(data.data(), len));
+  }
+
+  std::string badMagic = data;
+  badMagic[0] ^= 0x55;
+  assert(!SceneSnapshot::IsSnapshot(badMagic.data(), badMagic.size()));
+  SceneSnapshot snapshot;
+  assert(!snapshot.Read(badMagic.data(), badMagic.size()));
+
+  // placement count follows name, kind, visibility and display mode
+  const size_t namePos = data.find("box");
+  assert(namePos != std::string::npos);
+  const size_t countPos = namePos + 3 + 2 + sizeof(int32_t);
+  uint32_t nbPlacements = 0;
+  memcpy(&nbPlacements, data.data() + countPos, sizeof(nbPlacements));
+  assert(nbPlacements == 1);
+
+  std::string noPlacements = data;
+  nbPlacements = 0;
+  memcpy(&noPlacements[countPos], &nbPlacements, sizeof(nbPlacements));
+  assert(!snapshot.Read(noPlacements.data(), noPlacements.size()));
+
+  std::string badGeometry = data;
+  const uint32_t geomIndex = 1000;
+  memcpy(&badGeometry[countPos + sizeof(uint32_t)], &geomIndex,
+         sizeof(geomIndex));
+  assert(!snapshot.Read(badGeometry.data(), badGeometry.size()));
+}
+
+int main() {
+  testRoundTrip();
+  testRestoreAspect();
+  testCorrupted();
+}
@@ -0,0 +1,433 @@
+// Microbenchmarks of STL parsing, welding, edge extraction, normal
+// computation and mesh data source construction on procedurally generated
+// models.
+//
+// Usage: stl_bench [--sizes 10000,100000,1000000] [--threads 1,2,4,8]
+//                  [--repeat 3] [--out dir]
+// Models of each size are generated in memory as binary and ASCII STL
+// (and written into --out directory if given, e.g. for occt_demo_cli).
+// For each benchmark the best of --repeat runs is reported as triangles/s,
+// MB/s of input data and peak RSS; parsers are also run concurrently on
+// several threads, one model copy per thread, to show scaling.
+
+#include <Standard_ArrayStreamBuffer.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "../RWStl_Stream_Reader.h"
+#include "../XSDRAWSTLVRML_DataSource.h"
+#include "../help_algorithms.h"
+#include "../mesh_pack.h"
+#include "../stl_file.h"
+
+namespace {
+
+typedef std::function<void(const float*, const float*, const float*)>
+    FacetCallback;
+
+//! Procedural model emitting facets with outward orientation.
+struct Generator {
+  const char* Name;
+  //! Emit about count facets, return exact number of facets.
+  std::function<size_t(size_t count, const FacetCallback& facet)> Emit;
+};
+
+//! UV sphere of unit radius.
+size_t emitSphere(size_t count, const FacetCallback& facet) {
+  const int nStacks = std::max(2, int(std::sqrt(count / 4.0)));
+  const int nSlices = nStacks * 2;
+  auto node = [&](int slice, int stack, float* xyz) {
+    if (stack == 0 || stack == nStacks) {
+      // single node at each pole
+      xyz[0] = 0.0f;
+      xyz[1] = 0.0f;
+      xyz[2] = stack == 0 ? 1.0f : -1.0f;
+      return;
+    }
+    const double phi = M_PI * stack / nStacks;
+    const double theta = 2.0 * M_PI * (slice % nSlices) / nSlices;
+    xyz[0] = float(std::sin(phi) * std::cos(theta));
+    xyz[1] = float(std::sin(phi) * std::sin(theta));
+    xyz[2] = float(std::cos(phi));
+  };
+
+  size_t nFacets = 0;
+  float p[4][3];
+  for (int stack = 0; stack < nStacks; stack++) {
+    for (int slice = 0; slice < nSlices; slice++) {
+      node(slice, stack, p[0]);
+      node(slice, stack + 1, p[1]);
+      node(slice + 1, stack, p[2]);
+      node(slice + 1, stack + 1, p[3]);
+      if (stack != 0) {
+        facet(p[0], p[1], p[2]);
+        nFacets++;
+      }
+      if (stack != nStacks - 1) {
+        facet(p[2], p[1], p[3]);
+        nFacets++;
+      }
+    }
+  }
+  return nFacets;
+}
+
+//! Height field over a regular grid with several octaves of waves.
+size_t emitTerrain(size_t count, const FacetCallback& facet) {
+  const int nCells = std::max(1, int(std::sqrt(count / 2.0)));
+  auto node = [&](int i, int j, float* xyz) {
+    const double x = double(i) / nCells, y = double(j) / nCells;
+    double z = 0.0;
+    for (int octave = 1; octave <= 4; octave++) {
+      z += std::sin(x * 7.0 * octave + octave) *
+           std::cos(y * 5.0 * octave - octave) / (octave * 8.0);
+    }
+    xyz[0] = float(x);
+    xyz[1] = float(y);
+    xyz[2] = float(z);
+  };
+
+  float p[4][3];
+  for (int j = 0; j < nCells; j++) {
+    for (int i = 0; i < nCells; i++) {
+      node(i, j, p[0]);
+      node(i + 1, j, p[1]);
+      node(i, j + 1, p[2]);
+      node(i + 1, j + 1, p[3]);
+      facet(p[0], p[1], p[2]);
+      facet(p[2], p[1], p[3]);
+    }
+  }
+  return size_t(nCells) * nCells * 2;
+}
+
+//! Many separate tetrahedral shells scattered within unit cube.
+size_t emitDebris(size_t count, const FacetCallback& facet) {
+  const size_t nShells = std::max<size_t>(1, count / 4);
+  uint32_t seed = 12345;
+  auto random = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return float(seed >> 8) / float(1 << 24);
+  };
+
+  const float size = 0.5f / std::cbrt(float(nShells));
+  float p[4][3];
+  for (size_t shell = 0; shell < nShells; shell++) {
+    const float center[3] = {random(), random(), random()};
+    const float corners[4][3] = {
+        {1, 1, 1}, {1, -1, -1}, {-1, 1, -1}, {-1, -1, 1}};
+    for (int corner = 0; corner < 4; corner++) {
+      for (int axis = 0; axis < 3; axis++) {
+        p[corner][axis] = center[axis] + corners[corner][axis] * size *
+                                             (0.5f + random());
+      }
+    }
+    facet(p[0], p[1], p[2]);
+    facet(p[0], p[3], p[1]);
+    facet(p[0], p[2], p[3]);
+    facet(p[1], p[3], p[2]);
+  }
+  return nShells * 4;
+}
+
+//! Compute unit normal of the facet.
+void facetNormal(const float* p1, const float* p2, const float* p3,
+                 float* normal) {
+  const float u[3] = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]};
+  const float v[3] = {p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2]};
+  normal[0] = u[1] * v[2] - u[2] * v[1];
+  normal[1] = u[2] * v[0] - u[0] * v[2];
+  normal[2] = u[0] * v[1] - u[1] * v[0];
+  const float length = std::sqrt(normal[0] * normal[0] +
+                                 normal[1] * normal[1] +
+                                 normal[2] * normal[2]);
+  for (int axis = 0; axis < 3 && length > 0.0f; axis++) {
+    normal[axis] /= length;
+  }
+}
+
+//! Generate binary STL.
+std::string makeBinaryStl(const Generator& generator, size_t count) {
+  std::string data(84, '\0');
+  const size_t nFacets = generator.Emit(
+      count, [&data](const float* p1, const float* p2, const float* p3) {
+        float record[12];
+        facetNormal(p1, p2, p3, record);
+        memcpy(record + 3, p1, 12);
+        memcpy(record + 6, p2, 12);
+        memcpy(record + 9, p3, 12);
+        data.append(reinterpret_cast<const char*>(record), sizeof(record));
+        data.append(2, '\0');
+      });
+  const uint32_t nFacets32 = uint32_t(nFacets);
+  memcpy(&data[80], &nFacets32, 4);
+  return data;
+}
+
+//! Generate ASCII STL.
+std::string makeAsciiStl(const Generator& generator, size_t count) {
+  std::string data = std::string("solid ") + generator.Name + "\n";
+  char line[128];
+  generator.Emit(count, [&](const float* p1, const float* p2,
+                            const float* p3) {
+    float normal[3];
+    facetNormal(p1, p2, p3, normal);
+    snprintf(line, sizeof(line), " facet normal %g %g %g\n  outer loop\n",
+             normal[0], normal[1], normal[2]);
+    data += line;
+    for (const float* p : {p1, p2, p3}) {
+      snprintf(line, sizeof(line), "   vertex %.7g %.7g %.7g\n", p[0], p[1],
+               p[2]);
+      data += line;
+    }
+    data += "  endloop\n endfacet\n";
+  });
+  data += std::string("endsolid ") + generator.Name + "\n";
+  return data;
+}
+
+//! Reset peak resident set size of the process (Linux only).
+void resetPeakRss() {
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+}
+
+//! Return peak resident set size in MiB since the last reset.
+double peakRssMb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::atof(line.c_str() + 6) / 1024.0;
+    }
+  }
+  return 0.0;
+}
+
+//! Return time of the function in seconds, the best of several runs.
+double bestTime(int repeat, const std::function<void()>& func) {
+  double best = 1e300;
+  for (int run = 0; run < repeat; run++) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+//! Print benchmark line.
+void report(const std::string& name, size_t nFacets, size_t nBytes,
+            double seconds) {
+  char line[256];
+  snprintf(line, sizeof(line),
+           "  %-30s %10.3f ms %10.2f Mtri/s %9.1f MB/s  peak RSS %8.1f MB\n",
+           name.c_str(), seconds * 1000.0, nFacets / seconds / 1e6,
+           nBytes / seconds / 1048576.0, peakRssMb());
+  std::cout << line;
+}
+
+//! Parse STL with StlFile.
+void parseStlFile(const std::string& data, StlFile& stlFile) {
+  Standard_ArrayStreamBuffer buffer(data.data(), data.size());
+  std::istream is(&buffer);
+  if (!stlFile.LoadFromStream(is)) {
+    std::cerr << "StlFile::LoadFromStream failed" << std::endl;
+    std::exit(1);
+  }
+}
+
+//! Parse STL with RWStl_Stream_Reader.
+Handle(Poly_Triangulation) parseRWStl(const std::string& data) {
+  Standard_ArrayStreamBuffer buffer(data.data(), data.size());
+  std::istream is(&buffer);
+  RWStl_Stream_Reader reader;
+  if (!reader.Read(is)) {
+    std::cerr << "RWStl_Stream_Reader::Read failed" << std::endl;
+    std::exit(1);
+  }
+  return reader.GetTriangulation();
+}
+
+//! Run parser concurrently on each thread and report aggregate throughput.
+void benchScaling(const std::string& name, const std::string& data,
+                  size_t nFacets, const std::vector<int>& threadCounts,
+                  int repeat,
+                  const std::function<void(const std::string&)>& parse) {
+  double singleRate = 0.0;
+  for (int nThreads : threadCounts) {
+    resetPeakRss();
+    const double seconds = bestTime(repeat, [&]() {
+      std::vector<std::thread> threads;
+      for (int thread = 0; thread < nThreads; thread++) {
+        threads.emplace_back([&]() { parse(data); });
+      }
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+    });
+    const double rate = nFacets * nThreads / seconds;
+    if (singleRate == 0.0) {
+      singleRate = rate / nThreads;
+    }
+    char line[256];
+    snprintf(line, sizeof(line),
+             "  %-20s x%-3d threads %10.2f Mtri/s  speedup %5.2f  "
+             "peak RSS %8.1f MB\n",
+             name.c_str(), nThreads, rate / 1e6, rate / singleRate,
+             peakRssMb());
+    std::cout << line;
+  }
+}
+
+//! Parse comma-separated list of numbers.
+template <typename T>
+std::vector<T> parseList(const char* list) {
+  std::vector<T> values;
+  std::istringstream is(list);
+  std::string item;
+  while (std::getline(is, item, ',')) {
+    values.push_back(T(std::atof(item.c_str())));
+  }
+  return values;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<size_t> sizes = {10000, 100000, 1000000};
+  std::vector<int> threadCounts = {1, 2, 4,
+                                   int(std::thread::hardware_concurrency())};
+  int repeat = 3;
+  std::string outDir;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    if (arg == "--sizes") {
+      sizes = parseList<size_t>(argv[i + 1]);
+    } else if (arg == "--threads") {
+      threadCounts = parseList<int>(argv[i + 1]);
+    } else if (arg == "--repeat") {
+      repeat = std::max(1, std::atoi(argv[i + 1]));
+    } else if (arg == "--out") {
+      outDir = argv[i + 1];
+    }
+  }
+  threadCounts.erase(std::remove_if(threadCounts.begin(), threadCounts.end(),
+                                    [](int count) { return count < 1; }),
+                     threadCounts.end());
+  std::sort(threadCounts.begin(), threadCounts.end());
+  threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()),
+                     threadCounts.end());
+
+  const Generator generators[] = {{"sphere", emitSphere},
+                                  {"terrain", emitTerrain},
+                                  {"debris", emitDebris}};
+  for (const Generator& generator : generators) {
+    for (size_t size : sizes) {
+      for (bool isBinary : {true, false}) {
+        const std::string data = isBinary ? makeBinaryStl(generator, size)
+                                          : makeAsciiStl(generator, size);
+        const std::string label = std::string(generator.Name) + "-" +
+                                  std::to_string(size) +
+                                  (isBinary ? "-binary" : "-ascii");
+        if (!outDir.empty()) {
+          std::ofstream(outDir + "/" + label + ".stl", std::ios::binary)
+              << data;
+        }
+
+        StlFile stlFile;
+        parseStlFile(data, stlFile);
+        const size_t nFacets = stlFile.get_TriangleCount();
+        std::cout << label << ": " << nFacets << " triangles, "
+                  << data.size() / 1048576.0 << " MB" << std::endl;
+
+        resetPeakRss();
+        report("StlFile::LoadFromStream", nFacets, data.size(),
+               bestTime(repeat, [&]() {
+                 StlFile file;
+                 parseStlFile(data, file);
+               }));
+
+        resetPeakRss();
+        Handle(Poly_Triangulation) triangulation;
+        report("RWStl_Stream_Reader::Read", nFacets, data.size(),
+               bestTime(repeat, [&]() { triangulation = parseRWStl(data); }));
+
+        std::vector<float> vertexes;
+        std::vector<unsigned int> indexes;
+        resetPeakRss();
+        report("StlFile::ToIndexedData", nFacets,
+               nFacets * sizeof(Triangle3D<float>), bestTime(repeat, [&]() {
+                 vertexes.clear();
+                 indexes.clear();
+                 stlFile.ToIndexedData(vertexes, indexes);
+               }));
+
+        // file_edges() expects no degenerated triangles
+        std::vector<unsigned int> validIndexes;
+        for (size_t tri = 0; tri + 2 < indexes.size(); tri += 3) {
+          if (indexes[tri] != indexes[tri + 1] &&
+              indexes[tri + 1] != indexes[tri + 2] &&
+              indexes[tri] != indexes[tri + 2]) {
+            validIndexes.insert(validIndexes.end(), &indexes[tri],
+                                &indexes[tri] + 3);
+          }
+        }
+        resetPeakRss();
+        report("file_edges", validIndexes.size() / 3,
+               validIndexes.size() * sizeof(unsigned int),
+               bestTime(repeat, [&]() {
+                 std::vector<std::tuple<unsigned int, unsigned int>> edges;
+                 std::vector<
+                     std::tuple<unsigned int, unsigned int, unsigned int>>
+                     triangles;
+                 file_edges(validIndexes, edges, triangles);
+               }));
+
+        // smooth normals of the welded mesh, as written into mesh packs
+        resetPeakRss();
+        report("MeshPackWriter::ComputeNormals", indexes.size() / 3,
+               vertexes.size() * sizeof(float) +
+                   indexes.size() * sizeof(unsigned int),
+               bestTime(repeat, [&]() {
+                 std::vector<float> normals;
+                 MeshPackWriter::ComputeNormals(vertexes, indexes, normals);
+               }));
+
+        resetPeakRss();
+        report("XSDRAWSTLVRML_DataSource", nFacets,
+               vertexes.size() * sizeof(float) +
+                   indexes.size() * sizeof(unsigned int),
+               bestTime(repeat, [&]() {
+                 Handle(XSDRAWSTLVRML_DataSource) dataSource =
+                     new XSDRAWSTLVRML_DataSource(triangulation);
+               }));
+
+        benchScaling("StlFile", data, nFacets, threadCounts, repeat,
+                     [](const std::string& input) {
+                       StlFile file;
+                       parseStlFile(input, file);
+                     });
+        benchScaling("RWStl_Stream_Reader", data, nFacets, threadCounts,
+                     repeat,
+                     [](const std::string& input) { parseRWStl(input); });
+      }
+    }
+  }
+  return 0;
+}
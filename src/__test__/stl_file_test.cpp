@@ -5,6 +5,7 @@
 
 #include "../help_algorithms.h"
 #include "../membuf.h"
+#include "../trace_events.h"
 
 void testLoadStl(std::string fileName) {
   std::ifstream ifs;
@@ -29,7 +30,7 @@ void testLoadStl(std::string fileName) {
   std::vector<std::tuple<unsigned int, unsigned int>> edges;
   std::vector<std::tuple<unsigned int, unsigned int, unsigned int>> triangles;
 
-  findEdges(indexes, edges, triangles);
+  file_edges(indexes, edges, triangles);
 
   std::cout << "Edges Number: " << edges.size() << std::endl;
 
@@ -37,6 +38,13 @@ void testLoadStl(std::string fileName) {
 }
 
 int main() {
+  const char* traceFile = std::getenv("TRACE_FILE");
+  TraceRecorder::set_Enabled(traceFile != nullptr);
+
   testLoadStl("ascii.stl");
   testLoadStl("binary.stl");
+
+  if (traceFile != nullptr) {
+    TraceRecorder::DumpToFile(traceFile);
+  }
 }
\ No newline at end of file
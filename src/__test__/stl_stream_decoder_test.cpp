@@ -0,0 +1,160 @@
+#include "../stl_stream_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory_resource>
+
+#include "../chunk_source.h"
+#include "../trace_events.h"
+
+//! File source hiding its total size, like a download without Content-Length.
+class UnsizedFileChunkSource : public FileChunkSource {
+ public:
+  UnsizedFileChunkSource(const std::string& fileName, size_t chunkSize)
+      : FileChunkSource(fileName, chunkSize) {}
+
+  size_t get_TotalSize() const override { return 0; }
+};
+
+void testDecodeStl(std::string fileName, ChunkSource& source,
+                   size_t chunkSize) {
+  std::ifstream ifs;
+  ifs.open(fileName, std::ios_base::binary);
+  StlFile stlFile;
+  stlFile.LoadFromStream(ifs);
+  ifs.close();
+
+  size_t nCallbacks = 0;
+  size_t nPrevCount = 0;
+  StlStreamDecoder decoder(10, [&](StlStreamDecoder& theDecoder) {
+    // every callback reports the facets decoded since the previous one
+    assert(theDecoder.get_NotifiedCount() == nPrevCount);
+    nPrevCount = theDecoder.get_TriangleCount();
+    nCallbacks++;
+  });
+
+  bool isOk = DecodeStlChunks(source, decoder, chunkSize);
+  assert(isOk);
+  assert(decoder.IsFinished());
+  assert(decoder.get_TriangleCount() == stlFile.get_TriangleCount());
+  assert(nCallbacks > 0 && nPrevCount == decoder.get_TriangleCount());
+
+  for (size_t i = 0; i < decoder.get_TriangleCount(); i++) {
+    auto& expected = stlFile.get_Triangle(i);
+    auto& actual = decoder.get_Facets()[i];
+    for (size_t j = 0; j < 3; j++) {
+      assert(memcmp(expected.Vertexes[j].Coords, actual.Vertexes[j].Coords,
+                    sizeof(float) * 3) == 0);
+    }
+  }
+
+  std::cout << "decoded file " << fileName << " by " << chunkSize
+            << " bytes chunks: " << decoder.get_TriangleCount()
+            << " facets, " << nCallbacks << " updates" << std::endl;
+}
+
+void testDecodeStl(std::string fileName) {
+  const size_t chunkSizes[] = {1, 7, 50, 4096};
+  for (size_t chunkSize : chunkSizes) {
+    FileChunkSource source(fileName, chunkSize);
+    testDecodeStl(fileName, source, chunkSize);
+
+    UnsizedFileChunkSource unsizedSource(fileName, chunkSize);
+    testDecodeStl(fileName, unsizedSource, chunkSize);
+  }
+}
+
+void testTruncatedStl(std::string fileName) {
+  std::ifstream ifs;
+  ifs.open(fileName, std::ios_base::binary);
+  std::string data((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  ifs.close();
+
+  StlStreamDecoder decoder;
+  decoder.set_ExpectedSize(data.size());
+  decoder.Feed(data.data(), data.size() - 20);
+  assert(!decoder.Finish());
+}
+
+//! Bytes after the declared facets are ignored, like by RWStl_Stream_Reader.
+void testTrailingData(std::string fileName) {
+  std::ifstream ifs;
+  ifs.open(fileName, std::ios_base::binary);
+  std::string data((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  ifs.close();
+  unsigned int nFacets = 0;
+  memcpy(&nFacets, &data[80], 4);
+  data.append(123, '\x7f');
+
+  const size_t chunkSizes[] = {1, 7, 50, 4096};
+  for (size_t chunkSize : chunkSizes) {
+    StlStreamDecoder decoder;
+    decoder.set_ExpectedSize(data.size());
+    for (size_t pos = 0; pos < data.size(); pos += chunkSize) {
+      assert(decoder.Feed(data.data() + pos,
+                          std::min(chunkSize, data.size() - pos)));
+    }
+    assert(decoder.Finish());
+    assert(decoder.get_TriangleCount() == nFacets);
+  }
+}
+
+//! Facet count of a corrupted header does not reserve huge buffers.
+void testCorruptedHeader(std::string fileName) {
+  std::ifstream ifs;
+  ifs.open(fileName, std::ios_base::binary);
+  std::string data((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  ifs.close();
+  const unsigned int nFacets = 0xFFFFFFFF;
+  memcpy(&data[80], &nFacets, 4);
+
+  StlStreamDecoder sizedDecoder;
+  sizedDecoder.set_ExpectedSize(data.size());
+  sizedDecoder.Feed(data.data(), data.size());
+  assert(sizedDecoder.get_Facets().capacity() <= (data.size() - 84) / 50);
+  assert(!sizedDecoder.Finish());
+
+  StlStreamDecoder unsizedDecoder;
+  unsizedDecoder.Feed(data.data(), data.size());
+  assert(unsizedDecoder.get_Facets().capacity() <= (1 << 20));
+  assert(!unsizedDecoder.Finish());
+}
+
+//! Welding decoded facets within a load arena gives the same mesh.
+void testWeldInArena(std::string fileName) {
+  std::ifstream ifs;
+  ifs.open(fileName, std::ios_base::binary);
+  StlFile stlFile;
+  stlFile.LoadFromStream(ifs);
+  ifs.close();
+
+  std::vector<float> vertexes, arenaVertexes;
+  std::vector<unsigned int> indexes, arenaIndexes;
+  stlFile.ToIndexedData(vertexes, indexes);
+  {
+    std::pmr::monotonic_buffer_resource arena;
+    stlFile.ToIndexedData(arenaVertexes, arenaIndexes, &arena);
+  }
+  assert(!indexes.empty() && vertexes.size() < indexes.size() * 3);
+  assert(arenaVertexes == vertexes && arenaIndexes == indexes);
+}
+
+int main() {
+  const char* traceFile = std::getenv("TRACE_FILE");
+  TraceRecorder::set_Enabled(traceFile != nullptr);
+
+  testDecodeStl("ascii.stl");
+  testDecodeStl("binary.stl");
+  testTruncatedStl("binary.stl");
+  testTrailingData("binary.stl");
+  testCorruptedHeader("binary.stl");
+  testWeldInArena("ascii.stl");
+
+  if (traceFile != nullptr) {
+    TraceRecorder::DumpToFile(traceFile);
+  }
+}
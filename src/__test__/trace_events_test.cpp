@@ -0,0 +1,67 @@
+#include "../trace_events.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+size_t countOccurrences(const std::string& text, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + pattern.size())) {
+    count++;
+  }
+  return count;
+}
+
+void testDisabled() {
+  TraceRecorder::Clear();
+  TraceRecorder::set_Enabled(false);
+  { TRACE_SCOPE("disabled"); }
+  assert(TraceRecorder::get_EventCount() == 0);
+}
+
+void testThreads() {
+  TraceRecorder::Clear();
+  TraceRecorder::set_Enabled(true);
+
+  const size_t nThreads = 4;
+  const size_t nEvents = 10000;  // spans several buffer chunks
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nThreads; i++) {
+    threads.emplace_back([nEvents]() {
+      TraceRecorder::set_ThreadName("worker");
+      for (size_t j = 0; j < nEvents; j++) {
+        TRACE_SCOPE("work");
+      }
+    });
+  }
+  {
+    TRACE_SCOPE("main \"quoted\"\tcontrol");
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  TraceRecorder::set_Enabled(false);
+
+  assert(TraceRecorder::get_EventCount() == nThreads * nEvents + 1);
+  const std::string json = TraceRecorder::ToJson();
+  assert(countOccurrences(json, "\"name\":\"work\"") == nThreads * nEvents);
+  assert(countOccurrences(json, "\"name\":\"worker\"") == nThreads);
+  assert(countOccurrences(json, "main \\\"quoted\\\"\\u0009control") == 1);
+  assert(json.front() == '{' && json.back() == '}');
+
+  std::cout << "recorded " << TraceRecorder::get_EventCount() << " events from "
+            << nThreads << " threads" << std::endl;
+}
+
+int main() {
+  testDisabled();
+  testThreads();
+
+  if (const char* traceFile = std::getenv("TRACE_FILE")) {
+    assert(TraceRecorder::DumpToFile(traceFile));
+  }
+}
@@ -0,0 +1,154 @@
+#include "adaptive_quality.h"
+
+#include <algorithm>
+
+namespace {
+//! Navigation is considered stopped after this time without frames.
+static const double THE_IDLE_DELAY = 150.0;
+
+//! Weight of the new sample within the smoothed frame time.
+static const double THE_SMOOTHING = 0.3;
+
+//! Frames to measure at a level before it may be changed.
+static const int THE_MIN_SAMPLES = 3;
+
+//! Frames skipped after the level change, e.g. due to reallocated buffers.
+static const int THE_SETTLE_FRAMES = 1;
+
+//! Frames to keep the level raised before probing a better one.
+static const int THE_PROBE_FRAMES = 60;
+
+//! Frame time relative to the target to raise the level.
+static const double THE_SLOW_RATIO = 1.25;
+
+//! Frame time relative to the target to lower the level.
+static const double THE_FAST_RATIO = 0.6;
+
+static const float THE_RENDER_SCALES[AdaptiveQuality::THE_NB_LEVELS] = {
+    1.0f, 1.0f, 0.75f, 0.5f, 0.35f};
+static const double THE_CULLING_SIZES[AdaptiveQuality::THE_NB_LEVELS] = {
+    0.0, 0.0, 1.0, 2.0, 4.0};
+} // namespace
+
+// ================================================================
+// Function : AdaptiveQuality
+// Purpose  :
+// ================================================================
+AdaptiveQuality::AdaptiveQuality(double theTarget)
+    : myTarget(theTarget), myMeanTime(-1.0), myPrevTime(-1.0), myNavLevel(0),
+      myNbSamples(0), mySettleFrames(THE_SETTLE_FRAMES), myProbeFrames(0),
+      myIsNavigating(false), myIsEnabled(false) {}
+
+// ================================================================
+// Function : SetEnabled
+// Purpose  :
+// ================================================================
+void AdaptiveQuality::SetEnabled(bool theToEnable) {
+  myIsEnabled = theToEnable;
+  if (!theToEnable) {
+    Reset();
+  }
+}
+
+// ================================================================
+// Function : NavigationFrame
+// Purpose  :
+// ================================================================
+void AdaptiveQuality::NavigationFrame(double theTime, double theRequestTime) {
+  if (!myIsEnabled) {
+    return;
+  }
+
+  // frames requested while the previous one was rendered are measured
+  // from its end, so that waiting for input is not counted
+  const double aStart = std::max(theRequestTime, myPrevTime);
+  myIsNavigating = true;
+  myPrevTime = theTime;
+  if (mySettleFrames > 0) {
+    --mySettleFrames;
+    return;
+  }
+
+  const double aSample = std::max(theTime - aStart, 0.0);
+  myMeanTime = myMeanTime < 0.0
+                   ? aSample
+                   : myMeanTime + THE_SMOOTHING * (aSample - myMeanTime);
+  ++myNbSamples;
+  if (myProbeFrames > 0) {
+    --myProbeFrames;
+  }
+  if (myNbSamples < THE_MIN_SAMPLES) {
+    return;
+  }
+
+  if (myMeanTime > myTarget * THE_SLOW_RATIO &&
+      myNavLevel + 1 < THE_NB_LEVELS) {
+    setNavLevel(myNavLevel + 1);
+    // the better level has just failed, so that it is not retried at once
+    myProbeFrames = THE_PROBE_FRAMES;
+  } else if (myMeanTime < myTarget * THE_FAST_RATIO && myNavLevel > 0 &&
+             myProbeFrames == 0) {
+    setNavLevel(myNavLevel - 1);
+  }
+}
+
+// ================================================================
+// Function : IdleDelay
+// Purpose  :
+// ================================================================
+double AdaptiveQuality::IdleDelay(double theTime) const {
+  if (!myIsNavigating) {
+    return 0.0;
+  }
+  return std::max(THE_IDLE_DELAY - (theTime - myPrevTime), 0.0);
+}
+
+// ================================================================
+// Function : NavigationStopped
+// Purpose  :
+// ================================================================
+void AdaptiveQuality::NavigationStopped() {
+  myIsNavigating = false;
+  myPrevTime = -1.0;
+  myMeanTime = -1.0;
+  myNbSamples = 0;
+  // the first frame of the next navigation is rendered with full quality
+  mySettleFrames = THE_SETTLE_FRAMES;
+}
+
+// ================================================================
+// Function : Reset
+// Purpose  :
+// ================================================================
+void AdaptiveQuality::Reset() {
+  NavigationStopped();
+  myNavLevel = 0;
+  myProbeFrames = 0;
+}
+
+// ================================================================
+// Function : setNavLevel
+// Purpose  :
+// ================================================================
+void AdaptiveQuality::setNavLevel(int theLevel) {
+  myNavLevel = theLevel;
+  myMeanTime = -1.0;
+  myNbSamples = 0;
+  mySettleFrames = THE_SETTLE_FRAMES;
+}
+
+// ================================================================
+// Function : RenderScale
+// Purpose  :
+// ================================================================
+float AdaptiveQuality::RenderScale(int theLevel) {
+  return THE_RENDER_SCALES[std::min(std::max(theLevel, 0), THE_NB_LEVELS - 1)];
+}
+
+// ================================================================
+// Function : CullingSize
+// Purpose  :
+// ================================================================
+double AdaptiveQuality::CullingSize(int theLevel) {
+  return THE_CULLING_SIZES[std::min(std::max(theLevel, 0), THE_NB_LEVELS - 1)];
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+//! Adaptive quality of frames rendered during navigation.
+//! Level 0 stands for full quality, each next level is cheaper to render:
+//! multisampling is turned off first, then render resolution is lowered and
+//! small objects are culled. Navigation frames are measured and the level is
+//! raised while they take longer than the target frame time, and lowered
+//! back when there is enough headroom. The level reached is kept for the
+//! next navigation, while the view is refined to full quality once
+//! navigation has stopped.
+//! All times are in milliseconds; the caller provides timestamps from the
+//! same monotonic clock (emscripten_get_now() in the viewer).
+class AdaptiveQuality {
+public:
+  //! Number of quality levels.
+  static const int THE_NB_LEVELS = 5;
+
+public:
+  //! @param theTarget [in] target frame time
+  AdaptiveQuality(double theTarget = 1000.0 / 60.0);
+
+  //! Enable or disable adaptation; disabled controller keeps full quality.
+  void SetEnabled(bool theToEnable);
+
+  //! Return TRUE if adaptation is enabled.
+  bool IsEnabled() const { return myIsEnabled; }
+
+  //! Set target frame time.
+  void SetTarget(double theTarget) { myTarget = theTarget; }
+
+  //! Return target frame time.
+  double Target() const { return myTarget; }
+
+  //! Return quality level for the next frame.
+  int Level() const { return myIsNavigating ? myNavLevel : 0; }
+
+  //! Register frame rendered during navigation.
+  //! The first request of the frame may precede the end of the previous
+  //! frame, in which case the whole interval between frames is measured.
+  //! @param theTime        [in] time the frame has been finished
+  //! @param theRequestTime [in] time the frame has been first requested
+  void NavigationFrame(double theTime, double theRequestTime);
+
+  //! Return time left before navigation is considered stopped,
+  //! 0 if it has expired or there is no navigation.
+  double IdleDelay(double theTime) const;
+
+  //! Finish navigation; the next frame is rendered with full quality.
+  void NavigationStopped();
+
+  //! Forget the level reached and measurements, e.g. on scene change.
+  void Reset();
+
+  //! Return render resolution scale of the level within (0, 1] range.
+  static float RenderScale(int theLevel);
+
+  //! Return TRUE if multisampling is kept at the level.
+  static bool HasMsaa(int theLevel) { return theLevel == 0; }
+
+  //! Return projected size in pixels below which objects are culled at the
+  //! level, 0 if none are.
+  static double CullingSize(int theLevel);
+
+private:
+  //! Switch navigation level and restart measurements.
+  void setNavLevel(int theLevel);
+
+private:
+  double myTarget;
+  double myMeanTime;  //!< smoothed navigation frame time, negative if none
+  double myPrevTime;  //!< end of the previous navigation frame, or negative
+  int myNavLevel;     //!< level of navigation frames
+  int myNbSamples;    //!< frames measured at the current level
+  int mySettleFrames; //!< frames to skip before measuring
+  int myProbeFrames;  //!< frames before the level may be lowered
+  bool myIsNavigating;
+  bool myIsEnabled;
+};
@@ -0,0 +1,339 @@
+#include "alloc_profiler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+#include "help_algorithms.h"
+#include "trace_events.h"
+
+namespace {
+
+const int THE_MAX_SCOPES = 256;
+const int THE_MAX_ALIASES = 1024;
+const size_t THE_MIN_CAPACITY = 4096;
+
+//! Tracked block; Ptr is NULL for empty cells and THE_TOMBSTONE for
+//! removed ones.
+struct BlockEntry {
+  void* Ptr;
+  size_t Size;
+  int Scope;
+};
+
+void* const THE_TOMBSTONE = reinterpret_cast<void*>(uintptr_t(1));
+
+//! Profiler state, guarded by g_lock.
+//! All memory is taken directly from malloc, so hooks never re-enter.
+struct ProfilerState {
+  const char* ScopeNames[THE_MAX_SCOPES];  // slot 0 is outside of scopes
+  AllocProfiler::ScopeStats Scopes[THE_MAX_SCOPES];
+  int NbScopes;
+
+  // the same scope name may come as different literals from different
+  // translation units, so pointers are mapped to slots
+  const char* AliasPtrs[THE_MAX_ALIASES];
+  int AliasSlots[THE_MAX_ALIASES];
+  int NbAliases;
+
+  BlockEntry* Blocks;
+  size_t Capacity;
+  size_t NbUsed;  // including tombstones
+  size_t Live;
+  size_t Peak;
+};
+
+std::atomic<bool> g_enabled(false);
+std::atomic_flag g_lock = ATOMIC_FLAG_INIT;
+ProfilerState g_state;
+
+struct LockGuard {
+  LockGuard() {
+    while (g_lock.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+  ~LockGuard() { g_lock.clear(std::memory_order_release); }
+};
+
+size_t hashPointer(const void* ptr, size_t capacity) {
+  uint64_t key = reinterpret_cast<uintptr_t>(ptr);
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return size_t(key) & (capacity - 1);
+}
+
+//! Return slot of the scope name, registering it on first use.
+int scopeSlot(const char* name) {
+  if (name == nullptr) {
+    return 0;
+  }
+  for (int i = 0; i < g_state.NbAliases; i++) {
+    if (g_state.AliasPtrs[i] == name) {
+      return g_state.AliasSlots[i];
+    }
+  }
+
+  int slot = 0;
+  for (int i = 1; i < g_state.NbScopes; i++) {
+    if (std::strcmp(g_state.ScopeNames[i], name) == 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot == 0 && g_state.NbScopes < THE_MAX_SCOPES) {
+    slot = g_state.NbScopes++;
+    g_state.ScopeNames[slot] = name;
+  }
+  if (g_state.NbAliases < THE_MAX_ALIASES) {
+    g_state.AliasPtrs[g_state.NbAliases] = name;
+    g_state.AliasSlots[g_state.NbAliases] = slot;
+    g_state.NbAliases++;
+  }
+  return slot;
+}
+
+//! Return cell of the block, or NULL.
+BlockEntry* findBlock(void* ptr) {
+  if (g_state.Blocks == nullptr) {
+    return nullptr;
+  }
+  for (size_t i = hashPointer(ptr, g_state.Capacity);;
+       i = (i + 1) & (g_state.Capacity - 1)) {
+    BlockEntry& entry = g_state.Blocks[i];
+    if (entry.Ptr == ptr) {
+      return &entry;
+    }
+    if (entry.Ptr == nullptr) {
+      return nullptr;
+    }
+  }
+}
+
+void insertBlock(BlockEntry* blocks, size_t capacity, const BlockEntry& block) {
+  size_t i = hashPointer(block.Ptr, capacity);
+  while (blocks[i].Ptr != nullptr && blocks[i].Ptr != THE_TOMBSTONE) {
+    i = (i + 1) & (capacity - 1);
+  }
+  blocks[i] = block;
+}
+
+//! Keep load factor below 1/2, dropping tombstones.
+bool reserveBlocks() {
+  if ((g_state.NbUsed + 1) * 2 <= g_state.Capacity) {
+    return true;
+  }
+
+  size_t capacity = g_state.Capacity == 0 ? THE_MIN_CAPACITY : g_state.Capacity;
+  size_t nbLive = 0;
+  for (size_t i = 0; i < g_state.Capacity; i++) {
+    nbLive += g_state.Blocks[i].Ptr > THE_TOMBSTONE ? 1 : 0;
+  }
+  while ((nbLive + 1) * 4 > capacity) {
+    capacity *= 2;
+  }
+
+  BlockEntry* blocks =
+      static_cast<BlockEntry*>(std::calloc(capacity, sizeof(BlockEntry)));
+  if (blocks == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < g_state.Capacity; i++) {
+    if (g_state.Blocks[i].Ptr > THE_TOMBSTONE) {
+      insertBlock(blocks, capacity, g_state.Blocks[i]);
+    }
+  }
+  std::free(g_state.Blocks);
+  g_state.Blocks = blocks;
+  g_state.Capacity = capacity;
+  g_state.NbUsed = nbLive;
+  return true;
+}
+
+void releaseBlock(BlockEntry& entry) {
+  AllocProfiler::ScopeStats& stats = g_state.Scopes[entry.Scope];
+  stats.Live -= entry.Size;
+  g_state.Live -= entry.Size;
+  entry.Ptr = THE_TOMBSTONE;
+}
+
+}  // namespace
+
+bool AllocProfiler::IsAvailable() {
+#ifdef ALLOC_PROFILER
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AllocProfiler::set_Enabled(bool isEnabled) {
+  g_enabled.store(isEnabled, std::memory_order_relaxed);
+}
+
+bool AllocProfiler::IsEnabled() {
+  return g_enabled.load(std::memory_order_relaxed);
+}
+
+void AllocProfiler::OnAllocate(void* ptr, size_t size) {
+  if (ptr == nullptr || !g_enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  const TraceScope* scope = TraceScope::get_Current();
+  LockGuard lock;
+  if (g_state.NbScopes == 0) {
+    g_state.ScopeNames[0] = "(no scope)";
+    g_state.NbScopes = 1;
+  }
+
+  // address reused after a free bypassing the hooks
+  if (BlockEntry* stale = findBlock(ptr)) {
+    releaseBlock(*stale);
+  }
+  if (!reserveBlocks()) {
+    return;
+  }
+
+  const int slot = scopeSlot(scope != nullptr ? scope->get_Name() : nullptr);
+  insertBlock(g_state.Blocks, g_state.Capacity, BlockEntry{ptr, size, slot});
+  g_state.NbUsed++;
+
+  ScopeStats& stats = g_state.Scopes[slot];
+  stats.Count++;
+  stats.Bytes += size;
+  stats.Live += size;
+  if (stats.Live > stats.Peak) {
+    stats.Peak = stats.Live;
+  }
+  g_state.Live += size;
+  if (g_state.Live > g_state.Peak) {
+    g_state.Peak = g_state.Live;
+  }
+}
+
+void AllocProfiler::OnFree(void* ptr) {
+  if (ptr == nullptr || !g_enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  LockGuard lock;
+  if (BlockEntry* entry = findBlock(ptr)) {
+    releaseBlock(*entry);
+  }
+}
+
+void AllocProfiler::Clear() {
+  LockGuard lock;
+  std::free(g_state.Blocks);
+  std::memset(static_cast<void*>(&g_state), 0, sizeof(g_state));
+}
+
+size_t AllocProfiler::get_LiveBytes() {
+  LockGuard lock;
+  return g_state.Live;
+}
+
+size_t AllocProfiler::get_PeakBytes() {
+  LockGuard lock;
+  return g_state.Peak;
+}
+
+bool AllocProfiler::get_ScopeStats(const char* name, ScopeStats& stats) {
+  LockGuard lock;
+  for (int i = 0; i < g_state.NbScopes; i++) {
+    if (name == nullptr ? i == 0
+                        : i != 0 && std::strcmp(g_state.ScopeNames[i], name) == 0) {
+      stats = g_state.Scopes[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string AllocProfiler::ToJson() {
+  // copy counters first, as formatting allocates
+  const char* names[THE_MAX_SCOPES];
+  ScopeStats scopes[THE_MAX_SCOPES];
+  int nbScopes = 0;
+  size_t live = 0, peak = 0;
+  {
+    LockGuard lock;
+    nbScopes = g_state.NbScopes;
+    std::memcpy(names, g_state.ScopeNames, sizeof(names[0]) * nbScopes);
+    std::memcpy(scopes, g_state.Scopes, sizeof(scopes[0]) * nbScopes);
+    live = g_state.Live;
+    peak = g_state.Peak;
+  }
+
+  std::ostringstream os;
+  os << "{\"available\":" << (IsAvailable() ? "true" : "false")
+     << ",\"enabled\":" << (IsEnabled() ? "true" : "false")
+     << ",\"live\":" << live << ",\"peak\":" << peak << ",\"scopes\":[";
+  for (int i = 0; i < nbScopes; i++) {
+    os << (i == 0 ? "" : ",") << "\n{\"name\":";
+    write_json_string(os, names[i]);
+    os << ",\"count\":" << scopes[i].Count << ",\"bytes\":" << scopes[i].Bytes
+       << ",\"live\":" << scopes[i].Live << ",\"peak\":" << scopes[i].Peak
+       << "}";
+  }
+  os << "\n]}";
+  return os.str();
+}
+
+bool AllocProfiler::DumpToFile(const std::string& fileName) {
+  std::ofstream ofs(fileName, std::ios_base::trunc);
+  if (!ofs.is_open()) {
+    return false;
+  }
+  ofs << ToJson();
+  return ofs.good();
+}
+
+#ifdef ALLOC_PROFILER
+
+void* operator new(size_t size) {
+  void* ptr = std::malloc(size != 0 ? size : 1);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  AllocProfiler::OnAllocate(ptr, size);
+  return ptr;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  void* ptr = std::malloc(size != 0 ? size : 1);
+  AllocProfiler::OnAllocate(ptr, size);
+  return ptr;
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept {
+  AllocProfiler::OnFree(ptr);
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  operator delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  operator delete(ptr);
+}
+
+#endif
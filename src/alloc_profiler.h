@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//! Heap allocation profiler attributing allocations to the innermost
+//! TraceScope of the allocating thread.
+//! Hooks are compiled only with ALLOC_PROFILER defined: alloc_profiler.cpp
+//! then replaces global operator new/delete, and alloc_profiler_standard.cpp
+//! wraps Standard::Allocate/Reallocate/Free when linked with the -Wl,--wrap
+//! options (see Makefile). Allocations are tracked only while the profiler
+//! is enabled; memory released bypassing the hooks stays counted as live.
+class AllocProfiler {
+ public:
+  //! Counters of one scope.
+  struct ScopeStats {
+    size_t Count = 0;  //!< number of allocations
+    size_t Bytes = 0;  //!< total allocated bytes
+    size_t Live = 0;   //!< bytes allocated within scope and not yet freed
+    size_t Peak = 0;   //!< maximum of live bytes
+  };
+
+ public:
+  //! Return TRUE if hooks are compiled in.
+  static bool IsAvailable();
+
+  //! Start or stop tracking; disabled profiler costs a single flag check.
+  static void set_Enabled(bool isEnabled);
+
+  static bool IsEnabled();
+
+  //! Register allocated block, called by the hooks.
+  static void OnAllocate(void* ptr, size_t size);
+
+  //! Unregister released block, called by the hooks.
+  static void OnFree(void* ptr);
+
+  //! Drop all counters and tracked blocks.
+  static void Clear();
+
+  //! Return bytes currently allocated by tracked blocks.
+  static size_t get_LiveBytes();
+
+  //! Return maximum of live bytes since the last Clear().
+  static size_t get_PeakBytes();
+
+  //! Return counters of the named scope, NULL name for allocations made
+  //! outside of any scope.
+  //! @return FALSE if nothing has been allocated within the scope
+  static bool get_ScopeStats(const char* name, ScopeStats& stats);
+
+  //! Format counters of all scopes as JSON object.
+  static std::string ToJson();
+
+  //! Write JSON report into file.
+  //! @return FALSE on writing error
+  static bool DumpToFile(const std::string& fileName);
+};
@@ -0,0 +1,40 @@
+// Wrappers of the OCCT memory manager for AllocProfiler.
+// To be linked only together with the options
+//   -Wl,--wrap=_ZN8Standard8AllocateEm
+//   -Wl,--wrap=_ZN8Standard10ReallocateEPvm
+//   -Wl,--wrap=_ZN8Standard4FreeEPv
+// which redirect calls of Standard::Allocate/Reallocate/Free from the linked
+// objects and static libraries to the functions below. Calls made within
+// shared libraries are not redirected.
+
+#include <cstddef>
+
+#include "alloc_profiler.h"
+
+extern "C" {
+
+void* __real__ZN8Standard8AllocateEm(size_t size);
+void* __real__ZN8Standard10ReallocateEPvm(void* ptr, size_t size);
+void __real__ZN8Standard4FreeEPv(void* ptr);
+
+void* __wrap__ZN8Standard8AllocateEm(size_t size) {
+  void* ptr = __real__ZN8Standard8AllocateEm(size);
+  AllocProfiler::OnAllocate(ptr, size);
+  return ptr;
+}
+
+void* __wrap__ZN8Standard10ReallocateEPvm(void* ptr, size_t size) {
+  void* newPtr = __real__ZN8Standard10ReallocateEPvm(ptr, size);
+  if (newPtr != nullptr) {
+    AllocProfiler::OnFree(ptr);
+    AllocProfiler::OnAllocate(newPtr, size);
+  }
+  return newPtr;
+}
+
+void __wrap__ZN8Standard4FreeEPv(void* ptr) {
+  AllocProfiler::OnFree(ptr);
+  __real__ZN8Standard4FreeEPv(ptr);
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+//! Abstract source of data delivered by chunks (network download, file...).
+class ChunkSource {
+ public:
+  virtual ~ChunkSource() {}
+
+  //! Read next chunk into the buffer.
+  //! @return number of bytes read, 0 when source is exhausted or failed
+  virtual size_t ReadChunk(char* buf, size_t capacity) = 0;
+
+  //! Return TRUE when all data has been delivered.
+  virtual bool IsEof() const = 0;
+
+  //! Return TRUE if source failed.
+  virtual bool IsFailed() const { return false; }
+
+  //! Return total size of data or 0 if it is unknown in advance.
+  virtual size_t get_TotalSize() const { return 0; }
+};
+
+//! Chunk source reading local file, stands in for HTTP download in tests.
+class FileChunkSource : public ChunkSource {
+ public:
+  FileChunkSource(const std::string& fileName, size_t chunkSize)
+      : m_nChunkSize(chunkSize), m_nTotalSize(0) {
+    m_ifs.open(fileName, std::ios_base::binary);
+    if (m_ifs.is_open()) {
+      m_ifs.seekg(0, std::ios_base::end);
+      m_nTotalSize = static_cast<size_t>(m_ifs.tellg());
+      m_ifs.seekg(0, std::ios_base::beg);
+    }
+  }
+
+  size_t ReadChunk(char* buf, size_t capacity) override {
+    if (!m_ifs.is_open() || m_ifs.eof()) {
+      return 0;
+    }
+    size_t toRead = capacity < m_nChunkSize ? capacity : m_nChunkSize;
+    m_ifs.read(buf, toRead);
+    return static_cast<size_t>(m_ifs.gcount());
+  }
+
+  bool IsEof() const override { return !m_ifs.is_open() || m_ifs.eof(); }
+
+  bool IsFailed() const override { return !m_ifs.is_open(); }
+
+  size_t get_TotalSize() const override { return m_nTotalSize; }
+
+ private:
+  std::ifstream m_ifs;
+  size_t m_nChunkSize;
+  size_t m_nTotalSize;
+};
@@ -0,0 +1,188 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// ================================================================
+// Function : Percentile
+// Purpose  :
+// ================================================================
+double SampleRing::Percentile(double thePercent) const {
+  const size_t aSize = Size();
+  if (aSize == 0) {
+    return 0.0;
+  }
+
+  std::vector<double> aSorted(mySamples.begin(), mySamples.begin() + aSize);
+  const double aRank = std::ceil(thePercent / 100.0 * (double)aSize);
+  const size_t anIndex =
+      std::min(aSize - 1, (size_t)std::max(aRank - 1.0, 0.0));
+  std::nth_element(aSorted.begin(), aSorted.begin() + anIndex, aSorted.end());
+  return aSorted[anIndex];
+}
+
+// ================================================================
+// Function : Mean
+// Purpose  :
+// ================================================================
+double SampleRing::Mean() const {
+  const size_t aSize = Size();
+  if (aSize == 0) {
+    return 0.0;
+  }
+
+  double aSum = 0.0;
+  for (size_t anIter = 0; anIter < aSize; ++anIter) {
+    aSum += mySamples[anIter];
+  }
+  return aSum / (double)aSize;
+}
+
+// ================================================================
+// Function : Max
+// Purpose  :
+// ================================================================
+double SampleRing::Max() const {
+  const size_t aSize = Size();
+  return aSize == 0
+             ? 0.0
+             : *std::max_element(mySamples.begin(), mySamples.begin() + aSize);
+}
+
+// ================================================================
+// Function : ToJson
+// Purpose  :
+// ================================================================
+std::string SampleRing::ToJson() const {
+  std::ostringstream aStream;
+  aStream << "{\"count\":" << Size() << ",\"mean\":" << Mean()
+          << ",\"p50\":" << Percentile(50) << ",\"p90\":" << Percentile(90)
+          << ",\"p99\":" << Percentile(99) << ",\"max\":" << Max() << "}";
+  return aStream.str();
+}
+
+// ================================================================
+// Function : FrameStats
+// Purpose  :
+// ================================================================
+FrameStats::FrameStats(size_t theCapacity)
+    : myFrameTime(theCapacity), myFlushTime(theCapacity),
+      myRenderTime(theCapacity), myLatency(theCapacity),
+      myBurstFrames(theCapacity), myTriangles(theCapacity),
+      myElements(theCapacity) {
+  Reset();
+}
+
+// ================================================================
+// Function : Reset
+// Purpose  :
+// ================================================================
+void FrameStats::Reset() {
+  myFrameTime.Clear();
+  myFlushTime.Clear();
+  myRenderTime.Clear();
+  myLatency.Clear();
+  myBurstFrames.Clear();
+  myTriangles.Clear();
+  myElements.Clear();
+  myTickStart = 0.0;
+  myRenderStart = -1.0;
+  myInputTime = -1.0;
+  myBurstLength = 0;
+  myNbRequests = 0;
+  myNbTicks = 0;
+  myNbFrames = 0;
+  myNbInputs = 0;
+}
+
+// ================================================================
+// Function : InputEvent
+// Purpose  :
+// ================================================================
+void FrameStats::InputEvent(double theTime) {
+  ++myNbInputs;
+  if (myInputTime < 0.0) {
+    myInputTime = theTime;
+  }
+}
+
+// ================================================================
+// Function : TickStarted
+// Purpose  :
+// ================================================================
+void FrameStats::TickStarted(double theTime) {
+  ++myNbTicks;
+  myTickStart = theTime;
+  myRenderStart = -1.0;
+}
+
+// ================================================================
+// Function : RenderStarted
+// Purpose  :
+// ================================================================
+void FrameStats::RenderStarted(double theTime) {
+  myRenderStart = theTime;
+  myFlushTime.Add(theTime - myTickStart);
+}
+
+// ================================================================
+// Function : FrameFinished
+// Purpose  :
+// ================================================================
+void FrameStats::FrameFinished(double theTime, int theNbTriangles,
+                               int theNbElements, bool theIsLast) {
+  ++myNbFrames;
+  ++myBurstLength;
+  myFrameTime.Add(theTime - myTickStart);
+  if (myRenderStart >= 0.0) {
+    myRenderTime.Add(theTime - myRenderStart);
+  }
+  myTriangles.Add(theNbTriangles);
+  myElements.Add(theNbElements);
+  if (myInputTime >= 0.0) {
+    myLatency.Add(theTime - myInputTime);
+    myInputTime = -1.0;
+  }
+  if (theIsLast) {
+    myBurstFrames.Add(myBurstLength);
+    myBurstLength = 0;
+  }
+}
+
+// ================================================================
+// Function : ToJson
+// Purpose  :
+// ================================================================
+std::string FrameStats::ToJson() const {
+  std::ostringstream aStream;
+  aStream << "{\"requests\":" << myNbRequests << ",\"ticks\":" << myNbTicks
+          << ",\"frames\":" << myNbFrames << ",\"inputs\":" << myNbInputs
+          << ",\"frameTime\":" << myFrameTime.ToJson()
+          << ",\"flushTime\":" << myFlushTime.ToJson()
+          << ",\"renderTime\":" << myRenderTime.ToJson()
+          << ",\"latency\":" << myLatency.ToJson()
+          << ",\"framesPerBurst\":" << myBurstFrames.ToJson()
+          << ",\"triangles\":" << myTriangles.ToJson()
+          << ",\"elements\":" << myElements.ToJson() << "}";
+  return aStream.str();
+}
+
+// ================================================================
+// Function : ToString
+// Purpose  :
+// ================================================================
+std::string FrameStats::ToString() const {
+  std::ostringstream aStream;
+  aStream.precision(3);
+  aStream << "Frame ms p50/p99: " << myFrameTime.Percentile(50) << " / "
+          << myFrameTime.Percentile(99) << "\n"
+          << "Render ms p50/p99: " << myRenderTime.Percentile(50) << " / "
+          << myRenderTime.Percentile(99) << "\n"
+          << "Latency ms p50/p99: " << myLatency.Percentile(50) << " / "
+          << myLatency.Percentile(99) << "\n"
+          << "Frames per burst p50: " << myBurstFrames.Percentile(50) << "\n"
+          << "Triangles: " << (size_t)myTriangles.Percentile(50) << "\n"
+          << "Frames/requests: " << myNbFrames << " / " << myNbRequests;
+  return aStream.str();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//! Fixed-capacity ring buffer of samples with percentile queries.
+//! Oldest samples are overwritten once the buffer is full.
+class SampleRing {
+public:
+  SampleRing(size_t theCapacity = 256) : myNext(0), myIsFull(false) {
+    mySamples.resize(theCapacity > 0 ? theCapacity : 1);
+  }
+
+  //! Add sample.
+  void Add(double theValue) {
+    mySamples[myNext] = theValue;
+    if (++myNext == mySamples.size()) {
+      myNext = 0;
+      myIsFull = true;
+    }
+  }
+
+  //! Return number of stored samples.
+  size_t Size() const { return myIsFull ? mySamples.size() : myNext; }
+
+  //! Remove all samples.
+  void Clear() {
+    myNext = 0;
+    myIsFull = false;
+  }
+
+  //! Return percentile of stored samples (nearest rank), 0 if empty.
+  //! @param thePercent [in] percentile within [0, 100] range
+  double Percentile(double thePercent) const;
+
+  //! Return mean of stored samples, 0 if empty.
+  double Mean() const;
+
+  //! Return maximum of stored samples, 0 if empty.
+  double Max() const;
+
+  //! Format as JSON object with mean, p50, p90, p99 and max values.
+  std::string ToJson() const;
+
+private:
+  std::vector<double> mySamples;
+  size_t myNext;
+  bool myIsFull;
+};
+
+//! Collector of per-frame render statistics and input latency.
+//! All times are in milliseconds; the caller provides timestamps from the
+//! same monotonic clock (emscripten_get_now() in the viewer).
+class FrameStats {
+public:
+  FrameStats(size_t theCapacity = 256);
+
+  //! Register input event; the first event since the last presented frame
+  //! starts latency measurement.
+  void InputEvent(double theTime);
+
+  //! Register redraw request, including ones coalesced into a single frame.
+  void UpdateRequested() { ++myNbRequests; }
+
+  //! Begin processing of the main loop tick (events and redraw).
+  void TickStarted(double theTime);
+
+  //! Begin rendering of the frame; events have been flushed.
+  void RenderStarted(double theTime);
+
+  //! Finish the frame.
+  //! @param theTime        [in] current time
+  //! @param theNbTriangles [in] triangles rendered within the frame
+  //! @param theNbElements  [in] elements rendered within the frame
+  //! @param theIsLast      [in] no more frames are requested, e.g. animation
+  //!                            or navigation has finished
+  void FrameFinished(double theTime, int theNbTriangles, int theNbElements,
+                     bool theIsLast);
+
+  //! Remove all samples and counters.
+  void Reset();
+
+  //! Format statistics as JSON object.
+  std::string ToJson() const;
+
+  //! Format statistics as short multi-line text for on-screen overlay.
+  std::string ToString() const;
+
+private:
+  SampleRing myFrameTime;   //!< full tick time
+  SampleRing myFlushTime;   //!< processing of events before rendering
+  SampleRing myRenderTime;  //!< rendering (CPU side)
+  SampleRing myLatency;     //!< from input event to the presented frame
+  SampleRing myBurstFrames; //!< frames per input burst
+  SampleRing myTriangles;   //!< triangles rendered per frame
+  SampleRing myElements;    //!< elements rendered per frame
+  double myTickStart;
+  double myRenderStart;
+  double myInputTime; //!< first not yet presented input, negative if none
+  int myBurstLength;  //!< frames since the start of the current burst
+  size_t myNbRequests;
+  size_t myNbTicks;
+  size_t myNbFrames;
+  size_t myNbInputs;
+};
@@ -0,0 +1,458 @@
+#include "geometry_registry.h"
+
+#include <AIS_ConnectedInteractive.hxx>
+#include <AIS_MultipleConnectedInteractive.hxx>
+#include <AIS_Shape.hxx>
+#include <MeshVS_DisplayModeFlags.hxx>
+#include <MeshVS_Mesh.hxx>
+#include <TopoDS_Iterator.hxx>
+
+#include <cstring>
+#include <sstream>
+
+#include "XSDRAWSTLVRML_DataSource.h"
+#include "model_factory.h"
+#include "trace_events.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(GeometryRegistry, Standard_Transient)
+
+namespace {
+
+//! Mix value into the hash.
+inline void hashCombine(uint64_t &theHash, uint64_t theValue) {
+  theHash ^= theValue + 0x9E3779B97F4A7C15ULL + (theHash << 6) + (theHash >> 2);
+}
+
+//! Return hash of triangulation nodes and triangles.
+uint64_t hashTriangulation(const Handle(Poly_Triangulation) & theTriangulation) {
+  uint64_t aHash = 0;
+  hashCombine(aHash, (uint64_t)theTriangulation->NbNodes());
+  hashCombine(aHash, (uint64_t)theTriangulation->NbTriangles());
+  for (Standard_Integer aNodeIter = 1;
+       aNodeIter <= theTriangulation->NbNodes(); ++aNodeIter) {
+    const gp_Pnt aPnt = theTriangulation->Node(aNodeIter);
+    for (int aCoordIter = 1; aCoordIter <= 3; ++aCoordIter) {
+      const float aCoord = (float)aPnt.Coord(aCoordIter) + 0.0f;
+      uint32_t aBits;
+      memcpy(&aBits, &aCoord, sizeof(aBits));
+      hashCombine(aHash, aBits);
+    }
+  }
+  for (Standard_Integer aTriIter = 1;
+       aTriIter <= theTriangulation->NbTriangles(); ++aTriIter) {
+    Standard_Integer aN1, aN2, aN3;
+    theTriangulation->Triangle(aTriIter).Get(aN1, aN2, aN3);
+    hashCombine(aHash, (uint64_t(aN1) << 32) | uint32_t(aN2));
+    hashCombine(aHash, uint32_t(aN3));
+  }
+  return aHash;
+}
+
+//! Return TRUE if triangulations have the same nodes and triangles.
+bool isSameTriangulation(const Handle(Poly_Triangulation) & theLeft,
+                         const Handle(Poly_Triangulation) & theRight) {
+  if (theLeft == theRight) {
+    return true;
+  }
+  if (theLeft.IsNull() || theRight.IsNull() ||
+      theLeft->NbNodes() != theRight->NbNodes() ||
+      theLeft->NbTriangles() != theRight->NbTriangles()) {
+    return false;
+  }
+
+  for (Standard_Integer aNodeIter = 1; aNodeIter <= theLeft->NbNodes();
+       ++aNodeIter) {
+    const gp_Pnt aLeft = theLeft->Node(aNodeIter);
+    const gp_Pnt aRight = theRight->Node(aNodeIter);
+    if ((float)aLeft.X() != (float)aRight.X() ||
+        (float)aLeft.Y() != (float)aRight.Y() ||
+        (float)aLeft.Z() != (float)aRight.Z()) {
+      return false;
+    }
+  }
+  for (Standard_Integer aTriIter = 1; aTriIter <= theLeft->NbTriangles();
+       ++aTriIter) {
+    Standard_Integer aL1, aL2, aL3, aR1, aR2, aR3;
+    theLeft->Triangle(aTriIter).Get(aL1, aL2, aL3);
+    theRight->Triangle(aTriIter).Get(aR1, aR2, aR3);
+    if (aL1 != aR1 || aL2 != aR2 || aL3 != aR3) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! Return triangulation displayed by the mesh master.
+Handle(Poly_Triangulation)
+meshTriangulation(const Handle(AIS_InteractiveObject) & theMaster) {
+  Handle(MeshVS_Mesh) aMesh = Handle(MeshVS_Mesh)::DownCast(theMaster);
+  if (aMesh.IsNull()) {
+    return Handle(Poly_Triangulation)();
+  }
+  Handle(XSDRAWSTLVRML_DataSource) aDataSource =
+      Handle(XSDRAWSTLVRML_DataSource)::DownCast(aMesh->GetDataSource());
+  return !aDataSource.IsNull() ? aDataSource->Triangulation()
+                               : Handle(Poly_Triangulation)();
+}
+
+//! Find registered master of equal triangulation.
+Handle(AIS_InteractiveObject)
+findMesh(const std::vector<Handle(AIS_InteractiveObject)> &theMasters,
+         const Handle(Poly_Triangulation) & theTriangulation) {
+  for (const Handle(AIS_InteractiveObject) &aMaster : theMasters) {
+    if (isSameTriangulation(meshTriangulation(aMaster), theTriangulation)) {
+      return aMaster;
+    }
+  }
+  return Handle(AIS_InteractiveObject)();
+}
+
+//! Collect non-compound parts of the shape with accumulated locations.
+void collectParts(const TopoDS_Shape &theShape,
+                  NCollection_Sequence<TopoDS_Shape> &theParts) {
+  if (theShape.ShapeType() != TopAbs_COMPOUND) {
+    theParts.Append(theShape);
+    return;
+  }
+  for (TopoDS_Iterator aSubIter(theShape); aSubIter.More(); aSubIter.Next()) {
+    collectParts(aSubIter.Value(), theParts);
+  }
+}
+
+//! Count references to the masters held by the instance.
+//! Raw pointers are used to not affect reference counters being compared.
+void countMasterRefs(
+    const PrsMgr_PresentableObject *theObj,
+    std::unordered_map<const Standard_Transient *, int> &theRefs) {
+  if (const AIS_ConnectedInteractive *aConnected =
+          dynamic_cast<const AIS_ConnectedInteractive *>(theObj)) {
+    ++theRefs[aConnected->ConnectedTo().get()];
+    return;
+  }
+  for (PrsMgr_ListOfPresentableObjectsIter aChildIter(theObj->Children());
+       aChildIter.More(); aChildIter.Next()) {
+    countMasterRefs(aChildIter.Value().get(), theRefs);
+  }
+}
+
+//! Return TRUE if the master is referenced outside of the registry.
+bool isUsed(const Handle(AIS_InteractiveObject) & theMaster,
+            const std::unordered_map<const Standard_Transient *, int> &theRefs) {
+  const auto aRefs = theRefs.find(theMaster.get());
+  return theMaster->GetRefCount() >
+         (aRefs != theRefs.end() ? aRefs->second : 0);
+}
+
+} // namespace
+
+// ================================================================
+// Function : GeometryRegistry
+// Purpose  :
+// ================================================================
+GeometryRegistry::GeometryRegistry() {}
+
+// ================================================================
+// Function : AddMesh
+// Purpose  :
+// ================================================================
+Handle(AIS_InteractiveObject)
+GeometryRegistry::AddMesh(const Handle(Poly_Triangulation) & theTriangulation,
+                          ModelLoadStats *theStats) {
+  if (theTriangulation.IsNull()) {
+    return Handle(AIS_InteractiveObject)();
+  }
+
+  TRACE_SCOPE("geometry lookup");
+  const uint64_t aHash = hashTriangulation(theTriangulation);
+  {
+    std::lock_guard<std::mutex> aLock(myMutex);
+    Handle(AIS_InteractiveObject) aMaster =
+        findMesh(myMeshes[aHash], theTriangulation);
+    if (!aMaster.IsNull()) {
+      return Instantiate(aMaster, gp_Trsf());
+    }
+  }
+
+  // data source is built outside of the lock
+  Handle(AIS_InteractiveObject) aMaster =
+      ModelFactory::GetInstance()->CreateStlMesh(theTriangulation, theStats);
+  aMaster->SetDisplayMode(MeshVS_DMF_Shading);
+  {
+    std::lock_guard<std::mutex> aLock(myMutex);
+    std::vector<Handle(AIS_InteractiveObject)> &aMasters = myMeshes[aHash];
+    Handle(AIS_InteractiveObject) anEqual = findMesh(aMasters, theTriangulation);
+    if (!anEqual.IsNull()) {
+      aMaster = anEqual;
+    } else {
+      aMasters.push_back(aMaster);
+    }
+  }
+  return Instantiate(aMaster, gp_Trsf());
+}
+
+// ================================================================
+// Function : shapeMaster
+// Purpose  :
+// ================================================================
+Handle(AIS_InteractiveObject)
+GeometryRegistry::shapeMaster(const TopoDS_Shape &theShape) {
+  Handle(AIS_InteractiveObject) *aMaster = myShapes.ChangeSeek(theShape);
+  if (aMaster != nullptr) {
+    return *aMaster;
+  }
+  return *myShapes.Bound(
+      theShape, ModelFactory::GetInstance()->CreateMeshedShape(theShape));
+}
+
+// ================================================================
+// Function : AddShape
+// Purpose  :
+// ================================================================
+Handle(AIS_InteractiveObject)
+GeometryRegistry::AddShape(const TopoDS_Shape &theShape) {
+  if (theShape.IsNull()) {
+    return Handle(AIS_InteractiveObject)();
+  }
+
+  NCollection_Sequence<TopoDS_Shape> aParts;
+  collectParts(theShape, aParts);
+
+  std::lock_guard<std::mutex> aLock(myMutex);
+  if (theShape.ShapeType() != TopAbs_COMPOUND || aParts.IsEmpty()) {
+    return Instantiate(shapeMaster(theShape.Located(TopLoc_Location())),
+                       theShape.Location().Transformation());
+  }
+
+  Handle(AIS_MultipleConnectedInteractive) anAssembly =
+      new AIS_MultipleConnectedInteractive();
+  for (NCollection_Sequence<TopoDS_Shape>::Iterator aPartIter(aParts);
+       aPartIter.More(); aPartIter.Next()) {
+    const TopoDS_Shape &aPart = aPartIter.Value();
+    anAssembly->Connect(shapeMaster(aPart.Located(TopLoc_Location())),
+                        aPart.Location().Transformation());
+  }
+  anAssembly->SetDisplayMode(AIS_Shaded);
+  return anAssembly;
+}
+
+// ================================================================
+// Function : FindModel
+// Purpose  :
+// ================================================================
+bool GeometryRegistry::FindModel(
+    const std::string &theKey,
+    NCollection_Sequence<Handle(AIS_InteractiveObject)> &thePrs) {
+  std::lock_guard<std::mutex> aLock(myMutex);
+  const auto aModel = myModels.find(theKey);
+  if (theKey.empty() || aModel == myModels.end()) {
+    return false;
+  }
+
+  for (NCollection_Sequence<Handle(AIS_InteractiveObject)>::Iterator aPrsIter(
+           aModel->second);
+       aPrsIter.More(); aPrsIter.Next()) {
+    thePrs.Append(copyInstance(aPrsIter.Value()));
+  }
+  return true;
+}
+
+// ================================================================
+// Function : AddModel
+// Purpose  :
+// ================================================================
+void GeometryRegistry::AddModel(
+    const std::string &theKey,
+    const NCollection_Sequence<Handle(AIS_InteractiveObject)> &thePrs) {
+  if (theKey.empty() || thePrs.IsEmpty()) {
+    return;
+  }
+
+  // keep own copies, as scene objects may be modified by application
+  NCollection_Sequence<Handle(AIS_InteractiveObject)> aCopies;
+  for (NCollection_Sequence<Handle(AIS_InteractiveObject)>::Iterator aPrsIter(
+           thePrs);
+       aPrsIter.More(); aPrsIter.Next()) {
+    Handle(AIS_InteractiveObject) aCopy = copyInstance(aPrsIter.Value());
+    if (aCopy.IsNull()) {
+      return;
+    }
+    aCopies.Append(aCopy);
+  }
+
+  std::lock_guard<std::mutex> aLock(myMutex);
+  myModels[theKey] = aCopies;
+}
+
+// ================================================================
+// Function : Purge
+// Purpose  :
+// ================================================================
+void GeometryRegistry::Purge() {
+  std::lock_guard<std::mutex> aLock(myMutex);
+
+  // references held by the registry itself
+  std::unordered_map<const Standard_Transient *, int> aRefs;
+  for (const auto &aBucket : myMeshes) {
+    for (const Handle(AIS_InteractiveObject) &aMaster : aBucket.second) {
+      ++aRefs[aMaster.get()];
+    }
+  }
+  for (NCollection_DataMap<TopoDS_Shape, Handle(AIS_InteractiveObject),
+                           TopTools_OrientedShapeMapHasher>::Iterator
+           aShapeIter(myShapes);
+       aShapeIter.More(); aShapeIter.Next()) {
+    ++aRefs[aShapeIter.Value().get()];
+  }
+  for (const auto &aModel : myModels) {
+    for (NCollection_Sequence<Handle(AIS_InteractiveObject)>::Iterator
+             aPrsIter(aModel.second);
+         aPrsIter.More(); aPrsIter.Next()) {
+      countMasterRefs(aPrsIter.Value().get(), aRefs);
+    }
+  }
+
+  // models are kept while any of their masters is in use
+  for (auto aModel = myModels.begin(); aModel != myModels.end();) {
+    std::unordered_map<const Standard_Transient *, int> aModelRefs;
+    for (NCollection_Sequence<Handle(AIS_InteractiveObject)>::Iterator
+             aPrsIter(aModel->second);
+         aPrsIter.More(); aPrsIter.Next()) {
+      countMasterRefs(aPrsIter.Value().get(), aModelRefs);
+    }
+
+    bool isAlive = false;
+    for (const auto &aMasterRefs : aModelRefs) {
+      isAlive = isAlive ||
+                aMasterRefs.first->GetRefCount() > aRefs[aMasterRefs.first];
+    }
+    if (isAlive) {
+      ++aModel;
+      continue;
+    }
+
+    for (const auto &aMasterRefs : aModelRefs) {
+      aRefs[aMasterRefs.first] -= aMasterRefs.second;
+    }
+    aModel = myModels.erase(aModel);
+  }
+
+  for (auto aBucket = myMeshes.begin(); aBucket != myMeshes.end();) {
+    std::vector<Handle(AIS_InteractiveObject)> &aMasters = aBucket->second;
+    for (size_t aMasterIter = 0; aMasterIter < aMasters.size();) {
+      if (isUsed(aMasters[aMasterIter], aRefs)) {
+        ++aMasterIter;
+      } else {
+        aMasters[aMasterIter] = aMasters.back();
+        aMasters.pop_back();
+      }
+    }
+    aBucket = aMasters.empty() ? myMeshes.erase(aBucket) : std::next(aBucket);
+  }
+
+  NCollection_Sequence<TopoDS_Shape> anUnused;
+  for (NCollection_DataMap<TopoDS_Shape, Handle(AIS_InteractiveObject),
+                           TopTools_OrientedShapeMapHasher>::Iterator
+           aShapeIter(myShapes);
+       aShapeIter.More(); aShapeIter.Next()) {
+    if (!isUsed(aShapeIter.Value(), aRefs)) {
+      anUnused.Append(aShapeIter.Key());
+    }
+  }
+  for (NCollection_Sequence<TopoDS_Shape>::Iterator aShapeIter(anUnused);
+       aShapeIter.More(); aShapeIter.Next()) {
+    myShapes.UnBind(aShapeIter.Value());
+  }
+}
+
+// ================================================================
+// Function : Report
+// Purpose  :
+// ================================================================
+std::string GeometryRegistry::Report() {
+  std::lock_guard<std::mutex> aLock(myMutex);
+  size_t aNbMeshes = 0;
+  for (const auto &aBucket : myMeshes) {
+    aNbMeshes += aBucket.second.size();
+  }
+
+  std::ostringstream aStream;
+  aStream << "{\"meshes\":" << aNbMeshes << ",\"shapes\":" << myShapes.Extent()
+          << ",\"models\":" << myModels.size() << "}";
+  return aStream.str();
+}
+
+// ================================================================
+// Function : Instantiate
+// Purpose  :
+// ================================================================
+Handle(AIS_InteractiveObject)
+GeometryRegistry::Instantiate(const Handle(AIS_InteractiveObject) & theMaster,
+                              const gp_Trsf &theTrsf) {
+  Handle(AIS_ConnectedInteractive) anInstance = new AIS_ConnectedInteractive();
+  anInstance->Connect(theMaster, theTrsf);
+  anInstance->SetDisplayMode(theMaster->DisplayMode());
+  return anInstance;
+}
+
+// ================================================================
+// Function : copyInstance
+// Purpose  :
+// ================================================================
+Handle(AIS_InteractiveObject)
+GeometryRegistry::copyInstance(const Handle(AIS_InteractiveObject) & theObj) {
+  if (Handle(AIS_ConnectedInteractive) aConnected =
+          Handle(AIS_ConnectedInteractive)::DownCast(theObj)) {
+    return Instantiate(aConnected->ConnectedTo(),
+                       aConnected->LocalTransformation());
+  }
+
+  Handle(AIS_MultipleConnectedInteractive) anAssembly =
+      Handle(AIS_MultipleConnectedInteractive)::DownCast(theObj);
+  if (anAssembly.IsNull()) {
+    return Handle(AIS_InteractiveObject)();
+  }
+
+  Handle(AIS_MultipleConnectedInteractive) aCopy =
+      new AIS_MultipleConnectedInteractive();
+  for (PrsMgr_ListOfPresentableObjectsIter aChildIter(anAssembly->Children());
+       aChildIter.More(); aChildIter.Next()) {
+    Handle(AIS_ConnectedInteractive) aChild =
+        Handle(AIS_ConnectedInteractive)::DownCast(aChildIter.Value());
+    if (!aChild.IsNull()) {
+      aCopy->Connect(aChild->ConnectedTo(), aChild->LocalTransformation());
+    }
+  }
+  aCopy->SetDisplayMode(anAssembly->DisplayMode());
+  aCopy->SetLocalTransformation(anAssembly->LocalTransformation());
+  aCopy->SetOwner(anAssembly->GetOwner());
+  return aCopy;
+}
+
+// ================================================================
+// Function : Placements
+// Purpose  :
+// ================================================================
+void GeometryRegistry::Placements(
+    const Handle(AIS_InteractiveObject) & theObj,
+    NCollection_Sequence<Placement> &thePlacements) {
+  if (theObj.IsNull()) {
+    return;
+  }
+
+  Placement aPlacement;
+  aPlacement.Trsf = theObj->Transformation();
+  if (Handle(AIS_ConnectedInteractive) aConnected =
+          Handle(AIS_ConnectedInteractive)::DownCast(theObj)) {
+    aPlacement.Master = aConnected->ConnectedTo();
+    thePlacements.Append(aPlacement);
+  } else if (theObj->IsKind(STANDARD_TYPE(AIS_MultipleConnectedInteractive))) {
+    for (PrsMgr_ListOfPresentableObjectsIter aChildIter(theObj->Children());
+         aChildIter.More(); aChildIter.Next()) {
+      Placements(Handle(AIS_InteractiveObject)::DownCast(aChildIter.Value()),
+                 thePlacements);
+    }
+  } else {
+    aPlacement.Master = theObj;
+    thePlacements.Append(aPlacement);
+  }
+}
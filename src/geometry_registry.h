@@ -0,0 +1,98 @@
+#pragma once
+
+#include <AIS_InteractiveObject.hxx>
+#include <NCollection_DataMap.hxx>
+#include <NCollection_Sequence.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Standard_Transient.hxx>
+#include <TopTools_OrientedShapeMapHasher.hxx>
+#include <TopoDS_Shape.hxx>
+#include <gp_Trsf.hxx>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ModelLoadStats;
+
+class GeometryRegistry;
+DEFINE_STANDARD_HANDLE(GeometryRegistry, Standard_Transient)
+
+//! Registry of unique geometry shared by scene objects.
+//! Each unique triangulation (keyed by content hash) or shape (keyed by
+//! TopoDS_TShape and orientation) gets a single master presentation, which
+//! is never displayed itself. Scene objects are AIS_ConnectedInteractive
+//! instances of masters holding only transformation and display attributes,
+//! so that triangulation and GPU buffers are shared between instances.
+//! Compounds are split into instances of their parts grouped within
+//! AIS_MultipleConnectedInteractive.
+//! Methods are thread-safe, so that load jobs may register geometry.
+class GeometryRegistry : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(GeometryRegistry, Standard_Transient)
+public:
+  //! Master presentation with its placement within a scene object.
+  struct Placement {
+    Handle(AIS_InteractiveObject) Master;
+    gp_Trsf Trsf; //!< transformation of the master in world coordinates
+  };
+
+public:
+  GeometryRegistry();
+
+  //! Return instance of the mesh presentation of the triangulation.
+  //! Triangulation is dropped if equal one has been registered before.
+  Handle(AIS_InteractiveObject)
+  AddMesh(const Handle(Poly_Triangulation) & theTriangulation,
+          ModelLoadStats *theStats = nullptr);
+
+  //! Return instance of the shaded presentation of the meshed shape.
+  //! Compounds are split into instances of their parts.
+  Handle(AIS_InteractiveObject) AddShape(const TopoDS_Shape &theShape);
+
+  //! Create new instances of the model registered with the key.
+  //! @param theKey [in] content key, see TessellationCache::MakeKey()
+  //! @return FALSE if there is no such model
+  bool FindModel(const std::string &theKey,
+                 NCollection_Sequence<Handle(AIS_InteractiveObject)> &thePrs);
+
+  //! Register instances created for the model data.
+  void AddModel(const std::string &theKey,
+                const NCollection_Sequence<Handle(AIS_InteractiveObject)> &thePrs);
+
+  //! Release geometry not referenced by scene objects anymore.
+  void Purge();
+
+  //! Return statistics as JSON object.
+  std::string Report();
+
+  //! Create instance of the master presentation.
+  static Handle(AIS_InteractiveObject)
+  Instantiate(const Handle(AIS_InteractiveObject) & theMaster,
+              const gp_Trsf &theTrsf);
+
+  //! Collect master presentations of the scene object.
+  //! Objects not created by the registry are masters of themselves.
+  static void Placements(const Handle(AIS_InteractiveObject) & theObj,
+                         NCollection_Sequence<Placement> &thePlacements);
+
+private:
+  //! Return master of the shape located at origin.
+  Handle(AIS_InteractiveObject) shapeMaster(const TopoDS_Shape &theShape);
+
+  //! Copy instance of the registered model.
+  static Handle(AIS_InteractiveObject)
+  copyInstance(const Handle(AIS_InteractiveObject) & theObj);
+
+private:
+  std::unordered_map<uint64_t, std::vector<Handle(AIS_InteractiveObject)>>
+      myMeshes; //!< mesh masters by triangulation hash
+  NCollection_DataMap<TopoDS_Shape, Handle(AIS_InteractiveObject),
+                      TopTools_OrientedShapeMapHasher>
+      myShapes; //!< shape masters by shape located at origin
+  std::map<std::string, NCollection_Sequence<Handle(AIS_InteractiveObject)>>
+      myModels; //!< instances of loaded models by content key
+  std::mutex myMutex;
+};
@@ -0,0 +1,136 @@
+#include "gltf_scene_writer.h"
+
+#include <AIS_Shape.hxx>
+#include <BRep_Builder.hxx>
+#include <MeshVS_Mesh.hxx>
+#include <NCollection_DataMap.hxx>
+#include <RWGltf_CafWriter.hxx>
+#include <TColStd_IndexedDataMapOfStringString.hxx>
+#include <TDataStd_Name.hxx>
+#include <TDocStd_Document.hxx>
+#include <TopoDS_Face.hxx>
+#include <XCAFApp_Application.hxx>
+#include <XCAFDoc_ColorTool.hxx>
+#include <XCAFDoc_DocumentTool.hxx>
+#include <XCAFDoc_ShapeTool.hxx>
+
+#include <mutex>
+
+#include "XSDRAWSTLVRML_DataSource.h"
+#include "geometry_registry.h"
+#include "model_factory.h"
+#include "step_assembly.h"
+#include "trace_events.h"
+
+namespace {
+
+//! Part of the document written for master presentation.
+struct PartRef {
+  TDF_Label Label; //!< part located at origin, null if not meshed
+  TopLoc_Location Location; //!< own location of the master shape
+};
+
+//! Return shape of the master presentation: shape of shaded presentation,
+//! or face holding triangulation of mesh presentation.
+TopoDS_Shape masterShape(const Handle(AIS_InteractiveObject) & theMaster) {
+  if (Handle(AIS_Shape) aShapePrs = Handle(AIS_Shape)::DownCast(theMaster)) {
+    return aShapePrs->Shape();
+  }
+
+  Handle(MeshVS_Mesh) aMesh = Handle(MeshVS_Mesh)::DownCast(theMaster);
+  if (aMesh.IsNull()) {
+    return TopoDS_Shape();
+  }
+  Handle(XSDRAWSTLVRML_DataSource) aDataSource =
+      Handle(XSDRAWSTLVRML_DataSource)::DownCast(aMesh->GetDataSource());
+  if (aDataSource.IsNull() || aDataSource->Triangulation().IsNull()) {
+    return TopoDS_Shape();
+  }
+  TopoDS_Face aFace;
+  BRep_Builder().MakeFace(aFace, aDataSource->Triangulation());
+  return aFace;
+}
+
+} // namespace
+
+// ================================================================
+// Function : Write
+// Purpose  :
+// ================================================================
+bool GltfSceneWriter::Write(const SceneObjectMap &theObjects,
+                            const TCollection_AsciiString &thePath,
+                            const Message_ProgressRange &theProgress) {
+  TRACE_SCOPE("write glTF");
+  Handle(XCAFApp_Application) anApp;
+  Handle(TDocStd_Document) aDoc;
+  {
+    std::lock_guard<std::mutex> aLock(StepAssembly::XcafMutex());
+    anApp = XCAFApp_Application::GetApplication();
+    anApp->NewDocument("BinXCAF", aDoc);
+  }
+
+  Handle(XCAFDoc_ShapeTool) aShapeTool =
+      XCAFDoc_DocumentTool::ShapeTool(aDoc->Main());
+  Handle(XCAFDoc_ColorTool) aColorTool =
+      XCAFDoc_DocumentTool::ColorTool(aDoc->Main());
+  // part of each master, shared by all its placements
+  NCollection_DataMap<Handle(Standard_Transient), PartRef> aParts;
+  int aNbInstances = 0;
+  for (SceneObjectMap::Iterator anObjIter(theObjects); anObjIter.More();
+       anObjIter.Next()) {
+    NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+    GeometryRegistry::Placements(anObjIter.Value(), aPlacements);
+    TDF_Label anObjLabel;
+    for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+             aPlacementIter(aPlacements);
+         aPlacementIter.More(); aPlacementIter.Next()) {
+      const Handle(AIS_InteractiveObject) &aMaster =
+          aPlacementIter.Value().Master;
+      PartRef aPart;
+      if (!aParts.Find(aMaster, aPart)) {
+        const TopoDS_Shape aShape = masterShape(aMaster);
+        if (!aShape.IsNull() && ModelFactory::IsTriangulated(aShape)) {
+          aPart.Label = aShapeTool->AddShape(aShape.Located(TopLoc_Location()),
+                                             Standard_False);
+          aPart.Location = aShape.Location();
+          if (aMaster->HasColor()) {
+            Quantity_Color aColor;
+            aMaster->Color(aColor);
+            aColorTool->SetColor(aPart.Label, aColor, XCAFDoc_ColorSurf);
+          }
+        }
+        aParts.Bind(aMaster, aPart);
+      }
+      if (aPart.Label.IsNull()) {
+        continue;
+      }
+
+      if (anObjLabel.IsNull()) {
+        anObjLabel = aShapeTool->NewShape();
+        TDataStd_Name::Set(anObjLabel, anObjIter.Key());
+      }
+      aShapeTool->AddComponent(
+          anObjLabel, aPart.Label,
+          TopLoc_Location(aPlacementIter.Value().Trsf) * aPart.Location);
+      ++aNbInstances;
+    }
+  }
+
+  bool isDone = false;
+  if (aNbInstances > 0) {
+    aShapeTool->UpdateAssemblies();
+    RWGltf_CafWriter aWriter(thePath, Standard_True);
+    aWriter.SetTransformationFormat(RWGltf_WriterTrsfFormat_Compact);
+    // viewer is Z-up, while glTF is Y-up
+    aWriter.ChangeCoordinateSystemConverter().SetInputCoordinateSystem(
+        RWMesh_CoordinateSystem_Zup);
+    isDone = aWriter.Perform(aDoc, TColStd_IndexedDataMapOfStringString(),
+                             theProgress);
+  }
+
+  {
+    std::lock_guard<std::mutex> aLock(StepAssembly::XcafMutex());
+    anApp->Close(aDoc);
+  }
+  return isDone;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Message_ProgressRange.hxx>
+#include <TCollection_AsciiString.hxx>
+
+#include "scene_memory.h"
+
+//! Writer of scene objects into binary glTF file (GLB).
+//! Objects are gathered into intermediate XCAF document written by
+//! RWGltf_CafWriter: each master presentation (see
+//! GeometryRegistry::Placements()) becomes a part, and each its placement
+//! an instance, so that geometry shared between objects is stored once
+//! within the common binary buffer and referred to by located nodes.
+//! Shaded shapes are written with their triangulation, meshes with their
+//! triangles; parts not meshed yet are skipped.
+class GltfSceneWriter {
+public:
+  //! Write objects into the file.
+  //! @param theObjects [in] scene objects by name, names become root nodes
+  //! @param thePath    [in] output file path
+  //! @return FALSE if there is nothing to write or on writing error
+  static bool
+  Write(const SceneObjectMap &theObjects, const TCollection_AsciiString &thePath,
+        const Message_ProgressRange &theProgress = Message_ProgressRange());
+};
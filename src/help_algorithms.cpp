@@ -2,8 +2,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
 #include <string.h>
 
+#include "trace_events.h"
+
 /*
  * indexes is the index of vertexes
  * edges and triangles are the outputs.
@@ -11,16 +16,19 @@
  * triangles indicate by the edges indexes
  */
 bool file_edges(
-    std::vector<unsigned int> &indexes,
+    const std::vector<unsigned int> &indexes,
     std::vector<std::tuple<unsigned int, unsigned int>> &edges,
     std::vector<std::tuple<unsigned int, unsigned int, unsigned int>>
-        &triangles) {
+        &triangles,
+    std::pmr::memory_resource *arena) {
+  TRACE_SCOPE("edge extraction");
   // too large to process
   if (indexes.size() > 0x07fffffff) {
     return false;
   }
 
-  std::vector<unsigned long long> edgesTmp;
+  std::pmr::vector<unsigned long long> edgesTmp(arena);
+  edgesTmp.reserve(indexes.size());
 
   // get all the edges
   for (size_t i = 0; i < indexes.size() / 3; i++) {
@@ -37,7 +45,7 @@ bool file_edges(
   }
 
   // remove dupplicated edges
-  std::vector<unsigned int> sequence(indexes.size());
+  std::pmr::vector<unsigned int> sequence(indexes.size(), arena);
   for (unsigned int i = 0; i < sequence.size(); i++) {
     sequence[i] = i;
   }
@@ -45,11 +53,11 @@ bool file_edges(
   std::reverse(sequence.begin(), sequence.end());
 
   std::sort(sequence.begin(), sequence.end(),
-            [edgesTmp](unsigned int a, unsigned int b) {
+            [&edgesTmp](unsigned int a, unsigned int b) {
               return edgesTmp[a] < edgesTmp[b];
             });
 
-  std::vector<unsigned int> dupMap(sequence.size());
+  std::pmr::vector<unsigned int> dupMap(sequence.size(), arena);
   unsigned long long prevPos = std::numeric_limits<unsigned long long>::max();
   unsigned int mapTo = 0;
   unsigned int targetSize = 0;
@@ -110,4 +118,98 @@ bool test_file_extension(const std::string &targetString,
   return (::strcasecmp(targetString.c_str() + targetString.length() -
                            subString.length(),
                        subString.c_str())) == 0;
-}
\ No newline at end of file
+}
+
+bool decimate_mesh(const std::vector<float> &vertexes,
+                   const std::vector<unsigned int> &indexes,
+                   size_t targetTriangles, std::vector<float> &outVertexes,
+                   std::vector<unsigned int> &outIndexes) {
+  TRACE_SCOPE("decimation");
+  outVertexes.clear();
+  outIndexes.clear();
+  const size_t vertexCount = vertexes.size() / 3;
+  if (vertexCount == 0 || indexes.size() < 3 || targetTriangles == 0) {
+    return false;
+  }
+
+  float minPos[3], maxPos[3];
+  for (size_t j = 0; j < 3; j++) {
+    minPos[j] = maxPos[j] = vertexes[j];
+  }
+  for (size_t i = 1; i < vertexCount; i++) {
+    for (size_t j = 0; j < 3; j++) {
+      minPos[j] = std::min(minPos[j], vertexes[i * 3 + j]);
+      maxPos[j] = std::max(maxPos[j], vertexes[i * 3 + j]);
+    }
+  }
+
+  // surface meshes have about twice as many triangles as vertexes, and the
+  // number of occupied cells grows with the square of the grid resolution
+  const double cellsPerAxis =
+      std::max(2.0, std::sqrt((double)targetTriangles / 2.0));
+  double cellSize = 0.0;
+  for (size_t j = 0; j < 3; j++) {
+    cellSize = std::max(cellSize, (double)(maxPos[j] - minPos[j]));
+  }
+  cellSize = cellSize > 0.0 ? cellSize / cellsPerAxis : 1.0;
+
+  std::unordered_map<unsigned long long, unsigned int> cells;
+  std::vector<unsigned int> vertexMap(vertexCount);
+  std::vector<double> sums;
+  std::vector<unsigned int> counts;
+  for (size_t i = 0; i < vertexCount; i++) {
+    unsigned long long key = 0;
+    for (size_t j = 0; j < 3; j++) {
+      const auto cell = static_cast<unsigned long long>(
+          (vertexes[i * 3 + j] - minPos[j]) / cellSize);
+      key = (key << 21) | (cell & 0x1fffff);
+    }
+
+    auto inserted = cells.emplace(key, static_cast<unsigned int>(counts.size()));
+    if (inserted.second) {
+      sums.resize(sums.size() + 3, 0.0);
+      counts.push_back(0);
+    }
+    const unsigned int cluster = inserted.first->second;
+    vertexMap[i] = cluster;
+    counts[cluster]++;
+    for (size_t j = 0; j < 3; j++) {
+      sums[cluster * 3 + j] += vertexes[i * 3 + j];
+    }
+  }
+
+  outVertexes.resize(counts.size() * 3);
+  for (size_t i = 0; i < counts.size(); i++) {
+    for (size_t j = 0; j < 3; j++) {
+      outVertexes[i * 3 + j] = static_cast<float>(sums[i * 3 + j] / counts[i]);
+    }
+  }
+
+  for (size_t i = 0; i + 2 < indexes.size(); i += 3) {
+    const unsigned int p1 = vertexMap[indexes[i]];
+    const unsigned int p2 = vertexMap[indexes[i + 1]];
+    const unsigned int p3 = vertexMap[indexes[i + 2]];
+    if (p1 != p2 && p2 != p3 && p1 != p3) {
+      outIndexes.push_back(p1);
+      outIndexes.push_back(p2);
+      outIndexes.push_back(p3);
+    }
+  }
+  return !outIndexes.empty();
+}
+
+void write_json_string(std::ostream &stream, const char *str) {
+  stream << '"';
+  for (const char *c = str; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      stream << '\\' << *c;
+    } else if ((unsigned char)*c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*c);
+      stream << escaped;
+    } else {
+      stream << *c;
+    }
+  }
+  stream << '"';
+}
@@ -1,14 +1,37 @@
 #pragma once
 
+#include <memory_resource>
+#include <ostream>
 #include <tuple>
 #include <vector>
 #include <string>
 
+/*
+ * temporary buffers are allocated from arena, which may be shared by
+ * several algorithms of one load and released at once.
+ */
 bool file_edges(
     const std::vector<unsigned int> &indexes,
     std::vector<std::tuple<unsigned int, unsigned int>> &edges,
     std::vector<std::tuple<unsigned int, unsigned int, unsigned int>>
-        &triangles);
+        &triangles,
+    std::pmr::memory_resource *arena = std::pmr::get_default_resource());
 
 bool test_file_extension(const std::string &targetString,
-                         const std::string &subString);
\ No newline at end of file
+                         const std::string &subString);
+
+/*
+ * simplify indexed mesh by clustering vertexes on a regular grid,
+ * targetTriangles is the approximate number of output triangles.
+ * degenerated triangles are removed.
+ */
+bool decimate_mesh(const std::vector<float> &vertexes,
+                   const std::vector<unsigned int> &indexes,
+                   size_t targetTriangles, std::vector<float> &outVertexes,
+                   std::vector<unsigned int> &outIndexes);
+
+/*
+ * write str as JSON string literal, quotes, backslashes and control
+ * characters are escaped.
+ */
+void write_json_string(std::ostream &stream, const char *str);
\ No newline at end of file
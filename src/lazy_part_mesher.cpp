@@ -0,0 +1,273 @@
+#include "lazy_part_mesher.h"
+
+#include <BRepBndLib.hxx>
+#include <Graphic3d_ArrayOfSegments.hxx>
+#include <Prs3d_BndBox.hxx>
+#include <Prs3d_LineAspect.hxx>
+#include <Select3D_SensitiveBox.hxx>
+#include <SelectMgr_EntityOwner.hxx>
+#include <TColStd_MapOfTransient.hxx>
+
+#include <algorithm>
+
+#include "geometry_registry.h"
+#include "progressive_mesher.h"
+#include "projected_size.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(LazyPartPrs, AIS_Shape)
+IMPLEMENT_STANDARD_RTTIEXT(LazyPartMesher, Standard_Transient)
+
+namespace {
+//! Part is left as placeholder after this number of failed batches.
+static const int THE_MAX_FAILURES = 3;
+} // namespace
+
+// ================================================================
+// Function : LazyPartPrs
+// Purpose  :
+// ================================================================
+LazyPartPrs::LazyPartPrs(const TopoDS_Shape &theShape)
+    : AIS_Shape(theShape), myIsMeshed(false) {
+  // box of the surfaces is enough for placeholder and is cheap to compute
+  BRepBndLib::Add(theShape, myPartBox, Standard_False);
+
+  // same attributes as ModelFactory::CreateMeshedShape()
+  myDrawer->SetAutoTriangulation(Standard_False);
+  SetMaterial(Graphic3d_NameOfMaterial_Silver);
+  SetDisplayMode(AIS_Shaded);
+}
+
+// ================================================================
+// Function : Compute
+// Purpose  :
+// ================================================================
+void LazyPartPrs::Compute(const Handle(PrsMgr_PresentationManager) & thePrsMgr,
+                          const Handle(Prs3d_Presentation) & thePrs,
+                          const Standard_Integer theMode) {
+  if (myIsMeshed) {
+    AIS_Shape::Compute(thePrsMgr, thePrs, theMode);
+    return;
+  }
+  if (myPartBox.IsVoid()) {
+    return;
+  }
+
+  Handle(Graphic3d_Group) aGroup = thePrs->NewGroup();
+  aGroup->SetGroupPrimitivesAspect(myDrawer->WireAspect()->Aspect());
+  aGroup->AddPrimitiveArray(Prs3d_BndBox::FillSegments(myPartBox));
+}
+
+// ================================================================
+// Function : ComputeSelection
+// Purpose  :
+// ================================================================
+void LazyPartPrs::ComputeSelection(const Handle(SelectMgr_Selection) & theSel,
+                                   const Standard_Integer theMode) {
+  if (myIsMeshed) {
+    AIS_Shape::ComputeSelection(theSel, theMode);
+    return;
+  }
+  if (theMode != 0 || myPartBox.IsVoid()) {
+    return;
+  }
+
+  Handle(SelectMgr_EntityOwner) anOwner = new SelectMgr_EntityOwner(this);
+  theSel->Add(new Select3D_SensitiveBox(anOwner, myPartBox));
+}
+
+// ================================================================
+// Function : LazyPartMesher
+// Purpose  :
+// ================================================================
+LazyPartMesher::LazyPartMesher(double theMinSize, int thePartsPerBatch)
+    : myWinSize(0, 0), myIsChanged(false), myMinSize(theMinSize),
+      myPartsPerBatch(std::max(thePartsPerBatch, 1)) {}
+
+// ================================================================
+// Function : SetMinSize
+// Purpose  :
+// ================================================================
+void LazyPartMesher::SetMinSize(double theMinSize) {
+  myMinSize = theMinSize;
+  myIsChanged = true;
+}
+
+// ================================================================
+// Function : Add
+// Purpose  :
+// ================================================================
+void LazyPartMesher::Add(const Handle(AIS_InteractiveObject) & thePrs) {
+  NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+  GeometryRegistry::Placements(thePrs, aPlacements);
+  for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+           aPlacementIter(aPlacements);
+       aPlacementIter.More(); aPlacementIter.Next()) {
+    Handle(LazyPartPrs) aPart =
+        Handle(LazyPartPrs)::DownCast(aPlacementIter.Value().Master);
+    if (aPart.IsNull() || aPart->IsMeshed()) {
+      continue;
+    }
+
+    // the part may be placed many times within one or several objects
+    const auto aPartIndex = myPartIndices.find(aPart.get());
+    if (aPartIndex == myPartIndices.end()) {
+      PartItem anItem;
+      anItem.Part = aPart;
+      anItem.Size = 0.0;
+      anItem.NbFailures = 0;
+      myPartIndices[aPart.get()] = (int)myParts.size();
+      myParts.push_back(anItem);
+    }
+    PartItem &anItem = myParts[myPartIndices[aPart.get()]];
+    if (std::find(anItem.Objects.begin(), anItem.Objects.end(), thePrs) ==
+        anItem.Objects.end()) {
+      anItem.Objects.push_back(thePrs);
+    }
+    anItem.Boxes.push_back(
+        aPart->PartBox().Transformed(aPlacementIter.Value().Trsf));
+    myIsChanged = true;
+  }
+}
+
+// ================================================================
+// Function : Clear
+// Purpose  :
+// ================================================================
+void LazyPartMesher::Clear() {
+  myParts.clear();
+  myPartIndices.clear();
+}
+
+// ================================================================
+// Function : NextBatch
+// Purpose  :
+// ================================================================
+Handle(LoadJob)
+LazyPartMesher::NextBatch(const Handle(AIS_InteractiveContext) & theCtx,
+                          const Handle(V3d_View) & theView,
+                          const ModelMeshParams &theParams) {
+  if (!myJob.IsNull() || myParts.empty()) {
+    return Handle(LoadJob)();
+  }
+
+  // priorities depend only on the camera, so unchanged view is not
+  // evaluated again for every redraw
+  Graphic3d_Vec2i aWinSize;
+  theView->Window()->Size(aWinSize.x(), aWinSize.y());
+  const Handle(Graphic3d_Camera) &aCamera = theView->Camera();
+  if (!myIsChanged && aWinSize == myWinSize &&
+      !aCamera->WorldViewProjState().IsChanged(myCameraState)) {
+    return Handle(LoadJob)();
+  }
+  myIsChanged = false;
+  myWinSize = aWinSize;
+  myCameraState = aCamera->WorldViewProjState();
+
+  // drop parts of removed objects
+  myParts.erase(std::remove_if(myParts.begin(), myParts.end(),
+                               [&](const PartItem &theItem) {
+                                 return std::none_of(
+                                     theItem.Objects.begin(),
+                                     theItem.Objects.end(),
+                                     [&](const Handle(AIS_InteractiveObject) &
+                                         theObj) {
+                                       return theCtx->DisplayStatus(theObj) !=
+                                              AIS_DS_None;
+                                     });
+                               }),
+                myParts.end());
+
+  const double aMinArea = myMinSize * myMinSize;
+  size_t aNbVisible = 0;
+  for (PartItem &anItem : myParts) {
+    anItem.Size = 0.0;
+    for (const Bnd_Box &aBox : anItem.Boxes) {
+      anItem.Size =
+          std::max(anItem.Size, ProjectedBoxArea(aBox, aCamera, aWinSize));
+    }
+    if (anItem.Size >= aMinArea && anItem.Size > 0.0) {
+      ++aNbVisible;
+    }
+  }
+
+  const size_t aBatchSize = std::min(aNbVisible, (size_t)myPartsPerBatch);
+  if (aBatchSize == 0) {
+    indexParts();
+    return Handle(LoadJob)();
+  }
+
+  std::nth_element(myParts.begin(), myParts.begin() + (aBatchSize - 1),
+                   myParts.end(),
+                   [](const PartItem &theLeft, const PartItem &theRight) {
+                     return theLeft.Size > theRight.Size;
+                   });
+
+  // deflection is derived from the size of each part, unless it is explicit
+  myJob = new FaceRefineJob();
+  for (size_t aPartIter = 0; aPartIter < aBatchSize; ++aPartIter) {
+    const Handle(LazyPartPrs) &aPart = myParts[aPartIter].Part;
+    myJob->Add(aPart->Shape(), theParams.ForBox(aPart->PartBox()));
+    myJobParts.push_back(myParts[aPartIter]);
+  }
+  myParts.erase(myParts.begin(), myParts.begin() + aBatchSize);
+  indexParts();
+
+  // the rest of visible parts is taken by the next batch
+  myIsChanged = aNbVisible > aBatchSize;
+  return myJob;
+}
+
+// ================================================================
+// Function : Commit
+// Purpose  :
+// ================================================================
+bool LazyPartMesher::Commit(const Handle(LoadJob) & theJob,
+                            const Handle(AIS_InteractiveContext) & theCtx) {
+  if (myJob.IsNull() || theJob != myJob) {
+    return false;
+  }
+
+  Handle(FaceRefineJob) aJob = myJob;
+  myJob.Nullify();
+  if (aJob->GetState() != LoadJob::State_Done) {
+    // parts are meshed again by the next batches, unless they keep failing
+    for (PartItem &anItem : myJobParts) {
+      if (++anItem.NbFailures < THE_MAX_FAILURES &&
+          myPartIndices.find(anItem.Part.get()) == myPartIndices.end()) {
+        myParts.push_back(anItem);
+      }
+    }
+    myJobParts.clear();
+    indexParts();
+    myIsChanged = true;
+    return true;
+  }
+
+  aJob->Apply();
+  TColStd_MapOfTransient aRecomputed;
+  for (const PartItem &anItem : myJobParts) {
+    anItem.Part->SetMeshed();
+    // shared master is not displayed itself, only connected to objects
+    theCtx->Redisplay(anItem.Part, Standard_False);
+    for (const Handle(AIS_InteractiveObject) &anObj : anItem.Objects) {
+      if (theCtx->DisplayStatus(anObj) != AIS_DS_None &&
+          aRecomputed.Add(anObj)) {
+        theCtx->Redisplay(anObj, Standard_False);
+        theCtx->RecomputeSelectionOnly(anObj);
+      }
+    }
+  }
+  myJobParts.clear();
+  return true;
+}
+
+// ================================================================
+// Function : indexParts
+// Purpose  :
+// ================================================================
+void LazyPartMesher::indexParts() {
+  myPartIndices.clear();
+  for (size_t aPartIter = 0; aPartIter < myParts.size(); ++aPartIter) {
+    myPartIndices[myParts[aPartIter].Part.get()] = (int)aPartIter;
+  }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <Bnd_Box.hxx>
+#include <Graphic3d_WorldViewProjState.hxx>
+#include <V3d_View.hxx>
+
+#include <unordered_map>
+#include <vector>
+
+#include "load_job_queue.h"
+#include "model_factory.h"
+#include "progressive_mesher.h"
+
+class LazyPartPrs;
+DEFINE_STANDARD_HANDLE(LazyPartPrs, AIS_Shape)
+
+//! Shape presentation of assembly part meshed on demand.
+//! Until the part is meshed (see LazyPartMesher), its bounding box is
+//! displayed and selected instead, so that the assembly can be shown right
+//! after its structure has been read.
+class LazyPartPrs : public AIS_Shape {
+  DEFINE_STANDARD_RTTIEXT(LazyPartPrs, AIS_Shape)
+public:
+  //! Create placeholder of the part not meshed yet.
+  LazyPartPrs(const TopoDS_Shape &theShape);
+
+  //! Return TRUE if part has been meshed and is displayed as a shape.
+  bool IsMeshed() const { return myIsMeshed; }
+
+  //! Switch presentation to the meshed part; presentation should be
+  //! recomputed afterwards.
+  void SetMeshed() { myIsMeshed = true; }
+
+  //! Return bounding box of the part located at origin.
+  const Bnd_Box &PartBox() const { return myPartBox; }
+
+protected:
+  //! Compute box placeholder or shaded shape.
+  virtual void Compute(const Handle(PrsMgr_PresentationManager) & thePrsMgr,
+                       const Handle(Prs3d_Presentation) & thePrs,
+                       const Standard_Integer theMode) override;
+
+  //! Compute selection of the box placeholder or of the shape.
+  virtual void ComputeSelection(const Handle(SelectMgr_Selection) & theSel,
+                                const Standard_Integer theMode) override;
+
+private:
+  Bnd_Box myPartBox;
+  bool myIsMeshed;
+};
+
+class LazyPartMesher;
+DEFINE_STANDARD_HANDLE(LazyPartMesher, Standard_Transient)
+
+//! On-demand tessellation of assembly parts.
+//! Parts displayed as box placeholders (see LazyPartPrs) are meshed in
+//! background batches, only once they are visible and their projected size
+//! exceeds the threshold, largest on the screen first. Like
+//! ProgressiveMesher, batches are executed one at a time, and each shared
+//! part is meshed once for all objects displaying it.
+class LazyPartMesher : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(LazyPartMesher, Standard_Transient)
+public:
+  //! @param theMinSize      [in] minimal projected size in pixels of meshed
+  //!                             parts
+  //! @param thePartsPerBatch [in] maximal number of parts meshed at once
+  LazyPartMesher(double theMinSize = 4.0, int thePartsPerBatch = 16);
+
+  //! Set minimal projected size in pixels of meshed parts.
+  void SetMinSize(double theMinSize);
+
+  //! Add placeholders of parts displayed by the object.
+  void Add(const Handle(AIS_InteractiveObject) & thePrs);
+
+  //! Drop all pending parts.
+  void Clear();
+
+  //! Return TRUE if there are parts not yet meshed.
+  bool HasPending() const { return !myParts.empty(); }
+
+  //! Return TRUE if mesh batch is being executed.
+  bool IsRunning() const { return !myJob.IsNull(); }
+
+  //! Return number of parts not yet meshed.
+  int NbPending() const { return (int)myParts.size(); }
+
+  //! Create job meshing visible parts with the largest projected size.
+  //! Parts of removed presentations are dropped.
+  //! @return NULL if there is nothing to mesh in the current view or batch
+  //!         is already running
+  Handle(LoadJob) NextBatch(const Handle(AIS_InteractiveContext) & theCtx,
+                            const Handle(V3d_View) & theView,
+                            const ModelMeshParams &theParams);
+
+  //! Display parts meshed by the job.
+  //! Parts of a failed or cancelled job are put back to the pending ones,
+  //! unless they have failed too many times.
+  //! @return FALSE if job has not been created by this mesher
+  bool Commit(const Handle(LoadJob) & theJob,
+              const Handle(AIS_InteractiveContext) & theCtx);
+
+private:
+  //! Update indices of pending parts after reordering.
+  void indexParts();
+
+private:
+  //! Part pending tessellation.
+  struct PartItem {
+    Handle(LazyPartPrs) Part;
+    std::vector<Handle(AIS_InteractiveObject)> Objects; //!< displaying it
+    std::vector<Bnd_Box> Boxes; //!< boxes of instances in world coordinates
+    double Size; //!< largest projected area in pixels, updated for each batch
+    int NbFailures; //!< failed batches including the part
+  };
+
+private:
+  std::vector<PartItem> myParts;
+  std::unordered_map<const LazyPartPrs *, int> myPartIndices;
+  std::vector<PartItem> myJobParts; //!< parts meshed by the running batch
+  Handle(FaceRefineJob) myJob;
+  Graphic3d_WorldViewProjState myCameraState; //!< camera of the last batch
+  Graphic3d_Vec2i myWinSize;                  //!< window of the last batch
+  bool myIsChanged; //!< parts have been added since the last batch
+  double myMinSize;
+  int myPartsPerBatch;
+};
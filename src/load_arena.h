@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory_resource>
+
+//! Arena for transient buffers of one load, as std::pmr memory resource for
+//! standard containers. Individual deallocations are no-ops; all memory is
+//! released at once when the arena is destroyed, so that the load does not
+//! fragment the long-lived heap.
+class LoadArena {
+public:
+  //! Size of memory blocks requested from the heap.
+  static const size_t THE_BLOCK_SIZE = 1024 * 1024;
+
+  LoadArena() : myResource(THE_BLOCK_SIZE) {}
+
+  //! Return memory resource for std::pmr containers.
+  std::pmr::memory_resource *Resource() { return &myResource; }
+
+private:
+  LoadArena(const LoadArena &) = delete;
+  LoadArena &operator=(const LoadArena &) = delete;
+
+private:
+  std::pmr::monotonic_buffer_resource myResource;
+};
@@ -0,0 +1,279 @@
+#include "load_job_queue.h"
+
+#include <Message.hxx>
+#include <Message_ProgressIndicator.hxx>
+#include <Message_ProgressScope.hxx>
+#include <OSD_ThreadPool.hxx>
+#include <Standard_Failure.hxx>
+
+#include "trace_events.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(LoadJob, Standard_Transient)
+IMPLEMENT_STANDARD_RTTIEXT(LoadJobQueue, Standard_Transient)
+
+namespace {
+std::atomic<int> THE_LAST_JOB_ID(0);
+} // namespace
+
+//! Progress indicator forwarding position and cancellation to the job.
+class LoadJobProgress : public Message_ProgressIndicator {
+public:
+  LoadJobProgress(LoadJob *theJob) : myJob(theJob) {}
+
+  virtual Standard_Boolean UserBreak() Standard_OVERRIDE {
+    return myJob->IsCancelled();
+  }
+
+  virtual void Show(const Message_ProgressScope &,
+                    const Standard_Boolean) Standard_OVERRIDE {
+    myJob->myProgress = GetPosition();
+  }
+
+private:
+  LoadJob *myJob;
+};
+
+// ================================================================
+// Function : LoadJob
+// Purpose  :
+// ================================================================
+LoadJob::LoadJob(const TCollection_AsciiString &theName)
+    : myName(theName), myId(++THE_LAST_JOB_ID), myState(State_Queued),
+      myProgress(0.0), myToCancel(false) {}
+
+// ================================================================
+// Function : ~LoadJob
+// Purpose  :
+// ================================================================
+LoadJob::~LoadJob() {}
+
+// ================================================================
+// Function : Execute
+// Purpose  :
+// ================================================================
+void LoadJob::Execute() {
+  if (IsCancelled()) {
+    myState = State_Failed;
+    return;
+  }
+
+  TRACE_SCOPE("load job");
+  myState = State_Running;
+  bool isDone = false;
+  try {
+    Handle(LoadJobProgress) aProgress = new LoadJobProgress(this);
+    isDone = Perform(aProgress->Start());
+  } catch (const Standard_Failure &theFailure) {
+    Message::SendFail() << "Error: loading of " << myName
+                        << " failed: " << theFailure.GetMessageString();
+  } catch (const std::exception &theException) {
+    Message::SendFail() << "Error: loading of " << myName
+                        << " failed: " << theException.what();
+  }
+
+  if (!isDone || IsCancelled()) {
+    myPresentations.Clear();
+    myState = State_Failed;
+    return;
+  }
+  myProgress = 1.0;
+  myState = State_Done;
+}
+
+// ================================================================
+// Function : LoadJobQueue
+// Purpose  :
+// ================================================================
+LoadJobQueue::LoadJobQueue(int theNbThreads)
+    : myToStop(false), myNbPending(0), myCompleted(nullptr) {
+#ifdef LOAD_JOB_QUEUE_THREADED
+  const int aNbThreads = theNbThreads > 0
+                            ? theNbThreads
+                            : OSD_ThreadPool::DefaultPool()->NbThreads();
+  for (int aThreadIter = 0; aThreadIter < aNbThreads; ++aThreadIter) {
+    myThreads.emplace_back(&LoadJobQueue::threadLoop, this);
+  }
+#else
+  (void)theNbThreads;
+#endif
+}
+
+// ================================================================
+// Function : ~LoadJobQueue
+// Purpose  :
+// ================================================================
+LoadJobQueue::~LoadJobQueue() {
+  {
+    std::lock_guard<std::mutex> aLock(myMutex);
+    myToStop = true;
+    for (const Handle(LoadJob) & aJob : myQueue) {
+      aJob->Cancel();
+    }
+    myQueue.clear();
+  }
+  myWakeUp.notify_all();
+  for (std::thread &aThread : myThreads) {
+    aThread.join();
+  }
+
+  for (CompletedNode *aNode = myCompleted.exchange(nullptr); aNode != nullptr;) {
+    CompletedNode *aNext = aNode->Next;
+    delete aNode;
+    aNode = aNext;
+  }
+}
+
+// ================================================================
+// Function : Submit
+// Purpose  :
+// ================================================================
+int LoadJobQueue::Submit(const Handle(LoadJob) & theJob) {
+  {
+    std::lock_guard<std::mutex> aLock(myMutex);
+    myQueue.push_back(theJob);
+    myJobs.Bind(theJob->Id(), theJob);
+    ++myNbPending;
+  }
+  myWakeUp.notify_one();
+  return theJob->Id();
+}
+
+// ================================================================
+// Function : Cancel
+// Purpose  :
+// ================================================================
+bool LoadJobQueue::Cancel(int theJobId) {
+  std::lock_guard<std::mutex> aLock(myMutex);
+  Handle(LoadJob) aJob;
+  if (!myJobs.Find(theJobId, aJob) || aJob->GetState() == LoadJob::State_Done ||
+      aJob->GetState() == LoadJob::State_Failed) {
+    return false;
+  }
+  aJob->Cancel();
+  return true;
+}
+
+// ================================================================
+// Function : Progress
+// Purpose  :
+// ================================================================
+double LoadJobQueue::Progress(int theJobId) {
+  std::lock_guard<std::mutex> aLock(myMutex);
+  Handle(LoadJob) aJob;
+  return myJobs.Find(theJobId, aJob) ? aJob->Progress() : -1.0;
+}
+
+// ================================================================
+// Function : RunNext
+// Purpose  :
+// ================================================================
+bool LoadJobQueue::RunNext() {
+  Handle(LoadJob) aJob;
+  {
+    std::lock_guard<std::mutex> aLock(myMutex);
+    if (myQueue.empty()) {
+      return false;
+    }
+    aJob = myQueue.front();
+    myQueue.pop_front();
+  }
+  executeJob(aJob);
+  return true;
+}
+
+// ================================================================
+// Function : Wait
+// Purpose  :
+// ================================================================
+void LoadJobQueue::Wait() {
+  if (myThreads.empty()) {
+    while (RunNext()) {
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> aLock(myMutex);
+  myIdle.wait(aLock, [this]() {
+    for (NCollection_DataMap<int, Handle(LoadJob)>::Iterator aJobIter(myJobs);
+         aJobIter.More(); aJobIter.Next()) {
+      const LoadJob::State aState = aJobIter.Value()->GetState();
+      if (aState == LoadJob::State_Queued || aState == LoadJob::State_Running) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+// ================================================================
+// Function : TakeCompleted
+// Purpose  :
+// ================================================================
+void LoadJobQueue::TakeCompleted(
+    NCollection_Sequence<Handle(LoadJob)> &theJobs) {
+  CompletedNode *aNode = myCompleted.exchange(nullptr);
+
+  // the list is filled as a stack, reverse it to restore completion order
+  CompletedNode *aReversed = nullptr;
+  while (aNode != nullptr) {
+    CompletedNode *aNext = aNode->Next;
+    aNode->Next = aReversed;
+    aReversed = aNode;
+    aNode = aNext;
+  }
+
+  while (aReversed != nullptr) {
+    CompletedNode *aNext = aReversed->Next;
+    {
+      std::lock_guard<std::mutex> aLock(myMutex);
+      myJobs.UnBind(aReversed->Job->Id());
+    }
+    theJobs.Append(aReversed->Job);
+    --myNbPending;
+    delete aReversed;
+    aReversed = aNext;
+  }
+}
+
+// ================================================================
+// Function : threadLoop
+// Purpose  :
+// ================================================================
+void LoadJobQueue::threadLoop() {
+  TraceRecorder::set_ThreadName("load worker");
+  for (;;) {
+    Handle(LoadJob) aJob;
+    {
+      std::unique_lock<std::mutex> aLock(myMutex);
+      myWakeUp.wait(aLock, [this]() { return myToStop || !myQueue.empty(); });
+      if (myToStop) {
+        return;
+      }
+      aJob = myQueue.front();
+      myQueue.pop_front();
+    }
+    executeJob(aJob);
+  }
+}
+
+// ================================================================
+// Function : executeJob
+// Purpose  :
+// ================================================================
+void LoadJobQueue::executeJob(const Handle(LoadJob) & theJob) {
+  theJob->Execute();
+
+  CompletedNode *aNode = new CompletedNode();
+  aNode->Job = theJob;
+  aNode->Next = myCompleted.load(std::memory_order_relaxed);
+  while (!myCompleted.compare_exchange_weak(aNode->Next, aNode,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+  }
+
+  {
+    // synchronize with predicate check within Wait()
+    std::lock_guard<std::mutex> aLock(myMutex);
+  }
+  myIdle.notify_all();
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <AIS_InteractiveObject.hxx>
+#include <Message_ProgressRange.hxx>
+#include <NCollection_DataMap.hxx>
+#include <NCollection_Sequence.hxx>
+#include <Standard_Transient.hxx>
+#include <TCollection_AsciiString.hxx>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Working threads are available natively and in Emscripten build with -pthread;
+// otherwise jobs are executed one by one from the main loop.
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define LOAD_JOB_QUEUE_THREADED 1
+#endif
+
+class LoadJob;
+DEFINE_STANDARD_HANDLE(LoadJob, Standard_Transient)
+
+//! Base class for a model loading job.
+//! Perform() is executed by LoadJobQueue in a working thread and should do all
+//! the heavy work (parsing, transfer, meshing, building of arrays); resulting
+//! presentations are handed over to the main thread for displaying.
+class LoadJob : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(LoadJob, Standard_Transient)
+public:
+  //! Job state.
+  enum State { State_Queued, State_Running, State_Done, State_Failed };
+
+public:
+  LoadJob(const TCollection_AsciiString &theName);
+  virtual ~LoadJob();
+
+  //! Return unique job id assigned on creation.
+  int Id() const { return myId; }
+
+  //! Return name of the object to be loaded.
+  const TCollection_AsciiString &Name() const { return myName; }
+
+  //! Return job state.
+  State GetState() const { return myState.load(); }
+
+  //! Return progress within [0, 1] range.
+  double Progress() const { return myProgress.load(); }
+
+  //! Request job cancellation; running job stops at the next progress check.
+  void Cancel() { myToCancel = true; }
+
+  //! Return TRUE if job cancellation has been requested.
+  bool IsCancelled() const { return myToCancel.load(); }
+
+  //! Presentations built by the job.
+  const NCollection_Sequence<Handle(AIS_InteractiveObject)> &
+  Presentations() const {
+    return myPresentations;
+  }
+
+  //! Execute the job, called by LoadJobQueue.
+  void Execute();
+
+protected:
+  //! Perform loading in working thread.
+  //! @return FALSE on failure
+  virtual bool Perform(const Message_ProgressRange &theProgress) = 0;
+
+protected:
+  NCollection_Sequence<Handle(AIS_InteractiveObject)> myPresentations;
+
+private:
+  friend class LoadJobProgress;
+  TCollection_AsciiString myName;
+  int myId;
+  std::atomic<State> myState;
+  std::atomic<double> myProgress;
+  std::atomic<bool> myToCancel;
+};
+
+class LoadJobQueue;
+DEFINE_STANDARD_HANDLE(LoadJobQueue, Standard_Transient)
+
+//! Queue executing load jobs in background threads.
+//! Finished jobs are passed back through the lock-free completion list,
+//! which is drained by the main thread with TakeCompleted().
+class LoadJobQueue : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(LoadJobQueue, Standard_Transient)
+public:
+  //! @param theNbThreads number of working threads,
+  //!                     0 to use number of threads of OCCT default pool
+  //!                     (logical processors, unless limited on startup)
+  LoadJobQueue(int theNbThreads = 1);
+
+  //! Stop working threads; queued jobs are dropped.
+  virtual ~LoadJobQueue();
+
+  //! Return number of working threads (0 if jobs run from main loop).
+  int NbThreads() const { return (int)myThreads.size(); }
+
+  //! Add job to the queue.
+  //! @return job id
+  int Submit(const Handle(LoadJob) & theJob);
+
+  //! Request cancellation of queued or running job.
+  //! @return FALSE if job is unknown or already completed
+  bool Cancel(int theJobId);
+
+  //! Return job progress within [0, 1] range, or -1 if job is unknown.
+  double Progress(int theJobId);
+
+  //! Return TRUE if there are jobs queued, running or not yet taken.
+  bool HasPending() const { return myNbPending.load() > 0; }
+
+  //! Return TRUE if there are completed jobs not yet taken.
+  bool HasCompleted() const { return myCompleted.load() != nullptr; }
+
+  //! Execute one queued job in the calling thread.
+  //! Used when working threads are not available.
+  //! @return FALSE if queue was empty
+  bool RunNext();
+
+  //! Wait until all submitted jobs are completed.
+  void Wait();
+
+  //! Move jobs completed since the previous call into theJobs in completion
+  //! order. Should be called from a single (main) thread.
+  void TakeCompleted(NCollection_Sequence<Handle(LoadJob)> &theJobs);
+
+private:
+  //! Working thread function.
+  void threadLoop();
+
+  //! Execute the job and push it into completion list.
+  void executeJob(const Handle(LoadJob) & theJob);
+
+private:
+  //! Node of completion list.
+  struct CompletedNode {
+    Handle(LoadJob) Job;
+    CompletedNode *Next;
+  };
+
+private:
+  std::vector<std::thread> myThreads;
+  std::deque<Handle(LoadJob)> myQueue; //!< jobs waiting for execution
+  NCollection_DataMap<int, Handle(LoadJob)> myJobs; //!< not yet taken jobs
+  std::mutex myMutex;                     //!< guards myQueue and myJobs
+  std::condition_variable myWakeUp;       //!< signals new jobs or stop
+  std::condition_variable myIdle;         //!< signals job completion
+  bool myToStop;
+  std::atomic<int> myNbPending;
+  std::atomic<CompletedNode *> myCompleted; //!< lock-free completion stack
+};
@@ -7,6 +7,9 @@
 #include <Message_PrinterSystemLog.hxx>
 #include <OSD_MemInfo.hxx>
 #include <OSD_Parallel.hxx>
+#include <OSD_ThreadPool.hxx>
+
+#include <algorithm>
 
 #include <emscripten.h>
 #include <emscripten/html5.h>
@@ -51,6 +54,18 @@ EMSCRIPTEN_KEEPALIVE int main() {
 #endif
       ;
 
+#ifdef __EMSCRIPTEN_PTHREADS__
+  // Web Workers are started asynchronously, so that threads created while
+  // the main thread waits for them would never run; limit OCCT default pool
+  // (and load job queues sized by it) to the number of prestarted workers,
+  // see PTHREAD_POOL_SIZE in Makefile
+  OSD_ThreadPool::DefaultPool(
+      std::min(OSD_Parallel::NbLogicalProcessors(), WASM_MAX_THREADS));
+  Message::SendTrace() << "Default thread pool: "
+                       << OSD_ThreadPool::DefaultPool()->NbThreads()
+                       << " threads";
+#endif
+
   // setup a dummy single-shot main loop callback just to shut up a useless
   // Emscripten error message on calling eglSwapInterval()
   emscripten_set_main_loop(onMainLoop, -1, 0);
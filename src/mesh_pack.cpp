@@ -0,0 +1,328 @@
+#include "mesh_pack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "load_arena.h"
+#include "stl_file.h"
+#include "trace_events.h"
+
+namespace {
+
+//! Alignment of sections, enough for any value type used in place.
+const uint64_t kSectionAlignment = 8;
+
+uint64_t alignOffset(uint64_t offset) {
+  return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(uint8_t(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(uint8_t(value));
+}
+
+void writePadding(std::ostream& os, uint64_t& pos, uint64_t offset) {
+  static const char zeros[kSectionAlignment] = {};
+  os.write(zeros, std::streamsize(offset - pos));
+  pos = offset;
+}
+
+float signNotZero(float value) { return value < 0.0f ? -1.0f : 1.0f; }
+
+}  // namespace
+
+bool MeshPack::IsMeshPack(const char* data, size_t size) {
+  uint32_t magic = 0;
+  if (size < sizeof(Header)) {
+    return false;
+  }
+  memcpy(&magic, data, sizeof(magic));
+  return magic == kMagic;
+}
+
+void MeshPack::EncodeNormal(const float* normal, int16_t* oct) {
+  const float sum =
+      std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+  if (sum <= 0.0f) {
+    oct[0] = oct[1] = 0;
+    return;
+  }
+
+  // project onto octahedron, then fold its lower half onto the upper one
+  float x = normal[0] / sum;
+  float y = normal[1] / sum;
+  if (normal[2] < 0.0f) {
+    const float folded = (1.0f - std::fabs(y)) * signNotZero(x);
+    y = (1.0f - std::fabs(x)) * signNotZero(y);
+    x = folded;
+  }
+  oct[0] = int16_t(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+  oct[1] = int16_t(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+}
+
+void MeshPack::DecodeNormal(const int16_t* oct, float* normal) {
+  float x = std::max(float(oct[0]) / 32767.0f, -1.0f);
+  float y = std::max(float(oct[1]) / 32767.0f, -1.0f);
+  const float z = 1.0f - std::fabs(x) - std::fabs(y);
+  const float fold = std::max(-z, 0.0f);
+  x += x >= 0.0f ? -fold : fold;
+  y += y >= 0.0f ? -fold : fold;
+
+  const float length = std::sqrt(x * x + y * y + z * z);
+  const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+  normal[0] = x * scale;
+  normal[1] = y * scale;
+  normal[2] = z * scale;
+}
+
+bool MeshPackWriter::Write(std::ostream& os, const float* vertexes,
+                           size_t vertexCount, const float* normals,
+                           const unsigned int* indexes, size_t triangleCount) {
+  TRACE_SCOPE("write mesh pack");
+  if (vertexCount > UINT32_MAX || triangleCount > UINT32_MAX) {
+    return false;
+  }
+
+  // per-object scale and offset map bounding box onto full uint16 range
+  float bounds[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  if (vertexCount > 0) {
+    float minCorner[3] = {vertexes[0], vertexes[1], vertexes[2]};
+    float maxCorner[3] = {vertexes[0], vertexes[1], vertexes[2]};
+    for (size_t i = 1; i < vertexCount; i++) {
+      for (int axis = 0; axis < 3; axis++) {
+        minCorner[axis] = std::min(minCorner[axis], vertexes[i * 3 + axis]);
+        maxCorner[axis] = std::max(maxCorner[axis], vertexes[i * 3 + axis]);
+      }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+      bounds[axis] = minCorner[axis];
+      bounds[3 + axis] = (maxCorner[axis] - minCorner[axis]) / 65535.0f;
+    }
+  }
+
+  std::vector<uint16_t> positions(vertexCount * 3);
+  for (size_t i = 0; i < vertexCount; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const float scale = bounds[3 + axis];
+      const float value =
+          scale > 0.0f ? (vertexes[i * 3 + axis] - bounds[axis]) / scale : 0.0f;
+      positions[i * 3 + axis] =
+          uint16_t(std::lround(std::clamp(value, 0.0f, 65535.0f)));
+    }
+  }
+
+  std::vector<int16_t> octNormals;
+  if (normals != nullptr) {
+    octNormals.resize(vertexCount * 2);
+    for (size_t i = 0; i < vertexCount; i++) {
+      MeshPack::EncodeNormal(normals + i * 3, octNormals.data() + i * 2);
+    }
+  }
+
+  // neighbouring triangles share vertexes, so deltas are mostly small
+  std::vector<uint8_t> indexStream;
+  indexStream.reserve(triangleCount * 4);
+  int64_t prev = 0;
+  for (size_t i = 0; i < triangleCount * 3; i++) {
+    if (indexes[i] >= vertexCount) {
+      return false;
+    }
+    const int64_t delta = int64_t(indexes[i]) - prev;
+    writeVarint(indexStream, uint64_t((delta << 1) ^ (delta >> 63)));
+    prev = indexes[i];
+  }
+
+  std::vector<MeshPack::Section> sections;
+  sections.push_back({MeshPack::kSectionBounds, MeshPack::kEncodingFloat32, 0,
+                      sizeof(bounds)});
+  sections.push_back({MeshPack::kSectionPositions,
+                      MeshPack::kEncodingQuantized16, 0,
+                      positions.size() * sizeof(uint16_t)});
+  if (!octNormals.empty()) {
+    sections.push_back({MeshPack::kSectionNormals,
+                        MeshPack::kEncodingOctahedral16, 0,
+                        octNormals.size() * sizeof(int16_t)});
+  }
+  sections.push_back({MeshPack::kSectionIndexes,
+                      MeshPack::kEncodingDeltaVarint, 0, indexStream.size()});
+
+  MeshPack::Header header = {};
+  header.Magic = MeshPack::kMagic;
+  header.Version = MeshPack::kVersion;
+  header.HeaderSize = sizeof(MeshPack::Header);
+  header.VertexCount = uint32_t(vertexCount);
+  header.TriangleCount = uint32_t(triangleCount);
+  header.SectionCount = uint32_t(sections.size());
+
+  uint64_t offset =
+      sizeof(header) + sections.size() * sizeof(MeshPack::Section);
+  for (MeshPack::Section& section : sections) {
+    section.Offset = alignOffset(offset);
+    offset = section.Offset + section.Size;
+  }
+
+  const char* payloads[4] = {
+      reinterpret_cast<const char*>(bounds),
+      reinterpret_cast<const char*>(positions.data()),
+      reinterpret_cast<const char*>(octNormals.data()),
+      reinterpret_cast<const char*>(indexStream.data())};
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  os.write(reinterpret_cast<const char*>(sections.data()),
+           sections.size() * sizeof(MeshPack::Section));
+  uint64_t pos = sizeof(header) + sections.size() * sizeof(MeshPack::Section);
+  for (const MeshPack::Section& section : sections) {
+    writePadding(os, pos, section.Offset);
+    os.write(payloads[section.Type - 1], std::streamsize(section.Size));
+    pos += section.Size;
+  }
+  return os.good();
+}
+
+bool MeshPackWriter::Write(std::ostream& os, StlFile& stlFile) {
+  std::vector<float> vertexes;
+  std::vector<unsigned int> indexes;
+  {
+    LoadArena arena;
+    stlFile.ToIndexedData(vertexes, indexes, arena.Resource());
+  }
+  return Write(os, vertexes.data(), vertexes.size() / 3, nullptr,
+               indexes.data(), indexes.size() / 3);
+}
+
+void MeshPackWriter::ComputeNormals(const std::vector<float>& vertexes,
+                                    const std::vector<unsigned int>& indexes,
+                                    std::vector<float>& normals) {
+  normals.assign(vertexes.size(), 0.0f);
+  for (size_t i = 0; i + 2 < indexes.size(); i += 3) {
+    const float* p0 = &vertexes[indexes[i] * 3];
+    const float* p1 = &vertexes[indexes[i + 1] * 3];
+    const float* p2 = &vertexes[indexes[i + 2] * 3];
+    const float u[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const float v[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    // length of the cross product is twice the triangle area
+    const float n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2],
+                        u[0] * v[1] - u[1] * v[0]};
+    for (size_t corner = 0; corner < 3; corner++) {
+      float* normal = &normals[indexes[i + corner] * 3];
+      normal[0] += n[0];
+      normal[1] += n[1];
+      normal[2] += n[2];
+    }
+  }
+  for (size_t i = 0; i < normals.size(); i += 3) {
+    const float length =
+        std::sqrt(normals[i] * normals[i] + normals[i + 1] * normals[i + 1] +
+                  normals[i + 2] * normals[i + 2]);
+    if (length > 0.0f) {
+      normals[i] /= length;
+      normals[i + 1] /= length;
+      normals[i + 2] /= length;
+    }
+  }
+}
+
+bool MeshPackReader::Open(const char* data, size_t size) {
+  *this = MeshPackReader();
+  if (!MeshPack::IsMeshPack(data, size)) {
+    return false;
+  }
+
+  MeshPack::Header header;
+  memcpy(&header, data, sizeof(header));
+  if (header.Version != MeshPack::kVersion ||
+      header.HeaderSize < sizeof(header) ||
+      header.HeaderSize + uint64_t(header.SectionCount) *
+                              sizeof(MeshPack::Section) >
+          size) {
+    return false;
+  }
+
+  const float* bounds = nullptr;
+  for (uint32_t i = 0; i < header.SectionCount; i++) {
+    MeshPack::Section section;
+    memcpy(&section, data + header.HeaderSize + i * sizeof(section),
+           sizeof(section));
+    if (section.Offset > size || section.Size > size - section.Offset ||
+        section.Offset % kSectionAlignment != 0) {
+      return false;
+    }
+
+    // sections are used in place, so they should be properly aligned
+    const char* payload = data + section.Offset;
+    if (reinterpret_cast<uintptr_t>(payload) % alignof(float) != 0) {
+      return false;
+    }
+    switch (section.Type) {
+      case MeshPack::kSectionBounds:
+        if (section.Encoding != MeshPack::kEncodingFloat32 ||
+            section.Size != 6 * sizeof(float)) {
+          return false;
+        }
+        bounds = reinterpret_cast<const float*>(payload);
+        break;
+      case MeshPack::kSectionPositions:
+        if (section.Encoding != MeshPack::kEncodingQuantized16 ||
+            section.Size != uint64_t(header.VertexCount) * 3 * 2) {
+          return false;
+        }
+        m_pPositions = reinterpret_cast<const uint16_t*>(payload);
+        break;
+      case MeshPack::kSectionNormals:
+        if (section.Encoding != MeshPack::kEncodingOctahedral16 ||
+            section.Size != uint64_t(header.VertexCount) * 2 * 2) {
+          return false;
+        }
+        m_pNormals = reinterpret_cast<const int16_t*>(payload);
+        break;
+      case MeshPack::kSectionIndexes:
+        if (section.Encoding != MeshPack::kEncodingDeltaVarint) {
+          return false;
+        }
+        m_pIndexes = reinterpret_cast<const uint8_t*>(payload);
+        m_nIndexesSize = size_t(section.Size);
+        break;
+      default:
+        // sections of newer writers are skipped
+        break;
+    }
+  }
+  if (bounds == nullptr || m_pPositions == nullptr || m_pIndexes == nullptr) {
+    *this = MeshPackReader();
+    return false;
+  }
+
+  memcpy(m_fOffset, bounds, sizeof(m_fOffset));
+  memcpy(m_fScale, bounds + 3, sizeof(m_fScale));
+  m_nVertexes = header.VertexCount;
+  m_nTriangles = header.TriangleCount;
+  return true;
+}
+
+void MeshPackReader::DecodePositions(float* out, size_t stride) const {
+  for (size_t i = 0; i < m_nVertexes; i++) {
+    get_Position(i, out + i * stride);
+  }
+}
+
+void MeshPackReader::DecodeNormals(float* out, size_t stride) const {
+  if (m_pNormals == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < m_nVertexes; i++) {
+    get_Normal(i, out + i * stride);
+  }
+}
+
+bool MeshPackReader::DecodeIndexes(unsigned int* out,
+                                   unsigned int base) const {
+  return DecodeTriangles([out, base](size_t tri, unsigned int node1,
+                                     unsigned int node2, unsigned int node3) {
+    out[tri * 3] = node1 + base;
+    out[tri * 3 + 1] = node2 + base;
+    out[tri * 3 + 2] = node3 + base;
+  });
+}
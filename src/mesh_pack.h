@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+class StlFile;
+
+//! Compact indexed mesh container, pre-baked for instant loading.
+//! Little-endian layout: 32-byte header, table of sections, then sections
+//! aligned to 8 bytes:
+//!  - bounds:    offset and scale of positions, 6 floats;
+//!  - positions: 3 x uint16 per vertex, position = offset + value * scale;
+//!  - normals:   2 x int16 per vertex, octahedron-encoded (optional);
+//!  - indexes:   zigzag varint deltas between consecutive indexes.
+//! Fixed-size sections are used in place, so that data mapped into memory
+//! is read without copying and decoded straight into vertex buffers.
+//! Takes about 6 bytes per vertex and 3-5 bytes per triangle, against
+//! 50 bytes per triangle of binary STL.
+struct MeshPack {
+  static const uint32_t kMagic = 0x48534D4F;  // "OMSH"
+  static const uint16_t kVersion = 1;
+
+  enum SectionType : uint32_t {
+    kSectionBounds = 1,
+    kSectionPositions = 2,
+    kSectionNormals = 3,
+    kSectionIndexes = 4
+  };
+
+  enum Encoding : uint32_t {
+    kEncodingFloat32 = 0,
+    kEncodingQuantized16 = 1,
+    kEncodingOctahedral16 = 2,
+    kEncodingDeltaVarint = 3
+  };
+
+#pragma pack(push, 4)
+  struct Header {
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t HeaderSize;
+    uint32_t VertexCount;
+    uint32_t TriangleCount;
+    uint32_t SectionCount;
+    uint32_t Flags;
+    uint64_t Reserved;
+  };
+
+  struct Section {
+    uint32_t Type;
+    uint32_t Encoding;
+    uint64_t Offset;  //!< from the start of data
+    uint64_t Size;    //!< in bytes
+  };
+#pragma pack(pop)
+
+  //! Return TRUE if data starts with the mesh pack signature.
+  static bool IsMeshPack(const char* data, size_t size);
+
+  //! Encode unit vector into two snorm16 values.
+  static void EncodeNormal(const float* normal, int16_t* oct);
+
+  //! Decode unit vector from two snorm16 values.
+  static void DecodeNormal(const int16_t* oct, float* normal);
+};
+
+//! Writer of the mesh pack.
+class MeshPackWriter {
+ public:
+  //! Write indexed mesh.
+  //! @param vertexes      3 floats per vertex
+  //! @param normals       3 floats per vertex, or NULL
+  //! @param indexes       3 zero-based indexes per triangle
+  //! @return FALSE on writing error or invalid index
+  static bool Write(std::ostream& os, const float* vertexes,
+                    size_t vertexCount, const float* normals,
+                    const unsigned int* indexes, size_t triangleCount);
+
+  //! Write facets of STL file with coincident vertexes merged.
+  //! Normals are not written, as STL defines them per facet.
+  static bool Write(std::ostream& os, StlFile& stlFile);
+
+  //! Compute vertex normals as area-weighted average of triangle normals.
+  static void ComputeNormals(const std::vector<float>& vertexes,
+                             const std::vector<unsigned int>& indexes,
+                             std::vector<float>& normals);
+};
+
+//! Reader of the mesh pack from memory.
+//! Data is referenced, not copied, and should outlive the reader.
+class MeshPackReader {
+ public:
+  MeshPackReader() {}
+
+  //! Parse header and section table.
+  //! @return FALSE if data is not a valid mesh pack
+  bool Open(const char* data, size_t size);
+
+  size_t get_VertexCount() const { return m_nVertexes; }
+  size_t get_TriangleCount() const { return m_nTriangles; }
+  bool HasNormals() const { return m_pNormals != nullptr; }
+
+  //! Return offset and scale of quantized positions, 3 floats each.
+  const float* get_Offset() const { return m_fOffset; }
+  const float* get_Scale() const { return m_fScale; }
+
+  //! Return quantized positions within data, 3 values per vertex.
+  const uint16_t* get_QuantizedPositions() const { return m_pPositions; }
+
+  //! Return oct-encoded normals within data, 2 values per vertex, or NULL.
+  const int16_t* get_OctNormals() const { return m_pNormals; }
+
+  //! Decode position of the vertex.
+  void get_Position(size_t index, float* xyz) const {
+    const uint16_t* q = m_pPositions + index * 3;
+    for (int axis = 0; axis < 3; axis++) {
+      xyz[axis] = m_fOffset[axis] + float(q[axis]) * m_fScale[axis];
+    }
+  }
+
+  //! Decode normal of the vertex.
+  void get_Normal(size_t index, float* xyz) const {
+    MeshPack::DecodeNormal(m_pNormals + index * 2, xyz);
+  }
+
+  //! Decode positions into vertex buffer.
+  //! @param stride distance between vertexes in floats
+  void DecodePositions(float* out, size_t stride = 3) const;
+
+  //! Decode normals into vertex buffer, if any.
+  //! @param stride distance between vertexes in floats
+  void DecodeNormals(float* out, size_t stride = 3) const;
+
+  //! Decode triangles, calling func(triangle, index1, index2, index3) for
+  //! each of them with zero-based indexes.
+  //! @return FALSE if index stream is corrupted
+  template <typename Func>
+  bool DecodeTriangles(Func func) const {
+    const uint8_t* pos = m_pIndexes;
+    const uint8_t* end = m_pIndexes + m_nIndexesSize;
+    int64_t prev = 0;
+    for (size_t tri = 0; tri < m_nTriangles; tri++) {
+      unsigned int nodes[3];
+      for (int corner = 0; corner < 3; corner++) {
+        uint64_t zigzag = 0;
+        if (!readVarint(pos, end, zigzag) || zigzag > 0x1FFFFFFFFULL) {
+          return false;
+        }
+        prev += int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+        if (prev < 0 || uint64_t(prev) >= m_nVertexes) {
+          return false;
+        }
+        nodes[corner] = (unsigned int)prev;
+      }
+      func(tri, nodes[0], nodes[1], nodes[2]);
+    }
+    return true;
+  }
+
+  //! Decode triangles into index buffer, 3 indexes per triangle.
+  //! @param base value added to each index, e.g. 1 for 1-based arrays
+  bool DecodeIndexes(unsigned int* out, unsigned int base = 0) const;
+
+ private:
+  static bool readVarint(const uint8_t*& pos, const uint8_t* end,
+                         uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+      const uint8_t byte = *pos++;
+      value |= uint64_t(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  size_t m_nVertexes = 0;
+  size_t m_nTriangles = 0;
+  float m_fOffset[3] = {};
+  float m_fScale[3] = {};
+  const uint16_t* m_pPositions = nullptr;
+  const int16_t* m_pNormals = nullptr;
+  const uint8_t* m_pIndexes = nullptr;
+  size_t m_nIndexesSize = 0;
+};
@@ -1,4 +1,11 @@
+#include <AIS_Shape.hxx>
 #include <BRepAlgoAPI_Fuse.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepTools.hxx>
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <BinTools.hxx>
 #include <BRepBuilderAPI_MakeEdge.hxx>
 #include <BRepBuilderAPI_MakeFace.hxx>
 #include <BRepBuilderAPI_MakePolygon.hxx>
@@ -23,21 +30,38 @@
 #include <MeshVS_DrawerAttribute.hxx>
 #include <MeshVS_Mesh.hxx>
 #include <MeshVS_MeshPrsBuilder.hxx>
+#include <OSD_Timer.hxx>
+#include <Precision.hxx>
+#include <Message_ProgressScope.hxx>
+#include <STEPControl_Controller.hxx>
+#include <STEPControl_Reader.hxx>
+#include <Standard_ArrayStreamBuffer.hxx>
 #include <TopExp_Explorer.hxx>
 #include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
 #include <TopoDS_Edge.hxx>
 #include <TopoDS_Wire.hxx>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <gp_Ax1.hxx>
+#include <mutex>
+#include <sstream>
 
 #include "help_algorithms.h"
+#include "mesh_pack.h"
+#include "sliced_mesh_builder.h"
 // #include "stl_file.h"
 #include "RWStl_Stream_Reader.h"
 #include "XSDRAWSTLVRML_DataSource.h"
 
 #include "model_factory.h"
+#include "trace_events.h"
 
-ModelFactory::ModelFactory(/* args */) {}
+ModelFactory::ModelFactory(/* args */) : geometry_(new GeometryRegistry()) {}
 
 ModelFactory::~ModelFactory() {}
 
@@ -200,24 +224,155 @@ TopoDS_Shape ModelFactory::MakeBottle(const Standard_Real myWidth,
   return aRes;
 }
 
-Handle_AIS_InteractiveObject ModelFactory::LoadFromStl(std::istream &is) {
-  RWStl_Stream_Reader reader;
-  reader.Read(is);
+Handle(Poly_Triangulation)
+ModelFactory::ReadStl(std::istream &is, const Message_ProgressRange &progress,
+                      ModelLoadStats *stats) {
+  OSD_Timer timer;
+  timer.Start();
+  Handle(Poly_Triangulation) triangulation;
+  {
+    // reader releases its staging data within GetTriangulation()
+    RWStl_Stream_Reader reader;
+    reader.Read(is, progress);
+    triangulation = reader.GetTriangulation();
+  }
+  if (stats != nullptr) {
+    stats->ReadTime += timer.ElapsedTime();
+    stats->NbTriangles +=
+        triangulation.IsNull() ? 0 : triangulation->NbTriangles();
+  }
+  return triangulation;
+}
 
-  auto triangulation = reader.GetTriangulation();
+Handle(Poly_Triangulation)
+ModelFactory::ReadMeshPack(const char *data, size_t dataLen,
+                           ModelLoadStats *stats) {
+  TRACE_SCOPE("read mesh pack");
+  OSD_Timer timer;
+  timer.Start();
+  MeshPackReader reader;
+  if (!reader.Open(data, dataLen) || reader.get_TriangleCount() == 0) {
+    return Handle(Poly_Triangulation)();
+  }
 
-  Handle(XSDRAWSTLVRML_DataSource) dataSource =
-      new XSDRAWSTLVRML_DataSource(triangulation);
+  // values are decoded straight into triangulation arrays
+  Handle(Poly_Triangulation) triangulation = new Poly_Triangulation(
+      (Standard_Integer)reader.get_VertexCount(),
+      (Standard_Integer)reader.get_TriangleCount(), Standard_False);
+  float xyz[3];
+  for (size_t i = 0; i < reader.get_VertexCount(); i++) {
+    reader.get_Position(i, xyz);
+    triangulation->SetNode((Standard_Integer)i + 1,
+                           gp_Pnt(xyz[0], xyz[1], xyz[2]));
+  }
+  if (reader.HasNormals()) {
+    triangulation->AddNormals();
+    for (size_t i = 0; i < reader.get_VertexCount(); i++) {
+      reader.get_Normal(i, xyz);
+      triangulation->SetNormal((Standard_Integer)i + 1,
+                               gp_Vec3f(xyz[0], xyz[1], xyz[2]));
+    }
+  }
+  if (!reader.DecodeTriangles([&](size_t tri, unsigned int node1,
+                                  unsigned int node2, unsigned int node3) {
+        triangulation->SetTriangle(
+            (Standard_Integer)tri + 1,
+            Poly_Triangle(node1 + 1, node2 + 1, node3 + 1));
+      })) {
+    return Handle(Poly_Triangulation)();
+  }
 
-  Handle(MeshVS_Mesh) mesh = new MeshVS_Mesh();
-  mesh->SetDataSource(dataSource);
-  mesh->AddBuilder(new MeshVS_MeshPrsBuilder(mesh), Standard_True);
+  if (stats != nullptr) {
+    stats->ReadTime += timer.ElapsedTime();
+    stats->NbTriangles += triangulation->NbTriangles();
+  }
+  return triangulation;
+}
 
-  auto drawer = mesh->GetDrawer();
-  drawer->SetBoolean(MeshVS_DA_DisplayNodes, Standard_False);
-  drawer->SetBoolean(MeshVS_DA_ShowEdges, Standard_False);
-  mesh->SetMeshSelMethod(MeshVS_MSM_BOX);
-  return mesh;
+bool ModelFactory::WriteMeshPack(
+    const Handle(Poly_Triangulation) & triangulation, std::ostream &os) {
+  if (triangulation.IsNull()) {
+    return false;
+  }
+
+  std::vector<float> vertexes(triangulation->NbNodes() * 3);
+  for (Standard_Integer i = 1; i <= triangulation->NbNodes(); i++) {
+    const gp_Pnt node = triangulation->Node(i);
+    vertexes[(i - 1) * 3] = (float)node.X();
+    vertexes[(i - 1) * 3 + 1] = (float)node.Y();
+    vertexes[(i - 1) * 3 + 2] = (float)node.Z();
+  }
+  std::vector<float> normals;
+  if (triangulation->HasNormals()) {
+    normals.resize(vertexes.size());
+    for (Standard_Integer i = 1; i <= triangulation->NbNodes(); i++) {
+      const gp_Vec3f normal = triangulation->Normal(i);
+      memcpy(&normals[(i - 1) * 3], normal.GetData(), sizeof(float) * 3);
+    }
+  }
+  std::vector<unsigned int> indexes(triangulation->NbTriangles() * 3);
+  for (Standard_Integer i = 1; i <= triangulation->NbTriangles(); i++) {
+    Standard_Integer nodes[3];
+    triangulation->Triangle(i).Get(nodes[0], nodes[1], nodes[2]);
+    for (int corner = 0; corner < 3; corner++) {
+      indexes[(i - 1) * 3 + corner] = nodes[corner] - 1;
+    }
+  }
+  return MeshPackWriter::Write(os, vertexes.data(), vertexes.size() / 3,
+                               normals.empty() ? nullptr : normals.data(),
+                               indexes.data(), indexes.size() / 3);
+}
+
+bool ModelFactory::WriteMeshPack(const TopoDS_Shape &shape, std::ostream &os) {
+  std::vector<float> vertexes;
+  std::vector<unsigned int> indexes;
+  for (TopExp_Explorer faceExp(shape, TopAbs_FACE); faceExp.More();
+       faceExp.Next()) {
+    const TopoDS_Face &face = TopoDS::Face(faceExp.Current());
+    TopLoc_Location location;
+    const Handle(Poly_Triangulation) &triangulation =
+        BRep_Tool::Triangulation(face, location);
+    if (triangulation.IsNull()) {
+      continue;
+    }
+
+    const unsigned int first = (unsigned int)(vertexes.size() / 3);
+    const gp_Trsf trsf = location.Transformation();
+    for (Standard_Integer i = 1; i <= triangulation->NbNodes(); i++) {
+      const gp_Pnt node = triangulation->Node(i).Transformed(trsf);
+      vertexes.push_back((float)node.X());
+      vertexes.push_back((float)node.Y());
+      vertexes.push_back((float)node.Z());
+    }
+    // reversed faces have their triangles oriented against the surface
+    const bool isReversed = face.Orientation() == TopAbs_REVERSED;
+    for (Standard_Integer i = 1; i <= triangulation->NbTriangles(); i++) {
+      Standard_Integer nodes[3];
+      triangulation->Triangle(i).Get(nodes[0], nodes[1], nodes[2]);
+      if (isReversed) {
+        std::swap(nodes[1], nodes[2]);
+      }
+      for (int corner = 0; corner < 3; corner++) {
+        indexes.push_back(first + nodes[corner] - 1);
+      }
+    }
+  }
+  if (indexes.empty()) {
+    return false;
+  }
+
+  std::vector<float> normals;
+  MeshPackWriter::ComputeNormals(vertexes, indexes, normals);
+  return MeshPackWriter::Write(os, vertexes.data(), vertexes.size() / 3,
+                               normals.data(), indexes.data(),
+                               indexes.size() / 3);
+}
+
+Handle_AIS_InteractiveObject
+ModelFactory::LoadFromStl(std::istream &is,
+                          const Message_ProgressRange &progress,
+                          ModelLoadStats *stats) {
+  return CreateStlMesh(ReadStl(is, progress, stats), stats);
 
   // auto &nodes = triangulation->InternalNodes();
   // auto &triangles = triangulation->InternalTriangles();
@@ -263,6 +418,492 @@ Handle_AIS_InteractiveObject ModelFactory::LoadFromStl(std::istream &is) {
   // return compound;
 }
 
+TopoDS_Shape ModelFactory::LoadFromBRep(std::istream &is,
+                                        const Message_ProgressRange &progress,
+                                        ModelLoadStats *stats) {
+  TRACE_SCOPE("parse BRep");
+  OSD_Timer timer;
+  timer.Start();
+  // binary shape set starts with its own signature
+  static const char binarySignature[] = "Open CASCADE Topology V";
+  char signature[sizeof(binarySignature) - 1] = {};
+  is.read(signature, sizeof(signature));
+  const bool isBinary =
+      is.gcount() == (std::streamsize)sizeof(signature) &&
+      memcmp(signature, binarySignature, sizeof(signature)) == 0;
+  is.clear();
+  is.seekg(0, std::ios_base::beg);
+
+  TopoDS_Shape shape;
+  if (isBinary) {
+    BinTools::Read(shape, is, progress);
+  } else {
+    BRep_Builder builder;
+    BRepTools::Read(shape, is, builder, progress);
+  }
+  if (stats != nullptr) {
+    stats->ReadTime += timer.ElapsedTime();
+  }
+  return shape;
+}
+
+bool ModelFactory::LoadFromStep(std::istream &is, const std::string &name,
+                                NCollection_Sequence<TopoDS_Shape> &shapes,
+                                const Message_ProgressRange &progress,
+                                ModelLoadStats *stats) {
+  {
+    // static STEP controller and parameters are not initialized thread-safely
+    static std::mutex initMutex;
+    std::lock_guard<std::mutex> lock(initMutex);
+    STEPControl_Controller::Init();
+  }
+
+  OSD_Timer timer;
+  timer.Start();
+  STEPControl_Reader reader;
+  {
+    TRACE_SCOPE("parse STEP");
+    if (reader.ReadStream(name.c_str(), is) != IFSelect_RetDone) {
+      return false;
+    }
+  }
+
+  bool isFailsonly = false;
+  reader.PrintCheckLoad(isFailsonly, IFSelect_ItemsByEntity);
+  if (stats != nullptr) {
+    stats->ReadTime += timer.ElapsedTime();
+    timer.Reset();
+    timer.Start();
+  }
+
+  TRACE_SCOPE("transfer STEP");
+  const Standard_Integer nbRoots = reader.NbRootsForTransfer();
+  reader.PrintCheckTransfer(isFailsonly, IFSelect_ItemsByEntity);
+  Message_ProgressScope scope(progress, "Transferring STEP roots", nbRoots);
+  for (Standard_Integer n = 1; n <= nbRoots && scope.More(); n++) {
+    reader.TransferRoot(n, scope.Next());
+  }
+
+  for (Standard_Integer i = 1; i <= reader.NbShapes(); i++) {
+    shapes.Append(reader.Shape(i));
+  }
+  if (stats != nullptr) {
+    stats->TransferTime += timer.ElapsedTime();
+  }
+  return !scope.UserBreak();
+}
+
+Handle(StepAssembly) ModelFactory::LoadStepAssembly(
+    const char *data, size_t dataLen, const std::string &name,
+    const ModelMeshParams &params, const Message_ProgressRange &progress,
+    ModelLoadStats *stats, const std::string &key) {
+  Message_ProgressScope scope(progress, "Loading STEP assembly", 2);
+  NCollection_Sequence<TopoDS_Shape> cachedParts;
+  std::string cacheKey = key, cachedTree;
+  Handle(StepAssembly) assembly = new StepAssembly();
+  if (FindCachedMesh(data, dataLen, params, cachedParts, cacheKey, stats,
+                     &cachedTree) &&
+      assembly->DecodeTree(cachedTree) &&
+      assembly->SetPartShapes(cachedParts)) {
+    // STEP data is not parsed at all
+    return assembly;
+  }
+
+  {
+    Standard_ArrayStreamBuffer streamBuffer(data, dataLen);
+    std::istream is(&streamBuffer);
+    if (!assembly->Load(is, name, scope.Next(), stats)) {
+      return Handle(StepAssembly)();
+    }
+  }
+  std::string tree;
+  assembly->EncodeTree(tree);
+  // entry stored without the tree is used if it matches the parts
+  if (assembly->SetPartShapes(cachedParts)) {
+    StoreCachedMesh(cacheKey, cachedParts, tree);
+    return assembly;
+  } else if (params.IsLazy) {
+    // lazy parts are meshed once visible, see LazyPartMesher
+    return assembly;
+  }
+
+  NCollection_Sequence<TopoDS_Shape> parts;
+  assembly->PartShapes(parts);
+  if (!triangulateParts(parts, params, scope.Next(), stats)) {
+    return Handle(StepAssembly)();
+  }
+  if (!params.IsProgressive) {
+    StoreCachedMesh(cacheKey, parts, tree);
+  }
+  return assembly;
+}
+
+Handle(StepAssembly) ModelFactory::LoadXbfAssembly(
+    const char *data, size_t dataLen, const ModelMeshParams &params,
+    const Message_ProgressRange &progress, ModelLoadStats *stats) {
+  Message_ProgressScope scope(progress, "Loading XBF assembly", 2);
+  Handle(StepAssembly) assembly = new StepAssembly();
+  {
+    Standard_ArrayStreamBuffer streamBuffer(data, dataLen);
+    std::istream is(&streamBuffer);
+    if (!assembly->LoadXbf(is, scope.Next(), stats)) {
+      return Handle(StepAssembly)();
+    }
+  }
+  if (params.IsLazy) {
+    return assembly;
+  }
+
+  // stored triangulation is lossless, so document is not cached
+  NCollection_Sequence<TopoDS_Shape> parts;
+  assembly->PartShapes(parts);
+  if (!triangulateParts(parts, params, scope.Next(), stats)) {
+    return Handle(StepAssembly)();
+  }
+  return assembly;
+}
+
+Handle(StepAssembly) ModelFactory::LoadGltfAssembly(
+    const char *data, size_t dataLen, const Message_ProgressRange &progress,
+    ModelLoadStats *stats) {
+  // glTF reader accepts only files, so data is passed through a temporary
+  // file of the in-memory file system; name is unique between load jobs
+  static std::atomic<int> fileCounter(0);
+  const TCollection_AsciiString path =
+      TCollection_AsciiString("/tmp/occt-import-") + (++fileCounter) + ".glb";
+  {
+    std::ofstream os(path.ToCString(), std::ios::binary);
+    if (!os.write(data, dataLen)) {
+      return Handle(StepAssembly)();
+    }
+  }
+
+  Handle(StepAssembly) assembly = new StepAssembly();
+  const bool isDone = assembly->LoadGltf(path, progress, stats);
+  std::remove(path.ToCString());
+  return isDone ? assembly : Handle(StepAssembly)();
+}
+
+Handle(StepAssembly) ModelFactory::LoadAssembly(
+    const char *data, size_t dataLen, const std::string &name,
+    const ModelMeshParams &params, const Message_ProgressRange &progress,
+    ModelLoadStats *stats, const std::string &key) {
+  if (test_file_extension(name, ".xbf")) {
+    return LoadXbfAssembly(data, dataLen, params, progress, stats);
+  } else if (test_file_extension(name, ".glb")) {
+    return LoadGltfAssembly(data, dataLen, progress, stats);
+  }
+  return LoadStepAssembly(data, dataLen, name, params, progress, stats, key);
+}
+
+bool ModelFactory::IsTriangulated(const TopoDS_Shape &shape) {
+  return BRepTools::Triangulation(shape, Precision::Infinite());
+}
+
+bool ModelFactory::triangulateParts(
+    const NCollection_Sequence<TopoDS_Shape> &parts,
+    const ModelMeshParams &params, const Message_ProgressRange &progress,
+    ModelLoadStats *stats) {
+  if (params.Deflection <= 0.0) {
+    // deflection is derived from the size of each part
+    Message_ProgressScope scope(progress, "Meshing parts", parts.Size());
+    for (NCollection_Sequence<TopoDS_Shape>::Iterator partIter(parts);
+         partIter.More() && scope.More(); partIter.Next()) {
+      Message_ProgressRange range = scope.Next();
+      if (!IsTriangulated(partIter.Value())) {
+        Triangulate(partIter.Value(), params.FirstPass(), range, stats);
+      }
+    }
+    return scope.More();
+  }
+
+  // parts are meshed together to balance faces between threads
+  TopoDS_Compound compound;
+  BRep_Builder builder;
+  builder.MakeCompound(compound);
+  bool hasParts = false;
+  for (NCollection_Sequence<TopoDS_Shape>::Iterator partIter(parts);
+       partIter.More(); partIter.Next()) {
+    if (!IsTriangulated(partIter.Value())) {
+      builder.Add(compound, partIter.Value());
+      hasParts = true;
+    }
+  }
+  if (hasParts) {
+    Triangulate(compound, params.FirstPass(), progress, stats);
+  }
+  return !progress.UserBreak();
+}
+
+void ModelFactory::Triangulate(const TopoDS_Shape &shape,
+                               const ModelMeshParams &params,
+                               const Message_ProgressRange &progress,
+                               ModelLoadStats *stats) {
+  TRACE_SCOPE("tessellation");
+  OSD_Timer timer;
+  timer.Start();
+
+  const ModelMeshParams shapeParams = params.ForShape(shape);
+  IMeshTools_Parameters meshParams;
+  meshParams.Deflection = shapeParams.Deflection;
+  meshParams.Angle = shapeParams.Angle;
+  meshParams.Relative = shapeParams.IsRelative;
+  meshParams.InParallel = shapeParams.InParallel;
+  BRepMesh_IncrementalMesh mesher(shape, meshParams, progress);
+
+  if (stats == nullptr) {
+    return;
+  }
+
+  stats->MeshTime += timer.ElapsedTime();
+  for (TopExp_Explorer faceExp(shape, TopAbs_FACE); faceExp.More();
+       faceExp.Next()) {
+    TopLoc_Location location;
+    const Handle(Poly_Triangulation) &triangulation =
+        BRep_Tool::Triangulation(TopoDS::Face(faceExp.Current()), location);
+    stats->NbFaces++;
+    if (!triangulation.IsNull()) {
+      stats->NbTriangles += triangulation->NbTriangles();
+    }
+  }
+}
+
+Handle_AIS_InteractiveObject
+ModelFactory::CreateMeshedShape(const TopoDS_Shape &shape) {
+  Handle(AIS_Shape) shapePrs = new AIS_Shape(shape);
+  // keep triangulation computed with explicit parameters
+  shapePrs->Attributes()->SetAutoTriangulation(Standard_False);
+  shapePrs->SetMaterial(Graphic3d_NameOfMaterial_Silver);
+  shapePrs->SetDisplayMode(AIS_Shaded);
+  return shapePrs;
+}
+
+bool ModelFactory::FindCachedMesh(const char *data, size_t dataLen,
+                                  const ModelMeshParams &params,
+                                  NCollection_Sequence<TopoDS_Shape> &shapes,
+                                  std::string &key, ModelLoadStats *stats,
+                                  std::string *modelData) {
+  Handle(TessellationCache) cache = meshCache_;
+  if (cache.IsNull()) {
+    return false;
+  }
+
+  OSD_Timer timer;
+  timer.Start();
+  if (key.empty()) {
+    key = TessellationCache::MakeKey(data, dataLen, params);
+  }
+  int nbTriangles = 0;
+  if (!cache->Lookup(key, shapes, nbTriangles, modelData)) {
+    return false;
+  }
+
+  if (stats != nullptr) {
+    stats->ReadTime += timer.ElapsedTime();
+    stats->NbTriangles += nbTriangles;
+    for (NCollection_Sequence<TopoDS_Shape>::Iterator shapeIter(shapes);
+         shapeIter.More(); shapeIter.Next()) {
+      for (TopExp_Explorer faceExp(shapeIter.Value(), TopAbs_FACE);
+           faceExp.More(); faceExp.Next()) {
+        stats->NbFaces++;
+      }
+    }
+  }
+  return true;
+}
+
+void ModelFactory::StoreCachedMesh(
+    const std::string &key, const NCollection_Sequence<TopoDS_Shape> &shapes,
+    const std::string &modelData) {
+  Handle(TessellationCache) cache = meshCache_;
+  if (!cache.IsNull() && !key.empty()) {
+    cache->Store(key, shapes, modelData);
+  }
+}
+
+bool ModelFactory::FindSharedModel(
+    const char *data, size_t dataLen, const ModelMeshParams &params,
+    NCollection_Sequence<Handle(AIS_InteractiveObject)> &prs,
+    std::string &key) {
+  Handle(GeometryRegistry) geometry = geometry_;
+  if (geometry.IsNull()) {
+    return false;
+  }
+
+  if (key.empty()) {
+    key = TessellationCache::MakeKey(data, dataLen, params);
+  }
+  return geometry->FindModel(key, prs);
+}
+
+void ModelFactory::StoreSharedModel(
+    const std::string &key,
+    const NCollection_Sequence<Handle(AIS_InteractiveObject)> &prs) {
+  Handle(GeometryRegistry) geometry = geometry_;
+  if (!geometry.IsNull()) {
+    geometry->AddModel(key, prs);
+  }
+}
+
+Handle(AIS_InteractiveObject)
+ModelFactory::InstantiateStlMesh(const Handle(Poly_Triangulation) &triangulation,
+                                 ModelLoadStats *stats) {
+  Handle(GeometryRegistry) geometry = geometry_;
+  if (geometry.IsNull()) {
+    return CreateStlMesh(triangulation, stats);
+  }
+  return geometry->AddMesh(triangulation, stats);
+}
+
+Handle(AIS_InteractiveObject)
+ModelFactory::InstantiateShape(const TopoDS_Shape &shape) {
+  Handle(GeometryRegistry) geometry = geometry_;
+  if (geometry.IsNull()) {
+    return CreateMeshedShape(shape);
+  }
+  return geometry->AddShape(shape);
+}
+
+ModelMeshParams ModelMeshParams::FirstPass() const {
+  if (!IsProgressive) {
+    return *this;
+  }
+
+  // coarse enough to be computed within a fraction of the full meshing time
+  ModelMeshParams coarse = *this;
+  if (Deflection > 0.0) {
+    coarse.Deflection = Deflection * 20.0;
+  } else {
+    coarse.DeviationCoefficient = DeviationCoefficient * 20.0;
+  }
+  coarse.Angle = std::max(Angle * 2.0, 0.8);
+  coarse.InParallel = true;
+  return coarse;
+}
+
+ModelMeshParams ModelMeshParams::ForBox(const Bnd_Box &box) const {
+  if (Deflection > 0.0 || box.IsVoid()) {
+    return *this;
+  }
+
+  // same as Prs3d::GetDeflection() used by AIS with default drawer
+  double xMin, yMin, zMin, xMax, yMax, zMax;
+  box.Get(xMin, yMin, zMin, xMax, yMax, zMax);
+  const double size = std::max({xMax - xMin, yMax - yMin, zMax - zMin});
+  ModelMeshParams params = *this;
+  params.Deflection = size * DeviationCoefficient * 4.0;
+  params.IsRelative = false;
+  if (params.Deflection <= 0.0) {
+    params.Deflection = DeviationCoefficient;
+  }
+  return params;
+}
+
+ModelMeshParams ModelMeshParams::ForShape(const TopoDS_Shape &shape) const {
+  if (Deflection > 0.0) {
+    return *this;
+  }
+
+  Bnd_Box box;
+  BRepBndLib::Add(shape, box, Standard_False);
+  return ForBox(box);
+}
+
+std::string ModelLoadStats::ToJson() const {
+  std::ostringstream os;
+  os << "{\"read\":" << ReadTime << ",\"transfer\":" << TransferTime
+     << ",\"mesh\":" << MeshTime << ",\"build\":" << BuildTime
+     << ",\"faces\":" << NbFaces << ",\"triangles\":" << NbTriangles << "}";
+  return os.str();
+}
+
+std::string ModelLoadStats::ToString() const {
+  std::ostringstream os;
+  os << "read " << ReadTime << " s, transfer " << TransferTime << " s, mesh "
+     << MeshTime << " s, build " << BuildTime << " s, " << NbFaces
+     << " faces, " << NbTriangles << " triangles";
+  return os.str();
+}
+
+Handle_AIS_InteractiveObject
+ModelFactory::CreateStlMesh(const Handle(Poly_Triangulation) & triangulation,
+                            ModelLoadStats *stats) {
+  TRACE_SCOPE("mesh presentation setup");
+  OSD_Timer timer;
+  timer.Start();
+  Handle(XSDRAWSTLVRML_DataSource) dataSource =
+      new XSDRAWSTLVRML_DataSource(triangulation);
+
+  // smaller meshes are built within a single frame anyway
+  static const int minSlicedTriangles = 200000;
+  Handle(MeshVS_Mesh) mesh;
+  if (meshParams_.IsSliced && !triangulation.IsNull() &&
+      triangulation->NbTriangles() >= minSlicedTriangles) {
+    mesh = new SlicedMeshPrs();
+  } else {
+    mesh = new MeshVS_Mesh();
+  }
+  mesh->SetDataSource(dataSource);
+  mesh->AddBuilder(new MeshVS_MeshPrsBuilder(mesh), Standard_True);
+
+  auto drawer = mesh->GetDrawer();
+  drawer->SetBoolean(MeshVS_DA_DisplayNodes, Standard_False);
+  drawer->SetBoolean(MeshVS_DA_ShowEdges, Standard_False);
+  mesh->SetMeshSelMethod(MeshVS_MSM_BOX);
+  if (stats != nullptr) {
+    stats->BuildTime += timer.ElapsedTime();
+  }
+  return mesh;
+}
+
+Handle(Poly_Triangulation)
+ModelFactory::MakeTriangulation(const Triangle3D<float> *facets,
+                                size_t facetCount) {
+  if (facetCount == 0) {
+    return Handle(Poly_Triangulation)();
+  }
+
+  Handle(Poly_Triangulation) aPoly = new Poly_Triangulation(
+      static_cast<Standard_Integer>(facetCount * 3),
+      static_cast<Standard_Integer>(facetCount), Standard_False);
+  for (size_t i = 0; i < facetCount; i++) {
+    const Standard_Integer aFirst = static_cast<Standard_Integer>(i * 3 + 1);
+    for (size_t j = 0; j < 3; j++) {
+      const auto &pos = facets[i].Vertexes[j].Coords;
+      aPoly->SetNode(aFirst + (Standard_Integer)j,
+                     gp_Pnt(pos[0], pos[1], pos[2]));
+    }
+    aPoly->SetTriangle(static_cast<Standard_Integer>(i + 1),
+                       Poly_Triangle(aFirst, aFirst + 1, aFirst + 2));
+  }
+  return aPoly;
+}
+
+Handle(Poly_Triangulation)
+ModelFactory::MakeTriangulation(const std::vector<float> &vertexes,
+                                const std::vector<unsigned int> &indexes) {
+  if (indexes.size() < 3) {
+    return Handle(Poly_Triangulation)();
+  }
+
+  const Standard_Integer aNbNodes =
+      static_cast<Standard_Integer>(vertexes.size() / 3);
+  const Standard_Integer aNbTris =
+      static_cast<Standard_Integer>(indexes.size() / 3);
+  Handle(Poly_Triangulation) aPoly =
+      new Poly_Triangulation(aNbNodes, aNbTris, Standard_False);
+  for (Standard_Integer i = 0; i < aNbNodes; i++) {
+    aPoly->SetNode(i + 1, gp_Pnt(vertexes[i * 3], vertexes[i * 3 + 1],
+                                 vertexes[i * 3 + 2]));
+  }
+  for (Standard_Integer i = 0; i < aNbTris; i++) {
+    aPoly->SetTriangle(i + 1, Poly_Triangle(indexes[i * 3] + 1,
+                                            indexes[i * 3 + 1] + 1,
+                                            indexes[i * 3 + 2] + 1));
+  }
+  return aPoly;
+}
+
 /*
 TopoDS_Shape ModelFactory::LoadFromStl(std::istream &is) {
   StlFile stlFile;
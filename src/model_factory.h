@@ -1,7 +1,63 @@
 #pragma once
 
-class TopoDS_Shape;
+#include <Bnd_Box.hxx>
+#include <Message_ProgressRange.hxx>
+#include <NCollection_Sequence.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include <string>
+#include <vector>
+
+#include "geometry_registry.h"
+#include "step_assembly.h"
+#include "stl_file.h"
+#include "tessellation_cache.h"
+
 class AIS_InteractiveObject;
+class Poly_Triangulation;
+
+//! Tessellation parameters of B-Rep shapes.
+//! By default linear deflection is derived from the size of each meshed
+//! shape, like AIS does it for shapes without triangulation.
+struct ModelMeshParams {
+  double Deflection = 0.0; //!< linear deflection, 0 to derive from shape size
+  double DeviationCoefficient = 0.001; //!< deflection relative to shape size
+  double Angle = 0.349;      //!< angular deflection in radians (20 degrees)
+  bool IsRelative = false;   //!< deflection is relative to the edge size
+  bool InParallel = true;    //!< mesh faces in parallel threads
+  bool IsProgressive = false; //!< show coarse mesh first, refine afterwards
+  bool IsLazy = false; //!< show boxes of assembly parts, mesh visible ones
+  bool IsSliced = false; //!< build huge mesh presentations in time slices
+
+  //! Return parameters of the first meshing pass: coarse ones for
+  //! progressive meshing, or these parameters otherwise.
+  ModelMeshParams FirstPass() const;
+
+  //! Return parameters with linear deflection derived from the size of the
+  //! box (see Prs3d::GetDeflection()), unless Deflection is set explicitly.
+  ModelMeshParams ForBox(const Bnd_Box &theBox) const;
+
+  //! Return parameters with linear deflection derived from the shape size,
+  //! unless Deflection is set explicitly.
+  ModelMeshParams ForShape(const TopoDS_Shape &theShape) const;
+};
+
+//! Timing (in seconds) and size statistics of model loading stages.
+struct ModelLoadStats {
+  double ReadTime = 0.0;     //!< parsing of input data
+  double TransferTime = 0.0; //!< transfer of STEP entities into shapes
+  double MeshTime = 0.0;     //!< tessellation of shapes
+  double BuildTime = 0.0;    //!< building of presentation data
+  int NbFaces = 0;
+  int NbTriangles = 0;
+
+  //! Format statistics as JSON object.
+  std::string ToJson() const;
+
+  //! Format statistics as a message line.
+  std::string ToString() const;
+};
+
 class ModelFactory {
 private:
   static ModelFactory *instance_;
@@ -16,5 +72,201 @@ public:
                           const Standard_Real myHeight,
                           const Standard_Real myThickness);
 
-  Handle(AIS_InteractiveObject) LoadFromStl(std::istream &is);
+  //! Read STL stream into a single triangulation.
+  //! @return null handle on reading error
+  Handle(Poly_Triangulation)
+  ReadStl(std::istream &is,
+          const Message_ProgressRange &progress = Message_ProgressRange(),
+          ModelLoadStats *stats = nullptr);
+
+  Handle(AIS_InteractiveObject)
+  LoadFromStl(std::istream &is,
+              const Message_ProgressRange &progress = Message_ProgressRange(),
+              ModelLoadStats *stats = nullptr);
+
+  //! Read triangulation from the mesh pack in memory, see MeshPack.
+  //! @return null handle on invalid data
+  Handle(Poly_Triangulation) ReadMeshPack(const char *data, size_t dataLen,
+                                          ModelLoadStats *stats = nullptr);
+
+  //! Write triangulation as mesh pack, with normals if it has them.
+  //! @return FALSE on writing error
+  bool WriteMeshPack(const Handle(Poly_Triangulation) & triangulation,
+                     std::ostream &os);
+
+  //! Write triangulations of the shape faces as single mesh pack.
+  //! Faces keep their own vertexes, so that normals are smooth within
+  //! faces only.
+  //! @return FALSE if shape is not meshed or on writing error
+  bool WriteMeshPack(const TopoDS_Shape &shape, std::ostream &os);
+
+  //! Read shape from the textual or binary (BinTools) BRep stream.
+  //! Binary BRep keeps triangulation, see IsTriangulated().
+  //! @return null shape on reading error
+  TopoDS_Shape
+  LoadFromBRep(std::istream &is,
+               const Message_ProgressRange &progress = Message_ProgressRange(),
+               ModelLoadStats *stats = nullptr);
+
+  //! Read STEP stream and transfer all its roots.
+  //! @return FALSE on reading error
+  bool
+  LoadFromStep(std::istream &is, const std::string &name,
+               NCollection_Sequence<TopoDS_Shape> &shapes,
+               const Message_ProgressRange &progress = Message_ProgressRange(),
+               ModelLoadStats *stats = nullptr);
+
+  //! Read STEP assembly with names, colors and instanced parts.
+  //! Assembly tree and part meshes are restored from the mesh cache if
+  //! possible, so that STEP data is not parsed at all; otherwise parts are
+  //! triangulated with the first pass parameters and cached with the tree.
+  //! Lazy parameters (see ModelMeshParams::IsLazy) leave parts not cached
+  //! unmeshed, to be displayed as placeholders.
+  //! @param key [in] key of the data computed before, e.g. by
+  //!                 FindSharedModel(), or empty
+  //! @return NULL on reading error or user break
+  Handle(StepAssembly)
+  LoadStepAssembly(const char *data, size_t dataLen, const std::string &name,
+                   const ModelMeshParams &params,
+                   const Message_ProgressRange &progress = Message_ProgressRange(),
+                   ModelLoadStats *stats = nullptr,
+                   const std::string &key = std::string());
+
+  //! Read assembly from binary XCAF document (XBF).
+  //! Parts without stored triangulation are triangulated with the first
+  //! pass parameters, or left for lazy meshing (see ModelMeshParams::IsLazy).
+  //! @return NULL on reading error or user break
+  Handle(StepAssembly)
+  LoadXbfAssembly(const char *data, size_t dataLen,
+                  const ModelMeshParams &params,
+                  const Message_ProgressRange &progress = Message_ProgressRange(),
+                  ModelLoadStats *stats = nullptr);
+
+  //! Read scene of binary glTF file (GLB) as assembly.
+  //! Meshes are decoded straight into part triangulations, so that nothing
+  //! is meshed and nothing is cached.
+  //! @return NULL on reading error or user break
+  Handle(StepAssembly)
+  LoadGltfAssembly(const char *data, size_t dataLen,
+                   const Message_ProgressRange &progress = Message_ProgressRange(),
+                   ModelLoadStats *stats = nullptr);
+
+  //! Read assembly of STEP, XBF or GLB data, chosen by the name extension.
+  //! @param key [in] key of the data computed before, e.g. by
+  //!                 FindSharedModel(), or empty
+  //! @return NULL on reading error or user break
+  Handle(StepAssembly)
+  LoadAssembly(const char *data, size_t dataLen, const std::string &name,
+               const ModelMeshParams &params,
+               const Message_ProgressRange &progress = Message_ProgressRange(),
+               ModelLoadStats *stats = nullptr,
+               const std::string &key = std::string());
+
+  //! Return TRUE if all faces of the shape have triangulation,
+  //! so that it can be displayed without meshing.
+  static bool IsTriangulated(const TopoDS_Shape &shape);
+
+  //! Compute triangulation of the shape with BRepMesh_IncrementalMesh.
+  //! Presentations of meshed shapes should be created with
+  //! CreateMeshedShape() so that displaying does not re-mesh them.
+  void Triangulate(const TopoDS_Shape &shape, const ModelMeshParams &params,
+                   const Message_ProgressRange &progress = Message_ProgressRange(),
+                   ModelLoadStats *stats = nullptr);
+
+  //! Create shaded presentation of the shape meshed by Triangulate().
+  Handle(AIS_InteractiveObject) CreateMeshedShape(const TopoDS_Shape &shape);
+
+  //! Return parameters used for tessellation of loaded shapes.
+  const ModelMeshParams &MeshParams() const { return meshParams_; }
+
+  //! Set parameters used for tessellation of loaded shapes.
+  void SetMeshParams(const ModelMeshParams &params) { meshParams_ = params; }
+
+  //! Return cache of shape triangulations, NULL if caching is disabled.
+  const Handle(TessellationCache) & MeshCache() const { return meshCache_; }
+
+  //! Set cache of shape triangulations, NULL to disable caching.
+  void SetMeshCache(const Handle(TessellationCache) & cache) {
+    meshCache_ = cache;
+  }
+
+  //! Restore triangulated shapes of the model data from the mesh cache.
+  //! @param key       [in/out] cache key to be passed to StoreCachedMesh(),
+  //!                           computed unless given, e.g. by
+  //!                           FindSharedModel() for the same data
+  //! @param modelData [out] model data stored with the shapes, if not NULL
+  //! @return FALSE if caching is disabled or there is no entry
+  bool FindCachedMesh(const char *data, size_t dataLen,
+                      const ModelMeshParams &params,
+                      NCollection_Sequence<TopoDS_Shape> &shapes,
+                      std::string &key, ModelLoadStats *stats = nullptr,
+                      std::string *modelData = nullptr);
+
+  //! Store triangulation of the shapes into the mesh cache, if enabled,
+  //! with optional model data, see TessellationCache::Store().
+  void StoreCachedMesh(const std::string &key,
+                       const NCollection_Sequence<TopoDS_Shape> &shapes,
+                       const std::string &modelData = std::string());
+
+  //! Return registry of shared geometry, NULL if sharing is disabled.
+  const Handle(GeometryRegistry) & Geometry() const { return geometry_; }
+
+  //! Set registry of shared geometry, NULL to disable sharing.
+  void SetGeometry(const Handle(GeometryRegistry) & geometry) {
+    geometry_ = geometry;
+  }
+
+  //! Create instances of the model loaded before from the same data.
+  //! @param key [in/out] key to be passed to StoreSharedModel() and reused
+  //!                     by FindCachedMesh(), computed unless given
+  //! @return FALSE if sharing is disabled or model has not been loaded
+  bool FindSharedModel(const char *data, size_t dataLen,
+                       const ModelMeshParams &params,
+                       NCollection_Sequence<Handle(AIS_InteractiveObject)> &prs,
+                       std::string &key);
+
+  //! Register presentations of the model data for sharing, if enabled.
+  void StoreSharedModel(
+      const std::string &key,
+      const NCollection_Sequence<Handle(AIS_InteractiveObject)> &prs);
+
+  //! Create mesh presentation sharing equal triangulation registered before,
+  //! or CreateStlMesh() if sharing is disabled.
+  Handle(AIS_InteractiveObject)
+  InstantiateStlMesh(const Handle(Poly_Triangulation) & triangulation,
+                     ModelLoadStats *stats = nullptr);
+
+  //! Create shaded presentation sharing sub-shapes registered before,
+  //! or CreateMeshedShape() if sharing is disabled.
+  Handle(AIS_InteractiveObject) InstantiateShape(const TopoDS_Shape &shape);
+
+  //! Create mesh presentation for the triangulation.
+  //! The presentation refers to the triangulation without copying it.
+  //! With sliced parameters (see ModelMeshParams::IsSliced), presentation of
+  //! a huge triangulation is SlicedMeshPrs built within frame time budget.
+  Handle(AIS_InteractiveObject)
+  CreateStlMesh(const Handle(Poly_Triangulation) & triangulation,
+                ModelLoadStats *stats = nullptr);
+
+  //! Create triangulation from raw facets, coincident nodes are not merged.
+  Handle(Poly_Triangulation) MakeTriangulation(const Triangle3D<float> *facets,
+                                               size_t facetCount);
+
+  //! Create triangulation from data produced by StlFile::ToIndexedData().
+  Handle(Poly_Triangulation)
+  MakeTriangulation(const std::vector<float> &vertexes,
+                    const std::vector<unsigned int> &indexes);
+
+private:
+  //! Triangulate parts without triangulation together.
+  //! @return FALSE on user break
+  bool triangulateParts(const NCollection_Sequence<TopoDS_Shape> &parts,
+                        const ModelMeshParams &params,
+                        const Message_ProgressRange &progress,
+                        ModelLoadStats *stats);
+
+private:
+  ModelMeshParams meshParams_;
+  Handle(TessellationCache) meshCache_;
+  Handle(GeometryRegistry) geometry_;
 };
@@ -0,0 +1,160 @@
+#include "model_load_job.h"
+
+#include <MeshVS_DisplayModeFlags.hxx>
+#include <Message_ProgressScope.hxx>
+#include <Standard_ArrayStreamBuffer.hxx>
+
+#include "help_algorithms.h"
+#include "membuf.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(ModelLoadJob, LoadJob)
+
+// ================================================================
+// Function : ModelLoadJob
+// Purpose  :
+// ================================================================
+ModelLoadJob::ModelLoadJob(const TCollection_AsciiString &theName,
+                           char *theBuffer, size_t theDataLen,
+                           const ModelMeshParams &theParams)
+    : LoadJob(theName), myBuffer(theBuffer), myDataLen(theDataLen),
+      myParams(theParams) {}
+
+// ================================================================
+// Function : ~ModelLoadJob
+// Purpose  :
+// ================================================================
+ModelLoadJob::~ModelLoadJob() { releaseBuffer(); }
+
+// ================================================================
+// Function : IsSupported
+// Purpose  :
+// ================================================================
+bool ModelLoadJob::IsSupported(const TCollection_AsciiString &theName) {
+  const std::string aName(theName.ToCString());
+  return test_file_extension(aName, ".brep") ||
+         test_file_extension(aName, ".bbrep") ||
+         test_file_extension(aName, ".xbf") ||
+         test_file_extension(aName, ".glb") ||
+         test_file_extension(aName, ".stl") ||
+         test_file_extension(aName, ".step") ||
+         test_file_extension(aName, ".omsh");
+}
+
+// ================================================================
+// Function : releaseBuffer
+// Purpose  :
+// ================================================================
+void ModelLoadJob::releaseBuffer() {
+  free(myBuffer);
+  myBuffer = nullptr;
+  myDataLen = 0;
+}
+
+// ================================================================
+// Function : Perform
+// Purpose  :
+// ================================================================
+bool ModelLoadJob::Perform(const Message_ProgressRange &theProgress) {
+  const std::string aName(Name().ToCString());
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  Message_ProgressScope aPS(theProgress, "Loading", 2);
+
+  if (test_file_extension(aName, ".stl")) {
+    basic_membuf<char> aStreamBuffer(myBuffer, myDataLen);
+    std::istream aStream(&aStreamBuffer);
+    Handle(Poly_Triangulation) aTriangulation =
+        aFactory->ReadStl(aStream, aPS.Next(), &myStats);
+    releaseBuffer();
+    if (aTriangulation.IsNull() || !aPS.More()) {
+      return false;
+    }
+    Handle(AIS_InteractiveObject) aMesh =
+        aFactory->InstantiateStlMesh(aTriangulation, &myStats);
+    aMesh->SetDisplayMode(MeshVS_DMF_Shading);
+    myPresentations.Append(aMesh);
+    return true;
+  }
+
+  if (test_file_extension(aName, ".omsh")) {
+    Handle(Poly_Triangulation) aTriangulation =
+        aFactory->ReadMeshPack(myBuffer, myDataLen, &myStats);
+    releaseBuffer();
+    if (aTriangulation.IsNull()) {
+      return false;
+    }
+    Handle(AIS_InteractiveObject) aMesh =
+        aFactory->InstantiateStlMesh(aTriangulation, &myStats);
+    aMesh->SetDisplayMode(MeshVS_DMF_Shading);
+    myPresentations.Append(aMesh);
+    return true;
+  }
+
+  // key is computed once and shared by the geometry registry and mesh cache
+  std::string aModelKey;
+  if (aFactory->FindSharedModel(myBuffer, myDataLen, myParams, myPresentations,
+                                aModelKey)) {
+    releaseBuffer();
+    return true;
+  }
+
+  if (test_file_extension(aName, ".step") ||
+      test_file_extension(aName, ".xbf") ||
+      test_file_extension(aName, ".glb")) {
+    Handle(StepAssembly) anAssembly = aFactory->LoadAssembly(
+        myBuffer, myDataLen, aName, myParams, aPS.Next(2), &myStats,
+        aModelKey);
+    releaseBuffer();
+    if (anAssembly.IsNull() || !aPS.More()) {
+      return false;
+    }
+    myPresentations.Append(anAssembly->CreatePresentation());
+    aFactory->StoreSharedModel(aModelKey, myPresentations);
+    return true;
+  }
+
+  NCollection_Sequence<TopoDS_Shape> aShapes;
+  if (aFactory->FindCachedMesh(myBuffer, myDataLen, myParams, aShapes,
+                               aModelKey, &myStats)) {
+    releaseBuffer();
+    for (NCollection_Sequence<TopoDS_Shape>::Iterator aShapeIter(aShapes);
+         aShapeIter.More(); aShapeIter.Next()) {
+      myPresentations.Append(aFactory->InstantiateShape(aShapeIter.Value()));
+    }
+    aFactory->StoreSharedModel(aModelKey, myPresentations);
+    return true;
+  }
+
+  {
+    Standard_ArrayStreamBuffer aStreamBuffer(myBuffer, myDataLen);
+    std::istream aStream(&aStreamBuffer);
+    TopoDS_Shape aShape = aFactory->LoadFromBRep(aStream, aPS.Next(), &myStats);
+    if (!aShape.IsNull()) {
+      aShapes.Append(aShape);
+    }
+  }
+  releaseBuffer();
+  if (aShapes.IsEmpty() || !aPS.More()) {
+    return false;
+  }
+
+  // binary BRep may come with triangulation, which is used as is
+  const bool isTriangulated = ModelFactory::IsTriangulated(aShapes.First());
+  Message_ProgressScope aMeshPS(aPS.Next(), "Meshing", aShapes.Size());
+  for (NCollection_Sequence<TopoDS_Shape>::Iterator aShapeIter(aShapes);
+       aShapeIter.More() && aMeshPS.More(); aShapeIter.Next()) {
+    if (!isTriangulated) {
+      aFactory->Triangulate(aShapeIter.Value(), myParams.FirstPass(),
+                            aMeshPS.Next(), &myStats);
+    }
+    myPresentations.Append(aFactory->InstantiateShape(aShapeIter.Value()));
+  }
+  if (!aMeshPS.More()) {
+    return false;
+  }
+  aFactory->StoreSharedModel(aModelKey, myPresentations);
+  if (!myParams.IsProgressive && !isTriangulated) {
+    // coarse triangulation is not worth caching
+    aFactory->StoreCachedMesh(aModelKey, aShapes);
+  }
+  return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "load_job_queue.h"
+#include "model_factory.h"
+
+class ModelLoadJob;
+DEFINE_STANDARD_HANDLE(ModelLoadJob, LoadJob)
+
+//! Job loading STL, BRep, STEP, XBF or mesh pack model from memory buffer.
+//! Format is chosen by extension of the object name.
+class ModelLoadJob : public LoadJob {
+  DEFINE_STANDARD_RTTIEXT(ModelLoadJob, LoadJob)
+public:
+  //! @param theName    [in] object name
+  //! @param theBuffer  [in] data allocated by malloc(), job takes ownership
+  //! @param theDataLen [in] data length
+  //! @param theParams  [in] tessellation parameters of B-Rep shapes
+  ModelLoadJob(const TCollection_AsciiString &theName, char *theBuffer,
+               size_t theDataLen, const ModelMeshParams &theParams);
+
+  virtual ~ModelLoadJob();
+
+  //! Return TRUE if object name has supported extension.
+  static bool IsSupported(const TCollection_AsciiString &theName);
+
+  //! Return statistics of loading stages.
+  const ModelLoadStats &Stats() const { return myStats; }
+
+protected:
+  //! Parse buffer, mesh shapes and build presentations.
+  virtual bool Perform(const Message_ProgressRange &theProgress) override;
+
+private:
+  //! Release input buffer as soon as it is parsed.
+  void releaseBuffer();
+
+private:
+  char *myBuffer;
+  size_t myDataLen;
+  ModelMeshParams myParams;
+  ModelLoadStats myStats;
+};
@@ -0,0 +1,577 @@
+// Native command-line batch converter sharing the loading code of the viewer.
+//
+// Usage: occt_demo_cli [options] <file or directory>...
+// Each input file is processed by a worker pool (see LoadJobQueue):
+//  - read:      STL (welded with StlFile::ToIndexedData), mesh pack,
+//               textual or binary BRep, STEP;
+//  - tessellate B-Rep shapes not triangulated yet (ModelFactory::Triangulate);
+//  - validate   indexes, degenerated triangles, boundary and non-manifold
+//               edges (nodes of B-Rep face borders are welded for that);
+//  - decimate   meshes or tessellated shapes by vertex clustering
+//               (decimate_mesh());
+//  - write      mesh pack, binary STL or binary BRep with triangulation;
+//               files found in directories keep their relative path.
+// Per-file timing is printed as each file is completed.
+
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <BinTools.hxx>
+#include <OSD_Timer.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Standard_ArrayStreamBuffer.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <TopoDS_Face.hxx>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "help_algorithms.h"
+#include "load_arena.h"
+#include "load_job_queue.h"
+#include "mesh_pack.h"
+#include "model_factory.h"
+#include "stl_file.h"
+
+namespace {
+
+//! Conversion options.
+struct CliOptions {
+  std::string OutDir;          //!< output directory, empty for no output
+  std::string Format = "omsh"; //!< output format: omsh, stl or bbrep
+  int NbThreads = 0;           //!< 0 for number of logical processors
+  double DecimateRatio = 1.0;  //!< fraction of triangles kept
+  bool ToValidate = false;
+  ModelMeshParams MeshParams;
+};
+
+//! Result of mesh validation.
+struct Validation {
+  size_t NbDegenerated = 0; //!< triangles with coincident nodes
+  size_t NbBoundary = 0;    //!< edges of a single triangle
+  size_t NbNonManifold = 0; //!< edges of more than two triangles
+  bool IsValid = true;      //!< all indexes refer to existing nodes
+};
+
+//! Timing of processing stages in milliseconds.
+struct Timing {
+  double Read = 0.0;
+  double Weld = 0.0;
+  double Mesh = 0.0;
+  double Validate = 0.0;
+  double Decimate = 0.0;
+  double Write = 0.0;
+  double Total = 0.0;
+};
+
+//! Return elapsed time in milliseconds and restart the timer.
+double lapTime(OSD_Timer &theTimer) {
+  const double aTime = theTimer.ElapsedTime() * 1000.0;
+  theTimer.Reset();
+  theTimer.Start();
+  return aTime;
+}
+
+//! Collect triangulations of the shape faces into single indexed mesh.
+//! Triangles of reversed faces are flipped.
+void shapeToMesh(const TopoDS_Shape &theShape, std::vector<float> &theVertexes,
+                 std::vector<unsigned int> &theIndexes) {
+  for (TopExp_Explorer aFaceExp(theShape, TopAbs_FACE); aFaceExp.More();
+       aFaceExp.Next()) {
+    const TopoDS_Face &aFace = TopoDS::Face(aFaceExp.Current());
+    TopLoc_Location aLoc;
+    const Handle(Poly_Triangulation) &aTriangulation =
+        BRep_Tool::Triangulation(aFace, aLoc);
+    if (aTriangulation.IsNull()) {
+      continue;
+    }
+
+    const unsigned int aBase = (unsigned int)(theVertexes.size() / 3);
+    const gp_Trsf &aTrsf = aLoc.Transformation();
+    for (Standard_Integer aNodeIter = 1; aNodeIter <= aTriangulation->NbNodes();
+         ++aNodeIter) {
+      const gp_Pnt aPnt = aTriangulation->Node(aNodeIter).Transformed(aTrsf);
+      theVertexes.push_back((float)aPnt.X());
+      theVertexes.push_back((float)aPnt.Y());
+      theVertexes.push_back((float)aPnt.Z());
+    }
+    const bool isReversed = aFace.Orientation() == TopAbs_REVERSED;
+    for (Standard_Integer aTriIter = 1;
+         aTriIter <= aTriangulation->NbTriangles(); ++aTriIter) {
+      Standard_Integer aN1, aN2, aN3;
+      aTriangulation->Triangle(aTriIter).Get(aN1, aN2, aN3);
+      if (isReversed) {
+        std::swap(aN2, aN3);
+      }
+      theIndexes.push_back(aBase + aN1 - 1);
+      theIndexes.push_back(aBase + aN2 - 1);
+      theIndexes.push_back(aBase + aN3 - 1);
+    }
+  }
+}
+
+//! Merge coincident nodes of the mesh, e.g. shared by borders of faces.
+void weldMesh(const std::vector<float> &theVertexes,
+              const std::vector<unsigned int> &theIndexes,
+              std::vector<float> &theWeldedVertexes,
+              std::vector<unsigned int> &theWeldedIndexes) {
+  std::vector<Triangle3D<float>> aFacets(theIndexes.size() / 3);
+  for (size_t aTriIter = 0; aTriIter < aFacets.size(); ++aTriIter) {
+    for (int aCorner = 0; aCorner < 3; ++aCorner) {
+      const float *aNode = &theVertexes[theIndexes[aTriIter * 3 + aCorner] * 3];
+      aFacets[aTriIter][aCorner] = Point3D<float>(aNode[0], aNode[1], aNode[2]);
+    }
+  }
+  StlFile aStlFile;
+  aStlFile.set_Facets(std::move(aFacets));
+  LoadArena anArena;
+  aStlFile.ToIndexedData(theWeldedVertexes, theWeldedIndexes,
+                         anArena.Resource());
+}
+
+//! Validate indexed mesh; degenerated triangles are removed.
+Validation validateMesh(size_t theNbNodes,
+                        std::vector<unsigned int> &theIndexes) {
+  Validation aResult;
+  size_t aNbKept = 0;
+  for (size_t aTriIter = 0; aTriIter + 2 < theIndexes.size(); aTriIter += 3) {
+    const unsigned int *aTri = &theIndexes[aTriIter];
+    if (aTri[0] >= theNbNodes || aTri[1] >= theNbNodes ||
+        aTri[2] >= theNbNodes) {
+      aResult.IsValid = false;
+      return aResult;
+    }
+    if (aTri[0] == aTri[1] || aTri[1] == aTri[2] || aTri[0] == aTri[2]) {
+      ++aResult.NbDegenerated;
+      continue;
+    }
+    std::copy(aTri, aTri + 3, theIndexes.begin() + aNbKept * 3);
+    ++aNbKept;
+  }
+  theIndexes.resize(aNbKept * 3);
+
+  std::vector<std::tuple<unsigned int, unsigned int>> anEdges;
+  std::vector<std::tuple<unsigned int, unsigned int, unsigned int>> aTriEdges;
+  LoadArena anArena;
+  if (!file_edges(theIndexes, anEdges, aTriEdges, anArena.Resource())) {
+    aResult.IsValid = false;
+    return aResult;
+  }
+  std::vector<unsigned char> anEdgeUsage(anEdges.size(), 0);
+  for (const auto &aTri : aTriEdges) {
+    for (unsigned int anEdge :
+         {std::get<0>(aTri), std::get<1>(aTri), std::get<2>(aTri)}) {
+      if (anEdgeUsage[anEdge] < 3) {
+        ++anEdgeUsage[anEdge];
+      }
+    }
+  }
+  for (unsigned char aUsage : anEdgeUsage) {
+    aResult.NbBoundary += aUsage == 1 ? 1 : 0;
+    aResult.NbNonManifold += aUsage > 2 ? 1 : 0;
+  }
+  return aResult;
+}
+
+//! Job converting single file.
+class ConvertJob : public LoadJob {
+  DEFINE_STANDARD_RTTI_INLINE(ConvertJob, LoadJob)
+public:
+  //! @param thePath    [in] input file
+  //! @param theOutPath [in] output file relative to the output directory
+  ConvertJob(const std::filesystem::path &thePath,
+             const std::filesystem::path &theOutPath,
+             const CliOptions &theOptions)
+      : LoadJob(thePath.string().c_str()), myPath(thePath),
+        myOutPath(theOutPath), myOptions(theOptions), myInSize(0),
+        myOutSize(0), myNbNodes(0), myNbTriangles(0) {}
+
+  //! Print the result as a single line.
+  void Print(std::ostream &theStream) const {
+    theStream << Name() << ": ";
+    if (GetState() != State_Done) {
+      theStream << "FAILED " << myError << "\n";
+      return;
+    }
+    char aLine[512];
+    snprintf(aLine, sizeof(aLine),
+             "%zu nodes, %zu triangles, %.2f -> %.2f MB; read %.1f ms, "
+             "weld %.1f ms, mesh %.1f ms, validate %.1f ms, decimate %.1f ms, "
+             "write %.1f ms, total %.1f ms",
+             myNbNodes, myNbTriangles, myInSize / 1048576.0,
+             myOutSize / 1048576.0, myTiming.Read, myTiming.Weld,
+             myTiming.Mesh, myTiming.Validate, myTiming.Decimate,
+             myTiming.Write, myTiming.Total);
+    theStream << aLine;
+    if (myOptions.ToValidate) {
+      theStream << "; " << (myValidation.IsValid ? "valid" : "INVALID")
+                << ", degenerated " << myValidation.NbDegenerated
+                << ", boundary edges " << myValidation.NbBoundary
+                << ", non-manifold edges " << myValidation.NbNonManifold;
+    }
+    theStream << "\n";
+  }
+
+  //! Return number of output triangles.
+  size_t NbTriangles() const { return myNbTriangles; }
+
+protected:
+  //! Read, process and write the file.
+  virtual bool Perform(const Message_ProgressRange &theProgress) override {
+    OSD_Timer aTotalTimer, aTimer;
+    aTotalTimer.Start();
+    aTimer.Start();
+    try {
+      if (!read(theProgress)) {
+        return false;
+      }
+      myTiming.Read += lapTime(aTimer);
+      process(aTimer);
+      if (!write()) {
+        return false;
+      }
+      myTiming.Write = lapTime(aTimer);
+    } catch (const Standard_Failure &theFailure) {
+      myError = theFailure.GetMessageString();
+      return false;
+    }
+    myTiming.Total = aTotalTimer.ElapsedTime() * 1000.0;
+    return true;
+  }
+
+private:
+  //! Read input file into mesh arrays or shape.
+  bool read(const Message_ProgressRange &theProgress) {
+    std::ifstream aFile(myPath, std::ios::binary);
+    std::vector<char> aData((std::istreambuf_iterator<char>(aFile)),
+                            std::istreambuf_iterator<char>());
+    myInSize = aData.size();
+    if (!aFile.good() && !aFile.eof()) {
+      myError = "unable to read file";
+      return false;
+    }
+
+    ModelFactory *aFactory = ModelFactory::GetInstance();
+    const std::string aName = myPath.filename().string();
+    Standard_ArrayStreamBuffer aStreamBuffer(aData.data(), aData.size());
+    std::istream aStream(&aStreamBuffer);
+    if (test_file_extension(aName, ".stl")) {
+      StlFile aStlFile;
+      if (!aStlFile.LoadFromStream(aStream)) {
+        myError = "invalid STL";
+        return false;
+      }
+      OSD_Timer aTimer;
+      aTimer.Start();
+      {
+        LoadArena anArena;
+        aStlFile.ToIndexedData(myVertexes, myIndexes, anArena.Resource());
+      }
+      myTiming.Weld = lapTime(aTimer);
+      // caller adds the whole time of reading, welding included
+      myTiming.Read -= myTiming.Weld;
+      return true;
+    } else if (test_file_extension(aName, ".omsh")) {
+      Handle(Poly_Triangulation) aTriangulation =
+          aFactory->ReadMeshPack(aData.data(), aData.size());
+      if (aTriangulation.IsNull()) {
+        myError = "invalid mesh pack";
+        return false;
+      }
+      TopoDS_Face aFace;
+      BRep_Builder().MakeFace(aFace, aTriangulation);
+      shapeToMesh(aFace, myVertexes, myIndexes);
+      return true;
+    } else if (test_file_extension(aName, ".brep") ||
+               test_file_extension(aName, ".bbrep")) {
+      myShape = aFactory->LoadFromBRep(aStream, theProgress);
+    } else if (test_file_extension(aName, ".step") ||
+               test_file_extension(aName, ".stp")) {
+      NCollection_Sequence<TopoDS_Shape> aShapes;
+      aFactory->LoadFromStep(aStream, aName, aShapes, theProgress);
+      TopoDS_Compound aCompound;
+      BRep_Builder aBuilder;
+      aBuilder.MakeCompound(aCompound);
+      for (NCollection_Sequence<TopoDS_Shape>::Iterator aShapeIter(aShapes);
+           aShapeIter.More(); aShapeIter.Next()) {
+        aBuilder.Add(aCompound, aShapeIter.Value());
+      }
+      myShape = aShapes.IsEmpty() ? TopoDS_Shape() : aCompound;
+    } else {
+      myError = "unsupported format";
+      return false;
+    }
+
+    if (myShape.IsNull()) {
+      myError = "unable to read shape";
+      return false;
+    }
+    return true;
+  }
+
+  //! Tessellate, validate and decimate.
+  void process(OSD_Timer &theTimer) {
+    ModelFactory *aFactory = ModelFactory::GetInstance();
+    if (!myShape.IsNull()) {
+      if (!ModelFactory::IsTriangulated(myShape)) {
+        aFactory->Triangulate(myShape, myOptions.MeshParams);
+      }
+      myTiming.Mesh = lapTime(theTimer);
+      // B-Rep is kept for BRep output, other formats need the mesh
+      if (myOptions.Format != "bbrep" || myOptions.ToValidate ||
+          myOptions.DecimateRatio < 1.0) {
+        shapeToMesh(myShape, myVertexes, myIndexes);
+      }
+      lapTime(theTimer);
+    }
+
+    if (myOptions.ToValidate && !myShape.IsNull()) {
+      // faces are triangulated separately, so their borders are welded
+      // to check the shape rather than each face; output keeps sharp edges
+      std::vector<float> aVertexes;
+      std::vector<unsigned int> anIndexes;
+      weldMesh(myVertexes, myIndexes, aVertexes, anIndexes);
+      myTiming.Weld = lapTime(theTimer);
+      myValidation = validateMesh(aVertexes.size() / 3, anIndexes);
+      myTiming.Validate = lapTime(theTimer);
+    } else if (myOptions.ToValidate) {
+      myValidation = validateMesh(myVertexes.size() / 3, myIndexes);
+      myTiming.Validate = lapTime(theTimer);
+    }
+
+    if (myOptions.DecimateRatio < 1.0) {
+      // clustering merges nodes of face borders as well, so that tessellated
+      // shapes are decimated as a single mesh written instead of the B-Rep
+      myShape.Nullify();
+      std::vector<float> aVertexes;
+      std::vector<unsigned int> anIndexes;
+      if (decimate_mesh(myVertexes, myIndexes,
+                        (size_t)(myIndexes.size() / 3 *
+                                 myOptions.DecimateRatio),
+                        aVertexes, anIndexes)) {
+        myVertexes.swap(aVertexes);
+        myIndexes.swap(anIndexes);
+      }
+      myTiming.Decimate = lapTime(theTimer);
+    }
+    myNbNodes = myVertexes.size() / 3;
+    myNbTriangles = myIndexes.size() / 3;
+  }
+
+  //! Write result in the requested format.
+  bool write() {
+    if (myOptions.OutDir.empty()) {
+      return true;
+    }
+
+    const std::filesystem::path anOutPath =
+        std::filesystem::path(myOptions.OutDir) / myOutPath;
+    std::error_code anError;
+    std::filesystem::create_directories(anOutPath.parent_path(), anError);
+    std::ofstream aStream(anOutPath, std::ios::binary);
+    ModelFactory *aFactory = ModelFactory::GetInstance();
+    bool isDone = false;
+    if (myOptions.Format == "omsh") {
+      std::vector<float> aNormals;
+      MeshPackWriter::ComputeNormals(myVertexes, myIndexes, aNormals);
+      isDone = MeshPackWriter::Write(aStream, myVertexes.data(),
+                                     myVertexes.size() / 3, aNormals.data(),
+                                     myIndexes.data(), myIndexes.size() / 3);
+    } else if (myOptions.Format == "stl") {
+      std::vector<Triangle3D<float>> aFacets(myIndexes.size() / 3);
+      for (size_t aTriIter = 0; aTriIter < aFacets.size(); ++aTriIter) {
+        gp_XYZ aNodes[3];
+        for (int aCorner = 0; aCorner < 3; ++aCorner) {
+          const float *aNode =
+              &myVertexes[myIndexes[aTriIter * 3 + aCorner] * 3];
+          aNodes[aCorner].SetCoord(aNode[0], aNode[1], aNode[2]);
+          aFacets[aTriIter][aCorner] =
+              Point3D<float>(aNode[0], aNode[1], aNode[2]);
+        }
+        gp_XYZ aNormal = (aNodes[1] - aNodes[0]) ^ (aNodes[2] - aNodes[0]);
+        if (aNormal.Modulus() > 0.0) {
+          aNormal.Normalize();
+        }
+        aFacets[aTriIter].Normal =
+            Point3D<float>((float)aNormal.X(), (float)aNormal.Y(),
+                           (float)aNormal.Z());
+      }
+      StlFile aStlFile;
+      aStlFile.set_Facets(std::move(aFacets));
+      aStlFile.SaveAsBinary(aStream, "occt_demo_cli");
+      isDone = aStream.good();
+    } else if (myOptions.Format == "bbrep") {
+      TopoDS_Shape aShape = myShape;
+      if (aShape.IsNull()) {
+        TopoDS_Face aFace;
+        BRep_Builder().MakeFace(
+            aFace, aFactory->MakeTriangulation(myVertexes, myIndexes));
+        aShape = aFace;
+      }
+      BinTools::Write(aShape, aStream, Standard_True, Standard_True,
+                      BinTools_FormatVersion_CURRENT);
+      isDone = aStream.good();
+    }
+    myOutSize = isDone ? (size_t)aStream.tellp() : 0;
+    if (!isDone) {
+      myError = "unable to write " + anOutPath.string();
+    }
+    return isDone;
+  }
+
+private:
+  std::filesystem::path myPath;
+  std::filesystem::path myOutPath;
+  CliOptions myOptions;
+  TopoDS_Shape myShape;
+  std::vector<float> myVertexes;
+  std::vector<unsigned int> myIndexes;
+  Validation myValidation;
+  Timing myTiming;
+  std::string myError;
+  size_t myInSize;
+  size_t myOutSize;
+  size_t myNbNodes;
+  size_t myNbTriangles;
+};
+
+//! Return TRUE if file has supported extension.
+bool isSupported(const std::filesystem::path &thePath) {
+  const std::string aName = thePath.filename().string();
+  for (const char *anExt :
+       {".stl", ".omsh", ".brep", ".bbrep", ".step", ".stp"}) {
+    if (test_file_extension(aName, anExt)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//! Print usage.
+void printUsage(const char *theProgram) {
+  std::cout
+      << "Usage: " << theProgram << " [options] <file or directory>...\n"
+      << "  -o <dir>          write converted files into directory\n"
+      << "  -f <format>       output format: omsh (default), stl, bbrep\n"
+      << "  -j <threads>      number of worker threads (default: all cores)\n"
+      << "  -d <deflection>   linear deflection of tessellation\n"
+      << "                    (default: 0.4% of the size of each shape)\n"
+      << "  -a <angle>        angular deflection in degrees\n"
+      << "  --decimate <ratio> keep the fraction of mesh triangles\n"
+      << "  --validate        check indexes, degenerated triangles and edges\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  CliOptions anOptions;
+  std::vector<std::filesystem::path> aFiles;
+  std::vector<std::filesystem::path> anOutFiles; // relative output paths
+  for (int anArgIter = 1; anArgIter < argc; ++anArgIter) {
+    const std::string anArg = argv[anArgIter];
+    const bool hasValue = anArgIter + 1 < argc;
+    if (anArg == "-o" && hasValue) {
+      anOptions.OutDir = argv[++anArgIter];
+    } else if (anArg == "-f" && hasValue) {
+      anOptions.Format = argv[++anArgIter];
+    } else if (anArg == "-j" && hasValue) {
+      anOptions.NbThreads = std::atoi(argv[++anArgIter]);
+    } else if (anArg == "-d" && hasValue) {
+      anOptions.MeshParams.Deflection = std::atof(argv[++anArgIter]);
+    } else if (anArg == "-a" && hasValue) {
+      anOptions.MeshParams.Angle = std::atof(argv[++anArgIter]) * M_PI / 180.0;
+    } else if (anArg == "--decimate" && hasValue) {
+      anOptions.DecimateRatio = std::atof(argv[++anArgIter]);
+    } else if (anArg == "--validate") {
+      anOptions.ToValidate = true;
+    } else if (anArg == "-h" || anArg == "--help") {
+      printUsage(argv[0]);
+      return 0;
+    } else if (std::filesystem::is_directory(anArg)) {
+      for (const auto &anEntry :
+           std::filesystem::recursive_directory_iterator(anArg)) {
+        if (anEntry.is_regular_file() && isSupported(anEntry.path())) {
+          aFiles.push_back(anEntry.path());
+          anOutFiles.push_back(
+              std::filesystem::relative(anEntry.path(), anArg));
+        }
+      }
+    } else if (std::filesystem::is_regular_file(anArg)) {
+      aFiles.push_back(anArg);
+      anOutFiles.push_back(std::filesystem::path(anArg).filename());
+    } else {
+      std::cerr << "Error: unknown argument '" << anArg << "'\n";
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (aFiles.empty() || (anOptions.Format != "omsh" &&
+                         anOptions.Format != "stl" &&
+                         anOptions.Format != "bbrep")) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (!anOptions.OutDir.empty()) {
+    // e.g. x.stl and x.step, or files of the same name in several inputs
+    std::map<std::filesystem::path, std::filesystem::path> anOutputs;
+    for (size_t aFileIter = 0; aFileIter < aFiles.size(); ++aFileIter) {
+      anOutFiles[aFileIter].replace_extension("." + anOptions.Format);
+      const auto anOutput =
+          anOutputs.emplace(anOutFiles[aFileIter], aFiles[aFileIter]);
+      if (!anOutput.second) {
+        std::cerr << "Error: " << anOutput.first->second << " and "
+                  << aFiles[aFileIter] << " would be written to "
+                  << anOutFiles[aFileIter] << "\n";
+        return 1;
+      }
+    }
+    std::filesystem::create_directories(anOptions.OutDir);
+  }
+
+  // files are processed in parallel, so each of them is meshed in one thread
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  aFactory->SetGeometry(Handle(GeometryRegistry)());
+  Handle(LoadJobQueue) aQueue = new LoadJobQueue(anOptions.NbThreads);
+  anOptions.MeshParams.InParallel = aQueue->NbThreads() <= 1;
+
+  OSD_Timer aTimer;
+  aTimer.Start();
+  for (size_t aFileIter = 0; aFileIter < aFiles.size(); ++aFileIter) {
+    aQueue->Submit(
+        new ConvertJob(aFiles[aFileIter], anOutFiles[aFileIter], anOptions));
+  }
+
+  int aNbFailed = 0;
+  size_t aNbTriangles = 0;
+  while (aQueue->HasPending()) {
+    NCollection_Sequence<Handle(LoadJob)> aJobs;
+    aQueue->TakeCompleted(aJobs);
+    for (NCollection_Sequence<Handle(LoadJob)>::Iterator aJobIter(aJobs);
+         aJobIter.More(); aJobIter.Next()) {
+      Handle(ConvertJob) aJob = Handle(ConvertJob)::DownCast(aJobIter.Value());
+      aJob->Print(std::cout);
+      aNbFailed += aJob->GetState() != LoadJob::State_Done ? 1 : 0;
+      aNbTriangles += aJob->NbTriangles();
+    }
+    if (aJobs.IsEmpty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+
+  std::cout << aFiles.size() << " files, " << aNbFailed << " failed, "
+            << aNbTriangles << " triangles, " << aQueue->NbThreads()
+            << " threads, " << aTimer.ElapsedTime() * 1000.0 << " ms\n";
+  return aNbFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,318 @@
+#include "progressive_mesher.h"
+
+#include <BRepBndLib.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <Message_ProgressScope.hxx>
+#include <Poly_PolygonOnTriangulation.hxx>
+#include <TColStd_MapOfTransient.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+
+#include <algorithm>
+
+#include "lazy_part_mesher.h"
+#include "projected_size.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(FaceRefineJob, LoadJob)
+IMPLEMENT_STANDARD_RTTIEXT(ProgressiveMesher, Standard_Transient)
+
+namespace {
+//! Move triangulation of the meshed copy onto the original face, along with
+//! polygons of its edges; faces and edges are explored in the same order,
+//! as the copy preserves topology structure.
+static void applyFaceMesh(const TopoDS_Face &theFace,
+                          const TopoDS_Face &theCopy) {
+  TopLoc_Location aLoc;
+  const Handle(Poly_Triangulation) &aTris =
+      BRep_Tool::Triangulation(theCopy, aLoc);
+  if (aTris.IsNull()) {
+    return;
+  }
+
+  TopLoc_Location anOldLoc;
+  const Handle(Poly_Triangulation) anOldTris =
+      BRep_Tool::Triangulation(theFace, anOldLoc);
+  BRep_Builder aBuilder;
+  for (TopExp_Explorer anEdgeExp(theFace, TopAbs_EDGE),
+       aCopyExp(theCopy, TopAbs_EDGE);
+       anEdgeExp.More() && aCopyExp.More();
+       anEdgeExp.Next(), aCopyExp.Next()) {
+    const TopoDS_Edge &anEdge = TopoDS::Edge(anEdgeExp.Current());
+    const TopoDS_Edge &aCopyEdge = TopoDS::Edge(aCopyExp.Current());
+    if (!anOldTris.IsNull()) {
+      // edges shared with other faces keep polygons of their triangulation
+      aBuilder.UpdateEdge(anEdge, Handle(Poly_PolygonOnTriangulation)(),
+                          anOldTris, anOldLoc);
+    }
+    if (BRep_Tool::IsClosed(aCopyEdge, theCopy)) {
+      aBuilder.UpdateEdge(
+          anEdge,
+          BRep_Tool::PolygonOnTriangulation(
+              TopoDS::Edge(aCopyEdge.Oriented(TopAbs_FORWARD)), aTris, aLoc),
+          BRep_Tool::PolygonOnTriangulation(
+              TopoDS::Edge(aCopyEdge.Oriented(TopAbs_REVERSED)), aTris, aLoc),
+          aTris, aLoc);
+    } else {
+      aBuilder.UpdateEdge(
+          anEdge, BRep_Tool::PolygonOnTriangulation(aCopyEdge, aTris, aLoc),
+          aTris, aLoc);
+    }
+  }
+  aBuilder.UpdateFace(theFace, aTris);
+}
+} // namespace
+
+// ================================================================
+// Function : Add
+// Purpose  :
+// ================================================================
+void FaceRefineJob::Add(const TopoDS_Shape &theShape,
+                        const ModelMeshParams &theParams) {
+  Item anItem;
+  anItem.Shape = theShape;
+  anItem.Params = theParams;
+  myItems.push_back(anItem);
+}
+
+// ================================================================
+// Function : Perform
+// Purpose  :
+// ================================================================
+bool FaceRefineJob::Perform(const Message_ProgressRange &theProgress) {
+  Message_ProgressScope aPS(theProgress, "Refinement", (double)myItems.size());
+  for (Item &anItem : myItems) {
+    if (!aPS.More()) {
+      return false;
+    }
+    // topology is copied without triangulation, geometry is shared
+    BRepBuilderAPI_Copy aCopy(anItem.Shape, Standard_False, Standard_False);
+    anItem.Copy = aCopy.Shape();
+    ModelFactory::GetInstance()->Triangulate(anItem.Copy, anItem.Params,
+                                             aPS.Next());
+  }
+  return aPS.More();
+}
+
+// ================================================================
+// Function : Apply
+// Purpose  :
+// ================================================================
+void FaceRefineJob::Apply() {
+  for (Item &anItem : myItems) {
+    if (anItem.Copy.IsNull()) {
+      continue;
+    }
+    for (TopExp_Explorer aFaceExp(anItem.Shape, TopAbs_FACE),
+         aCopyExp(anItem.Copy, TopAbs_FACE);
+         aFaceExp.More() && aCopyExp.More();
+         aFaceExp.Next(), aCopyExp.Next()) {
+      applyFaceMesh(TopoDS::Face(aFaceExp.Current()),
+                    TopoDS::Face(aCopyExp.Current()));
+    }
+    anItem.Copy.Nullify();
+  }
+}
+
+// ================================================================
+// Function : ProgressiveMesher
+// Purpose  :
+// ================================================================
+ProgressiveMesher::ProgressiveMesher(int theFacesPerBatch)
+    : myFacesPerBatch(std::max(theFacesPerBatch, 1)) {}
+
+// ================================================================
+// Function : Add
+// Purpose  :
+// ================================================================
+void ProgressiveMesher::Add(const Handle(AIS_InteractiveObject) & thePrs) {
+  NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+  GeometryRegistry::Placements(thePrs, aPlacements);
+  for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+           aPlacementIter(aPlacements);
+       aPlacementIter.More(); aPlacementIter.Next()) {
+    Handle(AIS_Shape) aShapePrs =
+        Handle(AIS_Shape)::DownCast(aPlacementIter.Value().Master);
+    if (aShapePrs.IsNull()) {
+      continue;
+    }
+    // placeholders are meshed with fine parameters once visible
+    Handle(LazyPartPrs) aLazyPart = Handle(LazyPartPrs)::DownCast(aShapePrs);
+    if (!aLazyPart.IsNull() && !aLazyPart->IsMeshed()) {
+      continue;
+    }
+
+    // shared shape is refined once, priority is given by its first placement
+    const auto aTargetIndex = myTargetIndices.find(aShapePrs.get());
+    if (aTargetIndex != myTargetIndices.end()) {
+      std::vector<Handle(AIS_InteractiveObject)> &anObjects =
+          myTargets[aTargetIndex->second].Objects;
+      if (std::find(anObjects.begin(), anObjects.end(), thePrs) ==
+          anObjects.end()) {
+        anObjects.push_back(thePrs);
+      }
+      continue;
+    }
+
+    const int aTarget = (int)myTargets.size();
+    const gp_Trsf &aTrsf = aPlacementIter.Value().Trsf;
+    bool hasFaces = false;
+    for (TopExp_Explorer aFaceExp(aShapePrs->Shape(), TopAbs_FACE);
+         aFaceExp.More(); aFaceExp.Next()) {
+      const TopoDS_Face &aFace = TopoDS::Face(aFaceExp.Current());
+      if (BRep_Tool::Surface(aFace).IsNull()) {
+        continue;
+      }
+
+      FaceItem anItem;
+      anItem.Face = aFace;
+      BRepBndLib::Add(aFace, anItem.Box, Standard_True);
+      anItem.Box = anItem.Box.Transformed(aTrsf);
+      anItem.Target = aTarget;
+      anItem.Size = 0.0;
+      myFaces.push_back(anItem);
+      hasFaces = true;
+    }
+    if (hasFaces) {
+      Target aNewTarget;
+      aNewTarget.Shape = aShapePrs;
+      BRepBndLib::Add(aShapePrs->Shape(), aNewTarget.Box, Standard_True);
+      aNewTarget.Objects.push_back(thePrs);
+      myTargets.push_back(aNewTarget);
+      myTargetIndices[aShapePrs.get()] = aTarget;
+    }
+  }
+}
+
+// ================================================================
+// Function : Clear
+// Purpose  :
+// ================================================================
+void ProgressiveMesher::Clear() {
+  myFaces.clear();
+  if (myJob.IsNull()) {
+    clearTargets();
+  }
+}
+
+// ================================================================
+// Function : NextBatch
+// Purpose  :
+// ================================================================
+Handle(LoadJob)
+ProgressiveMesher::NextBatch(const Handle(AIS_InteractiveContext) & theCtx,
+                             const Handle(V3d_View) & theView,
+                             const ModelMeshParams &theParams) {
+  if (!myJob.IsNull() || myFaces.empty()) {
+    return Handle(LoadJob)();
+  }
+
+  // drop faces of removed objects
+  std::vector<bool> anIsAlive(myTargets.size(), false);
+  for (size_t aTargetIter = 0; aTargetIter < myTargets.size(); ++aTargetIter) {
+    for (const Handle(AIS_InteractiveObject) &anObj :
+         myTargets[aTargetIter].Objects) {
+      if (theCtx->DisplayStatus(anObj) != AIS_DS_None) {
+        anIsAlive[aTargetIter] = true;
+        break;
+      }
+    }
+  }
+  myFaces.erase(std::remove_if(myFaces.begin(), myFaces.end(),
+                               [&](const FaceItem &theItem) {
+                                 return !anIsAlive[theItem.Target];
+                               }),
+                myFaces.end());
+  if (myFaces.empty()) {
+    clearTargets();
+    return Handle(LoadJob)();
+  }
+
+  Graphic3d_Vec2i aWinSize;
+  theView->Window()->Size(aWinSize.x(), aWinSize.y());
+  const Handle(Graphic3d_Camera) &aCamera = theView->Camera();
+  for (FaceItem &anItem : myFaces) {
+    anItem.Size = ProjectedBoxArea(anItem.Box, aCamera, aWinSize);
+  }
+
+  // priorities are re-evaluated for each batch, so batch grows with the
+  // number of pending faces to keep the total sorting cost bounded
+  const size_t aBatchSize =
+      std::min(myFaces.size(),
+               std::max((size_t)myFacesPerBatch, myFaces.size() / 8));
+  std::nth_element(myFaces.begin(), myFaces.begin() + (aBatchSize - 1),
+                   myFaces.end(),
+                   [](const FaceItem &theLeft, const FaceItem &theRight) {
+                     return theLeft.Size > theRight.Size;
+                   });
+
+  // faces are grouped by shapes, so that shared edges are meshed once
+  std::vector<TopoDS_Compound> aCompounds(myTargets.size());
+  BRep_Builder aBuilder;
+  for (size_t aFaceIter = 0; aFaceIter < aBatchSize; ++aFaceIter) {
+    const FaceItem &anItem = myFaces[aFaceIter];
+    TopoDS_Compound &aCompound = aCompounds[anItem.Target];
+    if (aCompound.IsNull()) {
+      aBuilder.MakeCompound(aCompound);
+      myJobTargets.push_back(anItem.Target);
+    }
+    aBuilder.Add(aCompound, anItem.Face);
+  }
+  myFaces.erase(myFaces.begin(), myFaces.begin() + aBatchSize);
+
+  myJob = new FaceRefineJob();
+  for (int aTarget : myJobTargets) {
+    myJob->Add(aCompounds[aTarget],
+               theParams.ForBox(myTargets[aTarget].Box));
+  }
+  return myJob;
+}
+
+// ================================================================
+// Function : Commit
+// Purpose  :
+// ================================================================
+bool ProgressiveMesher::Commit(const Handle(LoadJob) & theJob,
+                               const Handle(AIS_InteractiveContext) & theCtx) {
+  if (myJob.IsNull() || theJob != myJob) {
+    return false;
+  }
+
+  Handle(FaceRefineJob) aJob = myJob;
+  myJob.Nullify();
+  if (aJob->GetState() == LoadJob::State_Done) {
+    aJob->Apply();
+    TColStd_MapOfTransient aRecomputed;
+    for (int aTarget : myJobTargets) {
+      const Target &aPrsTarget = myTargets[aTarget];
+      if (std::find(aPrsTarget.Objects.begin(), aPrsTarget.Objects.end(),
+                    aPrsTarget.Shape) == aPrsTarget.Objects.end()) {
+        // shared master is not displayed itself, only connected to objects
+        theCtx->Redisplay(aPrsTarget.Shape, Standard_False);
+      }
+      for (const Handle(AIS_InteractiveObject) &anObj : aPrsTarget.Objects) {
+        if (theCtx->DisplayStatus(anObj) != AIS_DS_None &&
+            aRecomputed.Add(anObj)) {
+          theCtx->Redisplay(anObj, Standard_False);
+          theCtx->RecomputeSelectionOnly(anObj);
+        }
+      }
+    }
+  }
+  myJobTargets.clear();
+  if (myFaces.empty()) {
+    clearTargets();
+  }
+  return true;
+}
+
+// ================================================================
+// Function : clearTargets
+// Purpose  :
+// ================================================================
+void ProgressiveMesher::clearTargets() {
+  myTargets.clear();
+  myTargetIndices.clear();
+}
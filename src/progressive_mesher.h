@@ -0,0 +1,128 @@
+#pragma once
+
+#include <AIS_InteractiveContext.hxx>
+#include <AIS_Shape.hxx>
+#include <Bnd_Box.hxx>
+#include <TopoDS_Face.hxx>
+#include <V3d_View.hxx>
+
+#include <unordered_map>
+#include <vector>
+
+#include "load_job_queue.h"
+#include "model_factory.h"
+
+class FaceRefineJob;
+DEFINE_STANDARD_HANDLE(FaceRefineJob, LoadJob)
+
+//! Job re-meshing a batch of shapes (faces or whole parts).
+//! Copies of the shapes' topology are meshed in the working thread, so that
+//! the main thread keeps reading the original faces and their triangulation
+//! (drawing, export, memory reports) meanwhile. The new triangulation is
+//! moved onto the original faces and edges by Apply() on the main thread.
+class FaceRefineJob : public LoadJob {
+  DEFINE_STANDARD_RTTIEXT(FaceRefineJob, LoadJob)
+public:
+  FaceRefineJob() : LoadJob("refinement") {}
+
+  //! Add shape to be meshed; should be called before the job is submitted.
+  //! @param theShape  [in] face, compound of faces or part
+  //! @param theParams [in] tessellation parameters
+  void Add(const TopoDS_Shape &theShape, const ModelMeshParams &theParams);
+
+  //! Return TRUE if no shapes have been added.
+  bool IsEmpty() const { return myItems.empty(); }
+
+  //! Replace triangulation of the original faces by the computed one;
+  //! should be called from the main thread once the job is done.
+  void Apply();
+
+protected:
+  virtual bool Perform(const Message_ProgressRange &theProgress) override;
+
+private:
+  //! Shape to be meshed.
+  struct Item {
+    TopoDS_Shape Shape; //!< original shape
+    TopoDS_Shape Copy;  //!< meshed copy sharing geometry with the original
+    ModelMeshParams Params;
+  };
+
+private:
+  std::vector<Item> myItems;
+};
+
+class ProgressiveMesher;
+DEFINE_STANDARD_HANDLE(ProgressiveMesher, Standard_Transient)
+
+//! Second pass of coarse-to-fine tessellation.
+//! Shapes are displayed with coarse triangulation first (see
+//! ModelMeshParams::FirstPass()); then their faces are re-meshed in batches,
+//! largest on the screen first, and only presentations of the shapes touched
+//! by a batch are recomputed. Batches are executed one at a time, and the
+//! new triangulation is applied by the main thread (see FaceRefineJob).
+//! Shapes shared by several scene objects (see GeometryRegistry) are refined
+//! once, and all objects displaying them are recomputed.
+class ProgressiveMesher : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(ProgressiveMesher, Standard_Transient)
+public:
+  //! @param theFacesPerBatch [in] minimal number of faces per batch
+  ProgressiveMesher(int theFacesPerBatch = 64);
+
+  //! Add faces of shapes displayed by the object for refinement.
+  //! Faces without surface geometry (e.g. restored from mesh cache) are
+  //! skipped.
+  void Add(const Handle(AIS_InteractiveObject) & thePrs);
+
+  //! Drop all pending faces.
+  void Clear();
+
+  //! Return TRUE if there are faces not yet refined.
+  bool HasPending() const { return !myFaces.empty(); }
+
+  //! Return TRUE if refinement batch is being executed.
+  bool IsRunning() const { return !myJob.IsNull(); }
+
+  //! Return number of faces not yet refined.
+  int NbPending() const { return (int)myFaces.size(); }
+
+  //! Create job refining the faces with the largest projected size.
+  //! Faces of removed presentations are dropped.
+  //! @return NULL if there is nothing to refine or batch is already running
+  Handle(LoadJob) NextBatch(const Handle(AIS_InteractiveContext) & theCtx,
+                            const Handle(V3d_View) & theView,
+                            const ModelMeshParams &theParams);
+
+  //! Recompute presentations refined by the job.
+  //! @return FALSE if job has not been created by this mesher
+  bool Commit(const Handle(LoadJob) & theJob,
+              const Handle(AIS_InteractiveContext) & theCtx);
+
+private:
+  //! Drop refined shapes.
+  void clearTargets();
+
+private:
+  //! Shape presentation being refined.
+  struct Target {
+    Handle(AIS_Shape) Shape;
+    std::vector<Handle(AIS_InteractiveObject)> Objects; //!< displaying it
+    Bnd_Box Box; //!< shape box, defines deflection unless it is explicit
+  };
+
+  //! Face pending refinement.
+  struct FaceItem {
+    TopoDS_Face Face;
+    Bnd_Box Box; //!< box in world coordinates
+    int Target;  //!< index within myTargets
+    double Size; //!< projected area in pixels, updated for each batch
+  };
+
+private:
+  std::vector<Target> myTargets;
+  std::unordered_map<const AIS_Shape *, int> myTargetIndices;
+  std::vector<FaceItem> myFaces;
+  std::vector<int> myJobTargets; //!< targets touched by the running batch
+  Handle(FaceRefineJob) myJob;
+  int myFacesPerBatch;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Bnd_Box.hxx>
+#include <Graphic3d_Camera.hxx>
+#include <Graphic3d_Vec2.hxx>
+
+#include <algorithm>
+
+//! Return area in pixels of the box projected onto the screen,
+//! clipped by the view frustum; 0 if the box is not visible.
+inline double ProjectedBoxArea(const Bnd_Box &theBox,
+                               const Handle(Graphic3d_Camera) & theCamera,
+                               const Graphic3d_Vec2i &theWinSize) {
+  if (theBox.IsVoid()) {
+    return 0.0;
+  }
+
+  const gp_Pnt aCorners[2] = {theBox.CornerMin(), theBox.CornerMax()};
+  Graphic3d_Vec2d aMin(RealLast(), RealLast()), aMax(RealFirst(), RealFirst());
+  bool hasPoint = false;
+  for (int aCornerIter = 0; aCornerIter < 8; ++aCornerIter) {
+    const gp_Pnt aPnt(aCorners[aCornerIter & 1].X(),
+                      aCorners[(aCornerIter >> 1) & 1].Y(),
+                      aCorners[(aCornerIter >> 2) & 1].Z());
+    const gp_Pnt aNdc = theCamera->Project(aPnt);
+    if (aNdc.Z() < -1.0 || aNdc.Z() > 1.0) {
+      // behind the camera or beyond far plane
+      continue;
+    }
+    hasPoint = true;
+    aMin.x() = std::min(aMin.x(), aNdc.X());
+    aMin.y() = std::min(aMin.y(), aNdc.Y());
+    aMax.x() = std::max(aMax.x(), aNdc.X());
+    aMax.y() = std::max(aMax.y(), aNdc.Y());
+  }
+  if (!hasPoint) {
+    return 0.0;
+  }
+
+  const double aSizeX =
+      std::max(0.0, std::min(aMax.x(), 1.0) - std::max(aMin.x(), -1.0));
+  const double aSizeY =
+      std::max(0.0, std::min(aMax.y(), 1.0) - std::max(aMin.y(), -1.0));
+  return aSizeX * 0.5 * theWinSize.x() * aSizeY * 0.5 * theWinSize.y();
+}
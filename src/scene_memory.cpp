@@ -0,0 +1,541 @@
+#include "scene_memory.h"
+
+#include <AIS_ConnectedInteractive.hxx>
+#include <AIS_Shape.hxx>
+#include <BRep_Tool.hxx>
+#include <MeshVS_Mesh.hxx>
+#include <OpenGl_Group.hxx>
+#include <OpenGl_PrimitiveArray.hxx>
+#include <OpenGl_Structure.hxx>
+#include <OpenGl_VertexBuffer.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TColStd_MapOfTransient.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "XSDRAWSTLVRML_DataSource.h"
+#include "geometry_registry.h"
+#include "help_algorithms.h"
+#include "lazy_part_mesher.h"
+#include "model_factory.h"
+#include "projected_size.h"
+#include "trace_events.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(SceneMemoryManager, Standard_Transient)
+
+namespace {
+
+//! Meshes smaller than this are not worth reducing.
+const Standard_Integer THE_MIN_REDUCED_TRIANGLES = 2000;
+
+//! Reduced mesh keeps this fraction of triangles.
+const double THE_REDUCTION_RATIO = 0.25;
+
+//! Return estimated size of triangulation arrays.
+Standard_Size
+triangulationSize(const Handle(Poly_Triangulation) & theTriangulation) {
+  if (theTriangulation.IsNull()) {
+    return 0;
+  }
+
+  const Standard_Size aNbNodes = (Standard_Size)theTriangulation->NbNodes();
+  const bool isDouble = theTriangulation->IsDoublePrecision();
+  Standard_Size aSize = sizeof(Poly_Triangulation) +
+                        aNbNodes * (isDouble ? 3 * sizeof(double)
+                                             : 3 * sizeof(float)) +
+                        (Standard_Size)theTriangulation->NbTriangles() *
+                            sizeof(Poly_Triangle);
+  if (theTriangulation->HasNormals()) {
+    aSize += aNbNodes * 3 * sizeof(float);
+  }
+  if (theTriangulation->HasUVNodes()) {
+    aSize += aNbNodes * (isDouble ? 2 * sizeof(double) : 2 * sizeof(float));
+  }
+  return aSize;
+}
+
+//! Return level name for the report.
+const char *levelName(SceneMemoryManager::Level theLevel) {
+  switch (theLevel) {
+  case SceneMemoryManager::Level_Full:
+    return "full";
+  case SceneMemoryManager::Level_Reduced:
+    return "reduced";
+  case SceneMemoryManager::Level_Unloaded:
+    return "unloaded";
+  }
+  return "";
+}
+
+//! Add memory used by geometry and presentations of the master object.
+void addUsage(const Handle(AIS_InteractiveObject) & theObj,
+              SceneMemoryManager::Usage &theUsage) {
+  if (Handle(MeshVS_Mesh) aMesh = Handle(MeshVS_Mesh)::DownCast(theObj)) {
+    Handle(XSDRAWSTLVRML_DataSource) aDataSource =
+        Handle(XSDRAWSTLVRML_DataSource)::DownCast(aMesh->GetDataSource());
+    if (!aDataSource.IsNull()) {
+      theUsage.DataSource += aDataSource->EstimatedDataSize();
+      theUsage.Triangulation += triangulationSize(aDataSource->Triangulation());
+    }
+  } else if (Handle(AIS_Shape) aShapePrs = Handle(AIS_Shape)::DownCast(theObj)) {
+    // instanced faces share triangulation
+    TColStd_MapOfTransient aTriangulations;
+    for (TopExp_Explorer aFaceExp(aShapePrs->Shape(), TopAbs_FACE);
+         aFaceExp.More(); aFaceExp.Next()) {
+      TopLoc_Location aLoc;
+      const Handle(Poly_Triangulation) &aTriangulation =
+          BRep_Tool::Triangulation(TopoDS::Face(aFaceExp.Current()), aLoc);
+      if (!aTriangulation.IsNull() && aTriangulations.Add(aTriangulation)) {
+        theUsage.Triangulation += triangulationSize(aTriangulation);
+      }
+    }
+  }
+
+  for (PrsMgr_Presentations::Iterator aPrsIter(theObj->Presentations());
+       aPrsIter.More(); aPrsIter.Next()) {
+    Handle(OpenGl_Structure) aStruct =
+        Handle(OpenGl_Structure)::DownCast(aPrsIter.Value()->CStructure());
+    if (aStruct.IsNull()) {
+      continue;
+    }
+
+    for (Graphic3d_SequenceOfGroup::Iterator aGroupIter(aStruct->Groups());
+         aGroupIter.More(); aGroupIter.Next()) {
+      Handle(OpenGl_Group) aGroup =
+          Handle(OpenGl_Group)::DownCast(aGroupIter.Value());
+      if (aGroup.IsNull()) {
+        continue;
+      }
+
+      for (const OpenGl_ElementNode *aNode = aGroup->FirstNode();
+           aNode != nullptr; aNode = aNode->next) {
+        const OpenGl_PrimitiveArray *anArray =
+            dynamic_cast<const OpenGl_PrimitiveArray *>(aNode->elem);
+        if (anArray == nullptr) {
+          theUsage.Presentation += aNode->elem->EstimatedDataSize();
+          continue;
+        }
+
+        // client-side copies are kept until buffers are uploaded
+        if (!anArray->Attributes().IsNull()) {
+          theUsage.Presentation += anArray->Attributes()->Size();
+        }
+        if (!anArray->Indices().IsNull()) {
+          theUsage.Presentation += anArray->Indices()->Size();
+        }
+        if (!anArray->AttributesVbo().IsNull()) {
+          theUsage.Gpu += anArray->AttributesVbo()->EstimatedDataSize();
+        }
+        if (!anArray->IndexVbo().IsNull()) {
+          theUsage.Gpu += anArray->IndexVbo()->EstimatedDataSize();
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+// ================================================================
+// Function : SceneMemoryManager
+// Purpose  :
+// ================================================================
+SceneMemoryManager::SceneMemoryManager() : myBudget(0), myLastTime(0.0) {}
+
+// ================================================================
+// Function : Measure
+// Purpose  :
+// ================================================================
+SceneMemoryManager::Usage
+SceneMemoryManager::Measure(const Handle(AIS_InteractiveObject) & theObj,
+                            TColStd_MapOfTransient *theCounted) {
+  Usage aUsage;
+  NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+  GeometryRegistry::Placements(theObj, aPlacements);
+  TColStd_MapOfTransient aCounted;
+  TColStd_MapOfTransient &aMasters =
+      theCounted != nullptr ? *theCounted : aCounted;
+  for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+           aPlacementIter(aPlacements);
+       aPlacementIter.More(); aPlacementIter.Next()) {
+    if (aMasters.Add(aPlacementIter.Value().Master)) {
+      addUsage(aPlacementIter.Value().Master, aUsage);
+    }
+  }
+  return aUsage;
+}
+
+// ================================================================
+// Function : total
+// Purpose  :
+// ================================================================
+Standard_Size SceneMemoryManager::total(const SceneObjectMap &theObjects) {
+  Standard_Size aTotal = 0;
+  TColStd_MapOfTransient aCounted;
+  for (SceneObjectMap::Iterator anObjIter(theObjects); anObjIter.More();
+       anObjIter.Next()) {
+    aTotal += Measure(anObjIter.Value(), &aCounted).Total();
+  }
+  return aTotal;
+}
+
+// ================================================================
+// Function : state
+// Purpose  :
+// ================================================================
+SceneMemoryManager::ObjectState &
+SceneMemoryManager::state(const TCollection_AsciiString &theName,
+                          const Handle(AIS_InteractiveObject) & theObj) {
+  ObjectState *aState = myStates.ChangeSeek(theName);
+  if (aState == nullptr) {
+    aState = myStates.Bound(theName, ObjectState());
+  }
+  if (aState->Object != theObj) {
+    // new objects are considered as just viewed
+    aState->Object = theObj;
+    aState->LastViewed = myLastTime;
+    aState->DowngradeLevel = Level_Full;
+  }
+  return *aState;
+}
+
+// ================================================================
+// Function : UpdateVisibility
+// Purpose  :
+// ================================================================
+int SceneMemoryManager::UpdateVisibility(
+    const SceneObjectMap &theObjects,
+    const Handle(AIS_InteractiveContext) & theCtx,
+    const Handle(V3d_View) & theView, double theTime) {
+  myLastTime = theTime;
+
+  // forget removed objects
+  NCollection_DataMap<TCollection_AsciiString, ObjectState> aStates;
+  for (SceneObjectMap::Iterator anObjIter(theObjects); anObjIter.More();
+       anObjIter.Next()) {
+    const ObjectState *anOld = myStates.Seek(anObjIter.Key());
+    if (anOld != nullptr) {
+      aStates.Bind(anObjIter.Key(), *anOld);
+    }
+  }
+  myStates.Exchange(aStates);
+
+  Graphic3d_Vec2i aWinSize;
+  theView->Window()->Size(aWinSize.x(), aWinSize.y());
+  int aNbReloaded = 0;
+  for (SceneObjectMap::Iterator anObjIter(theObjects); anObjIter.More();
+       anObjIter.Next()) {
+    ObjectState &aState = state(anObjIter.Key(), anObjIter.Value());
+    if (aState.DowngradeLevel == Level_Unloaded &&
+        theCtx->DisplayStatus(anObjIter.Value()) == AIS_DS_None &&
+        ProjectedBoxArea(aState.Box, theView->Camera(), aWinSize) > 0.0) {
+      // unloaded object got back into the view
+      theCtx->Display(anObjIter.Value(), anObjIter.Value()->DisplayMode(), 0,
+                      Standard_False);
+      ++aNbReloaded;
+    }
+    if (!theCtx->IsDisplayed(anObjIter.Value())) {
+      continue;
+    }
+    if (aState.DowngradeLevel == Level_Unloaded) {
+      // displayed again by the application or above
+      aState.DowngradeLevel = aState.LoadedLevel;
+      aState.Box.SetVoid();
+    }
+
+    Bnd_Box aBox;
+    anObjIter.Value()->BoundingBox(aBox);
+    if (ProjectedBoxArea(aBox, theView->Camera(), aWinSize) > 0.0) {
+      aState.LastViewed = theTime;
+    }
+  }
+  return aNbReloaded;
+}
+
+// ================================================================
+// Function : reduce
+// Purpose  :
+// ================================================================
+Handle(AIS_InteractiveObject)
+SceneMemoryManager::reduce(const Handle(AIS_InteractiveObject) & theObj,
+                           const Handle(AIS_InteractiveContext) & theCtx) {
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  if (Handle(AIS_ConnectedInteractive) aConnected =
+          Handle(AIS_ConnectedInteractive)::DownCast(theObj)) {
+    // other instances of the shared mesh keep full level of detail
+    const Handle(AIS_InteractiveObject) &aMaster = aConnected->ConnectedTo();
+    Handle(AIS_InteractiveObject) aReduced = reduce(aMaster, theCtx);
+    if (aReduced.IsNull()) {
+      return Handle(AIS_InteractiveObject)();
+    } else if (aReduced == aMaster) {
+      return theObj;
+    }
+    return GeometryRegistry::Instantiate(aReduced,
+                                         aConnected->LocalTransformation());
+  }
+
+  if (Handle(MeshVS_Mesh) aMesh = Handle(MeshVS_Mesh)::DownCast(theObj)) {
+    Handle(XSDRAWSTLVRML_DataSource) aDataSource =
+        Handle(XSDRAWSTLVRML_DataSource)::DownCast(aMesh->GetDataSource());
+    if (aDataSource.IsNull() || aDataSource->Triangulation().IsNull() ||
+        aDataSource->Triangulation()->NbTriangles() <
+            THE_MIN_REDUCED_TRIANGLES) {
+      return Handle(AIS_InteractiveObject)();
+    }
+
+    const Handle(Poly_Triangulation) &aTriangulation =
+        aDataSource->Triangulation();
+    std::vector<float> aVertexes(aTriangulation->NbNodes() * 3);
+    for (Standard_Integer aNodeIter = 1; aNodeIter <= aTriangulation->NbNodes();
+         ++aNodeIter) {
+      const gp_Pnt aPnt = aTriangulation->Node(aNodeIter);
+      aVertexes[(aNodeIter - 1) * 3] = (float)aPnt.X();
+      aVertexes[(aNodeIter - 1) * 3 + 1] = (float)aPnt.Y();
+      aVertexes[(aNodeIter - 1) * 3 + 2] = (float)aPnt.Z();
+    }
+    std::vector<unsigned int> anIndexes(aTriangulation->NbTriangles() * 3);
+    for (Standard_Integer aTriIter = 1;
+         aTriIter <= aTriangulation->NbTriangles(); ++aTriIter) {
+      Standard_Integer aN1, aN2, aN3;
+      aTriangulation->Triangle(aTriIter).Get(aN1, aN2, aN3);
+      anIndexes[(aTriIter - 1) * 3] = aN1 - 1;
+      anIndexes[(aTriIter - 1) * 3 + 1] = aN2 - 1;
+      anIndexes[(aTriIter - 1) * 3 + 2] = aN3 - 1;
+    }
+
+    std::vector<float> aReducedVertexes;
+    std::vector<unsigned int> aReducedIndexes;
+    if (!decimate_mesh(aVertexes, anIndexes,
+                       (size_t)(aTriangulation->NbTriangles() *
+                                THE_REDUCTION_RATIO),
+                       aReducedVertexes, aReducedIndexes)) {
+      return Handle(AIS_InteractiveObject)();
+    }
+    aVertexes.clear();
+    anIndexes.clear();
+
+    Handle(AIS_InteractiveObject) aReduced = aFactory->CreateStlMesh(
+        aFactory->MakeTriangulation(aReducedVertexes, aReducedIndexes));
+    aReduced->SetDisplayMode(theObj->DisplayMode());
+    return aReduced;
+  }
+
+  if (Handle(AIS_Shape) aShapePrs = Handle(AIS_Shape)::DownCast(theObj)) {
+    // placeholders have no triangulation yet
+    Handle(LazyPartPrs) aLazyPart = Handle(LazyPartPrs)::DownCast(aShapePrs);
+    if (!aLazyPart.IsNull() && !aLazyPart->IsMeshed()) {
+      return Handle(AIS_InteractiveObject)();
+    }
+
+    // shapes restored from the tessellation cache have no geometry to re-mesh
+    for (TopExp_Explorer aFaceExp(aShapePrs->Shape(), TopAbs_FACE);
+         aFaceExp.More(); aFaceExp.Next()) {
+      if (BRep_Tool::Surface(TopoDS::Face(aFaceExp.Current())).IsNull()) {
+        return Handle(AIS_InteractiveObject)();
+      }
+    }
+
+    // shared master is re-meshed once for all its instances
+    if (std::find(myJobObjects.begin(), myJobObjects.end(), theObj) !=
+        myJobObjects.end()) {
+      return aShapePrs;
+    }
+
+    // coarse triangulation replaces the current one once the job is done,
+    // the shape may be shared with other objects and is not modified meanwhile
+    ModelMeshParams aParams = aFactory->MeshParams();
+    aParams.IsProgressive = true;
+    myJob->Add(aShapePrs->Shape(), aParams.FirstPass());
+    myJobObjects.push_back(aShapePrs);
+    return aShapePrs;
+  }
+
+  // parts of assembly are re-meshed in place
+  NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+  GeometryRegistry::Placements(theObj, aPlacements);
+  TColStd_MapOfTransient aParts;
+  bool isReduced = false;
+  for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+           aPlacementIter(aPlacements);
+       aPlacementIter.More(); aPlacementIter.Next()) {
+    const Handle(AIS_InteractiveObject) &aPart = aPlacementIter.Value().Master;
+    if (aPart != theObj && aPart->IsKind(STANDARD_TYPE(AIS_Shape)) &&
+        aParts.Add(aPart) && reduce(aPart, theCtx) == aPart) {
+      isReduced = true;
+    }
+  }
+  return isReduced ? theObj : Handle(AIS_InteractiveObject)();
+}
+
+// ================================================================
+// Function : Enforce
+// Purpose  :
+// ================================================================
+int SceneMemoryManager::Enforce(SceneObjectMap &theObjects,
+                                const Handle(AIS_InteractiveContext) & theCtx,
+                                Handle(LoadJob) & theJob) {
+  theJob.Nullify();
+  if (myBudget == 0 || IsRunning()) {
+    return 0;
+  }
+
+  Standard_Size aTotal = total(theObjects);
+  if (aTotal <= myBudget) {
+    return 0;
+  }
+
+  TRACE_SCOPE("memory budget");
+  std::vector<int> anOrder;
+  for (int anObjIter = 1; anObjIter <= theObjects.Extent(); ++anObjIter) {
+    state(theObjects.FindKey(anObjIter), theObjects.FindFromIndex(anObjIter));
+    anOrder.push_back(anObjIter);
+  }
+  std::stable_sort(anOrder.begin(), anOrder.end(), [&](int theLeft, int theRight) {
+    return myStates.Find(theObjects.FindKey(theLeft)).LastViewed <
+           myStates.Find(theObjects.FindKey(theRight)).LastViewed;
+  });
+
+  // reduce level of detail first, unload only if it is not enough
+  myJob = new FaceRefineJob();
+  Standard_Size aPending = 0; // usage expected to be released by the job
+  int aNbDowngraded = 0;
+  for (int aPass = 0; aPass < 2 && aTotal > myBudget && myJob->IsEmpty();
+       ++aPass) {
+    for (int anIndex : anOrder) {
+      if (aTotal <= myBudget) {
+        break;
+      }
+
+      ObjectState &aState = myStates.ChangeFind(theObjects.FindKey(anIndex));
+      const Handle(AIS_InteractiveObject) anObj = aState.Object;
+      if (aPass == 0 && aState.DowngradeLevel == Level_Full) {
+        Handle(AIS_InteractiveObject) aReduced = reduce(anObj, theCtx);
+        if (aReduced.IsNull()) {
+          continue;
+        }
+
+        if (aReduced == anObj) {
+          // recomputed once re-meshing is done
+          if (std::find(myJobObjects.begin(), myJobObjects.end(), anObj) ==
+              myJobObjects.end()) {
+            myJobObjects.push_back(anObj);
+          }
+          aPending += (Standard_Size)((double)Measure(anObj).Total() *
+                                      (1.0 - THE_REDUCTION_RATIO));
+        } else {
+          const bool wasDisplayed = theCtx->IsDisplayed(anObj);
+          theCtx->Remove(anObj, Standard_False);
+          theObjects.ChangeFromIndex(anIndex) = aReduced;
+          if (wasDisplayed) {
+            theCtx->Display(aReduced, aReduced->DisplayMode(), 0,
+                            Standard_False);
+          }
+        }
+        aState.Object = aReduced;
+        aState.DowngradeLevel = Level_Reduced;
+      } else if (aPass == 1 && aState.DowngradeLevel != Level_Unloaded &&
+                 aState.LastViewed < myLastTime &&
+                 theCtx->IsDisplayed(anObj)) {
+        // objects visible right now are never unloaded; the box is kept to
+        // display the object again (see UpdateVisibility()), while objects
+        // hidden by the application are left to it
+        aState.Box.SetVoid();
+        anObj->BoundingBox(aState.Box);
+        theCtx->Remove(anObj, Standard_False);
+        aState.LoadedLevel = aState.DowngradeLevel;
+        aState.DowngradeLevel = Level_Unloaded;
+      } else {
+        continue;
+      }
+
+      // shared geometry is released only when all its objects are downgraded
+      aTotal = total(theObjects);
+      aTotal -= std::min(aTotal, aPending);
+      ++aNbDowngraded;
+    }
+  }
+
+  if (myJob->IsEmpty()) {
+    myJob.Nullify();
+  } else {
+    theJob = myJob;
+  }
+  return aNbDowngraded;
+}
+
+// ================================================================
+// Function : Commit
+// Purpose  :
+// ================================================================
+bool SceneMemoryManager::Commit(const Handle(LoadJob) & theJob,
+                                const Handle(AIS_InteractiveContext) & theCtx) {
+  if (myJob.IsNull() || theJob != myJob) {
+    return false;
+  }
+
+  Handle(FaceRefineJob) aJob = myJob;
+  myJob.Nullify();
+  if (aJob->GetState() == LoadJob::State_Done) {
+    aJob->Apply();
+    for (const Handle(AIS_InteractiveObject) &anObj : myJobObjects) {
+      theCtx->Redisplay(anObj, Standard_False);
+    }
+  } else {
+    // shapes have been left intact, so that they could be reduced later
+    for (NCollection_DataMap<TCollection_AsciiString, ObjectState>::Iterator
+             aStateIter(myStates);
+         aStateIter.More(); aStateIter.Next()) {
+      ObjectState &aState = aStateIter.ChangeValue();
+      if (aState.DowngradeLevel == Level_Reduced &&
+          std::find(myJobObjects.begin(), myJobObjects.end(),
+                    aState.Object) != myJobObjects.end()) {
+        aState.DowngradeLevel = Level_Full;
+      }
+    }
+  }
+  myJobObjects.clear();
+  return true;
+}
+
+// ================================================================
+// Function : Report
+// Purpose  :
+// ================================================================
+std::string SceneMemoryManager::Report(const SceneObjectMap &theObjects) {
+  std::ostringstream aStream;
+  Usage aTotal;
+  TColStd_MapOfTransient aCounted;
+  bool isFirst = true;
+  aStream << "{\"objects\":[";
+  for (SceneObjectMap::Iterator anObjIter(theObjects); anObjIter.More();
+       anObjIter.Next()) {
+    const ObjectState &aState = state(anObjIter.Key(), anObjIter.Value());
+    const Usage aUsage = Measure(anObjIter.Value());
+    const Usage anUnique = Measure(anObjIter.Value(), &aCounted);
+    aTotal.Triangulation += anUnique.Triangulation;
+    aTotal.DataSource += anUnique.DataSource;
+    aTotal.Presentation += anUnique.Presentation;
+    aTotal.Gpu += anUnique.Gpu;
+
+    aStream << (isFirst ? "" : ",") << "{\"name\":";
+    isFirst = false;
+    write_json_string(aStream, anObjIter.Key().ToCString());
+    aStream << ",\"level\":\"" << levelName(aState.DowngradeLevel)
+            << "\",\"lastViewed\":" << aState.LastViewed
+            << ",\"triangulation\":" << aUsage.Triangulation
+            << ",\"dataSource\":" << aUsage.DataSource
+            << ",\"presentation\":" << aUsage.Presentation
+            << ",\"gpu\":" << aUsage.Gpu << ",\"total\":" << aUsage.Total()
+            << ",\"shared\":" << (aUsage.Total() - anUnique.Total()) << "}";
+  }
+  aStream << "],\"triangulation\":" << aTotal.Triangulation
+          << ",\"dataSource\":" << aTotal.DataSource
+          << ",\"presentation\":" << aTotal.Presentation
+          << ",\"gpu\":" << aTotal.Gpu << ",\"total\":" << aTotal.Total()
+          << ",\"budget\":" << myBudget << "}";
+  return aStream.str();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <AIS_InteractiveContext.hxx>
+#include <Bnd_Box.hxx>
+#include <NCollection_DataMap.hxx>
+#include <NCollection_IndexedDataMap.hxx>
+#include <Standard_Transient.hxx>
+#include <TColStd_MapOfTransient.hxx>
+#include <TCollection_AsciiString.hxx>
+#include <V3d_View.hxx>
+
+#include <string>
+#include <vector>
+
+#include "progressive_mesher.h"
+
+//! Map of named scene objects, as kept by the viewer.
+typedef NCollection_IndexedDataMap<TCollection_AsciiString,
+                                   Handle(AIS_InteractiveObject)>
+    SceneObjectMap;
+
+class SceneMemoryManager;
+DEFINE_STANDARD_HANDLE(SceneMemoryManager, Standard_Transient)
+
+//! Per-object memory accounting and scene memory budget.
+//! When the total exceeds the budget, least recently viewed objects are
+//! downgraded step by step: first to a lower level of detail, then their
+//! presentations are unloaded (object is removed from the context but kept
+//! in the scene, and displayed again once it gets back into the view).
+//! Shapes are re-meshed with coarse parameters by a job executed within the
+//! load queue, see Enforce() and Commit().
+//! Geometry shared by several objects (see GeometryRegistry) is counted once
+//! in totals.
+class SceneMemoryManager : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(SceneMemoryManager, Standard_Transient)
+public:
+  //! Memory usage of an object in bytes.
+  struct Usage {
+    Standard_Size Triangulation = 0; //!< source triangulation
+    Standard_Size DataSource = 0;    //!< mesh data source arrays
+    Standard_Size Presentation = 0;  //!< client-side presentation data
+    Standard_Size Gpu = 0;           //!< vertex and index buffers
+
+    Standard_Size Total() const {
+      return Triangulation + DataSource + Presentation + Gpu;
+    }
+  };
+
+  //! Downgrade level of an object.
+  enum Level { Level_Full, Level_Reduced, Level_Unloaded };
+
+public:
+  SceneMemoryManager();
+
+  //! Return memory budget in bytes, 0 if unlimited.
+  Standard_Size Budget() const { return myBudget; }
+
+  //! Set memory budget in bytes, 0 for unlimited.
+  void SetBudget(Standard_Size theBudget) { myBudget = theBudget; }
+
+  //! Estimate memory used by the object.
+  //! @param theCounted [in,out] shared geometry already counted, to be skipped
+  static Usage Measure(const Handle(AIS_InteractiveObject) & theObj,
+                       TColStd_MapOfTransient *theCounted = nullptr);
+
+  //! Mark objects visible within the view as viewed at the given time.
+  //! Unloaded objects which got back into the view are displayed again.
+  //! @return number of objects displayed again
+  int UpdateVisibility(const SceneObjectMap &theObjects,
+                       const Handle(AIS_InteractiveContext) & theCtx,
+                       const Handle(V3d_View) & theView, double theTime);
+
+  //! Downgrade least recently viewed objects until the total usage fits
+  //! the budget. Reduced objects replace the original ones in theObjects.
+  //! Shapes are reduced by the returned job; objects are not unloaded until
+  //! it is committed, as the usage is not lowered before.
+  //! @param theJob [out] job re-meshing reduced shapes to be submitted to the
+  //!                     load queue, NULL if there is none
+  //! @return number of downgraded objects
+  int Enforce(SceneObjectMap &theObjects,
+              const Handle(AIS_InteractiveContext) & theCtx,
+              Handle(LoadJob) & theJob);
+
+  //! Return TRUE if re-meshing of reduced shapes is being executed.
+  bool IsRunning() const { return !myJob.IsNull(); }
+
+  //! Recompute presentations of the shapes re-meshed by the job.
+  //! Objects of a failed job get back to the full level.
+  //! @return FALSE if job has not been created by this manager
+  bool Commit(const Handle(LoadJob) & theJob,
+              const Handle(AIS_InteractiveContext) & theCtx);
+
+  //! Return memory report of the objects as JSON object.
+  std::string Report(const SceneObjectMap &theObjects);
+
+private:
+  //! Tracked state of a named object.
+  struct ObjectState {
+    Handle(AIS_InteractiveObject) Object;
+    double LastViewed = 0.0;
+    Level DowngradeLevel = Level_Full;
+    Level LoadedLevel = Level_Full; //!< level to restore once displayed again
+    Bnd_Box Box; //!< box of the unloaded object
+  };
+
+  //! Return state of the object, resetting it if object has been replaced.
+  ObjectState &state(const TCollection_AsciiString &theName,
+                     const Handle(AIS_InteractiveObject) & theObj);
+
+  //! Return total usage of the objects.
+  static Standard_Size total(const SceneObjectMap &theObjects);
+
+  //! Create reduced level of detail of the object.
+  //! Shapes are added to the re-meshing job and returned as is; they are
+  //! recomputed within the context once the job is committed.
+  //! @return NULL if object could not be reduced
+  Handle(AIS_InteractiveObject)
+  reduce(const Handle(AIS_InteractiveObject) & theObj,
+         const Handle(AIS_InteractiveContext) & theCtx);
+
+private:
+  NCollection_DataMap<TCollection_AsciiString, ObjectState> myStates;
+  Handle(FaceRefineJob) myJob; //!< re-meshing of reduced shapes
+  std::vector<Handle(AIS_InteractiveObject)> myJobObjects; //!< to recompute
+  Standard_Size myBudget;
+  double myLastTime; //!< time of the last visibility update
+};
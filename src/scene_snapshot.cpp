@@ -0,0 +1,533 @@
+#include "scene_snapshot.h"
+
+#include <AIS_ConnectedInteractive.hxx>
+#include <AIS_MultipleConnectedInteractive.hxx>
+#include <AIS_Shape.hxx>
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <BinTools.hxx>
+#include <MeshVS_Mesh.hxx>
+#include <NCollection_DataMap.hxx>
+#include <OSD_Parallel.hxx>
+#include <OSD_Timer.hxx>
+#include <Standard_ArrayStreamBuffer.hxx>
+#include <Standard_Failure.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Face.hxx>
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "XSDRAWSTLVRML_DataSource.h"
+#include "geometry_registry.h"
+#include "lazy_part_mesher.h"
+#include "model_factory.h"
+#include "trace_events.h"
+
+namespace {
+
+const uint32_t THE_SNAPSHOT_MAGIC = 0x504E534F; // "OSNP"
+const uint32_t THE_SNAPSHOT_VERSION = 1;
+
+//! Kind of geometry section.
+enum GeometryKind : uint8_t {
+  GeometryKind_Shape = 0, //!< shaded shape
+  GeometryKind_Mesh = 1   //!< mesh stored as single triangulated face
+};
+
+//! Kind of scene object.
+enum ObjectKind : uint8_t {
+  ObjectKind_Master = 0,    //!< object is master presentation itself
+  ObjectKind_Connected = 1, //!< single instance of master
+  ObjectKind_Multiple = 2   //!< group of master instances
+};
+
+//! Geometry section with display attributes of its master.
+struct GeometryEntry {
+  Handle(AIS_InteractiveObject) Master;
+  TopoDS_Shape Shape;
+  std::string Data; //!< encoded shape, filled on writing
+  const char *DataPtr = nullptr; //!< encoded shape, on reading
+  uint64_t Size = 0;
+  int32_t DisplayMode = 0;
+  int32_t Material = Graphic3d_NameOfMaterial_DEFAULT;
+  float Color[3] = {0.0f, 0.0f, 0.0f};
+  float Transparency = 0.0f;
+  uint8_t Kind = GeometryKind_Shape;
+  uint8_t HasColor = 0;
+};
+
+//! Scene object referring to geometry sections.
+struct ObjectEntry {
+  TCollection_AsciiString Name;
+  std::vector<std::pair<int, gp_Trsf>> Placements; //!< geometry and trsf
+  int32_t DisplayMode = 0;
+  uint8_t Kind = ObjectKind_Master;
+  uint8_t IsVisible = 1;
+};
+
+//! Write plain value.
+template <typename T>
+void writeValue(std::ostream &theStream, const T &theValue) {
+  theStream.write(reinterpret_cast<const char *>(&theValue), sizeof(T));
+}
+
+//! Write point or direction.
+template <typename T> void writeXyz(std::ostream &theStream, const T &theXyz) {
+  writeValue(theStream, theXyz.X());
+  writeValue(theStream, theXyz.Y());
+  writeValue(theStream, theXyz.Z());
+}
+
+//! Write transformation as 3x4 matrix.
+void writeTrsf(std::ostream &theStream, const gp_Trsf &theTrsf) {
+  for (int aRow = 1; aRow <= 3; ++aRow) {
+    for (int aCol = 1; aCol <= 4; ++aCol) {
+      writeValue(theStream, theTrsf.Value(aRow, aCol));
+    }
+  }
+}
+
+//! Sequential reader of plain values checking data bounds.
+class SnapshotInput {
+public:
+  SnapshotInput(const char *theData, size_t theDataLen)
+      : myPos(theData), myEnd(theData + theDataLen) {}
+
+  //! Return current position.
+  const char *Position() const { return myPos; }
+
+  //! Return number of bytes left.
+  size_t Left() const { return size_t(myEnd - myPos); }
+
+  //! Read plain value.
+  template <typename T> bool Read(T &theValue) {
+    if (Left() < sizeof(T)) {
+      return false;
+    }
+    memcpy(&theValue, myPos, sizeof(T));
+    myPos += sizeof(T);
+    return true;
+  }
+
+  //! Read string prefixed by its length.
+  bool Read(TCollection_AsciiString &theString) {
+    uint32_t aLength = 0;
+    if (!Read(aLength) || Left() < aLength) {
+      return false;
+    }
+    theString = TCollection_AsciiString(myPos, (Standard_Integer)aLength);
+    myPos += aLength;
+    return true;
+  }
+
+  //! Read point or direction.
+  template <typename T> bool ReadXyz(T &theXyz) {
+    double aCoords[3];
+    if (!Read(aCoords[0]) || !Read(aCoords[1]) || !Read(aCoords[2])) {
+      return false;
+    }
+    theXyz.SetCoord(aCoords[0], aCoords[1], aCoords[2]);
+    return true;
+  }
+
+  //! Read transformation stored as 3x4 matrix.
+  bool ReadTrsf(gp_Trsf &theTrsf) {
+    double aMat[12];
+    for (double &aValue : aMat) {
+      if (!Read(aValue)) {
+        return false;
+      }
+    }
+    try {
+      theTrsf.SetValues(aMat[0], aMat[1], aMat[2], aMat[3], aMat[4], aMat[5],
+                        aMat[6], aMat[7], aMat[8], aMat[9], aMat[10],
+                        aMat[11]);
+    } catch (const Standard_Failure &) {
+      return false;
+    }
+    return true;
+  }
+
+private:
+  const char *myPos;
+  const char *myEnd;
+};
+
+//! Return shape of the master presentation and kind of its section.
+TopoDS_Shape masterShape(const Handle(AIS_InteractiveObject) & theMaster,
+                         uint8_t &theKind) {
+  if (Handle(AIS_Shape) aShapePrs = Handle(AIS_Shape)::DownCast(theMaster)) {
+    theKind = GeometryKind_Shape;
+    return aShapePrs->Shape();
+  }
+
+  Handle(MeshVS_Mesh) aMesh = Handle(MeshVS_Mesh)::DownCast(theMaster);
+  if (aMesh.IsNull()) {
+    return TopoDS_Shape();
+  }
+  Handle(XSDRAWSTLVRML_DataSource) aDataSource =
+      Handle(XSDRAWSTLVRML_DataSource)::DownCast(aMesh->GetDataSource());
+  if (aDataSource.IsNull() || aDataSource->Triangulation().IsNull()) {
+    return TopoDS_Shape();
+  }
+  TopoDS_Face aFace;
+  BRep_Builder().MakeFace(aFace, aDataSource->Triangulation());
+  theKind = GeometryKind_Mesh;
+  return aFace;
+}
+
+//! Create master presentation of the decoded section.
+Handle(AIS_InteractiveObject) createMaster(const GeometryEntry &theEntry) {
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  Handle(AIS_InteractiveObject) aMaster;
+  if (theEntry.Shape.IsNull()) {
+    return aMaster;
+  } else if (theEntry.Kind == GeometryKind_Mesh) {
+    if (theEntry.Shape.ShapeType() != TopAbs_FACE) {
+      return aMaster;
+    }
+    TopLoc_Location aLoc;
+    const Handle(Poly_Triangulation) &aTriangulation =
+        BRep_Tool::Triangulation(TopoDS::Face(theEntry.Shape), aLoc);
+    if (aTriangulation.IsNull()) {
+      return aMaster;
+    }
+    aMaster = aFactory->CreateStlMesh(aTriangulation);
+  } else if (ModelFactory::IsTriangulated(theEntry.Shape)) {
+    aMaster = aFactory->CreateMeshedShape(theEntry.Shape);
+  } else {
+    aMaster = new LazyPartPrs(theEntry.Shape);
+  }
+
+  aMaster->SetDisplayMode(theEntry.DisplayMode);
+  if (theEntry.Material >= 0 &&
+      theEntry.Material < Graphic3d_NameOfMaterial_UserDefined &&
+      aMaster->IsKind(STANDARD_TYPE(AIS_Shape))) {
+    aMaster->SetMaterial(
+        Graphic3d_MaterialAspect((Graphic3d_NameOfMaterial)theEntry.Material));
+  }
+  if (theEntry.HasColor) {
+    aMaster->SetColor(Quantity_Color(theEntry.Color[0], theEntry.Color[1],
+                                     theEntry.Color[2], Quantity_TOC_RGB));
+  }
+  if (theEntry.Transparency > 0.0f) {
+    aMaster->SetTransparency(theEntry.Transparency);
+  }
+  return aMaster;
+}
+
+} // namespace
+
+// ================================================================
+// Function : Write
+// Purpose  :
+// ================================================================
+bool SceneSnapshot::Write(std::ostream &theStream,
+                          const SceneObjectMap &theObjects,
+                          const Handle(AIS_InteractiveContext) & theCtx,
+                          const Handle(Graphic3d_Camera) & theCamera) {
+  TRACE_SCOPE("write snapshot");
+  std::vector<GeometryEntry> aGeometries;
+  std::vector<ObjectEntry> anObjects;
+  // section of each master, -1 for unsupported ones
+  NCollection_DataMap<Handle(Standard_Transient), int> aGeomIndices;
+  for (SceneObjectMap::Iterator anObjIter(theObjects); anObjIter.More();
+       anObjIter.Next()) {
+    const Handle(AIS_InteractiveObject) &anObj = anObjIter.Value();
+    NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+    GeometryRegistry::Placements(anObj, aPlacements);
+
+    ObjectEntry anEntry;
+    anEntry.Name = anObjIter.Key();
+    anEntry.DisplayMode = anObj->DisplayMode();
+    anEntry.IsVisible = theCtx->DisplayStatus(anObj) == AIS_DS_Displayed;
+    if (anObj->IsKind(STANDARD_TYPE(AIS_ConnectedInteractive))) {
+      anEntry.Kind = ObjectKind_Connected;
+    } else if (anObj->IsKind(STANDARD_TYPE(AIS_MultipleConnectedInteractive))) {
+      anEntry.Kind = ObjectKind_Multiple;
+    }
+    for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+             aPlacementIter(aPlacements);
+         aPlacementIter.More(); aPlacementIter.Next()) {
+      const Handle(AIS_InteractiveObject) &aMaster =
+          aPlacementIter.Value().Master;
+      int aGeomIndex = -1;
+      if (!aGeomIndices.Find(aMaster, aGeomIndex)) {
+        GeometryEntry aGeom;
+        aGeom.Shape = masterShape(aMaster, aGeom.Kind);
+        if (!aGeom.Shape.IsNull()) {
+          aGeom.Master = aMaster;
+          aGeom.DisplayMode = aMaster->DisplayMode();
+          aGeom.Material = aMaster->Material();
+          aGeom.Transparency = (float)aMaster->Transparency();
+          if (aMaster->HasColor()) {
+            Quantity_Color aColor;
+            aMaster->Color(aColor);
+            aGeom.HasColor = 1;
+            aGeom.Color[0] = (float)aColor.Red();
+            aGeom.Color[1] = (float)aColor.Green();
+            aGeom.Color[2] = (float)aColor.Blue();
+          }
+          aGeomIndex = (int)aGeometries.size();
+          aGeometries.push_back(aGeom);
+        }
+        aGeomIndices.Bind(aMaster, aGeomIndex);
+      }
+      if (aGeomIndex >= 0) {
+        anEntry.Placements.push_back(
+            std::make_pair(aGeomIndex, aPlacementIter.Value().Trsf));
+      }
+    }
+    if (!anEntry.Placements.empty()) {
+      anObjects.push_back(anEntry);
+    }
+  }
+
+  {
+    TRACE_SCOPE("encode snapshot sections");
+    OSD_Parallel::For(0, (int)aGeometries.size(), [&](int theIndex) {
+      GeometryEntry &aGeom = aGeometries[theIndex];
+      std::ostringstream aStream;
+      BinTools::Write(aGeom.Shape, aStream, Standard_True, Standard_True,
+                      BinTools_FormatVersion_CURRENT);
+      aGeom.Data = aStream.str();
+    });
+  }
+
+  writeValue(theStream, THE_SNAPSHOT_MAGIC);
+  writeValue(theStream, THE_SNAPSHOT_VERSION);
+  writeXyz(theStream, theCamera->Eye());
+  writeXyz(theStream, theCamera->Center());
+  writeXyz(theStream, theCamera->Up());
+  writeValue(theStream, theCamera->Scale());
+  writeValue(theStream, theCamera->FOVy());
+  writeValue(theStream, (int32_t)theCamera->ProjectionType());
+
+  writeValue(theStream, (uint32_t)aGeometries.size());
+  for (const GeometryEntry &aGeom : aGeometries) {
+    writeValue(theStream, aGeom.Kind);
+    writeValue(theStream, aGeom.HasColor);
+    writeValue(theStream, aGeom.DisplayMode);
+    writeValue(theStream, aGeom.Material);
+    writeValue(theStream, aGeom.Color);
+    writeValue(theStream, aGeom.Transparency);
+    writeValue(theStream, (uint64_t)aGeom.Data.size());
+  }
+
+  writeValue(theStream, (uint32_t)anObjects.size());
+  for (const ObjectEntry &anEntry : anObjects) {
+    writeValue(theStream, (uint32_t)anEntry.Name.Length());
+    theStream.write(anEntry.Name.ToCString(), anEntry.Name.Length());
+    writeValue(theStream, anEntry.Kind);
+    writeValue(theStream, anEntry.IsVisible);
+    writeValue(theStream, anEntry.DisplayMode);
+    writeValue(theStream, (uint32_t)anEntry.Placements.size());
+    for (const std::pair<int, gp_Trsf> &aPlacement : anEntry.Placements) {
+      writeValue(theStream, (uint32_t)aPlacement.first);
+      writeTrsf(theStream, aPlacement.second);
+    }
+  }
+
+  for (const GeometryEntry &aGeom : aGeometries) {
+    theStream.write(aGeom.Data.data(), aGeom.Data.size());
+  }
+  return theStream.good();
+}
+
+// ================================================================
+// Function : IsSnapshot
+// Purpose  :
+// ================================================================
+bool SceneSnapshot::IsSnapshot(const char *theData, size_t theDataLen) {
+  uint32_t aMagic = 0;
+  return SnapshotInput(theData, theDataLen).Read(aMagic) &&
+         aMagic == THE_SNAPSHOT_MAGIC;
+}
+
+// ================================================================
+// Function : Read
+// Purpose  :
+// ================================================================
+bool SceneSnapshot::Read(const char *theData, size_t theDataLen,
+                         ModelLoadStats *theStats) {
+  TRACE_SCOPE("read snapshot");
+  myObjects.clear();
+  myCamera.Nullify();
+
+  OSD_Timer aTimer;
+  aTimer.Start();
+  SnapshotInput anInput(theData, theDataLen);
+  uint32_t aMagic = 0, aVersion = 0;
+  if (!anInput.Read(aMagic) || aMagic != THE_SNAPSHOT_MAGIC ||
+      !anInput.Read(aVersion) || aVersion != THE_SNAPSHOT_VERSION) {
+    return false;
+  }
+
+  gp_Pnt anEye, aCenter;
+  gp_Dir anUp;
+  double aScale = 1.0, aFovy = 45.0;
+  int32_t aProjection = 0;
+  if (!anInput.ReadXyz(anEye) || !anInput.ReadXyz(aCenter) ||
+      !anInput.ReadXyz(anUp) || !anInput.Read(aScale) ||
+      !anInput.Read(aFovy) || !anInput.Read(aProjection)) {
+    return false;
+  }
+  myCamera = new Graphic3d_Camera();
+  myCamera->SetProjectionType(
+      aProjection == Graphic3d_Camera::Projection_Perspective
+          ? Graphic3d_Camera::Projection_Perspective
+          : Graphic3d_Camera::Projection_Orthographic);
+  myCamera->SetFOVy(aFovy);
+  // perspective scale moves the eye, so that it precedes the orientation
+  myCamera->SetScale(aScale);
+  myCamera->SetEyeAndCenter(anEye, aCenter);
+  myCamera->SetUp(anUp);
+
+  uint32_t aNbGeometries = 0;
+  if (!anInput.Read(aNbGeometries) ||
+      anInput.Left() / 34 < aNbGeometries) {
+    return false;
+  }
+  std::vector<GeometryEntry> aGeometries(aNbGeometries);
+  for (GeometryEntry &aGeom : aGeometries) {
+    if (!anInput.Read(aGeom.Kind) || !anInput.Read(aGeom.HasColor) ||
+        !anInput.Read(aGeom.DisplayMode) || !anInput.Read(aGeom.Material) ||
+        !anInput.Read(aGeom.Color) || !anInput.Read(aGeom.Transparency) ||
+        !anInput.Read(aGeom.Size)) {
+      return false;
+    }
+  }
+
+  uint32_t aNbObjects = 0;
+  if (!anInput.Read(aNbObjects) || anInput.Left() < aNbObjects) {
+    return false;
+  }
+  std::vector<ObjectEntry> anObjects(aNbObjects);
+  for (ObjectEntry &anEntry : anObjects) {
+    uint32_t aNbPlacements = 0;
+    if (!anInput.Read(anEntry.Name) || !anInput.Read(anEntry.Kind) ||
+        !anInput.Read(anEntry.IsVisible) ||
+        !anInput.Read(anEntry.DisplayMode) || !anInput.Read(aNbPlacements) ||
+        anInput.Left() / 100 < aNbPlacements) {
+      return false;
+    }
+    // single objects are restored from their first placement
+    if (aNbPlacements == 0 && (anEntry.Kind == ObjectKind_Master ||
+                               anEntry.Kind == ObjectKind_Connected)) {
+      return false;
+    }
+    anEntry.Placements.resize(aNbPlacements);
+    for (std::pair<int, gp_Trsf> &aPlacement : anEntry.Placements) {
+      uint32_t aGeomIndex = 0;
+      if (!anInput.Read(aGeomIndex) || aGeomIndex >= aNbGeometries ||
+          !anInput.ReadTrsf(aPlacement.second)) {
+        return false;
+      }
+      aPlacement.first = (int)aGeomIndex;
+    }
+  }
+
+  // sections follow each other after the tables
+  const char *aSection = anInput.Position();
+  for (GeometryEntry &aGeom : aGeometries) {
+    if (size_t(theData + theDataLen - aSection) < aGeom.Size) {
+      return false;
+    }
+    aGeom.DataPtr = aSection;
+    aSection += aGeom.Size;
+  }
+
+  {
+    TRACE_SCOPE("decode snapshot sections");
+    OSD_Parallel::For(0, (int)aGeometries.size(), [&](int theIndex) {
+      GeometryEntry &aGeom = aGeometries[theIndex];
+      Standard_ArrayStreamBuffer aStreamBuffer(aGeom.DataPtr,
+                                               (size_t)aGeom.Size);
+      std::istream aStream(&aStreamBuffer);
+      try {
+        BinTools::Read(aGeom.Shape, aStream);
+      } catch (const Standard_Failure &) {
+        // object is restored without the broken section
+        aGeom.Shape.Nullify();
+      }
+    });
+  }
+  if (theStats != nullptr) {
+    theStats->ReadTime += aTimer.ElapsedTime();
+    aTimer.Reset();
+    aTimer.Start();
+  }
+
+  {
+    TRACE_SCOPE("snapshot presentation");
+    for (GeometryEntry &aGeom : aGeometries) {
+      aGeom.Master = createMaster(aGeom);
+    }
+    for (const ObjectEntry &anEntry : anObjects) {
+      Handle(AIS_InteractiveObject) aPrs;
+      if (anEntry.Kind == ObjectKind_Master) {
+        // master is not shared by other objects
+        const std::pair<int, gp_Trsf> &aPlacement = anEntry.Placements[0];
+        aPrs = aGeometries[aPlacement.first].Master;
+        if (!aPrs.IsNull() && aPlacement.second.Form() != gp_Identity) {
+          aPrs->SetLocalTransformation(aPlacement.second);
+        }
+      } else if (anEntry.Kind == ObjectKind_Connected) {
+        const std::pair<int, gp_Trsf> &aPlacement = anEntry.Placements[0];
+        const Handle(AIS_InteractiveObject) &aMaster =
+            aGeometries[aPlacement.first].Master;
+        if (!aMaster.IsNull()) {
+          aPrs = GeometryRegistry::Instantiate(aMaster, aPlacement.second);
+        }
+      } else {
+        Handle(AIS_MultipleConnectedInteractive) aGroup =
+            new AIS_MultipleConnectedInteractive();
+        for (const std::pair<int, gp_Trsf> &aPlacement : anEntry.Placements) {
+          const Handle(AIS_InteractiveObject) &aMaster =
+              aGeometries[aPlacement.first].Master;
+          if (!aMaster.IsNull()) {
+            aGroup->Connect(aMaster, aPlacement.second);
+          }
+        }
+        if (aGroup->HasConnection()) {
+          aPrs = aGroup;
+        }
+      }
+      if (aPrs.IsNull()) {
+        continue;
+      }
+
+      aPrs->SetDisplayMode(anEntry.DisplayMode);
+      Object anObject;
+      anObject.Name = anEntry.Name;
+      anObject.Prs = aPrs;
+      anObject.DisplayMode = anEntry.DisplayMode;
+      anObject.IsVisible = anEntry.IsVisible != 0;
+      myObjects.push_back(anObject);
+    }
+  }
+  if (theStats != nullptr) {
+    theStats->BuildTime += aTimer.ElapsedTime();
+  }
+  return true;
+}
+
+// ================================================================
+// Function : RestoreCamera
+// Purpose  :
+// ================================================================
+void SceneSnapshot::RestoreCamera(
+    const Handle(Graphic3d_Camera) & theCamera) const {
+  if (myCamera.IsNull()) {
+    return;
+  }
+
+  // aspect, Z range and stereo settings belong to the view, not the scene
+  theCamera->SetProjectionType(myCamera->ProjectionType());
+  theCamera->SetFOVy(myCamera->FOVy());
+  theCamera->SetScale(myCamera->Scale());
+  theCamera->CopyOrientationData(myCamera);
+}
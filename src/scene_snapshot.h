@@ -0,0 +1,66 @@
+#pragma once
+
+#include <AIS_InteractiveContext.hxx>
+#include <Graphic3d_Camera.hxx>
+#include <TCollection_AsciiString.hxx>
+
+#include <ostream>
+#include <vector>
+
+#include "scene_memory.h"
+
+struct ModelLoadStats;
+
+//! Binary snapshot of the whole scene, restored without parsing source
+//! files, meshing or welding again.
+//! Layout (native byte order):
+//!  - header: signature, version and camera;
+//!  - geometry table: kind, display attributes and size of each master
+//!    presentation (see GeometryRegistry::Placements());
+//!  - object table: name, display mode, visibility and placements of
+//!    masters for each scene object;
+//!  - geometry sections: shape of each master in binary BRep format with
+//!    triangulation and normals; meshes are stored as triangulated faces.
+//! Sections are independent, so that they are encoded and decoded in
+//! parallel threads. Masters shared by objects are stored once.
+class SceneSnapshot {
+public:
+  //! Restored scene object.
+  struct Object {
+    TCollection_AsciiString Name;
+    Handle(AIS_InteractiveObject) Prs;
+    int DisplayMode = 0;
+    bool IsVisible = true;
+  };
+
+public:
+  SceneSnapshot() {}
+
+  //! Write snapshot of the scene objects and the camera.
+  //! Objects without shapes or meshes (e.g. labels) are skipped.
+  //! @return FALSE on writing error
+  static bool Write(std::ostream &theStream, const SceneObjectMap &theObjects,
+                    const Handle(AIS_InteractiveContext) & theCtx,
+                    const Handle(Graphic3d_Camera) & theCamera);
+
+  //! Return TRUE if data starts with the snapshot signature.
+  static bool IsSnapshot(const char *theData, size_t theDataLen);
+
+  //! Decode snapshot and create presentations of its objects.
+  //! Shapes stored without triangulation are restored as placeholders
+  //! (see LazyPartPrs).
+  //! @return FALSE if data is not a valid snapshot
+  bool Read(const char *theData, size_t theDataLen,
+            ModelLoadStats *theStats = nullptr);
+
+  //! Return restored objects, in the order of the saved scene.
+  const std::vector<Object> &Objects() const { return myObjects; }
+
+  //! Apply restored orientation, projection type, field of view and scale
+  //! to the camera; its aspect, Z range and stereo settings are kept.
+  void RestoreCamera(const Handle(Graphic3d_Camera) & theCamera) const;
+
+private:
+  std::vector<Object> myObjects;
+  Handle(Graphic3d_Camera) myCamera;
+};
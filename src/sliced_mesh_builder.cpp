@@ -0,0 +1,389 @@
+#include "sliced_mesh_builder.h"
+
+#include <Graphic3d_ArrayOfSegments.hxx>
+#include <Graphic3d_ArrayOfTriangles.hxx>
+#include <MeshVS_DisplayModeFlags.hxx>
+#include <MeshVS_Drawer.hxx>
+#include <MeshVS_DrawerAttribute.hxx>
+#include <MeshVS_Tool.hxx>
+#include <OSD_Timer.hxx>
+#include <Prs3d_BndBox.hxx>
+#include <Prs3d_LineAspect.hxx>
+#include <gp.hxx>
+
+#include <algorithm>
+#include <cmath>
+
+#include "XSDRAWSTLVRML_DataSource.h"
+#include "geometry_registry.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(SlicedMeshPrs, MeshVS_Mesh)
+IMPLEMENT_STANDARD_RTTIEXT(SlicedMeshBuilder, Standard_Transient)
+
+// ================================================================
+// Function : SlicedMeshPrs
+// Purpose  :
+// ================================================================
+SlicedMeshPrs::SlicedMeshPrs()
+    : myStage(Stage_Init), myNext(1), myNbUnitsDone(0), myNbUnits(1),
+      myIsSmooth(false), myToShowEdges(false), myIsScheduled(false) {}
+
+// ================================================================
+// Function : Progress
+// Purpose  :
+// ================================================================
+double SlicedMeshPrs::Progress() const {
+  return myStage == Stage_Done ? 1.0 : double(myNbUnitsDone) / myNbUnits;
+}
+
+// ================================================================
+// Function : Build
+// Purpose  :
+// ================================================================
+void SlicedMeshPrs::Build(double theBudget) {
+  OSD_Timer aTimer;
+  aTimer.Start();
+  do {
+    buildUnit();
+  } while (myStage != Stage_Done && aTimer.ElapsedTime() * 1000.0 < theBudget);
+}
+
+// ================================================================
+// Function : buildUnit
+// Purpose  :
+// ================================================================
+void SlicedMeshPrs::buildUnit() {
+  if (myStage == Stage_Done) {
+    return;
+  }
+
+  ++myNbUnitsDone;
+  if (myStage == Stage_Init) {
+    Handle(XSDRAWSTLVRML_DataSource) aSource =
+        Handle(XSDRAWSTLVRML_DataSource)::DownCast(GetDataSource());
+    if (aSource.IsNull() || aSource->Triangulation().IsNull()) {
+      myStage = Stage_Done;
+      return;
+    }
+
+    // drawer attributes are set up after construction of the presentation
+    Standard_Boolean isSmooth = Standard_False, toShowEdges = Standard_False;
+    GetDrawer()->GetBoolean(MeshVS_DA_SmoothShading, isSmooth);
+    GetDrawer()->GetBoolean(MeshVS_DA_ShowEdges, toShowEdges);
+    myIsSmooth = isSmooth == Standard_True;
+    myToShowEdges = toShowEdges == Standard_True;
+
+    myTriangulation = aSource->Triangulation();
+    const int aNbTriUnits =
+        (myTriangulation->NbTriangles() + THE_UNIT_SIZE - 1) / THE_UNIT_SIZE;
+    const int aNbNodeUnits =
+        (myTriangulation->NbNodes() + THE_UNIT_SIZE - 1) / THE_UNIT_SIZE;
+    myNbUnits = 1 + aNbNodeUnits + aNbTriUnits;
+    if (myIsSmooth) {
+      myNormals.assign(size_t(myTriangulation->NbNodes()) * 3, 0.0f);
+      myNbUnits += aNbTriUnits + aNbNodeUnits;
+    }
+    myStage = Stage_Bounds;
+    myNext = 1;
+    return;
+  }
+
+  const bool isNodeStage =
+      myStage == Stage_Bounds || myStage == Stage_Normalize;
+  const int aCount = isNodeStage ? myTriangulation->NbNodes()
+                                 : myTriangulation->NbTriangles();
+  const int aFirst = myNext;
+  const int aLast = std::min(aFirst + THE_UNIT_SIZE - 1, aCount);
+  if (myStage == Stage_Bounds) {
+    for (int aNodeIter = aFirst; aNodeIter <= aLast; ++aNodeIter) {
+      myBox.Add(myTriangulation->Node(aNodeIter));
+    }
+  } else if (myStage == Stage_Normals) {
+    // area-weighted sum of facet normals
+    for (int aTriIter = aFirst; aTriIter <= aLast; ++aTriIter) {
+      int aNodes[3];
+      myTriangulation->Triangle(aTriIter).Get(aNodes[0], aNodes[1], aNodes[2]);
+      const gp_XYZ aP1 = myTriangulation->Node(aNodes[0]).XYZ();
+      const gp_XYZ aP2 = myTriangulation->Node(aNodes[1]).XYZ();
+      const gp_XYZ aP3 = myTriangulation->Node(aNodes[2]).XYZ();
+      const gp_XYZ aNorm = (aP2 - aP1).Crossed(aP3 - aP1);
+      for (int aNode : aNodes) {
+        float *aDst = &myNormals[size_t(aNode - 1) * 3];
+        aDst[0] += float(aNorm.X());
+        aDst[1] += float(aNorm.Y());
+        aDst[2] += float(aNorm.Z());
+      }
+    }
+  } else if (myStage == Stage_Normalize) {
+    for (int aNodeIter = aFirst; aNodeIter <= aLast; ++aNodeIter) {
+      float *aNorm = &myNormals[size_t(aNodeIter - 1) * 3];
+      const float aLen = std::sqrt(aNorm[0] * aNorm[0] + aNorm[1] * aNorm[1] +
+                                   aNorm[2] * aNorm[2]);
+      if (aLen > 0.0f) {
+        aNorm[0] /= aLen;
+        aNorm[1] /= aLen;
+        aNorm[2] /= aLen;
+      } else {
+        aNorm[2] = 1.0f;
+      }
+    }
+  } else {
+    buildChunk(aFirst, aLast);
+  }
+
+  myNext = aLast + 1;
+  if (myNext <= aCount) {
+    return;
+  }
+
+  // switch to the next stage
+  myNext = 1;
+  if (myStage == Stage_Bounds) {
+    myStage = myIsSmooth ? Stage_Normals : Stage_Triangles;
+  } else if (myStage == Stage_Normals) {
+    myStage = Stage_Normalize;
+  } else if (myStage == Stage_Normalize) {
+    myStage = Stage_Triangles;
+  } else {
+    myStage = Stage_Done;
+    myNormals.clear();
+    myNormals.shrink_to_fit();
+    myTriangulation.Nullify();
+  }
+}
+
+// ================================================================
+// Function : buildChunk
+// Purpose  :
+// ================================================================
+void SlicedMeshPrs::buildChunk(int theFirst, int theLast) {
+  const int aNbTriangles = theLast - theFirst + 1;
+  if (aNbTriangles <= 0) {
+    return;
+  }
+
+  Handle(Graphic3d_ArrayOfTriangles) aTriangles =
+      new Graphic3d_ArrayOfTriangles(aNbTriangles * 3, 0,
+                                     Graphic3d_ArrayFlags_VertexNormal);
+  Handle(Graphic3d_ArrayOfSegments) anEdges;
+  if (myToShowEdges) {
+    anEdges = new Graphic3d_ArrayOfSegments(aNbTriangles * 6);
+  }
+  for (int aTriIter = theFirst; aTriIter <= theLast; ++aTriIter) {
+    int aNodes[3];
+    myTriangulation->Triangle(aTriIter).Get(aNodes[0], aNodes[1], aNodes[2]);
+    const gp_Pnt aPnts[3] = {myTriangulation->Node(aNodes[0]),
+                             myTriangulation->Node(aNodes[1]),
+                             myTriangulation->Node(aNodes[2])};
+    gp_XYZ aFacetNorm(0.0, 0.0, 1.0);
+    if (!myIsSmooth) {
+      const gp_XYZ aNorm = (aPnts[1].XYZ() - aPnts[0].XYZ())
+                               .Crossed(aPnts[2].XYZ() - aPnts[0].XYZ());
+      if (aNorm.Modulus() > gp::Resolution()) {
+        aFacetNorm = aNorm.Normalized();
+      }
+    }
+    for (int aCorner = 0; aCorner < 3; ++aCorner) {
+      gp_XYZ aNorm = aFacetNorm;
+      if (myIsSmooth) {
+        const float *aSrc = &myNormals[size_t(aNodes[aCorner] - 1) * 3];
+        aNorm.SetCoord(aSrc[0], aSrc[1], aSrc[2]);
+      }
+      aTriangles->AddVertex(aPnts[aCorner].X(), aPnts[aCorner].Y(),
+                            aPnts[aCorner].Z(), aNorm.X(), aNorm.Y(),
+                            aNorm.Z());
+      if (!anEdges.IsNull()) {
+        anEdges->AddVertex(aPnts[aCorner]);
+        anEdges->AddVertex(aPnts[(aCorner + 1) % 3]);
+      }
+    }
+  }
+  myTriangles.Append(aTriangles);
+  if (!anEdges.IsNull()) {
+    myEdges.Append(anEdges);
+  }
+}
+
+// ================================================================
+// Function : Compute
+// Purpose  :
+// ================================================================
+void SlicedMeshPrs::Compute(
+    const Handle(PrsMgr_PresentationManager) & thePrsMgr,
+    const Handle(Prs3d_Presentation) & thePrs, const Standard_Integer theMode) {
+  if (theMode != MeshVS_DMF_Shading) {
+    MeshVS_Mesh::Compute(thePrsMgr, thePrs, theMode);
+    return;
+  }
+  if (!myIsScheduled) {
+    // nobody would build it in slices
+    while (myStage != Stage_Done) {
+      buildUnit();
+    }
+  }
+
+  if (myTriangles.IsEmpty()) {
+    if (myStage > Stage_Bounds && !myBox.IsVoid()) {
+      Handle(Graphic3d_Group) aGroup = thePrs->NewGroup();
+      aGroup->SetGroupPrimitivesAspect(myDrawer->WireAspect()->Aspect());
+      aGroup->AddPrimitiveArray(Prs3d_BndBox::FillSegments(myBox));
+    }
+    return;
+  }
+
+  Handle(Graphic3d_AspectFillArea3d) aFillAspect =
+      MeshVS_Tool::CreateAspectFillArea3d(GetDrawer());
+  aFillAspect->SetEdgeOff();
+  Handle(Graphic3d_Group) aGroup = thePrs->NewGroup();
+  aGroup->SetGroupPrimitivesAspect(aFillAspect);
+  for (NCollection_Sequence<Handle(Graphic3d_ArrayOfPrimitives)>::Iterator
+           anArrayIter(myTriangles);
+       anArrayIter.More(); anArrayIter.Next()) {
+    aGroup->AddPrimitiveArray(anArrayIter.Value());
+  }
+
+  if (!myEdges.IsEmpty()) {
+    Handle(Graphic3d_Group) anEdgeGroup = thePrs->NewGroup();
+    anEdgeGroup->SetGroupPrimitivesAspect(
+        MeshVS_Tool::CreateAspectLine3d(GetDrawer()));
+    for (NCollection_Sequence<Handle(Graphic3d_ArrayOfPrimitives)>::Iterator
+             anArrayIter(myEdges);
+         anArrayIter.More(); anArrayIter.Next()) {
+      anEdgeGroup->AddPrimitiveArray(anArrayIter.Value());
+    }
+  }
+}
+
+// ================================================================
+// Function : SlicedMeshBuilder
+// Purpose  :
+// ================================================================
+SlicedMeshBuilder::SlicedMeshBuilder(double theBudget) : myBudget(theBudget) {}
+
+// ================================================================
+// Function : Add
+// Purpose  :
+// ================================================================
+void SlicedMeshBuilder::Add(const Handle(AIS_InteractiveObject) & thePrs) {
+  NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+  GeometryRegistry::Placements(thePrs, aPlacements);
+  for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+           aPlacementIter(aPlacements);
+       aPlacementIter.More(); aPlacementIter.Next()) {
+    Handle(SlicedMeshPrs) aMesh =
+        Handle(SlicedMeshPrs)::DownCast(aPlacementIter.Value().Master);
+    if (aMesh.IsNull() || aMesh->IsBuilt()) {
+      continue;
+    }
+
+    // the mesh may be placed many times within one or several objects
+    const auto aTargetIndex = myTargetIndices.find(aMesh.get());
+    if (aTargetIndex == myTargetIndices.end()) {
+      Target aTarget;
+      aTarget.Mesh = aMesh;
+      aTarget.NbShown = 0;
+      aMesh->SetScheduled(true);
+      myTargetIndices[aMesh.get()] = (int)myTargets.size();
+      myTargets.push_back(aTarget);
+    }
+    Target &aTarget = myTargets[myTargetIndices[aMesh.get()]];
+    if (std::find(aTarget.Objects.begin(), aTarget.Objects.end(), thePrs) ==
+        aTarget.Objects.end()) {
+      aTarget.Objects.push_back(thePrs);
+    }
+  }
+}
+
+// ================================================================
+// Function : Clear
+// Purpose  :
+// ================================================================
+void SlicedMeshBuilder::Clear() {
+  // presentations left are built at once on the next recomputation
+  for (Target &aTarget : myTargets) {
+    aTarget.Mesh->SetScheduled(false);
+  }
+  myTargets.clear();
+  myTargetIndices.clear();
+}
+
+// ================================================================
+// Function : Progress
+// Purpose  :
+// ================================================================
+double SlicedMeshBuilder::Progress() const {
+  if (myTargets.empty()) {
+    return 1.0;
+  }
+
+  double aProgress = 0.0;
+  for (const Target &aTarget : myTargets) {
+    aProgress += aTarget.Mesh->Progress();
+  }
+  return aProgress / myTargets.size();
+}
+
+// ================================================================
+// Function : BuildSlice
+// Purpose  :
+// ================================================================
+bool SlicedMeshBuilder::BuildSlice(
+    const Handle(AIS_InteractiveContext) & theCtx) {
+  OSD_Timer aTimer;
+  aTimer.Start();
+  bool isChanged = false;
+  std::vector<Target> aPending;
+  for (size_t aTargetIter = 0; aTargetIter < myTargets.size();
+       ++aTargetIter) {
+    Target &aTarget = myTargets[aTargetIter];
+    aTarget.Objects.erase(
+        std::remove_if(aTarget.Objects.begin(), aTarget.Objects.end(),
+                       [&theCtx](const Handle(AIS_InteractiveObject) &theObj) {
+                         return theCtx->DisplayStatus(theObj) == AIS_DS_None;
+                       }),
+        aTarget.Objects.end());
+    if (aTarget.Objects.empty()) {
+      aTarget.Mesh->SetScheduled(false);
+      continue;
+    }
+
+    const double aBudget = myBudget - aTimer.ElapsedTime() * 1000.0;
+    if (aBudget > 0.0) {
+      aTarget.Mesh->Build(aBudget);
+      const int aNbChunks = aTarget.Mesh->NbChunks();
+      if (aTarget.Mesh->IsBuilt() ||
+          (aNbChunks > aTarget.NbShown && aNbChunks >= aTarget.NbShown * 2)) {
+        showTarget(aTarget, theCtx);
+        isChanged = true;
+      }
+    }
+    if (!aTarget.Mesh->IsBuilt()) {
+      aPending.push_back(aTarget);
+    }
+  }
+
+  myTargets.swap(aPending);
+  myTargetIndices.clear();
+  for (size_t aTargetIter = 0; aTargetIter < myTargets.size();
+       ++aTargetIter) {
+    myTargetIndices[myTargets[aTargetIter].Mesh.get()] = (int)aTargetIter;
+  }
+  return isChanged;
+}
+
+// ================================================================
+// Function : showTarget
+// Purpose  :
+// ================================================================
+void SlicedMeshBuilder::showTarget(
+    Target &theTarget, const Handle(AIS_InteractiveContext) & theCtx) {
+  theTarget.NbShown = theTarget.Mesh->NbChunks();
+  if (std::find(theTarget.Objects.begin(), theTarget.Objects.end(),
+                theTarget.Mesh) == theTarget.Objects.end()) {
+    // shared master is not displayed itself, only connected to objects
+    theCtx->Redisplay(theTarget.Mesh, Standard_False);
+  }
+  for (const Handle(AIS_InteractiveObject) &anObj : theTarget.Objects) {
+    theCtx->Redisplay(anObj, Standard_False);
+  }
+}
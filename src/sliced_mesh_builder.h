@@ -0,0 +1,150 @@
+#pragma once
+
+#include <AIS_InteractiveContext.hxx>
+#include <Bnd_Box.hxx>
+#include <Graphic3d_ArrayOfPrimitives.hxx>
+#include <MeshVS_Mesh.hxx>
+#include <NCollection_Sequence.hxx>
+#include <Poly_Triangulation.hxx>
+
+#include <unordered_map>
+#include <vector>
+
+class SlicedMeshPrs;
+DEFINE_STANDARD_HANDLE(SlicedMeshPrs, MeshVS_Mesh)
+
+//! Mesh presentation built cooperatively on the main thread.
+//! Shaded arrays of the triangulation are filled in work units of a few
+//! thousand nodes or triangles (bounding box, node normals for smooth
+//! shading, then triangles with their edge overlay, if enabled), so that
+//! building of a huge mesh is spread over many frames by SlicedMeshBuilder.
+//! Compute() of the shading mode only attaches arrays of the finished
+//! chunks, showing the bounding box until the first one is ready. Other
+//! display modes and selection are those of MeshVS_Mesh with the same data
+//! source.
+class SlicedMeshPrs : public MeshVS_Mesh {
+  DEFINE_STANDARD_RTTIEXT(SlicedMeshPrs, MeshVS_Mesh)
+public:
+  //! Number of triangles (or nodes) processed by one work unit.
+  static const int THE_UNIT_SIZE = 16384;
+
+public:
+  SlicedMeshPrs();
+
+  //! Return TRUE if all work units have been executed.
+  bool IsBuilt() const { return myStage == Stage_Done; }
+
+  //! Return building progress within [0, 1] range.
+  double Progress() const;
+
+  //! Return number of finished chunks of triangles.
+  int NbChunks() const { return myTriangles.Length(); }
+
+  //! Mark presentation as built by SlicedMeshBuilder; otherwise Compute()
+  //! executes all work units at once.
+  void SetScheduled(bool theIsScheduled) { myIsScheduled = theIsScheduled; }
+
+  //! Execute work units until the time budget is spent;
+  //! at least one unit is executed.
+  //! @param theBudget [in] time budget in milliseconds
+  void Build(double theBudget);
+
+  //! Compute shaded presentation from the finished chunks.
+  virtual void Compute(const Handle(PrsMgr_PresentationManager) & thePrsMgr,
+                       const Handle(Prs3d_Presentation) & thePrs,
+                       const Standard_Integer theMode) override;
+
+private:
+  //! Building stage.
+  enum Stage {
+    Stage_Init,      //!< triangulation is not taken from data source yet
+    Stage_Bounds,    //!< collecting bounding box of nodes
+    Stage_Normals,   //!< accumulating facet normals at nodes
+    Stage_Normalize, //!< normalizing node normals
+    Stage_Triangles, //!< filling arrays of triangles
+    Stage_Done
+  };
+
+  //! Execute the next work unit.
+  void buildUnit();
+
+  //! Fill arrays of the next chunk of triangles.
+  void buildChunk(int theFirst, int theLast);
+
+private:
+  Handle(Poly_Triangulation) myTriangulation;
+  std::vector<float> myNormals; //!< node normals, for smooth shading only
+  NCollection_Sequence<Handle(Graphic3d_ArrayOfPrimitives)> myTriangles;
+  NCollection_Sequence<Handle(Graphic3d_ArrayOfPrimitives)> myEdges;
+  Bnd_Box myBox;       //!< placeholder shown until the first chunk is ready
+  Stage myStage;
+  int myNext;          //!< first triangle or node of the next unit, 1-based
+  int myNbUnitsDone;
+  int myNbUnits;
+  bool myIsSmooth;     //!< MeshVS_DA_SmoothShading of the drawer
+  bool myToShowEdges;  //!< MeshVS_DA_ShowEdges of the drawer
+  bool myIsScheduled;
+};
+
+class SlicedMeshBuilder;
+DEFINE_STANDARD_HANDLE(SlicedMeshBuilder, Standard_Transient)
+
+//! Time-sliced building of mesh presentations.
+//! Work units of pending presentations (see SlicedMeshPrs) are executed
+//! within a per-frame time budget, oldest presentation first, so that the
+//! view keeps responding to navigation while a huge mesh is being built.
+//! Objects are recomputed each time the number of finished chunks doubles,
+//! so that the mesh grows on the screen while all uploads together stay
+//! within twice the mesh size. Shared masters are built once for all objects
+//! displaying them.
+class SlicedMeshBuilder : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(SlicedMeshBuilder, Standard_Transient)
+public:
+  //! @param theBudget [in] time budget per frame in milliseconds
+  SlicedMeshBuilder(double theBudget = 8.0);
+
+  //! Set time budget per frame in milliseconds.
+  void SetBudget(double theBudget) { myBudget = theBudget; }
+
+  //! Return time budget per frame in milliseconds.
+  double Budget() const { return myBudget; }
+
+  //! Schedule presentations displayed by the object; should be called
+  //! before the object is displayed.
+  void Add(const Handle(AIS_InteractiveObject) & thePrs);
+
+  //! Drop all pending presentations.
+  void Clear();
+
+  //! Return TRUE if there are presentations not yet built.
+  bool HasPending() const { return !myTargets.empty(); }
+
+  //! Return number of presentations not yet built.
+  int NbPending() const { return (int)myTargets.size(); }
+
+  //! Return progress of pending presentations within [0, 1] range.
+  double Progress() const;
+
+  //! Execute work units within the time budget and recompute objects
+  //! displaying presentations with enough new chunks. Presentations of
+  //! removed objects are dropped.
+  //! @return TRUE if objects have been recomputed
+  bool BuildSlice(const Handle(AIS_InteractiveContext) & theCtx);
+
+private:
+  //! Presentation being built.
+  struct Target {
+    Handle(SlicedMeshPrs) Mesh;
+    std::vector<Handle(AIS_InteractiveObject)> Objects; //!< displaying it
+    int NbShown; //!< chunks shown by the last recomputation
+  };
+
+  //! Recompute objects displaying the presentation.
+  void showTarget(Target &theTarget,
+                  const Handle(AIS_InteractiveContext) & theCtx);
+
+private:
+  std::vector<Target> myTargets;
+  std::unordered_map<const SlicedMeshPrs *, int> myTargetIndices;
+  double myBudget;
+};
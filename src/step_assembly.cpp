@@ -0,0 +1,603 @@
+#include "step_assembly.h"
+
+#include <AIS_MultipleConnectedInteractive.hxx>
+#include <BinXCAFDrivers.hxx>
+#include <NCollection_DataMap.hxx>
+#include <OSD_Timer.hxx>
+#include <PCDM_ReaderFilter.hxx>
+#include <Standard_Failure.hxx>
+#include <RWGltf_CafReader.hxx>
+#include <STEPCAFControl_Controller.hxx>
+#include <STEPCAFControl_Reader.hxx>
+#include <TDF_LabelMapHasher.hxx>
+#include <TDF_LabelSequence.hxx>
+#include <TDataStd_Name.hxx>
+#include <TDocStd_Document.hxx>
+#include <XCAFApp_Application.hxx>
+#include <XCAFDoc_ColorTool.hxx>
+#include <XCAFDoc_DocumentTool.hxx>
+#include <XCAFDoc_ShapeTool.hxx>
+#include <XCAFDoc_VisMaterial.hxx>
+#include <XCAFDoc_VisMaterialTool.hxx>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include "help_algorithms.h"
+#include "lazy_part_mesher.h"
+#include "model_factory.h"
+#include "trace_events.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(StepAssembly, Standard_Transient)
+
+namespace {
+
+//! Auxiliary tool collecting assembly tree from XCAF document.
+class AssemblyExplorer {
+public:
+  AssemblyExplorer(const Handle(TDocStd_Document) & theDoc,
+                   std::vector<StepAssembly::Node> &theNodes,
+                   std::vector<StepAssembly::Part> &theParts)
+      : myColorTool(XCAFDoc_DocumentTool::ColorTool(theDoc->Main())),
+        myMatTool(XCAFDoc_DocumentTool::VisMaterialTool(theDoc->Main())),
+        myNodes(theNodes), myParts(theParts) {}
+
+  //! Add node of the label and its sub-tree.
+  void Add(const TDF_Label &theLabel, int theParent) {
+    TDF_Label aRefLabel = theLabel;
+    gp_Trsf aLocation;
+    if (XCAFDoc_ShapeTool::IsReference(theLabel)) {
+      XCAFDoc_ShapeTool::GetReferredShape(theLabel, aRefLabel);
+      aLocation = XCAFDoc_ShapeTool::GetLocation(theLabel).Transformation();
+    } else if (!XCAFDoc_ShapeTool::IsAssembly(theLabel)) {
+      // free part may be located itself
+      aLocation =
+          XCAFDoc_ShapeTool::GetShape(theLabel).Location().Transformation();
+    }
+
+    StepAssembly::Node aNode;
+    aNode.Parent = theParent;
+    aNode.Location = aLocation;
+    if (!findName(theLabel, aNode.Name)) {
+      findName(aRefLabel, aNode.Name);
+    }
+    // instance color overrides part color, which overrides inherited one
+    if (findColor(theLabel, aNode.Color) || findColor(aRefLabel, aNode.Color)) {
+      aNode.HasColor = true;
+    } else if (theParent >= 0 && myNodes[theParent].HasColor) {
+      aNode.Color = myNodes[theParent].Color;
+      aNode.HasColor = true;
+    }
+
+    const int aNodeIndex = (int)myNodes.size();
+    if (!XCAFDoc_ShapeTool::IsAssembly(aRefLabel)) {
+      aNode.Part = partIndex(aRefLabel);
+      ++myParts[aNode.Part].NbInstances;
+      myNodes.push_back(aNode);
+      return;
+    }
+
+    myNodes.push_back(aNode);
+    TDF_LabelSequence aComponents;
+    XCAFDoc_ShapeTool::GetComponents(aRefLabel, aComponents);
+    for (TDF_LabelSequence::Iterator aCompIter(aComponents); aCompIter.More();
+         aCompIter.Next()) {
+      Add(aCompIter.Value(), aNodeIndex);
+    }
+  }
+
+private:
+  //! Return index of the part, adding it on the first use.
+  int partIndex(const TDF_Label &theLabel) {
+    if (const int *anIndex = myPartIndices.Seek(theLabel)) {
+      return *anIndex;
+    }
+
+    StepAssembly::Part aPart;
+    findName(theLabel, aPart.Name);
+    aPart.Shape =
+        XCAFDoc_ShapeTool::GetShape(theLabel).Located(TopLoc_Location());
+    myParts.push_back(aPart);
+    myPartIndices.Bind(theLabel, (int)myParts.size() - 1);
+    return (int)myParts.size() - 1;
+  }
+
+  //! Find name attribute of the label.
+  static bool findName(const TDF_Label &theLabel,
+                       TCollection_AsciiString &theName) {
+    Handle(TDataStd_Name) aName;
+    if (!theLabel.FindAttribute(TDataStd_Name::GetID(), aName)) {
+      return false;
+    }
+    theName = TCollection_AsciiString(aName->Get());
+    return true;
+  }
+
+  //! Find surface or generic color of the label, or base color of its
+  //! visualization material (as assigned by glTF reader).
+  bool findColor(const TDF_Label &theLabel, Quantity_ColorRGBA &theColor) {
+    if (myColorTool->GetColor(theLabel, XCAFDoc_ColorSurf, theColor) ||
+        myColorTool->GetColor(theLabel, XCAFDoc_ColorGen, theColor)) {
+      return true;
+    }
+    Handle(XCAFDoc_VisMaterial) aMat = myMatTool->GetShapeMaterial(theLabel);
+    if (aMat.IsNull() || aMat->IsEmpty()) {
+      return false;
+    }
+    theColor = aMat->BaseColor();
+    return true;
+  }
+
+private:
+  Handle(XCAFDoc_ColorTool) myColorTool;
+  Handle(XCAFDoc_VisMaterialTool) myMatTool;
+  std::vector<StepAssembly::Node> &myNodes;
+  std::vector<StepAssembly::Part> &myParts;
+  NCollection_DataMap<TDF_Label, int, TDF_LabelMapHasher> myPartIndices;
+};
+
+//! Append plain value to binary blob.
+template <typename T>
+void appendValue(std::string &theData, const T &theValue) {
+  theData.append(reinterpret_cast<const char *>(&theValue), sizeof(T));
+}
+
+//! Append string prefixed by its length to binary blob.
+void appendString(std::string &theData,
+                  const TCollection_AsciiString &theString) {
+  appendValue(theData, (uint32_t)theString.Length());
+  theData.append(theString.ToCString(), theString.Length());
+}
+
+//! Read plain value of binary blob, checking its bounds.
+template <typename T>
+bool readValue(const std::string &theData, size_t &thePos, T &theValue) {
+  if (theData.size() - thePos < sizeof(T)) {
+    return false;
+  }
+  memcpy(&theValue, theData.data() + thePos, sizeof(T));
+  thePos += sizeof(T);
+  return true;
+}
+
+//! Read string prefixed by its length.
+bool readString(const std::string &theData, size_t &thePos,
+                TCollection_AsciiString &theString) {
+  uint32_t aLength = 0;
+  if (!readValue(theData, thePos, aLength) ||
+      theData.size() - thePos < aLength) {
+    return false;
+  }
+  theString = TCollection_AsciiString(theData.data() + thePos, (int)aLength);
+  thePos += aLength;
+  return true;
+}
+
+//! Return XCAF application with binary XCAF format defined.
+//! To be called with XcafMutex() locked.
+Handle(XCAFApp_Application) binXcafApplication() {
+  Handle(XCAFApp_Application) anApp = XCAFApp_Application::GetApplication();
+  static bool isFormatDefined = false;
+  if (!isFormatDefined) {
+    BinXCAFDrivers::DefineFormat(anApp);
+    isFormatDefined = true;
+  }
+  return anApp;
+}
+
+} // namespace
+
+// ================================================================
+// Function : Load
+// Purpose  :
+// ================================================================
+bool StepAssembly::Load(std::istream &theStream, const std::string &theName,
+                        const Message_ProgressRange &theProgress,
+                        ModelLoadStats *theStats) {
+  myNodes.clear();
+  myParts.clear();
+
+  Handle(XCAFApp_Application) anApp;
+  Handle(TDocStd_Document) aDoc;
+  {
+    std::lock_guard<std::mutex> aLock(XcafMutex());
+    STEPCAFControl_Controller::Init();
+    anApp = XCAFApp_Application::GetApplication();
+    anApp->NewDocument("BinXCAF", aDoc);
+  }
+
+  OSD_Timer aTimer;
+  aTimer.Start();
+  STEPCAFControl_Reader aReader;
+  aReader.SetColorMode(true);
+  aReader.SetNameMode(true);
+  aReader.SetLayerMode(false);
+  aReader.SetPropsMode(false);
+  bool isDone = false;
+  {
+    TRACE_SCOPE("parse STEP");
+    isDone = aReader.ChangeReader().ReadStream(theName.c_str(), theStream) ==
+             IFSelect_RetDone;
+  }
+  if (theStats != nullptr) {
+    theStats->ReadTime += aTimer.ElapsedTime();
+    aTimer.Reset();
+    aTimer.Start();
+  }
+
+  if (isDone) {
+    TRACE_SCOPE("transfer STEP");
+    isDone = aReader.Transfer(aDoc, theProgress);
+  }
+  if (isDone) {
+    explore(aDoc);
+  }
+  if (theStats != nullptr) {
+    theStats->TransferTime += aTimer.ElapsedTime();
+  }
+
+  {
+    // part shapes are kept, the document is not needed anymore
+    std::lock_guard<std::mutex> aLock(XcafMutex());
+    anApp->Close(aDoc);
+  }
+  return isDone && !myParts.empty();
+}
+
+// ================================================================
+// Function : LoadXbf
+// Purpose  :
+// ================================================================
+bool StepAssembly::LoadXbf(std::istream &theStream,
+                           const Message_ProgressRange &theProgress,
+                           ModelLoadStats *theStats) {
+  myNodes.clear();
+  myParts.clear();
+
+  OSD_Timer aTimer;
+  aTimer.Start();
+  Handle(XCAFApp_Application) anApp;
+  Handle(TDocStd_Document) aDoc;
+  PCDM_ReaderStatus aStatus = PCDM_RS_OpenError;
+  {
+    // application keeps the list of open documents
+    TRACE_SCOPE("parse XBF");
+    std::lock_guard<std::mutex> aLock(XcafMutex());
+    anApp = binXcafApplication();
+    aStatus = anApp->Open(theStream, aDoc, Handle(PCDM_ReaderFilter)(),
+                          theProgress);
+  }
+  if (aStatus == PCDM_RS_OK) {
+    explore(aDoc);
+  }
+  if (theStats != nullptr) {
+    theStats->ReadTime += aTimer.ElapsedTime();
+  }
+
+  if (!aDoc.IsNull()) {
+    std::lock_guard<std::mutex> aLock(XcafMutex());
+    anApp->Close(aDoc);
+  }
+  return aStatus == PCDM_RS_OK && !myParts.empty();
+}
+
+// ================================================================
+// Function : SaveXbf
+// Purpose  :
+// ================================================================
+bool StepAssembly::SaveXbf(const TopoDS_Shape &theShape,
+                           std::ostream &theStream) {
+  std::lock_guard<std::mutex> aLock(XcafMutex());
+  Handle(XCAFApp_Application) anApp = binXcafApplication();
+  Handle(TDocStd_Document) aDoc;
+  anApp->NewDocument("BinXCAF", aDoc);
+  XCAFDoc_DocumentTool::ShapeTool(aDoc->Main())->AddShape(theShape);
+  const bool isDone = anApp->SaveAs(aDoc, theStream) == PCDM_SS_OK;
+  anApp->Close(aDoc);
+  return isDone && theStream.good();
+}
+
+// ================================================================
+// Function : LoadGltf
+// Purpose  :
+// ================================================================
+bool StepAssembly::LoadGltf(const TCollection_AsciiString &thePath,
+                            const Message_ProgressRange &theProgress,
+                            ModelLoadStats *theStats) {
+  myNodes.clear();
+  myParts.clear();
+
+  Handle(XCAFApp_Application) anApp;
+  Handle(TDocStd_Document) aDoc;
+  {
+    std::lock_guard<std::mutex> aLock(XcafMutex());
+    anApp = XCAFApp_Application::GetApplication();
+    anApp->NewDocument("BinXCAF", aDoc);
+  }
+
+  OSD_Timer aTimer;
+  aTimer.Start();
+  RWGltf_CafReader aReader;
+  aReader.SetDocument(aDoc);
+  aReader.SetParallel(true);
+  // data is loaded at once, the file is not needed afterwards
+  aReader.SetToKeepLateData(false);
+  aReader.SetSystemCoordinateSystem(RWMesh_CoordinateSystem_Zup);
+  bool isDone = false;
+  {
+    TRACE_SCOPE("parse glTF");
+    isDone = aReader.Perform(thePath, theProgress);
+  }
+  if (isDone) {
+    explore(aDoc);
+  }
+  if (theStats != nullptr) {
+    theStats->ReadTime += aTimer.ElapsedTime();
+  }
+
+  {
+    std::lock_guard<std::mutex> aLock(XcafMutex());
+    anApp->Close(aDoc);
+  }
+  return isDone && !myParts.empty();
+}
+
+// ================================================================
+// Function : XcafMutex
+// Purpose  :
+// ================================================================
+std::mutex &StepAssembly::XcafMutex() {
+  // guards also static STEP controller, which is not initialized
+  // thread-safely
+  static std::mutex THE_XCAF_MUTEX;
+  return THE_XCAF_MUTEX;
+}
+
+// ================================================================
+// Function : explore
+// Purpose  :
+// ================================================================
+void StepAssembly::explore(const Handle(TDocStd_Document) & theDoc) {
+  Handle(XCAFDoc_ShapeTool) aShapeTool =
+      XCAFDoc_DocumentTool::ShapeTool(theDoc->Main());
+  TDF_LabelSequence aRoots;
+  aShapeTool->GetFreeShapes(aRoots);
+  AssemblyExplorer anExplorer(theDoc, myNodes, myParts);
+  for (TDF_LabelSequence::Iterator aRootIter(aRoots); aRootIter.More();
+       aRootIter.Next()) {
+    anExplorer.Add(aRootIter.Value(), -1);
+  }
+}
+
+// ================================================================
+// Function : PartShapes
+// Purpose  :
+// ================================================================
+void StepAssembly::PartShapes(
+    NCollection_Sequence<TopoDS_Shape> &theShapes) const {
+  for (const Part &aPart : myParts) {
+    theShapes.Append(aPart.Shape);
+  }
+}
+
+// ================================================================
+// Function : SetPartShapes
+// Purpose  :
+// ================================================================
+bool StepAssembly::SetPartShapes(
+    const NCollection_Sequence<TopoDS_Shape> &theShapes) {
+  if (theShapes.Size() != (int)myParts.size()) {
+    return false;
+  }
+
+  int aPartIndex = 0;
+  for (NCollection_Sequence<TopoDS_Shape>::Iterator aShapeIter(theShapes);
+       aShapeIter.More(); aShapeIter.Next(), ++aPartIndex) {
+    myParts[aPartIndex].Shape = aShapeIter.Value();
+  }
+  return true;
+}
+
+// ================================================================
+// Function : EncodeTree
+// Purpose  :
+// ================================================================
+void StepAssembly::EncodeTree(std::string &theData) const {
+  appendValue(theData, (uint32_t)myParts.size());
+  for (const Part &aPart : myParts) {
+    appendString(theData, aPart.Name);
+    appendValue(theData, (int32_t)aPart.NbInstances);
+  }
+
+  appendValue(theData, (uint32_t)myNodes.size());
+  for (const Node &aNode : myNodes) {
+    appendString(theData, aNode.Name);
+    appendValue(theData, (int32_t)aNode.Parent);
+    appendValue(theData, (int32_t)aNode.Part);
+    for (int aRow = 1; aRow <= 3; ++aRow) {
+      for (int aCol = 1; aCol <= 4; ++aCol) {
+        appendValue(theData, aNode.Location.Value(aRow, aCol));
+      }
+    }
+    const Quantity_Color &aColor = aNode.Color.GetRGB();
+    const float aRgba[4] = {(float)aColor.Red(), (float)aColor.Green(),
+                            (float)aColor.Blue(), aNode.Color.Alpha()};
+    appendValue(theData, aRgba);
+    appendValue(theData, (uint8_t)(aNode.HasColor ? 1 : 0));
+  }
+}
+
+// ================================================================
+// Function : DecodeTree
+// Purpose  :
+// ================================================================
+bool StepAssembly::DecodeTree(const std::string &theData) {
+  myNodes.clear();
+  myParts.clear();
+  size_t aPos = 0;
+  uint32_t aNbParts = 0;
+  if (!readValue(theData, aPos, aNbParts) ||
+      aNbParts > theData.size() - aPos) {
+    return false;
+  }
+  myParts.resize(aNbParts);
+  for (Part &aPart : myParts) {
+    int32_t aNbInstances = 0;
+    if (!readString(theData, aPos, aPart.Name) ||
+        !readValue(theData, aPos, aNbInstances)) {
+      return false;
+    }
+    aPart.NbInstances = aNbInstances;
+  }
+
+  uint32_t aNbNodes = 0;
+  if (!readValue(theData, aPos, aNbNodes) ||
+      aNbNodes > theData.size() - aPos) {
+    return false;
+  }
+  myNodes.resize(aNbNodes);
+  for (uint32_t aNodeIter = 0; aNodeIter < aNbNodes; ++aNodeIter) {
+    Node &aNode = myNodes[aNodeIter];
+    int32_t aParent = -1, aPart = -1;
+    double aMat[12];
+    float aRgba[4];
+    uint8_t aHasColor = 0;
+    if (!readString(theData, aPos, aNode.Name) ||
+        !readValue(theData, aPos, aParent) ||
+        !readValue(theData, aPos, aPart) || !readValue(theData, aPos, aMat) ||
+        !readValue(theData, aPos, aRgba) ||
+        !readValue(theData, aPos, aHasColor)) {
+      return false;
+    }
+    // parent precedes its children, see Nodes()
+    if (aParent < -1 || aParent >= (int32_t)aNodeIter || aPart < -1 ||
+        aPart >= (int32_t)aNbParts) {
+      return false;
+    }
+    try {
+      aNode.Location.SetValues(aMat[0], aMat[1], aMat[2], aMat[3], aMat[4],
+                               aMat[5], aMat[6], aMat[7], aMat[8], aMat[9],
+                               aMat[10], aMat[11]);
+    } catch (const Standard_Failure &) {
+      return false;
+    }
+    aNode.Parent = aParent;
+    aNode.Part = aPart;
+    aNode.Color = Quantity_ColorRGBA(aRgba[0], aRgba[1], aRgba[2], aRgba[3]);
+    aNode.HasColor = aHasColor != 0;
+  }
+  return aPos == theData.size() && !myParts.empty();
+}
+
+// ================================================================
+// Function : CreatePresentation
+// Purpose  :
+// ================================================================
+Handle(AIS_InteractiveObject) StepAssembly::CreatePresentation() {
+  TRACE_SCOPE("assembly presentation");
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  Handle(AIS_MultipleConnectedInteractive) anAssemblyPrs =
+      new AIS_MultipleConnectedInteractive();
+
+  // one master per part and color
+  std::map<std::pair<int, std::string>, Handle(AIS_InteractiveObject)>
+      aMasters;
+  std::vector<bool> isMeshed(myParts.size());
+  for (size_t aPartIter = 0; aPartIter < myParts.size(); ++aPartIter) {
+    isMeshed[aPartIter] =
+        ModelFactory::IsTriangulated(myParts[aPartIter].Shape);
+  }
+  std::vector<gp_Trsf> aWorldTrsfs(myNodes.size());
+  for (size_t aNodeIter = 0; aNodeIter < myNodes.size(); ++aNodeIter) {
+    const Node &aNode = myNodes[aNodeIter];
+    aWorldTrsfs[aNodeIter] =
+        aNode.Parent >= 0
+            ? aWorldTrsfs[aNode.Parent].Multiplied(aNode.Location)
+            : aNode.Location;
+    if (aNode.Part < 0 || myParts[aNode.Part].Shape.IsNull()) {
+      continue;
+    }
+
+    const std::string aColorKey =
+        aNode.HasColor ? Quantity_ColorRGBA::ColorToHex(aNode.Color).ToCString()
+                       : "";
+    Handle(AIS_InteractiveObject) &aMaster =
+        aMasters[std::make_pair(aNode.Part, aColorKey)];
+    if (aMaster.IsNull()) {
+      const TopoDS_Shape &aShape = myParts[aNode.Part].Shape;
+      if (isMeshed[aNode.Part]) {
+        aMaster = aFactory->CreateMeshedShape(aShape);
+      } else {
+        aMaster = new LazyPartPrs(aShape);
+      }
+      if (aNode.HasColor) {
+        aMaster->SetColor(aNode.Color.GetRGB());
+        if (aNode.Color.Alpha() < 1.0f) {
+          aMaster->SetTransparency(1.0 - aNode.Color.Alpha());
+        }
+      }
+    }
+    anAssemblyPrs->Connect(aMaster, aWorldTrsfs[aNodeIter]);
+  }
+
+  for (Part &aPart : myParts) {
+    aPart.Shape.Nullify();
+  }
+  anAssemblyPrs->SetDisplayMode(AIS_Shaded);
+  anAssemblyPrs->SetOwner(this);
+  return anAssemblyPrs;
+}
+
+// ================================================================
+// Function : ToJson
+// Purpose  :
+// ================================================================
+std::string StepAssembly::ToJson() const {
+  std::vector<std::vector<int>> aChildren(myNodes.size());
+  std::vector<int> aRoots;
+  for (size_t aNodeIter = 0; aNodeIter < myNodes.size(); ++aNodeIter) {
+    const int aParent = myNodes[aNodeIter].Parent;
+    (aParent >= 0 ? aChildren[aParent] : aRoots).push_back((int)aNodeIter);
+  }
+
+  std::ostringstream aStream;
+  aStream << "[";
+  for (size_t aRootIter = 0; aRootIter < aRoots.size(); ++aRootIter) {
+    aStream << (aRootIter > 0 ? "," : "");
+    writeNode(aStream, aRoots[aRootIter], aChildren);
+  }
+  aStream << "]";
+  return aStream.str();
+}
+
+// ================================================================
+// Function : writeNode
+// Purpose  :
+// ================================================================
+void StepAssembly::writeNode(
+    std::ostream &theStream, int theNode,
+    const std::vector<std::vector<int>> &theChildren) const {
+  const Node &aNode = myNodes[theNode];
+  theStream << "{\"name\":";
+  write_json_string(theStream, aNode.Name.ToCString());
+  if (aNode.HasColor) {
+    theStream << ",\"color\":\""
+              << Quantity_ColorRGBA::ColorToHex(aNode.Color).ToCString()
+              << "\"";
+  }
+  if (aNode.Part >= 0) {
+    theStream << ",\"part\":" << aNode.Part << ",\"instances\":"
+              << myParts[aNode.Part].NbInstances << "}";
+    return;
+  }
+
+  theStream << ",\"children\":[";
+  const std::vector<int> &aChildren = theChildren[theNode];
+  for (size_t aChildIter = 0; aChildIter < aChildren.size(); ++aChildIter) {
+    theStream << (aChildIter > 0 ? "," : "");
+    writeNode(theStream, aChildren[aChildIter], theChildren);
+  }
+  theStream << "]}";
+}
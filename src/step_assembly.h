@@ -0,0 +1,124 @@
+#pragma once
+
+#include <AIS_InteractiveObject.hxx>
+#include <Message_ProgressRange.hxx>
+#include <NCollection_Sequence.hxx>
+#include <Quantity_ColorRGBA.hxx>
+#include <Standard_Transient.hxx>
+#include <TCollection_AsciiString.hxx>
+#include <TDocStd_Document.hxx>
+#include <TopoDS_Shape.hxx>
+#include <gp_Trsf.hxx>
+
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct ModelLoadStats;
+
+class StepAssembly;
+DEFINE_STANDARD_HANDLE(StepAssembly, Standard_Transient)
+
+//! Assembly tree of STEP model read with STEPCAFControl_Reader,
+//! of XCAF document stored in binary XBF format, or of glTF scene.
+//! Each unique part is kept once as a prototype located at origin, while
+//! tree nodes refer to it with their own location, name and color.
+//! Presentation displays every part prototype once and connects located
+//! instances of it, so that memory does not grow with the number of copies.
+class StepAssembly : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(StepAssembly, Standard_Transient)
+public:
+  //! Node of the assembly tree.
+  struct Node {
+    TCollection_AsciiString Name;
+    int Parent = -1;  //!< index of the parent node, -1 for roots
+    int Part = -1;    //!< index of the part, -1 for sub-assemblies
+    gp_Trsf Location; //!< location relative to the parent node
+    Quantity_ColorRGBA Color; //!< own or inherited color
+    bool HasColor = false;
+  };
+
+  //! Unique part shape.
+  struct Part {
+    TCollection_AsciiString Name;
+    TopoDS_Shape Shape; //!< prototype located at origin
+    int NbInstances = 0;
+  };
+
+public:
+  StepAssembly() {}
+
+  //! Read assembly structure, names, colors and part shapes.
+  //! Nodes are ordered so that parent precedes its children.
+  bool Load(std::istream &theStream, const std::string &theName,
+            const Message_ProgressRange &theProgress = Message_ProgressRange(),
+            ModelLoadStats *theStats = nullptr);
+
+  //! Read assembly structure, names, colors and part shapes from binary
+  //! XCAF document. Triangulations stored within the document are kept.
+  bool LoadXbf(std::istream &theStream,
+               const Message_ProgressRange &theProgress = Message_ProgressRange(),
+               ModelLoadStats *theStats = nullptr);
+
+  //! Write the shape with its triangulation as binary XCAF document,
+  //! to be read back with LoadXbf().
+  static bool SaveXbf(const TopoDS_Shape &theShape, std::ostream &theStream);
+
+  //! Read scene nodes, names, colors and meshes of glTF file (.gltf or .glb).
+  //! Buffer views are decoded by RWGltf_CafReader straight into part
+  //! triangulations, so that parts are displayed without meshing.
+  bool LoadGltf(const TCollection_AsciiString &thePath,
+                const Message_ProgressRange &theProgress = Message_ProgressRange(),
+                ModelLoadStats *theStats = nullptr);
+
+  //! Return mutex guarding XCAF application, which is shared by document
+  //! readers and writers and is not thread-safe.
+  static std::mutex &XcafMutex();
+
+  //! Return tree nodes.
+  const std::vector<Node> &Nodes() const { return myNodes; }
+
+  //! Return unique parts.
+  const std::vector<Part> &Parts() const { return myParts; }
+
+  //! Return shapes of the parts, in the order of Parts().
+  void PartShapes(NCollection_Sequence<TopoDS_Shape> &theShapes) const;
+
+  //! Replace shapes of the parts, e.g. by ones restored from mesh cache.
+  //! @return FALSE if number of shapes does not match number of parts
+  bool SetPartShapes(const NCollection_Sequence<TopoDS_Shape> &theShapes);
+
+  //! Write tree nodes and parts without their shapes into binary blob,
+  //! to be kept next to part meshes in the mesh cache.
+  void EncodeTree(std::string &theData) const;
+
+  //! Restore tree nodes and parts written by EncodeTree(); part shapes are
+  //! then to be set by SetPartShapes().
+  //! @return FALSE if data is malformed
+  bool DecodeTree(const std::string &theData);
+
+  //! Create presentation of the whole assembly.
+  //! Part shapes should be meshed beforehand, otherwise parts are displayed
+  //! by placeholders (see LazyPartPrs). Shapes are released afterwards,
+  //! as presentation keeps them. The assembly becomes owner of the
+  //! presentation, see AIS_InteractiveObject::GetOwner().
+  Handle(AIS_InteractiveObject) CreatePresentation();
+
+  //! Return assembly tree as JSON array of root nodes; each node has name,
+  //! color (if any) and either children or part index.
+  std::string ToJson() const;
+
+private:
+  //! Collect tree nodes and parts of XCAF document.
+  void explore(const Handle(TDocStd_Document) & theDoc);
+
+  //! Write node with its children.
+  void writeNode(std::ostream &theStream, int theNode,
+                 const std::vector<std::vector<int>> &theChildren) const;
+
+private:
+  std::vector<Node> myNodes;
+  std::vector<Part> myParts;
+};
@@ -22,6 +22,8 @@
 #include <regex>
 #include <tuple>
 
+#include "trace_events.h"
+
 using namespace std;
 
 bool ExtractPoint3D(string& line, regex& exp, Point3D<float>& newPoint);
@@ -31,6 +33,7 @@ StlFile::StlFile() {}
 StlFile::~StlFile() {}
 
 bool StlFile::LoadFromStream(std::istream& is) {
+  TRACE_SCOPE("parse STL");
   if (!LoadBinaryFormatStream(is)) {
     is.seekg(0);
     if (!LoadAsciiFormatStream(is)) {
@@ -187,8 +190,10 @@ bool ExtractPoint3D(string& line, regex& exp, Point3D<float>& newPoint) {
 }
 
 void StlFile::ToIndexedData(std::vector<float>& vertexes,
-                            std::vector<unsigned int>& indexes) {
-  std::vector<size_t> sequence(m_vecFacets.size() * 3);
+                            std::vector<unsigned int>& indexes,
+                            std::pmr::memory_resource* arena) {
+  TRACE_SCOPE("weld");
+  std::pmr::vector<size_t> sequence(m_vecFacets.size() * 3, arena);
   for (size_t i = 0; i < sequence.size(); i++) {
     sequence[i] = i;
   }
@@ -197,7 +202,7 @@ void StlFile::ToIndexedData(std::vector<float>& vertexes,
 
   // sort by vertex position
   std::sort(sequence.begin(), sequence.end(),
-            [faces](const size_t a, const size_t b) {
+            [&faces](const size_t a, const size_t b) {
               auto& aPos = faces[a / 3].Vertexes[a % 3].Coords;
               auto& bPos = faces[b / 3].Vertexes[b % 3].Coords;
 
@@ -214,7 +219,7 @@ void StlFile::ToIndexedData(std::vector<float>& vertexes,
             });
 
   // look for the overlapped vertexes
-  std::vector<size_t> dupMap(sequence.size());
+  std::pmr::vector<size_t> dupMap(sequence.size(), arena);
   size_t mapTo = 0;
   size_t vertexNumber = 0;
   float p[] = {std::numeric_limits<float>::min(),
@@ -12,6 +12,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -85,8 +86,17 @@ class StlFile {
 
   std::string get_Header();
 
-  void ToIndexedData(std::vector<float>& vertexes,
-                     std::vector<unsigned int>& indexes);
+  //! Take ownership of already decoded facets.
+  void set_Facets(std::vector<Triangle3D<float>>&& facets) {
+    m_vecFacets = std::move(facets);
+  }
+
+  //! Merge coincident vertexes.
+  //! @param arena memory for temporary buffers, which may be shared by
+  //!              several algorithms of one load and released at once
+  void ToIndexedData(
+      std::vector<float>& vertexes, std::vector<unsigned int>& indexes,
+      std::pmr::memory_resource* arena = std::pmr::get_default_resource());
 
  private:
   bool LoadBinaryFormatStream(std::istream& is);
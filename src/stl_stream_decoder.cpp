@@ -0,0 +1,330 @@
+#include "stl_stream_decoder.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#include "chunk_source.h"
+#include "trace_events.h"
+
+namespace {
+
+// Binary STL sizes
+const size_t THE_STL_HEADER_SIZE = 84;
+const size_t THE_STL_SIZEOF_FACET = 50;
+
+// Number of leading bytes inspected to guess the format
+const size_t THE_DETECT_SIZE = 512;
+
+// Facets reserved up front when the stream size is unknown; the facet
+// count of the header is not trusted beyond it
+const size_t THE_MAX_RESERVED_FACETS = 1 << 20;
+
+static_assert(sizeof(Triangle3D<float>) == THE_STL_SIZEOF_FACET,
+              "Triangle3D should match binary STL facet layout");
+
+bool startsWithSolid(const std::string& data) {
+  size_t pos = data.find_first_not_of(" \t\r\n");
+  return pos != std::string::npos && data.compare(pos, 5, "solid") == 0;
+}
+
+bool isTextData(const std::string& data, size_t len) {
+  for (size_t i = 0; i < len && i < data.size(); i++) {
+    unsigned char c = static_cast<unsigned char>(data[i]);
+    if (c == 0 || c > 127) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parse up to 3 float values following the keyword.
+int readFloats(const char* beg, const char* end, Point3D<float>& pnt) {
+  std::string str(beg, end);
+  const char* cur = str.c_str();
+  int i = 0;
+  for (; i < 3; i++) {
+    char* next = nullptr;
+    float value = strtof(cur, &next);
+    if (next == cur) {
+      break;
+    }
+    pnt.Coords[i] = value;
+    cur = next;
+  }
+  return i;
+}
+
+}  // namespace
+
+StlStreamDecoder::StlStreamDecoder(size_t facetsPerNotify,
+                                   FacetsCallback callback)
+    : m_nFacetsPerNotify(facetsPerNotify),
+      m_callback(callback),
+      m_nExpectedSize(0),
+      m_nNotified(0),
+      m_eFormat(Format::Unknown),
+      m_bFailed(false),
+      m_bFinished(false),
+      m_nBinaryFacets(0),
+      m_bBinaryHeaderDone(false),
+      m_nCurVertex(0) {}
+
+StlStreamDecoder::~StlStreamDecoder() {}
+
+std::vector<Triangle3D<float>> StlStreamDecoder::DetachFacets() {
+  std::vector<Triangle3D<float>> facets;
+  facets.swap(m_vecFacets);
+  m_nNotified = 0;
+  return facets;
+}
+
+bool StlStreamDecoder::Feed(const char* data, size_t len) {
+  TRACE_SCOPE("decode STL chunk");
+  if (m_bFailed || m_bFinished) {
+    return false;
+  }
+
+  if (m_eFormat == Format::Unknown) {
+    m_strPending.append(data, len);
+    if (!detectFormat(false)) {
+      return true;  // need more data
+    }
+    std::string buffered;
+    buffered.swap(m_strPending);
+    data = buffered.data();
+    len = buffered.size();
+    bool isOk = IsAscii() ? feedAscii(data, len) : feedBinary(data, len);
+    notify(false);
+    return isOk;
+  }
+
+  bool isOk = IsAscii() ? feedAscii(data, len) : feedBinary(data, len);
+  notify(false);
+  return isOk;
+}
+
+bool StlStreamDecoder::Finish() {
+  if (m_bFinished) {
+    return !m_bFailed;
+  }
+
+  if (m_eFormat == Format::Unknown && !m_bFailed) {
+    detectFormat(true);
+    std::string buffered;
+    buffered.swap(m_strPending);
+    if (IsAscii()) {
+      feedAscii(buffered.data(), buffered.size());
+    } else {
+      feedBinary(buffered.data(), buffered.size());
+    }
+  }
+
+  if (!m_bFailed && IsAscii() && !m_strPending.empty()) {
+    // the last line may have no line break
+    std::string line;
+    line.swap(m_strPending);
+    parseAsciiLine(line.data(), line.data() + line.size());
+  }
+
+  if (!m_bFailed && !IsAscii()) {
+    // truncated binary stream
+    if (!m_bBinaryHeaderDone || !m_strPending.empty() ||
+        m_vecFacets.size() != m_nBinaryFacets) {
+      m_bFailed = true;
+    }
+  }
+
+  m_bFinished = true;
+  notify(true);
+  return !m_bFailed;
+}
+
+bool StlStreamDecoder::detectFormat(bool isLast) {
+  const std::string& data = m_strPending;
+  if (m_nExpectedSize >= THE_STL_HEADER_SIZE &&
+      data.size() >= THE_STL_HEADER_SIZE) {
+    unsigned int nFacet = 0;
+    memcpy(&nFacet, data.data() + 80, 4);
+    if (THE_STL_HEADER_SIZE + (size_t)nFacet * THE_STL_SIZEOF_FACET ==
+        m_nExpectedSize) {
+      m_eFormat = Format::Binary;
+      return true;
+    }
+  }
+
+  if (!isLast && data.size() < THE_DETECT_SIZE) {
+    return false;
+  }
+
+  // binary facets almost always contain zero or non-ASCII bytes
+  if (startsWithSolid(data) && isTextData(data, THE_DETECT_SIZE)) {
+    m_eFormat = Format::Ascii;
+  } else {
+    m_eFormat = Format::Binary;
+  }
+  return true;
+}
+
+bool StlStreamDecoder::feedBinary(const char* data, size_t len) {
+  if (!m_bBinaryHeaderDone) {
+    size_t need = THE_STL_HEADER_SIZE - m_strPending.size();
+    size_t take = len < need ? len : need;
+    m_strPending.append(data, take);
+    data += take;
+    len -= take;
+    if (m_strPending.size() < THE_STL_HEADER_SIZE) {
+      return true;
+    }
+
+    memcpy(&m_nBinaryFacets, m_strPending.data() + 80, 4);
+    m_strPending.clear();
+    m_bBinaryHeaderDone = true;
+    // the header may be corrupted, so that facets which can actually
+    // arrive are reserved only
+    size_t nReserved = m_nBinaryFacets;
+    if (m_nExpectedSize >= THE_STL_HEADER_SIZE) {
+      nReserved = std::min(nReserved, (m_nExpectedSize - THE_STL_HEADER_SIZE) /
+                                          THE_STL_SIZEOF_FACET);
+    } else {
+      nReserved = std::min(nReserved, THE_MAX_RESERVED_FACETS);
+    }
+    m_vecFacets.reserve(nReserved);
+  }
+
+  // bytes after the declared facets are ignored, like by RWStl_Stream_Reader
+  const uint64_t nRemaining =
+      uint64_t(m_nBinaryFacets - m_vecFacets.size()) * THE_STL_SIZEOF_FACET -
+      m_strPending.size();
+  if (len > nRemaining) {
+    len = size_t(nRemaining);
+  }
+
+  // complete the facet split between chunks
+  if (!m_strPending.empty()) {
+    size_t need = THE_STL_SIZEOF_FACET - m_strPending.size();
+    size_t take = len < need ? len : need;
+    m_strPending.append(data, take);
+    data += take;
+    len -= take;
+    if (m_strPending.size() < THE_STL_SIZEOF_FACET) {
+      return true;
+    }
+    Triangle3D<float> facet;
+    memcpy(&facet, m_strPending.data(), THE_STL_SIZEOF_FACET);
+    m_vecFacets.push_back(facet);
+    m_strPending.clear();
+  }
+
+  size_t nFacets = len / THE_STL_SIZEOF_FACET;
+  if (nFacets > 0) {
+    size_t oldSize = m_vecFacets.size();
+    m_vecFacets.resize(oldSize + nFacets);
+    memcpy(m_vecFacets.data() + oldSize, data, nFacets * THE_STL_SIZEOF_FACET);
+    data += nFacets * THE_STL_SIZEOF_FACET;
+    len -= nFacets * THE_STL_SIZEOF_FACET;
+  }
+
+  m_strPending.append(data, len);
+  return true;
+}
+
+bool StlStreamDecoder::feedAscii(const char* data, size_t len) {
+  const char* end = data + len;
+  const char* lineBeg = data;
+  for (const char* cur = data; cur != end; ++cur) {
+    if (*cur != '\n') {
+      continue;
+    }
+
+    if (!m_strPending.empty()) {
+      m_strPending.append(lineBeg, cur);
+      std::string line;
+      line.swap(m_strPending);
+      if (!parseAsciiLine(line.data(), line.data() + line.size())) {
+        return false;
+      }
+    } else if (!parseAsciiLine(lineBeg, cur)) {
+      return false;
+    }
+    lineBeg = cur + 1;
+  }
+
+  m_strPending.append(lineBeg, end);
+  return true;
+}
+
+bool StlStreamDecoder::parseAsciiLine(const char* beg, const char* end) {
+  while (beg != end && (*beg == ' ' || *beg == '\t')) {
+    ++beg;
+  }
+  while (end != beg && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+    --end;
+  }
+
+  size_t len = end - beg;
+  if (len >= 12 && strncmp(beg, "facet normal", 12) == 0) {
+    m_curFacet = Triangle3D<float>();
+    m_nCurVertex = 0;
+    readFloats(beg + 12, end, m_curFacet.Normal);
+  } else if (len >= 6 && strncmp(beg, "vertex", 6) == 0) {
+    if (m_nCurVertex >= 3 ||
+        readFloats(beg + 6, end, m_curFacet.Vertexes[m_nCurVertex]) != 3) {
+      m_bFailed = true;
+      return false;
+    }
+    m_nCurVertex++;
+  } else if (len >= 8 && strncmp(beg, "endfacet", 8) == 0) {
+    if (m_nCurVertex != 3) {
+      m_bFailed = true;
+      return false;
+    }
+    m_vecFacets.push_back(m_curFacet);
+    m_nCurVertex = 0;
+  }
+  // "solid", "outer loop", "endloop" and "endsolid" carry no geometry
+  return true;
+}
+
+void StlStreamDecoder::notify(bool isLast) {
+  if (!m_callback) {
+    return;
+  }
+
+  size_t count = m_vecFacets.size();
+  if (count == m_nNotified) {
+    if (isLast) {
+      m_callback(*this);
+    }
+    return;
+  }
+
+  if (isLast ||
+      (m_nFacetsPerNotify > 0 && count - m_nNotified >= m_nFacetsPerNotify)) {
+    m_callback(*this);
+    m_nNotified = count;
+  }
+}
+
+bool DecodeStlChunks(ChunkSource& source, StlStreamDecoder& decoder,
+                     size_t chunkSize) {
+  decoder.set_ExpectedSize(source.get_TotalSize());
+
+  std::vector<char> buf(chunkSize);
+  while (true) {
+    size_t nRead = source.ReadChunk(buf.data(), buf.size());
+    if (nRead == 0) {
+      break;
+    }
+    if (!decoder.Feed(buf.data(), nRead)) {
+      return false;
+    }
+  }
+
+  if (source.IsFailed()) {
+    return false;
+  }
+  return decoder.Finish();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "stl_file.h"
+
+class ChunkSource;
+
+//! Incremental STL decoder which is fed with chunks of arbitrary size.
+//! Both binary and ASCII formats are supported. Facets become available as
+//! soon as they are complete, so partial geometry could be shown while the
+//! rest of the file is still being downloaded. Bytes following the declared
+//! number of binary facets are ignored, as by RWStl_Stream_Reader.
+class StlStreamDecoder {
+ public:
+  //! Callback invoked when the next group of facets has been decoded.
+  typedef std::function<void(StlStreamDecoder&)> FacetsCallback;
+
+  //! @param facetsPerNotify number of new facets between callback calls,
+  //!                        0 to notify only when decoding is finished
+  StlStreamDecoder(size_t facetsPerNotify = 0,
+                   FacetsCallback callback = FacetsCallback());
+  virtual ~StlStreamDecoder();
+
+ public:
+  //! Set total size of the stream when known (e.g. Content-Length).
+  //! Used to distinguish binary files starting with "solid" keyword.
+  void set_ExpectedSize(size_t size) { m_nExpectedSize = size; }
+
+  //! Decode next chunk of data.
+  //! @return FALSE if data is malformed
+  bool Feed(const char* data, size_t len);
+
+  //! Flush remaining data, must be called after the last chunk.
+  //! @return FALSE if stream is malformed or truncated
+  bool Finish();
+
+  bool IsAscii() const { return m_eFormat == Format::Ascii; }
+  bool IsFailed() const { return m_bFailed; }
+  bool IsFinished() const { return m_bFinished; }
+
+  size_t get_TriangleCount() const { return m_vecFacets.size(); }
+
+  //! Number of facets already reported through the callback.
+  size_t get_NotifiedCount() const { return m_nNotified; }
+
+  const std::vector<Triangle3D<float>>& get_Facets() const {
+    return m_vecFacets;
+  }
+
+  //! Move decoded facets out of decoder.
+  std::vector<Triangle3D<float>> DetachFacets();
+
+ private:
+  enum class Format { Unknown, Binary, Ascii };
+
+  bool detectFormat(bool isLast);
+  bool feedBinary(const char* data, size_t len);
+  bool feedAscii(const char* data, size_t len);
+  bool parseAsciiLine(const char* beg, const char* end);
+  void notify(bool isLast);
+
+ private:
+  size_t m_nFacetsPerNotify;
+  FacetsCallback m_callback;
+  size_t m_nExpectedSize;
+  size_t m_nNotified;
+  Format m_eFormat;
+  bool m_bFailed;
+  bool m_bFinished;
+
+  std::string m_strPending;  //!< bytes of incomplete record or line
+  unsigned int m_nBinaryFacets;
+  bool m_bBinaryHeaderDone;
+
+  Triangle3D<float> m_curFacet;  //!< ASCII facet under construction
+  int m_nCurVertex;
+
+  std::vector<Triangle3D<float>> m_vecFacets;
+};
+
+//! Pump all chunks from the source into the decoder.
+//! @return FALSE if source or decoder failed
+bool DecodeStlChunks(ChunkSource& source, StlStreamDecoder& decoder,
+                     size_t chunkSize);
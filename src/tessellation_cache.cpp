@@ -0,0 +1,430 @@
+#include "tessellation_cache.h"
+
+#include <BRep_Builder.hxx>
+#include <BRep_Tool.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <TopoDS_Face.hxx>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "model_factory.h"
+
+IMPLEMENT_STANDARD_RTTIEXT(TessellationCacheStorage, Standard_Transient)
+IMPLEMENT_STANDARD_RTTIEXT(DirectoryCacheStorage, TessellationCacheStorage)
+IMPLEMENT_STANDARD_RTTIEXT(TessellationCache, Standard_Transient)
+
+namespace {
+
+const char THE_CACHE_MAGIC[4] = {'O', 'T', 'C', '1'};
+const char *THE_CACHE_EXTENSION = ".otc";
+
+//! 64-bit MurmurHash2 (MurmurHash64A), fast enough for hundreds of MB.
+uint64_t hashBytes(const char *theData, size_t theLen, uint64_t theSeed) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+  uint64_t h = theSeed ^ (theLen * m);
+
+  const size_t aNbBlocks = theLen / 8;
+  for (size_t i = 0; i < aNbBlocks; ++i) {
+    uint64_t k;
+    memcpy(&k, theData + i * 8, 8);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  const unsigned char *aTail =
+      reinterpret_cast<const unsigned char *>(theData + aNbBlocks * 8);
+  switch (theLen & 7) {
+  case 7: h ^= uint64_t(aTail[6]) << 48; // fall through
+  case 6: h ^= uint64_t(aTail[5]) << 40; // fall through
+  case 5: h ^= uint64_t(aTail[4]) << 32; // fall through
+  case 4: h ^= uint64_t(aTail[3]) << 24; // fall through
+  case 3: h ^= uint64_t(aTail[2]) << 16; // fall through
+  case 2: h ^= uint64_t(aTail[1]) << 8;  // fall through
+  case 1:
+    h ^= uint64_t(aTail[0]);
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+template <typename T> void writeValue(std::string &theData, const T &theValue) {
+  theData.append(reinterpret_cast<const char *>(&theValue), sizeof(T));
+}
+
+template <typename T>
+bool readValue(const std::string &theData, size_t &thePos, T &theValue) {
+  if (thePos + sizeof(T) > theData.size()) {
+    return false;
+  }
+  memcpy(&theValue, theData.data() + thePos, sizeof(T));
+  thePos += sizeof(T);
+  return true;
+}
+
+} // namespace
+
+// ================================================================
+// Function : DirectoryCacheStorage
+// Purpose  :
+// ================================================================
+DirectoryCacheStorage::DirectoryCacheStorage(const std::string &theDir)
+    : myDir(theDir) {
+  std::error_code anErr;
+  std::filesystem::create_directories(myDir, anErr);
+}
+
+// ================================================================
+// Function : filePath
+// Purpose  :
+// ================================================================
+std::string DirectoryCacheStorage::filePath(const std::string &theKey) const {
+  return (std::filesystem::path(myDir) / (theKey + THE_CACHE_EXTENSION))
+      .string();
+}
+
+// ================================================================
+// Function : Read
+// Purpose  :
+// ================================================================
+bool DirectoryCacheStorage::Read(const std::string &theKey,
+                                 std::string &theData) {
+  std::ifstream aFile(filePath(theKey), std::ios_base::binary);
+  if (!aFile.is_open()) {
+    return false;
+  }
+  theData.assign(std::istreambuf_iterator<char>(aFile),
+                 std::istreambuf_iterator<char>());
+  return !aFile.bad();
+}
+
+// ================================================================
+// Function : Write
+// Purpose  :
+// ================================================================
+bool DirectoryCacheStorage::Write(const std::string &theKey,
+                                  const std::string &theData) {
+  // write into temporary file first so that readers never see partial data
+  const std::string aPath = filePath(theKey);
+  const std::string aTmpPath = aPath + ".tmp";
+  {
+    std::ofstream aFile(aTmpPath, std::ios_base::binary | std::ios_base::trunc);
+    if (!aFile.is_open()) {
+      return false;
+    }
+    aFile.write(theData.data(), (std::streamsize)theData.size());
+    if (!aFile.good()) {
+      return false;
+    }
+  }
+  std::error_code anErr;
+  std::filesystem::rename(aTmpPath, aPath, anErr);
+  return !anErr;
+}
+
+// ================================================================
+// Function : Remove
+// Purpose  :
+// ================================================================
+void DirectoryCacheStorage::Remove(const std::string &theKey) {
+  std::error_code anErr;
+  std::filesystem::remove(filePath(theKey), anErr);
+}
+
+// ================================================================
+// Function : Touch
+// Purpose  :
+// ================================================================
+void DirectoryCacheStorage::Touch(const std::string &theKey) {
+  std::error_code anErr;
+  std::filesystem::last_write_time(
+      filePath(theKey), std::filesystem::file_time_type::clock::now(), anErr);
+}
+
+// ================================================================
+// Function : List
+// Purpose  :
+// ================================================================
+void DirectoryCacheStorage::List(std::vector<Entry> &theEntries) {
+  std::error_code anErr;
+  for (std::filesystem::directory_iterator aFileIter(myDir, anErr);
+       !anErr && aFileIter != std::filesystem::directory_iterator();
+       aFileIter.increment(anErr)) {
+    const std::filesystem::path &aPath = aFileIter->path();
+    if (aPath.extension() != THE_CACHE_EXTENSION) {
+      continue;
+    }
+
+    std::error_code anEntryErr;
+    Entry anEntry;
+    anEntry.Key = aPath.stem().string();
+    anEntry.Size = std::filesystem::file_size(aPath, anEntryErr);
+    anEntry.Stamp = std::filesystem::last_write_time(aPath, anEntryErr)
+                        .time_since_epoch()
+                        .count();
+    if (!anEntryErr) {
+      theEntries.push_back(anEntry);
+    }
+  }
+}
+
+// ================================================================
+// Function : TessellationCache
+// Purpose  :
+// ================================================================
+TessellationCache::TessellationCache(
+    const Handle(TessellationCacheStorage) & theStorage, uint64_t theMaxSize)
+    : myStorage(theStorage), myMaxSize(theMaxSize) {}
+
+// ================================================================
+// Function : MakeKey
+// Purpose  :
+// ================================================================
+std::string TessellationCache::MakeKey(const char *theData, size_t theDataLen,
+                                       const ModelMeshParams &theParams) {
+  const double aParams[4] = {theParams.Deflection,
+                             theParams.DeviationCoefficient, theParams.Angle,
+                             theParams.IsRelative ? 1.0 : 0.0};
+  const uint64_t aDataHash = hashBytes(theData, theDataLen, 0);
+  const uint64_t aParamsHash = hashBytes(
+      reinterpret_cast<const char *>(aParams), sizeof(aParams), aDataHash);
+
+  char aKey[64];
+  snprintf(aKey, sizeof(aKey), "%016llx-%016llx",
+           (unsigned long long)aDataHash, (unsigned long long)aParamsHash);
+  return aKey;
+}
+
+// ================================================================
+// Function : Lookup
+// Purpose  :
+// ================================================================
+bool TessellationCache::Lookup(const std::string &theKey,
+                               NCollection_Sequence<TopoDS_Shape> &theShapes,
+                               int &theNbTriangles,
+                               std::string *theModelData) {
+  std::string aData;
+  {
+    std::lock_guard<std::mutex> aLock(myMutex);
+    if (!myStorage->Read(theKey, aData)) {
+      return false;
+    }
+    myStorage->Touch(theKey);
+  }
+
+  if (!Decode(aData, theShapes, theNbTriangles, theModelData)) {
+    std::lock_guard<std::mutex> aLock(myMutex);
+    myStorage->Remove(theKey);
+    return false;
+  }
+  return true;
+}
+
+// ================================================================
+// Function : Store
+// Purpose  :
+// ================================================================
+bool TessellationCache::Store(
+    const std::string &theKey,
+    const NCollection_Sequence<TopoDS_Shape> &theShapes,
+    const std::string &theModelData) {
+  std::string aData;
+  Encode(theShapes, aData, theModelData);
+  if (aData.size() > myMaxSize) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> aLock(myMutex);
+  if (!myStorage->Write(theKey, aData)) {
+    return false;
+  }
+  evict();
+  myStorage->Flush();
+  return true;
+}
+
+// ================================================================
+// Function : evict
+// Purpose  :
+// ================================================================
+void TessellationCache::evict() {
+  std::vector<TessellationCacheStorage::Entry> anEntries;
+  myStorage->List(anEntries);
+
+  uint64_t aTotalSize = 0;
+  for (const TessellationCacheStorage::Entry &anEntry : anEntries) {
+    aTotalSize += anEntry.Size;
+  }
+  if (aTotalSize <= myMaxSize) {
+    return;
+  }
+
+  std::sort(anEntries.begin(), anEntries.end(),
+            [](const TessellationCacheStorage::Entry &theLeft,
+               const TessellationCacheStorage::Entry &theRight) {
+              return theLeft.Stamp < theRight.Stamp;
+            });
+  for (const TessellationCacheStorage::Entry &anEntry : anEntries) {
+    if (aTotalSize <= myMaxSize) {
+      break;
+    }
+    myStorage->Remove(anEntry.Key);
+    aTotalSize -= anEntry.Size;
+  }
+}
+
+// ================================================================
+// Function : Encode
+// Purpose  :
+// ================================================================
+void TessellationCache::Encode(
+    const NCollection_Sequence<TopoDS_Shape> &theShapes, std::string &theData,
+    const std::string &theModelData) {
+  theData.append(THE_CACHE_MAGIC, sizeof(THE_CACHE_MAGIC));
+  writeValue(theData, (uint32_t)theShapes.Size());
+  for (NCollection_Sequence<TopoDS_Shape>::Iterator aShapeIter(theShapes);
+       aShapeIter.More(); aShapeIter.Next()) {
+    NCollection_Sequence<TopoDS_Face> aFaces;
+    for (TopExp_Explorer aFaceExp(aShapeIter.Value(), TopAbs_FACE);
+         aFaceExp.More(); aFaceExp.Next()) {
+      TopLoc_Location aLoc;
+      const TopoDS_Face &aFace = TopoDS::Face(aFaceExp.Current());
+      if (!BRep_Tool::Triangulation(aFace, aLoc).IsNull()) {
+        aFaces.Append(aFace);
+      }
+    }
+
+    writeValue(theData, (uint32_t)aFaces.Size());
+    for (NCollection_Sequence<TopoDS_Face>::Iterator aFaceIter(aFaces);
+         aFaceIter.More(); aFaceIter.Next()) {
+      TopLoc_Location aLoc;
+      const Handle(Poly_Triangulation) &aTri =
+          BRep_Tool::Triangulation(aFaceIter.Value(), aLoc);
+      const gp_Trsf &aTrsf = aLoc.Transformation();
+      const bool isReversed =
+          aFaceIter.Value().Orientation() == TopAbs_REVERSED;
+
+      writeValue(theData, (uint32_t)aTri->NbNodes());
+      writeValue(theData, (uint32_t)aTri->NbTriangles());
+      for (Standard_Integer aNodeIter = 1; aNodeIter <= aTri->NbNodes();
+           ++aNodeIter) {
+        const gp_Pnt aPnt = aTri->Node(aNodeIter).Transformed(aTrsf);
+        writeValue(theData, (float)aPnt.X());
+        writeValue(theData, (float)aPnt.Y());
+        writeValue(theData, (float)aPnt.Z());
+      }
+      for (Standard_Integer aTriIter = 1; aTriIter <= aTri->NbTriangles();
+           ++aTriIter) {
+        Standard_Integer aN1, aN2, aN3;
+        aTri->Triangle(aTriIter).Get(aN1, aN2, aN3);
+        if (isReversed) {
+          std::swap(aN2, aN3);
+        }
+        writeValue(theData, (uint32_t)(aN1 - 1));
+        writeValue(theData, (uint32_t)(aN2 - 1));
+        writeValue(theData, (uint32_t)(aN3 - 1));
+      }
+    }
+  }
+  writeValue(theData, (uint32_t)theModelData.size());
+  theData.append(theModelData);
+}
+
+// ================================================================
+// Function : Decode
+// Purpose  :
+// ================================================================
+bool TessellationCache::Decode(const std::string &theData,
+                               NCollection_Sequence<TopoDS_Shape> &theShapes,
+                               int &theNbTriangles,
+                               std::string *theModelData) {
+  theNbTriangles = 0;
+  if (theModelData != nullptr) {
+    theModelData->clear();
+  }
+  if (theData.size() < sizeof(THE_CACHE_MAGIC) ||
+      memcmp(theData.data(), THE_CACHE_MAGIC, sizeof(THE_CACHE_MAGIC)) != 0) {
+    return false;
+  }
+
+  size_t aPos = sizeof(THE_CACHE_MAGIC);
+  uint32_t aNbShapes = 0;
+  if (!readValue(theData, aPos, aNbShapes)) {
+    return false;
+  }
+
+  BRep_Builder aBuilder;
+  for (uint32_t aShapeIter = 0; aShapeIter < aNbShapes; ++aShapeIter) {
+    uint32_t aNbFaces = 0;
+    if (!readValue(theData, aPos, aNbFaces)) {
+      return false;
+    }
+
+    TopoDS_Compound aCompound;
+    aBuilder.MakeCompound(aCompound);
+    for (uint32_t aFaceIter = 0; aFaceIter < aNbFaces; ++aFaceIter) {
+      uint32_t aNbNodes = 0, aNbTris = 0;
+      if (!readValue(theData, aPos, aNbNodes) ||
+          !readValue(theData, aPos, aNbTris) ||
+          aPos + (size_t)aNbNodes * 3 * sizeof(float) +
+                  (size_t)aNbTris * 3 * sizeof(uint32_t) >
+              theData.size()) {
+        return false;
+      }
+
+      Handle(Poly_Triangulation) aTri =
+          new Poly_Triangulation(aNbNodes, aNbTris, Standard_False);
+      for (uint32_t aNodeIter = 0; aNodeIter < aNbNodes; ++aNodeIter) {
+        float aXYZ[3];
+        readValue(theData, aPos, aXYZ);
+        aTri->SetNode(aNodeIter + 1, gp_Pnt(aXYZ[0], aXYZ[1], aXYZ[2]));
+      }
+      for (uint32_t aTriIter = 0; aTriIter < aNbTris; ++aTriIter) {
+        uint32_t aNodes[3];
+        readValue(theData, aPos, aNodes);
+        if (aNodes[0] >= aNbNodes || aNodes[1] >= aNbNodes ||
+            aNodes[2] >= aNbNodes) {
+          return false;
+        }
+        aTri->SetTriangle(aTriIter + 1,
+                          Poly_Triangle(aNodes[0] + 1, aNodes[1] + 1,
+                                        aNodes[2] + 1));
+      }
+
+      TopoDS_Face aFace;
+      aBuilder.MakeFace(aFace, aTri);
+      aBuilder.Add(aCompound, aFace);
+      theNbTriangles += (int)aNbTris;
+    }
+    theShapes.Append(aCompound);
+  }
+
+  // entries stored before model data was introduced end with the shapes
+  uint32_t aModelDataSize = 0;
+  if (aPos == theData.size()) {
+    return true;
+  }
+  if (!readValue(theData, aPos, aModelDataSize) ||
+      aModelDataSize != theData.size() - aPos) {
+    return false;
+  }
+  if (theModelData != nullptr) {
+    theModelData->assign(theData, aPos, aModelDataSize);
+  }
+  return true;
+}
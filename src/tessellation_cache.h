@@ -0,0 +1,130 @@
+#pragma once
+
+#include <NCollection_Sequence.hxx>
+#include <Standard_Transient.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ModelMeshParams;
+
+class TessellationCacheStorage;
+DEFINE_STANDARD_HANDLE(TessellationCacheStorage, Standard_Transient)
+
+//! Backend storing cache entries as named binary blobs.
+class TessellationCacheStorage : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(TessellationCacheStorage, Standard_Transient)
+public:
+  //! Description of the stored entry.
+  struct Entry {
+    std::string Key;
+    uint64_t Size;  //!< size in bytes
+    int64_t Stamp;  //!< last access time, larger is more recent
+  };
+
+public:
+  //! Read entry data.
+  //! @return FALSE if entry does not exist
+  virtual bool Read(const std::string &theKey, std::string &theData) = 0;
+
+  //! Write entry data, existing entry is replaced.
+  virtual bool Write(const std::string &theKey, const std::string &theData) = 0;
+
+  //! Remove entry.
+  virtual void Remove(const std::string &theKey) = 0;
+
+  //! Mark entry as recently used.
+  virtual void Touch(const std::string &theKey) = 0;
+
+  //! List all stored entries.
+  virtual void List(std::vector<Entry> &theEntries) = 0;
+
+  //! Persist changes, if backend needs it.
+  virtual void Flush() {}
+};
+
+class DirectoryCacheStorage;
+DEFINE_STANDARD_HANDLE(DirectoryCacheStorage, TessellationCacheStorage)
+
+//! Storage keeping each entry in a file within local directory.
+//! Last modification time of the file is used as access stamp.
+class DirectoryCacheStorage : public TessellationCacheStorage {
+  DEFINE_STANDARD_RTTIEXT(DirectoryCacheStorage, TessellationCacheStorage)
+public:
+  //! @param theDir [in] directory, created if it does not exist
+  DirectoryCacheStorage(const std::string &theDir);
+
+  virtual bool Read(const std::string &theKey, std::string &theData) override;
+  virtual bool Write(const std::string &theKey,
+                     const std::string &theData) override;
+  virtual void Remove(const std::string &theKey) override;
+  virtual void Touch(const std::string &theKey) override;
+  virtual void List(std::vector<Entry> &theEntries) override;
+
+protected:
+  std::string filePath(const std::string &theKey) const;
+
+protected:
+  std::string myDir;
+};
+
+class TessellationCache;
+DEFINE_STANDARD_HANDLE(TessellationCache, Standard_Transient)
+
+//! Cache of shape triangulations keyed by content hash of the input file
+//! and meshing parameters. Entries keep only triangulations of faces, so
+//! restored shapes have no B-Rep geometry and are suitable for display.
+//! Entries may also keep opaque model data, e.g. assembly tree, so that the
+//! input file does not need to be parsed at all.
+//! Total size is bounded, least recently used entries are evicted first.
+class TessellationCache : public Standard_Transient {
+  DEFINE_STANDARD_RTTIEXT(TessellationCache, Standard_Transient)
+public:
+  //! @param theStorage [in] storage backend
+  //! @param theMaxSize [in] maximum total size of entries in bytes
+  TessellationCache(const Handle(TessellationCacheStorage) & theStorage,
+                    uint64_t theMaxSize);
+
+  //! Make cache key from input data and meshing parameters.
+  static std::string MakeKey(const char *theData, size_t theDataLen,
+                             const ModelMeshParams &theParams);
+
+  //! Restore shapes stored with the key.
+  //! @param theNbTriangles [out] total number of restored triangles
+  //! @param theModelData   [out] model data stored with the shapes, empty
+  //!                             if none; ignored if NULL
+  //! @return FALSE if there is no such entry
+  bool Lookup(const std::string &theKey,
+              NCollection_Sequence<TopoDS_Shape> &theShapes,
+              int &theNbTriangles, std::string *theModelData = nullptr);
+
+  //! Store triangulations of the shapes and evict old entries if needed.
+  //! @param theModelData [in] opaque model data to be kept with the shapes
+  bool Store(const std::string &theKey,
+             const NCollection_Sequence<TopoDS_Shape> &theShapes,
+             const std::string &theModelData = std::string());
+
+  //! Encode triangulations of the shapes and model data into binary blob.
+  static void Encode(const NCollection_Sequence<TopoDS_Shape> &theShapes,
+                     std::string &theData,
+                     const std::string &theModelData = std::string());
+
+  //! Decode shapes and model data from binary blob.
+  //! @return FALSE if data is malformed
+  static bool Decode(const std::string &theData,
+                     NCollection_Sequence<TopoDS_Shape> &theShapes,
+                     int &theNbTriangles,
+                     std::string *theModelData = nullptr);
+
+private:
+  //! Remove least recently used entries exceeding size limit.
+  void evict();
+
+private:
+  Handle(TessellationCacheStorage) myStorage;
+  uint64_t myMaxSize;
+  std::mutex myMutex;
+};
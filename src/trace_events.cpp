@@ -0,0 +1,147 @@
+#include "trace_events.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "help_algorithms.h"
+
+namespace {
+
+//! Complete event ("ph":"X").
+struct TraceEvent {
+  const char* Name;
+  int64_t Start;
+  int64_t Duration;
+};
+
+const size_t THE_CHUNK_SIZE = 4096;
+const size_t THE_MAX_CHUNKS = 1024;  // up to 4M events per thread
+
+//! Events of one thread, written only by the owning thread.
+//! Chunks are never moved, so readers may access events below Count
+//! while the owner keeps appending.
+struct ThreadBuffer {
+  int Tid;
+  std::atomic<const char*> Name;
+  std::atomic<TraceEvent*> Chunks[THE_MAX_CHUNKS];
+  std::atomic<size_t> Count;
+  ThreadBuffer* Next;
+
+  ThreadBuffer(int tid) : Tid(tid), Name(nullptr), Count(0), Next(nullptr) {
+    for (size_t i = 0; i < THE_MAX_CHUNKS; i++) {
+      Chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+};
+
+std::atomic<ThreadBuffer*> g_buffers(nullptr);
+std::atomic<int> g_lastTid(0);
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+const std::chrono::steady_clock::time_point THE_START_TIME =
+    std::chrono::steady_clock::now();
+
+//! Return buffer of the calling thread, registering it on first use.
+ThreadBuffer* threadBuffer() {
+  if (t_buffer == nullptr) {
+    t_buffer = new ThreadBuffer(++g_lastTid);
+    t_buffer->Next = g_buffers.load(std::memory_order_relaxed);
+    while (!g_buffers.compare_exchange_weak(t_buffer->Next, t_buffer,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+    }
+  }
+  return t_buffer;
+}
+
+}  // namespace
+
+std::atomic<bool> TraceRecorder::s_bEnabled(false);
+thread_local TraceScope* TraceScope::s_pCurrent = nullptr;
+
+int64_t TraceRecorder::Now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - THE_START_TIME)
+      .count();
+}
+
+void TraceRecorder::AddEvent(const char* name, int64_t start,
+                             int64_t duration) {
+  ThreadBuffer* buffer = threadBuffer();
+  const size_t index = buffer->Count.load(std::memory_order_relaxed);
+  const size_t chunkIndex = index / THE_CHUNK_SIZE;
+  if (chunkIndex >= THE_MAX_CHUNKS) {
+    return;
+  }
+
+  TraceEvent* chunk = buffer->Chunks[chunkIndex].load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    chunk = new TraceEvent[THE_CHUNK_SIZE];
+    buffer->Chunks[chunkIndex].store(chunk, std::memory_order_release);
+  }
+  chunk[index % THE_CHUNK_SIZE] = TraceEvent{name, start, duration};
+  buffer->Count.store(index + 1, std::memory_order_release);
+}
+
+void TraceRecorder::set_ThreadName(const char* name) {
+  threadBuffer()->Name.store(name, std::memory_order_relaxed);
+}
+
+void TraceRecorder::Clear() {
+  for (ThreadBuffer* buffer = g_buffers.load(std::memory_order_acquire);
+       buffer != nullptr; buffer = buffer->Next) {
+    buffer->Count.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t TraceRecorder::get_EventCount() {
+  size_t count = 0;
+  for (ThreadBuffer* buffer = g_buffers.load(std::memory_order_acquire);
+       buffer != nullptr; buffer = buffer->Next) {
+    count += buffer->Count.load(std::memory_order_acquire);
+  }
+  return count;
+}
+
+std::string TraceRecorder::ToJson() {
+  std::ostringstream os;
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool isFirst = true;
+  for (ThreadBuffer* buffer = g_buffers.load(std::memory_order_acquire);
+       buffer != nullptr; buffer = buffer->Next) {
+    const char* threadName = buffer->Name.load(std::memory_order_relaxed);
+    if (threadName != nullptr) {
+      os << (isFirst ? "" : ",")
+         << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << buffer->Tid << ",\"args\":{\"name\":";
+      write_json_string(os, threadName);
+      os << "}}";
+      isFirst = false;
+    }
+
+    const size_t count = buffer->Count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      const TraceEvent* chunk =
+          buffer->Chunks[i / THE_CHUNK_SIZE].load(std::memory_order_acquire);
+      const TraceEvent& event = chunk[i % THE_CHUNK_SIZE];
+      os << (isFirst ? "" : ",") << "\n{\"name\":";
+      write_json_string(os, event.Name);
+      os << ",\"ph\":\"X\",\"ts\":" << event.Start
+         << ",\"dur\":" << event.Duration << ",\"pid\":1,\"tid\":"
+         << buffer->Tid << "}";
+      isFirst = false;
+    }
+  }
+  os << "\n]}";
+  return os.str();
+}
+
+bool TraceRecorder::DumpToFile(const std::string& fileName) {
+  std::ofstream ofs(fileName, std::ios_base::trunc);
+  if (!ofs.is_open()) {
+    return false;
+  }
+  ofs << ToJson();
+  return ofs.good();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//! Recorder of the timeline in Chrome trace-event format, which can be
+//! opened with chrome://tracing or https://ui.perfetto.dev.
+//! Every thread appends events into its own buffer without locks; buffers
+//! are registered once within a lock-free list and are never released,
+//! so events of finished threads are kept until Clear().
+class TraceRecorder {
+ public:
+  //! Start or stop recording; disabled recorder costs a single flag check.
+  static void set_Enabled(bool isEnabled) {
+    s_bEnabled.store(isEnabled, std::memory_order_relaxed);
+  }
+
+  static bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+
+  //! Return time in microseconds since the process start.
+  static int64_t Now();
+
+  //! Record complete event of the calling thread.
+  //! @param name     event name, must have static lifetime (string literal)
+  //! @param start    start time returned by Now()
+  //! @param duration duration in microseconds
+  static void AddEvent(const char* name, int64_t start, int64_t duration);
+
+  //! Set name of the calling thread shown in the timeline.
+  //! @param name thread name, must have static lifetime
+  static void set_ThreadName(const char* name);
+
+  //! Drop all recorded events.
+  //! Should not be called while other threads are recording.
+  static void Clear();
+
+  //! Return number of recorded events.
+  static size_t get_EventCount();
+
+  //! Format recorded events as trace-event JSON object.
+  static std::string ToJson();
+
+  //! Write trace-event JSON into file.
+  //! @return FALSE on writing error
+  static bool DumpToFile(const std::string& fileName);
+
+ private:
+  static std::atomic<bool> s_bEnabled;
+};
+
+//! Records complete event spanning the lifetime of the object.
+//! Scopes of every thread form a stack, which is maintained even while
+//! recording is disabled, so that other tools (e.g. AllocProfiler) could
+//! attribute their data to the innermost scope.
+class TraceScope {
+ public:
+  //! @param name event name, must have static lifetime (string literal)
+  explicit TraceScope(const char* name)
+      : m_szName(name),
+        m_pParent(s_pCurrent),
+        m_nStart(TraceRecorder::IsEnabled() ? TraceRecorder::Now() : -1) {
+    s_pCurrent = this;
+  }
+
+  ~TraceScope() {
+    s_pCurrent = m_pParent;
+    if (m_nStart >= 0) {
+      TraceRecorder::AddEvent(m_szName, m_nStart,
+                              TraceRecorder::Now() - m_nStart);
+    }
+  }
+
+  const char* get_Name() const { return m_szName; }
+
+  //! Return innermost scope of the calling thread, or NULL.
+  static const TraceScope* get_Current() { return s_pCurrent; }
+
+ private:
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* m_szName;
+  TraceScope* m_pParent;
+  int64_t m_nStart;
+
+  static thread_local TraceScope* s_pCurrent;
+};
+
+#define TRACE_SCOPE_CONCAT2(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT2(a, b)
+
+//! Record the enclosing block as a named event.
+#define TRACE_SCOPE(name) \
+  TraceScope TRACE_SCOPE_CONCAT(aTraceScope, __LINE__)(name)
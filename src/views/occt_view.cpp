@@ -24,36 +24,67 @@
 #include "occt_view.h"
 
 #include <emscripten/bind.h>
+#include <emscripten/fetch.h>
 
 #include <AIS_Shape.hxx>
+#include <AIS_TextLabel.hxx>
 #include <AIS_ViewCube.hxx>
 #include <Aspect_DisplayConnection.hxx>
 #include <Aspect_Handle.hxx>
 #include <BRepBndLib.hxx>
 #include <BRepTools.hxx>
 #include <BRep_Builder.hxx>
+#include <BinTools.hxx>
 #include <Graphic3d_CubeMapPacked.hxx>
 #include <Image_AlienPixMap.hxx>
 #include <MeshVS_DisplayModeFlags.hxx>
 #include <Message.hxx>
 #include <Message_Messenger.hxx>
+#include <NCollection_Sequence.hxx>
+#include <OSD_MemInfo.hxx>
+#include <OpenGl_Context.hxx>
+#include <OpenGl_FrameStats.hxx>
 #include <OpenGl_GraphicDriver.hxx>
 #include <Prs3d_DatumAspect.hxx>
 #include <Prs3d_ToolCylinder.hxx>
 #include <Prs3d_ToolDisk.hxx>
 #include <STEPControl_Reader.hxx>
+#include <STEPControl_Writer.hxx>
 #include <Standard_ArrayStreamBuffer.hxx>
+#include <TopoDS_Compound.hxx>
+#include <V3d_Viewer.hxx>
 #include <Wasm_Window.hxx>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string.h>
 #include <string>
 
+#include "../alloc_profiler.h"
+#include "../gltf_scene_writer.h"
 #include "../help_algorithms.h"
+#include "../load_arena.h"
 #include "../membuf.h"
 #include "../model_factory.h"
+#include "../model_load_job.h"
+#include "../scene_snapshot.h"
 #include "../stl_file.h"
+#include "../step_assembly.h"
+#include "../stl_stream_decoder.h"
+#include "../trace_events.h"
 
 #define THE_CANVAS_ID "#occViewerCanvas"
 
+//! Interval in milliseconds between checks of background load queue.
+#define THE_LOAD_POLL_INTERVAL 50
+
+//! Interval in milliseconds between updates of frame statistics overlay.
+#define THE_STATS_OVERLAY_INTERVAL 500
+
+//! Interval in milliseconds between checks of memory budget.
+#define THE_MEMORY_CHECK_INTERVAL 1000
+
 namespace {
 //! Auxiliary wrapper for loading model.
 struct ModelAsyncLoader {
@@ -82,6 +113,170 @@ struct ModelAsyncLoader {
   }
 };
 
+//! Auxiliary wrapper for loading model while it is being downloaded.
+//! Only STL is decoded incrementally; other formats are buffered and loaded
+//! once the download is completed.
+struct ModelStreamLoader {
+  std::string Name;
+  std::string Path;
+  bool IsStl;
+  StlStreamDecoder Decoder;
+  std::string Data; //!< accumulated data of formats without chunked decoder
+  NCollection_Sequence<Handle(AIS_InteractiveObject)> Parts;
+  NCollection_Sequence<size_t> PartFirsts; //!< first facet of each part
+  size_t NbReceived = 0; //!< bytes delivered by chunks
+
+  ModelStreamLoader(const char *theName, const char *thePath,
+                    size_t theFacetsPerUpdate)
+      : Name(theName), Path(thePath),
+        IsStl(test_file_extension(theName, ".stl")),
+        Decoder(theFacetsPerUpdate, [this](StlStreamDecoder &theDecoder) {
+          onFacetsDecoded(theDecoder);
+        }) {}
+
+  //! Display facets decoded since the previous update.
+  //! Trailing parts not larger than the new facets are merged into a single
+  //! part like digits of a binary counter, so that only a logarithmic number
+  //! of parts is displayed and each facet is meshed a logarithmic number of
+  //! times during the download.
+  void onFacetsDecoded(StlStreamDecoder &theDecoder) {
+    const size_t aNbFacets = theDecoder.get_TriangleCount();
+    size_t aFirst = theDecoder.get_NotifiedCount();
+    if (aFirst == aNbFacets || theDecoder.IsFinished()) {
+      return;
+    }
+
+    OcctView &aViewer = OcctView::Instance();
+    const bool isFirstUpdate = aFirst == 0;
+    while (!Parts.IsEmpty() &&
+           aFirst - PartFirsts.Last() <= aNbFacets - aFirst) {
+      aFirst = PartFirsts.Last();
+      aViewer.Context()->Remove(Parts.Last(), false);
+      Parts.Remove(Parts.Length());
+      PartFirsts.Remove(PartFirsts.Length());
+    }
+
+    Handle(AIS_InteractiveObject) aPart =
+        ModelFactory::GetInstance()->CreateStlMesh(
+            ModelFactory::GetInstance()->MakeTriangulation(
+                theDecoder.get_Facets().data() + aFirst, aNbFacets - aFirst));
+    aViewer.Context()->Display(aPart, MeshVS_DMF_Shading, -1, false);
+    if (isFirstUpdate) {
+      aViewer.View()->FitAll(0.01, false);
+    }
+    Parts.Append(aPart);
+    PartFirsts.Append(aFirst);
+    aViewer.UpdateView();
+  }
+
+  //! Remove temporary parts displayed during download.
+  void removeParts() {
+    OcctView &aViewer = OcctView::Instance();
+    for (NCollection_Sequence<Handle(AIS_InteractiveObject)>::Iterator
+             aPartIter(Parts);
+         aPartIter.More(); aPartIter.Next()) {
+      aViewer.Context()->Remove(aPartIter.Value(), false);
+    }
+    Parts.Clear();
+    PartFirsts.Clear();
+  }
+
+  //! Replace parts by the single mesh with merged nodes.
+  void finishStl() {
+    removeParts();
+    if (!Decoder.Finish() || Decoder.get_TriangleCount() == 0) {
+      Message::SendFail() << "Error: unable to decode STL file "
+                          << Path.c_str();
+      OcctView::Instance().UpdateView();
+      return;
+    }
+
+    StlFile aStlFile;
+    aStlFile.set_Facets(Decoder.DetachFacets());
+    std::vector<float> aVertexes;
+    std::vector<unsigned int> anIndexes;
+    {
+      LoadArena anArena;
+      aStlFile.ToIndexedData(aVertexes, anIndexes, anArena.Resource());
+    }
+    aStlFile.set_Facets(std::vector<Triangle3D<float>>());
+
+    Handle(AIS_InteractiveObject) aMesh =
+        ModelFactory::GetInstance()->InstantiateStlMesh(
+            ModelFactory::GetInstance()->MakeTriangulation(aVertexes,
+                                                           anIndexes));
+    OcctView &aViewer = OcctView::Instance();
+    aViewer.AddObject(Name.c_str(), aMesh, MeshVS_DMF_Shading);
+    aViewer.View()->FitAll(0.01, false);
+    aViewer.UpdateView();
+
+    Message::DefaultMessenger()->Send(
+        TCollection_AsciiString("Loaded file ") + Name.c_str(), Message_Info);
+    Message::DefaultMessenger()->Send(OSD_MemInfo::PrintInfo(), Message_Trace);
+  }
+
+  //! Data chunk received event.
+  static void onProgress(emscripten_fetch_t *theFetch) {
+    ModelStreamLoader *aTask = (ModelStreamLoader *)theFetch->userData;
+    if (theFetch->numBytes == 0) {
+      return;
+    }
+    aTask->NbReceived += size_t(theFetch->numBytes);
+
+    if (aTask->IsStl) {
+      if (aTask->Decoder.IsFailed()) {
+        return; // error is reported on completion
+      }
+      aTask->Decoder.set_ExpectedSize(size_t(theFetch->totalBytes));
+      aTask->Decoder.Feed(theFetch->data, size_t(theFetch->numBytes));
+    } else {
+      if (aTask->Data.empty() && theFetch->totalBytes > 0) {
+        aTask->Data.reserve(size_t(theFetch->totalBytes));
+      }
+      aTask->Data.append(theFetch->data, size_t(theFetch->numBytes));
+    }
+  }
+
+  //! Download completed event.
+  static void onSucceeded(emscripten_fetch_t *theFetch) {
+    ModelStreamLoader *aTask = (ModelStreamLoader *)theFetch->userData;
+    const bool hasData = theFetch->totalBytes == 0 || aTask->NbReceived > 0;
+    emscripten_fetch_close(theFetch);
+    if (!hasData) {
+      // data chunks are not delivered by this browser (chunked XHR without
+      // FETCH_STREAMING is Firefox-only); download again by buffered loader,
+      // which is usually served from HTTP cache
+      Message::SendWarning() << "Warning: streamed download is not supported, "
+                                "loading "
+                             << aTask->Path.c_str() << " at once";
+      OcctView::openFromUrl(aTask->Name, aTask->Path);
+      delete aTask;
+      return;
+    }
+    if (aTask->IsStl) {
+      aTask->finishStl();
+    } else {
+      OcctView::openFromMemory(aTask->Name,
+                               reinterpret_cast<uintptr_t>(aTask->Data.data()),
+                               (int)aTask->Data.size(), false);
+    }
+    delete aTask;
+  }
+
+  //! Download failed event.
+  static void onFailed(emscripten_fetch_t *theFetch) {
+    ModelStreamLoader *aTask = (ModelStreamLoader *)theFetch->userData;
+    Message::DefaultMessenger()->Send(
+        TCollection_AsciiString("Error: unable to load file ") +
+            aTask->Path.c_str(),
+        Message_Fail);
+    aTask->removeParts();
+    OcctView::Instance().UpdateView();
+    emscripten_fetch_close(theFetch);
+    delete aTask;
+  }
+};
+
 //! Auxiliary wrapper for loading cubemap.
 struct CubemapAsyncLoader {
   //! Image file read event.
@@ -102,6 +297,23 @@ struct CubemapAsyncLoader {
         Message_Fail);
   }
 };
+
+//! Cache storage within IDBFS mount point.
+//! Changes are written into IndexedDB asynchronously after each update.
+class IdbfsCacheStorage : public DirectoryCacheStorage {
+public:
+  IdbfsCacheStorage(const std::string &theDir)
+      : DirectoryCacheStorage(theDir) {}
+
+  virtual void Flush() override {
+    // FS is owned by the main thread, while cache may be updated by workers
+    MAIN_THREAD_ASYNC_EM_ASM(FS.syncfs(false, function(theErr) {
+      if (theErr) {
+        console.warn('Tessellation cache sync failed: ' + theErr);
+      }
+    }););
+  }
+};
 } // namespace
 
 // ================================================================
@@ -117,7 +329,12 @@ OcctView &OcctView::Instance() {
 // Function : WasmOcctView
 // Purpose  :
 // ================================================================
-OcctView::OcctView() : myDevicePixelRatio(1.0f), myUpdateRequests(0) {
+OcctView::OcctView()
+    : myPartMesher(new LazyPartMesher()),
+      myPrsBuilder(new SlicedMeshBuilder()), myMemoryCheckTime(0.0),
+      myNbBatchTaken(0), myStatsOverlayTime(0.0), myToCountElements(false),
+      myQualityLevel(0), myNbMsaaSamples(0), myFrameRequestTime(0.0),
+      myIsRefineQueued(false), myDevicePixelRatio(1.0f), myUpdateRequests(0) {
   addActionHotKeys(Aspect_VKey_NavForward, Aspect_VKey_W,
                    Aspect_VKey_W | Aspect_VKeyFlags_SHIFT);
   addActionHotKeys(Aspect_VKey_NavBackward, Aspect_VKey_S,
@@ -175,6 +392,7 @@ OcctView::~OcctView() {}
 // Purpose  :
 // ================================================================
 void OcctView::run(std::string canvasId) {
+  TraceRecorder::set_ThreadName("main");
   TCollection_AsciiString theCanvasId(canvasId.c_str());
   initWindow(theCanvasId);
   initViewer(theCanvasId);
@@ -421,7 +639,9 @@ void OcctView::ProcessInput() {
     // input is flushed by browser. Redrawing viewer on every single message
     // would be a pointless waste of resources, as user will see only the last
     // drawn frame due to WebGL implementation details.
+    myFrameStats.UpdateRequested();
     if (++myUpdateRequests == 1) {
+      myFrameRequestTime = emscripten_get_now();
       emscripten_async_call(onRedrawView, this, 0);
     }
   }
@@ -439,31 +659,455 @@ void OcctView::UpdateView() {
   }
 }
 
+// ================================================================
+// Function : AddObject
+// Purpose  :
+// ================================================================
+void OcctView::AddObject(const TCollection_AsciiString &theName,
+                         const Handle(AIS_InteractiveObject) & thePrs,
+                         int theDispMode) {
+  TRACE_SCOPE("presentation compute");
+  if (!theName.IsEmpty()) {
+    // previous object of the same name would be left untracked otherwise
+    if (Handle(AIS_InteractiveObject) *anOldPrs =
+            myObjects.ChangeSeek(theName)) {
+      myContext->Remove(*anOldPrs, false);
+      *anOldPrs = thePrs;
+    } else {
+      myObjects.Add(theName, thePrs);
+    }
+  }
+  // sliced presentations should be scheduled before their first computation
+  myPrsBuilder->Add(thePrs);
+  myContext->Display(thePrs, theDispMode, 0, false);
+  if (!myMesher.IsNull()) {
+    myMesher->Add(thePrs);
+  }
+  myPartMesher->Add(thePrs);
+}
+
+// ================================================================
+// Function : AddObjects
+// Purpose  :
+// ================================================================
+void OcctView::AddObjects(
+    const TCollection_AsciiString &theName,
+    const NCollection_Sequence<Handle(AIS_InteractiveObject)> &thePrsSeq,
+    int theDispMode) {
+  // parts left from the previous model of more presentations
+  for (int aPartIter = thePrsSeq.Size() + 1;; ++aPartIter) {
+    const TCollection_AsciiString aPartName =
+        objectPartName(theName, aPartIter);
+    Handle(AIS_InteractiveObject) anOldPrs;
+    if (theName.IsEmpty() || !myObjects.FindFromKey(aPartName, anOldPrs)) {
+      break;
+    }
+    myContext->Remove(anOldPrs, false);
+    myObjects.RemoveKey(aPartName);
+  }
+
+  int aPartIndex = 1;
+  for (NCollection_Sequence<Handle(AIS_InteractiveObject)>::Iterator aPrsIter(
+           thePrsSeq);
+       aPrsIter.More(); aPrsIter.Next(), ++aPartIndex) {
+    AddObject(objectPartName(theName, aPartIndex), aPrsIter.Value(),
+              theDispMode < 0 ? aPrsIter.Value()->DisplayMode() : theDispMode);
+  }
+}
+
+// ================================================================
+// Function : objectPartName
+// Purpose  :
+// ================================================================
+TCollection_AsciiString
+OcctView::objectPartName(const TCollection_AsciiString &theName,
+                         int theIndex) {
+  if (theIndex == 1 || theName.IsEmpty()) {
+    return theName;
+  }
+  return theName + ":" + theIndex;
+}
+
+// ================================================================
+// Function : nbObjectParts
+// Purpose  :
+// ================================================================
+int OcctView::nbObjectParts(const TCollection_AsciiString &theName) const {
+  int aNbParts = 0;
+  while (!theName.IsEmpty() &&
+         myObjects.Contains(objectPartName(theName, aNbParts + 1))) {
+    ++aNbParts;
+  }
+  return aNbParts;
+}
+
 // ================================================================
 // Function : redrawView
 // Purpose  :
 // ================================================================
 void OcctView::redrawView() {
   if (!myView.IsNull()) {
+    myFrameStats.TickStarted(emscripten_get_now());
+    processCompletedJobs();
+    refineNextBatch();
+    meshVisibleParts();
+    buildPresentations();
+    updateMemoryBudget();
+    updateStatsOverlay();
     FlushViewEvents(myContext, myView, true);
   }
 }
 
+// ================================================================
+// Function : loadQueue
+// Purpose  :
+// ================================================================
+const Handle(LoadJobQueue) & OcctView::loadQueue() {
+  if (myLoadQueue.IsNull()) {
+    myLoadQueue = new LoadJobQueue(1);
+  }
+  return myLoadQueue;
+}
+
+// ================================================================
+// Function : submitLoadJob
+// Purpose  :
+// ================================================================
+int OcctView::submitLoadJob(const Handle(LoadJob) & theJob) {
+  const bool wasIdle = !loadQueue()->HasPending() && myBatchQueue.IsNull();
+  const int aJobId = loadQueue()->Submit(theJob);
+  if (wasIdle) {
+    emscripten_async_call(onPollLoadJobs, this, THE_LOAD_POLL_INTERVAL);
+  }
+  return aJobId;
+}
+
+// ================================================================
+// Function : processCompletedJobs
+// Purpose  :
+// ================================================================
+void OcctView::processCompletedJobs() {
+  if (myLoadQueue.IsNull() || !myLoadQueue->HasCompleted()) {
+    return;
+  }
+
+  NCollection_Sequence<Handle(LoadJob)> aJobs;
+  myLoadQueue->TakeCompleted(aJobs);
+  bool toFit = false;
+  for (NCollection_Sequence<Handle(LoadJob)>::Iterator aJobIter(aJobs);
+       aJobIter.More(); aJobIter.Next()) {
+    const Handle(LoadJob) &aJob = aJobIter.Value();
+    if (aJob->IsKind(STANDARD_TYPE(FaceRefineJob))) {
+      if ((!myMesher.IsNull() && myMesher->Commit(aJob, myContext)) ||
+          myPartMesher->Commit(aJob, myContext) ||
+          (!myMemoryManager.IsNull() &&
+           myMemoryManager->Commit(aJob, myContext))) {
+        myView->Invalidate();
+      }
+      continue;
+    }
+    if (aJob->GetState() != LoadJob::State_Done) {
+      Message::DefaultMessenger()->Send(
+          TCollection_AsciiString(aJob->IsCancelled()
+                                      ? "Loading cancelled for "
+                                      : "Error: unable to load file ") +
+              aJob->Name(),
+          aJob->IsCancelled() ? Message_Info : Message_Fail);
+      continue;
+    }
+
+    Handle(ModelLoadJob) aModelJob = Handle(ModelLoadJob)::DownCast(aJob);
+    if (!aModelJob.IsNull()) {
+      setLoadStats(aJob->Name().ToCString(), aModelJob->Stats());
+    }
+    removeObject(aJob->Name().ToCString());
+    AddObjects(aJob->Name(), aJob->Presentations());
+    toFit = true;
+    Message::DefaultMessenger()->Send(
+        TCollection_AsciiString("Loaded file ") + aJob->Name(), Message_Info);
+  }
+
+  if (toFit) {
+    myView->FitAll(0.01, false);
+    myView->Invalidate();
+    Message::DefaultMessenger()->Send(OSD_MemInfo::PrintInfo(), Message_Trace);
+  }
+}
+
+// ================================================================
+// Function : refineNextBatch
+// Purpose  :
+// ================================================================
+void OcctView::refineNextBatch() {
+  if (myMesher.IsNull() || myMesher->IsRunning() || !myMesher->HasPending()) {
+    return;
+  }
+
+  // priorities follow the current camera, so refinement is scheduled
+  // from the redraw rather than right after the previous batch
+  Handle(LoadJob) aJob = myMesher->NextBatch(
+      myContext, myView, ModelFactory::GetInstance()->MeshParams());
+  if (!aJob.IsNull()) {
+    submitLoadJob(aJob);
+  }
+}
+
+// ================================================================
+// Function : meshVisibleParts
+// Purpose  :
+// ================================================================
+void OcctView::meshVisibleParts() {
+  if (myPartMesher->IsRunning() || !myPartMesher->HasPending()) {
+    return;
+  }
+
+  // placeholders are replaced by fine meshes, refinement is not needed
+  Handle(LoadJob) aJob = myPartMesher->NextBatch(
+      myContext, myView, ModelFactory::GetInstance()->MeshParams());
+  if (!aJob.IsNull()) {
+    submitLoadJob(aJob);
+  }
+}
+
+// ================================================================
+// Function : buildPresentations
+// Purpose  :
+// ================================================================
+void OcctView::buildPresentations() {
+  if (myPrsBuilder->HasPending() && myPrsBuilder->BuildSlice(myContext)) {
+    myView->Invalidate();
+  }
+  if (!myPrsBuilder->HasPending()) {
+    if (!myBuildProgress.IsNull()) {
+      myContext->Remove(myBuildProgress, false);
+      myBuildProgress.Nullify();
+    }
+    return;
+  }
+
+  if (myBuildProgress.IsNull()) {
+    myBuildProgress = new AIS_TextLabel();
+    myBuildProgress->SetColor(Quantity_NOC_GRAY95);
+    myBuildProgress->SetHeight(myTextStyle->Height());
+    myBuildProgress->SetFont(Font_NOF_ASCII_MONO);
+    myBuildProgress->SetHJustification(Graphic3d_HTA_LEFT);
+    myBuildProgress->SetVJustification(Graphic3d_VTA_BOTTOM);
+    myBuildProgress->SetZLayer(Graphic3d_ZLayerId_TopOSD);
+    myBuildProgress->SetTransformPersistence(
+        new Graphic3d_TransformPers(Graphic3d_TMF_2d, Aspect_TOTP_LEFT_LOWER,
+                                    Graphic3d_Vec2i(10, 10)));
+  }
+  TCollection_AsciiString aText("Building presentations: ");
+  aText += int(myPrsBuilder->Progress() * 100.0);
+  aText += "%";
+  myBuildProgress->SetText(aText);
+  if (myBuildProgress->HasInteractiveContext()) {
+    myContext->Redisplay(myBuildProgress, false);
+  } else {
+    myContext->Display(myBuildProgress, 0, -1, false);
+  }
+}
+
+// ================================================================
+// Function : pollLoadJobs
+// Purpose  :
+// ================================================================
+void OcctView::pollLoadJobs() {
+  const bool hasBatch = pollBatchJobs();
+  if (myLoadQueue.IsNull()) {
+    if (hasBatch) {
+      emscripten_async_call(onPollLoadJobs, this, THE_LOAD_POLL_INTERVAL);
+    }
+    return;
+  }
+
+  if (myLoadQueue->NbThreads() == 0) {
+    // no working threads - execute the next job within main loop
+    myLoadQueue->RunNext();
+  }
+  if (myLoadQueue->HasCompleted()) {
+    UpdateView();
+  }
+  if (myLoadQueue->HasPending() || hasBatch) {
+    emscripten_async_call(onPollLoadJobs, this, THE_LOAD_POLL_INTERVAL);
+  }
+}
+
+// ================================================================
+// Function : updateStatsOverlay
+// Purpose  :
+// ================================================================
+void OcctView::updateStatsOverlay() {
+  if (myStatsOverlay.IsNull()) {
+    return;
+  }
+
+  // overlay is refreshed only along with frames drawn anyway,
+  // so that it never requests redraws on its own
+  const double aTime = emscripten_get_now();
+  if (aTime - myStatsOverlayTime < THE_STATS_OVERLAY_INTERVAL) {
+    return;
+  }
+  myStatsOverlayTime = aTime;
+  myStatsOverlay->SetText(myFrameStats.ToString().c_str());
+  myContext->Redisplay(myStatsOverlay, false);
+}
+
+// ================================================================
+// Function : updateMemoryBudget
+// Purpose  :
+// ================================================================
+void OcctView::updateMemoryBudget() {
+  if (myMemoryManager.IsNull()) {
+    return;
+  }
+
+  const double aTime = emscripten_get_now();
+  if (aTime - myMemoryCheckTime < THE_MEMORY_CHECK_INTERVAL) {
+    return;
+  }
+  myMemoryCheckTime = aTime;
+  // unloaded objects back in the view are displayed again
+  if (myMemoryManager->UpdateVisibility(myObjects, myContext, myView,
+                                        aTime) > 0) {
+    myView->Invalidate();
+  }
+
+  // refinement in progress would override reduced triangulation
+  if ((!myMesher.IsNull() && myMesher->IsRunning()) ||
+      myPartMesher->IsRunning()) {
+    return;
+  }
+  Handle(LoadJob) aJob;
+  if (myMemoryManager->Enforce(myObjects, myContext, aJob) > 0) {
+    purgeGeometry();
+    myView->Invalidate();
+  }
+  if (!aJob.IsNull()) {
+    submitLoadJob(aJob);
+  }
+}
+
+// ================================================================
+// Function : purgeGeometry
+// Purpose  :
+// ================================================================
+void OcctView::purgeGeometry() {
+  const Handle(GeometryRegistry) &aGeometry =
+      ModelFactory::GetInstance()->Geometry();
+  if (!aGeometry.IsNull()) {
+    aGeometry->Purge();
+  }
+}
+
 // ================================================================
 // Function : handleViewRedraw
 // Purpose  :
 // ================================================================
 void OcctView::handleViewRedraw(const Handle(AIS_InteractiveContext) & theCtx,
                                 const Handle(V3d_View) & theView) {
+  TRACE_SCOPE("frame");
   myUpdateRequests = 0;
+  myFrameStats.RenderStarted(emscripten_get_now());
   AIS_ViewController::handleViewRedraw(theCtx, theView);
+  updateRenderQuality();
+
+  if (myPrsBuilder->HasPending()) {
+    // presentations are built in slices between frames
+    myToAskNextFrame = true;
+  }
+
+  int aNbTriangles = 0, aNbElements = 0;
+  if (myToCountElements) {
+    Handle(OpenGl_GraphicDriver) aDriver = Handle(OpenGl_GraphicDriver)::DownCast(
+        theCtx->CurrentViewer()->Driver());
+    const Graphic3d_FrameStatsData &aFrameData =
+        aDriver->GetSharedContext()->FrameStats()->LastDataFrame();
+    aNbTriangles =
+        (int)aFrameData[Graphic3d_FrameStatsCounter_NbTrianglesRendered];
+    aNbElements = (int)aFrameData[Graphic3d_FrameStatsCounter_NbElemsRendered];
+  }
+  myFrameStats.FrameFinished(emscripten_get_now(), aNbTriangles, aNbElements,
+                             !myToAskNextFrame);
   if (myToAskNextFrame) {
     // ask more frames
     ++myUpdateRequests;
+    myFrameRequestTime = emscripten_get_now();
     emscripten_async_call(onRedrawView, this, 0);
   }
 }
 
+// ================================================================
+// Function : isNavigating
+// Purpose  :
+// ================================================================
+bool OcctView::isNavigating() const {
+  // animations, inertia and navigation keys ask the next frame on their own
+  return myToAskNextFrame || myGL.OrbitRotation.ToRotate ||
+         myGL.ViewRotation.ToRotate || myGL.Panning.ToPan ||
+         !myGL.ZoomActions.IsEmpty();
+}
+
+// ================================================================
+// Function : updateRenderQuality
+// Purpose  :
+// ================================================================
+void OcctView::updateRenderQuality() {
+  if (!myQuality.IsEnabled() && myQualityLevel == 0) {
+    return;
+  }
+
+  const double aTime = emscripten_get_now();
+  if (isNavigating()) {
+    myQuality.NavigationFrame(aTime, myFrameRequestTime);
+  } else if (myQuality.Level() != 0) {
+    // short pauses of the input and held mouse buttons keep the quality
+    // of navigation, so that it doesn't flicker within a single gesture
+    const bool isHeld = myMouseActiveGesture != AIS_MouseGesture_NONE ||
+                        !myTouchPoints.IsEmpty();
+    const double aDelay = myQuality.IdleDelay(aTime);
+    if (isHeld || aDelay > 0.0) {
+      if (!myIsRefineQueued) {
+        myIsRefineQueued = true;
+        emscripten_async_call(onRefineView, this,
+                              isHeld ? 100 : (int)aDelay + 1);
+      }
+      return;
+    }
+    myQuality.NavigationStopped();
+  }
+
+  const int aLevel = myQuality.Level();
+  if (aLevel == myQualityLevel) {
+    return;
+  }
+  applyRenderQuality(aLevel);
+  if (aLevel == 0) {
+    // refine the last navigation frame
+    myView->Invalidate();
+    myToAskNextFrame = true;
+  }
+}
+
+// ================================================================
+// Function : applyRenderQuality
+// Purpose  :
+// ================================================================
+void OcctView::applyRenderQuality(int theLevel) {
+  myQualityLevel = theLevel;
+  Graphic3d_RenderingParams &aParams = myView->ChangeRenderingParams();
+  aParams.RenderResolutionScale = AdaptiveQuality::RenderScale(theLevel);
+  aParams.NbMsaaSamples =
+      AdaptiveQuality::HasMsaa(theLevel) ? myNbMsaaSamples : 0;
+
+  // presentations have no LODs, so that small objects are culled instead
+  const Handle(V3d_Viewer) &aViewer = myView->Viewer();
+  Graphic3d_ZLayerSettings aSettings =
+      aViewer->ZLayerSettings(Graphic3d_ZLayerId_Default);
+  aSettings.SetCullingSize(AdaptiveQuality::CullingSize(theLevel));
+  aViewer->SetZLayerSettings(Graphic3d_ZLayerId_Default, aSettings);
+}
+
 // ================================================================
 // Function : onResizeEvent
 // Purpose  :
@@ -507,6 +1151,7 @@ EM_BOOL OcctView::onMouseEvent(int theEventType,
     return EM_FALSE;
   }
 
+  myFrameStats.InputEvent(emscripten_get_now());
   Handle(Wasm_Window) aWindow = Handle(Wasm_Window)::DownCast(myView->Window());
   return aWindow->ProcessMouseEvent(*this, theEventType, theEvent) ? EM_TRUE
                                                                    : EM_FALSE;
@@ -522,6 +1167,7 @@ EM_BOOL OcctView::onWheelEvent(int theEventType,
     return EM_FALSE;
   }
 
+  myFrameStats.InputEvent(emscripten_get_now());
   Handle(Wasm_Window) aWindow = Handle(Wasm_Window)::DownCast(myView->Window());
   return aWindow->ProcessWheelEvent(*this, theEventType, theEvent) ? EM_TRUE
                                                                    : EM_FALSE;
@@ -537,6 +1183,7 @@ EM_BOOL OcctView::onTouchEvent(int theEventType,
     return EM_FALSE;
   }
 
+  myFrameStats.InputEvent(emscripten_get_now());
   Handle(Wasm_Window) aWindow = Handle(Wasm_Window)::DownCast(myView->Window());
   return aWindow->ProcessTouchEvent(*this, theEventType, theEvent) ? EM_TRUE
                                                                    : EM_FALSE;
@@ -587,6 +1234,7 @@ EM_BOOL OcctView::onKeyDownEvent(int theEventType,
     return EM_FALSE;
   }
 
+  myFrameStats.InputEvent(emscripten_get_now());
   Handle(Wasm_Window) aWindow = Handle(Wasm_Window)::DownCast(myView->Window());
   return aWindow->ProcessKeyEvent(*this, theEventType, theEvent) ? EM_TRUE
                                                                  : EM_FALSE;
@@ -710,6 +1358,13 @@ void OcctView::removeAllObjects() {
     aViewer.Context()->Remove(anObjIter.Value(), false);
   }
   aViewer.myObjects.Clear();
+  if (!aViewer.myMesher.IsNull()) {
+    aViewer.myMesher->Clear();
+  }
+  aViewer.myPartMesher->Clear();
+  aViewer.myPrsBuilder->Clear();
+  aViewer.myQuality.Reset();
+  aViewer.purgeGeometry();
   aViewer.UpdateView();
 }
 
@@ -726,7 +1381,16 @@ bool OcctView::removeObject(const std::string &theName) {
   }
 
   aViewer.Context()->Remove(anObj, false);
+  for (int aPartIter = aViewer.nbObjectParts(theName.c_str()); aPartIter > 1;
+       --aPartIter) {
+    const TCollection_AsciiString aPartName =
+        objectPartName(theName.c_str(), aPartIter);
+    aViewer.Context()->Remove(aViewer.myObjects.FindFromKey(aPartName), false);
+    aViewer.myObjects.RemoveKey(aPartName);
+  }
   aViewer.myObjects.RemoveKey(theName.c_str());
+  anObj.Nullify();
+  aViewer.purgeGeometry();
   aViewer.UpdateView();
   return true;
 }
@@ -744,6 +1408,12 @@ bool OcctView::eraseObject(const std::string &theName) {
   }
 
   aViewer.Context()->Erase(anObj, false);
+  for (int aPartIter = aViewer.nbObjectParts(theName.c_str()); aPartIter > 1;
+       --aPartIter) {
+    aViewer.Context()->Erase(aViewer.myObjects.FindFromKey(
+                                 objectPartName(theName.c_str(), aPartIter)),
+                             false);
+  }
   aViewer.UpdateView();
   return true;
 }
@@ -761,51 +1431,939 @@ bool OcctView::displayObject(const std::string &theName) {
   }
 
   aViewer.Context()->Display(anObj, false);
+  for (int aPartIter = aViewer.nbObjectParts(theName.c_str()); aPartIter > 1;
+       --aPartIter) {
+    aViewer.Context()->Display(aViewer.myObjects.FindFromKey(
+                                   objectPartName(theName.c_str(), aPartIter)),
+                               false);
+  }
   aViewer.UpdateView();
   return true;
 }
 
 // ================================================================
-// Function : openFromUrl
+// Function : getAssemblyTree
 // Purpose  :
 // ================================================================
-void OcctView::openFromUrl(const std::string &theName,
-                           const std::string &theModelPath) {
-  ModelAsyncLoader *aTask =
-      new ModelAsyncLoader(theName.c_str(), theModelPath.c_str());
-  emscripten_async_wget_data(theModelPath.c_str(), (void *)aTask,
-                             ModelAsyncLoader::onDataRead,
-                             ModelAsyncLoader::onReadFailed);
+std::string OcctView::getAssemblyTree(const std::string &theName) {
+  OcctView &aViewer = Instance();
+  Handle(AIS_InteractiveObject) anObj;
+  if (!aViewer.myObjects.FindFromKey(theName.c_str(), anObj)) {
+    return "[]";
+  }
+
+  Handle(StepAssembly) anAssembly =
+      Handle(StepAssembly)::DownCast(anObj->GetOwner());
+  return anAssembly.IsNull() ? "[]" : anAssembly->ToJson();
 }
 
 // ================================================================
-// Function : openFromMemory
+// Function : exportGlb
 // Purpose  :
 // ================================================================
-bool OcctView::openFromMemory(const std::string &theName, uintptr_t theBuffer,
-                              int theDataLen, bool theToFree) {
-  removeObject(theName);
-  char *aBytes = reinterpret_cast<char *>(theBuffer);
-  if (aBytes == nullptr || theDataLen <= 0) {
+bool OcctView::exportGlb(const std::string &thePath) {
+  OcctView &aViewer = Instance();
+  if (!GltfSceneWriter::Write(aViewer.myObjects, thePath.c_str())) {
+    Message::SendFail() << "Error: unable to write '" << thePath.c_str()
+                        << "'";
     return false;
   }
+  return true;
+}
+
+// ================================================================
+// Function : exportShape
+// Purpose  :
+// ================================================================
+bool OcctView::exportShape(const std::string &theName,
+                           const std::string &thePath) {
+  OcctView &aViewer = Instance();
+  Handle(AIS_InteractiveObject) anObj;
+  if (!aViewer.myObjects.FindFromKey(theName.c_str(), anObj)) {
+    Message::SendFail() << "Error: unknown object '" << theName.c_str()
+                        << "'";
+    return false;
+  }
+
+  // shared masters are written with locations of their instances
+  NCollection_Sequence<GeometryRegistry::Placement> aPlacements;
+  for (int aPartIter = aViewer.nbObjectParts(theName.c_str()); aPartIter > 0;
+       --aPartIter) {
+    GeometryRegistry::Placements(aViewer.myObjects.FindFromKey(objectPartName(
+                                     theName.c_str(), aPartIter)),
+                                 aPlacements);
+  }
+  TopoDS_Compound aCompound;
+  BRep_Builder aBuilder;
+  aBuilder.MakeCompound(aCompound);
+  TopoDS_Shape aShape;
+  int aNbShapes = 0;
+  for (NCollection_Sequence<GeometryRegistry::Placement>::Iterator
+           aPlacementIter(aPlacements);
+       aPlacementIter.More(); aPlacementIter.Next()) {
+    const GeometryRegistry::Placement &aPlacement = aPlacementIter.Value();
+    Handle(AIS_Shape) aShapePrs =
+        Handle(AIS_Shape)::DownCast(aPlacement.Master);
+    if (!aShapePrs.IsNull()) {
+      aShape = aShapePrs->Shape().Moved(TopLoc_Location(aPlacement.Trsf));
+      aBuilder.Add(aCompound, aShape);
+      ++aNbShapes;
+    }
+  }
+  if (aNbShapes == 0) {
+    Message::SendFail() << "Error: object '" << theName.c_str()
+                        << "' has no shapes";
+    return false;
+  }
+  if (aNbShapes > 1) {
+    aShape = aCompound;
+  }
+
+  bool isDone = false;
+  if (test_file_extension(thePath, ".brep") ||
+      test_file_extension(thePath, ".bbrep")) {
+    std::ofstream aStream(thePath.c_str(), std::ios::binary);
+    if (test_file_extension(thePath, ".brep")) {
+      BRepTools::Write(aShape, aStream, Standard_True, Standard_True,
+                       TopTools_FormatVersion_CURRENT);
+    } else {
+      BinTools::Write(aShape, aStream, Standard_True, Standard_True,
+                      BinTools_FormatVersion_CURRENT);
+    }
+    isDone = aStream.good();
+  } else if (test_file_extension(thePath, ".xbf")) {
+    std::ofstream aStream(thePath.c_str(), std::ios::binary);
+    isDone = StepAssembly::SaveXbf(aShape, aStream);
+  } else if (test_file_extension(thePath, ".step") ||
+             test_file_extension(thePath, ".stp")) {
+    STEPControl_Writer aWriter;
+    isDone = aWriter.Transfer(aShape, STEPControl_AsIs) == IFSelect_RetDone &&
+             aWriter.Write(thePath.c_str()) == IFSelect_RetDone;
+  } else {
+    Message::SendFail() << "Error: unsupported format of '" << thePath.c_str()
+                        << "'";
+    return false;
+  }
+  if (!isDone) {
+    Message::SendFail() << "Error: unable to write '" << thePath.c_str()
+                        << "'";
+  }
+  return isDone;
+}
+
+// ================================================================
+// Function : setGeometrySharing
+// Purpose  :
+// ================================================================
+void OcctView::setGeometrySharing(bool theToShare) {
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  if (!theToShare) {
+    aFactory->SetGeometry(Handle(GeometryRegistry)());
+  } else if (aFactory->Geometry().IsNull()) {
+    aFactory->SetGeometry(new GeometryRegistry());
+  }
+}
+
+// ================================================================
+// Function : getGeometryStats
+// Purpose  :
+// ================================================================
+std::string OcctView::getGeometryStats() {
+  const Handle(GeometryRegistry) &aGeometry =
+      ModelFactory::GetInstance()->Geometry();
+  return aGeometry.IsNull() ? "{}" : aGeometry->Report();
+}
+
+// ================================================================
+// Function : saveSceneSnapshot
+// Purpose  :
+// ================================================================
+bool OcctView::saveSceneSnapshot(const std::string &thePath) {
+  OcctView &aViewer = Instance();
+  std::ofstream aStream(thePath.c_str(), std::ios::binary);
+  if (!SceneSnapshot::Write(aStream, aViewer.myObjects, aViewer.Context(),
+                            aViewer.View()->Camera())) {
+    Message::SendFail() << "Error: unable to write '" << thePath.c_str()
+                        << "'";
+    return false;
+  }
+  return true;
+}
+
+// ================================================================
+// Function : loadSceneSnapshot
+// Purpose  :
+// ================================================================
+bool OcctView::loadSceneSnapshot(uintptr_t theBuffer, int theDataLen,
+                                 bool theToFree) {
+  OcctView &aViewer = Instance();
+  char *aRawData = reinterpret_cast<char *>(theBuffer);
+  SceneSnapshot aSnapshot;
+  ModelLoadStats aStats;
+  const bool isDone = aRawData != nullptr && theDataLen > 0 &&
+                      aSnapshot.Read(aRawData, theDataLen, &aStats);
+  if (theToFree) {
+    free(aRawData);
+  }
+  if (!isDone) {
+    Message::SendFail() << "Error: invalid scene snapshot";
+    return false;
+  }
+
+  removeAllObjects();
+  for (const SceneSnapshot::Object &anObject : aSnapshot.Objects()) {
+    aViewer.AddObject(anObject.Name, anObject.Prs, anObject.DisplayMode);
+    if (!anObject.IsVisible) {
+      aViewer.Context()->Erase(anObject.Prs, false);
+    }
+  }
+  aViewer.setLoadStats("snapshot", aStats);
+  aSnapshot.RestoreCamera(aViewer.View()->Camera());
+  aViewer.View()->Invalidate();
+  aViewer.UpdateView();
+  return true;
+}
+
+// ================================================================
+// Function : openFromUrl
+// Purpose  :
+// ================================================================
+void OcctView::openFromUrl(const std::string &theName,
+                           const std::string &theModelPath) {
+  ModelAsyncLoader *aTask =
+      new ModelAsyncLoader(theName.c_str(), theModelPath.c_str());
+  emscripten_async_wget_data(theModelPath.c_str(), (void *)aTask,
+                             ModelAsyncLoader::onDataRead,
+                             ModelAsyncLoader::onReadFailed);
+}
+
+// ================================================================
+// Function : openFromUrlStreamed
+// Purpose  :
+// ================================================================
+void OcctView::openFromUrlStreamed(const std::string &theName,
+                                   const std::string &theModelPath,
+                                   int theFacetsPerUpdate) {
+  removeObject(theName);
+  ModelStreamLoader *aTask =
+      new ModelStreamLoader(theName.c_str(), theModelPath.c_str(),
+                            (size_t)Max(theFacetsPerUpdate, 0));
+
+  emscripten_fetch_attr_t anAttr;
+  emscripten_fetch_attr_init(&anAttr);
+  strcpy(anAttr.requestMethod, "GET");
+  // data is delivered by chunks to onProgress() and is not kept by fetch;
+  // chunks are passed only along with EMSCRIPTEN_FETCH_LOAD_TO_MEMORY
+  anAttr.attributes =
+      EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_STREAM_DATA;
+  anAttr.userData = aTask;
+  anAttr.onprogress = ModelStreamLoader::onProgress;
+  anAttr.onsuccess = ModelStreamLoader::onSucceeded;
+  anAttr.onerror = ModelStreamLoader::onFailed;
+  emscripten_fetch(&anAttr, theModelPath.c_str());
+}
+
+// ================================================================
+// Function : openFromMemory
+// Purpose  :
+// ================================================================
+bool OcctView::openFromMemory(const std::string &theName, uintptr_t theBuffer,
+                              int theDataLen, bool theToFree) {
+  removeObject(theName);
+  char *aBytes = reinterpret_cast<char *>(theBuffer);
+  if (aBytes == nullptr || theDataLen <= 0) {
+    return false;
+  }
+
+  if (test_file_extension(theName, ".brep") ||
+      test_file_extension(theName, ".bbrep")) {
+    return openBRepFromMemory(theName, theBuffer, theDataLen, theToFree);
+  } else if (test_file_extension(theName, ".stl")) {
+    return openStlFromMemory(theName, theBuffer, theDataLen, theToFree);
+  } else if (test_file_extension(theName, ".step") ||
+             test_file_extension(theName, ".xbf") ||
+             test_file_extension(theName, ".glb")) {
+    return openSTEPFromMemory(theName, theBuffer, theDataLen, theToFree);
+  } else if (test_file_extension(theName, ".omsh")) {
+    return openMeshPackFromMemory(theName, theBuffer, theDataLen, theToFree);
+  }
+  if (theToFree) {
+    free(aBytes);
+  }
 
-  if (test_file_extension(theName, ".brep")) {
-    return openBRepFromMemory(theName, theBuffer, theDataLen, theToFree);
-  } else if (test_file_extension(theName, ".stl")) {
-    return openStlFromMemory(theName, theBuffer, theDataLen, theToFree);
-  } else if (test_file_extension(theName, ".step")) {
-    return openSTEPFromMemory(theName, theBuffer, theDataLen, theToFree);
-  }
-  if (theToFree) {
-    free(aBytes);
-  }
-
   Message::SendFail() << "Error: file '" << theName.c_str()
                       << "' has unsupported format";
   return false;
 }
 
+// ================================================================
+// Function : openFromMemoryAsync
+// Purpose  :
+// ================================================================
+int OcctView::openFromMemoryAsync(const std::string &theName,
+                                  uintptr_t theBuffer, int theDataLen,
+                                  bool theToFree) {
+  char *aBytes = reinterpret_cast<char *>(theBuffer);
+  if (aBytes == nullptr || theDataLen <= 0 ||
+      !ModelLoadJob::IsSupported(theName.c_str())) {
+    if (theToFree) {
+      free(aBytes);
+    }
+    Message::SendFail() << "Error: file '" << theName.c_str()
+                        << "' has unsupported format";
+    return -1;
+  }
+
+  if (!theToFree) {
+    // caller keeps ownership and may release buffer before job is executed
+    char *aCopy = (char *)malloc(theDataLen);
+    if (aCopy == nullptr) {
+      return -1;
+    }
+    memcpy(aCopy, aBytes, theDataLen);
+    aBytes = aCopy;
+  }
+
+  return Instance().submitLoadJob(
+      new ModelLoadJob(theName.c_str(), aBytes, (size_t)theDataLen,
+                       ModelFactory::GetInstance()->MeshParams()));
+}
+
+// ================================================================
+// Function : beginBatchImport
+// Purpose  :
+// ================================================================
+void OcctView::beginBatchImport() { Instance().myBatchJobs.Clear(); }
+
+// ================================================================
+// Function : addBatchItem
+// Purpose  :
+// ================================================================
+bool OcctView::addBatchItem(const std::string &theName, uintptr_t theBuffer,
+                            int theDataLen, bool theToFree) {
+  char *aBytes = reinterpret_cast<char *>(theBuffer);
+  if (aBytes == nullptr || theDataLen <= 0 ||
+      !ModelLoadJob::IsSupported(theName.c_str())) {
+    if (theToFree) {
+      free(aBytes);
+    }
+    Message::SendFail() << "Error: file '" << theName.c_str()
+                        << "' has unsupported format";
+    return false;
+  }
+
+  if (!theToFree) {
+    char *aCopy = (char *)malloc(theDataLen);
+    if (aCopy == nullptr) {
+      return false;
+    }
+    memcpy(aCopy, aBytes, theDataLen);
+    aBytes = aCopy;
+  }
+
+  Instance().myBatchJobs.Append(
+      new ModelLoadJob(theName.c_str(), aBytes, (size_t)theDataLen,
+                       ModelFactory::GetInstance()->MeshParams()));
+  return true;
+}
+
+// ================================================================
+// Function : commitBatchImport
+// Purpose  :
+// ================================================================
+int OcctView::commitBatchImport() {
+  OcctView &aViewer = Instance();
+  if (aViewer.myBatchJobs.IsEmpty()) {
+    return 0;
+  }
+  if (!aViewer.myBatchQueue.IsNull()) {
+    Message::SendFail() << "Error: previous batch is still being loaded";
+    return -1;
+  }
+
+  // one worker per logical processor, parts are loaded independently;
+  // the main thread never waits for the pool, as workers may need it
+  // (proxied file system calls, start of Web Workers)
+  aViewer.myBatchLoading.Clear();
+  aViewer.myBatchLoading.Append(aViewer.myBatchJobs);
+  aViewer.myNbBatchTaken = 0;
+  aViewer.myBatchQueue = new LoadJobQueue(0);
+  for (NCollection_Sequence<Handle(LoadJob)>::Iterator aJobIter(
+           aViewer.myBatchLoading);
+       aJobIter.More(); aJobIter.Next()) {
+    aViewer.myBatchQueue->Submit(aJobIter.Value());
+  }
+  if (aViewer.myLoadQueue.IsNull() || !aViewer.myLoadQueue->HasPending()) {
+    emscripten_async_call(onPollLoadJobs, &aViewer, THE_LOAD_POLL_INTERVAL);
+  }
+  return aViewer.myBatchLoading.Size();
+}
+
+// ================================================================
+// Function : pollBatchJobs
+// Purpose  :
+// ================================================================
+bool OcctView::pollBatchJobs() {
+  if (myBatchQueue.IsNull()) {
+    return false;
+  }
+
+  if (myBatchQueue->NbThreads() == 0) {
+    // no working threads - execute the next job within main loop
+    myBatchQueue->RunNext();
+  }
+  // results are taken from myBatchLoading to keep the order of files
+  NCollection_Sequence<Handle(LoadJob)> aCompleted;
+  myBatchQueue->TakeCompleted(aCompleted);
+  myNbBatchTaken += aCompleted.Size();
+  if (myNbBatchTaken < myBatchLoading.Size()) {
+    return true;
+  }
+
+  myBatchQueue.Nullify();
+  commitBatch();
+  return false;
+}
+
+// ================================================================
+// Function : commitBatch
+// Purpose  :
+// ================================================================
+void OcctView::commitBatch() {
+  // commit the whole batch to the scene within a single transaction,
+  // keeping the order in which files were added
+  int aNbLoaded = 0;
+  for (NCollection_Sequence<Handle(LoadJob)>::Iterator aJobIter(
+           myBatchLoading);
+       aJobIter.More(); aJobIter.Next()) {
+    const Handle(LoadJob) &aJob = aJobIter.Value();
+    if (aJob->GetState() != LoadJob::State_Done) {
+      Message::DefaultMessenger()->Send(
+          TCollection_AsciiString("Error: unable to load file ") + aJob->Name(),
+          Message_Fail);
+      continue;
+    }
+
+    Handle(ModelLoadJob) aModelJob = Handle(ModelLoadJob)::DownCast(aJob);
+    if (!aModelJob.IsNull()) {
+      setLoadStats(aJob->Name().ToCString(), aModelJob->Stats());
+    }
+    Handle(AIS_InteractiveObject) anOldObj;
+    if (myObjects.FindFromKey(aJob->Name(), anOldObj)) {
+      myContext->Remove(anOldObj, false);
+      myObjects.RemoveKey(aJob->Name());
+    }
+    AddObjects(aJob->Name(), aJob->Presentations());
+    ++aNbLoaded;
+  }
+  myBatchLoading.Clear();
+
+  myView->FitAll(0.01, false);
+  UpdateView();
+
+  Message::DefaultMessenger()->Send(
+      TCollection_AsciiString("Loaded files: ") + aNbLoaded, Message_Info);
+  Message::DefaultMessenger()->Send(OSD_MemInfo::PrintInfo(), Message_Trace);
+}
+
+// ================================================================
+// Function : setMeshParameters
+// Purpose  :
+// ================================================================
+void OcctView::setMeshParameters(double theDeflection, double theAngleDeg,
+                                 bool theIsRelative) {
+  ModelMeshParams aParams = ModelFactory::GetInstance()->MeshParams();
+  aParams.Deflection = theDeflection;
+  aParams.Angle = theAngleDeg * M_PI / 180.0;
+  aParams.IsRelative = theIsRelative;
+  ModelFactory::GetInstance()->SetMeshParams(aParams);
+}
+
+// ================================================================
+// Function : setProgressiveMeshing
+// Purpose  :
+// ================================================================
+void OcctView::setProgressiveMeshing(bool theToEnable, int theFacesPerBatch) {
+  ModelMeshParams aParams = ModelFactory::GetInstance()->MeshParams();
+  aParams.IsProgressive = theToEnable;
+  ModelFactory::GetInstance()->SetMeshParams(aParams);
+
+  OcctView &aViewer = Instance();
+  if (!theToEnable) {
+    // already refined faces are shown on the next update of their objects
+    aViewer.myMesher.Nullify();
+  } else if (aViewer.myMesher.IsNull()) {
+    aViewer.myMesher = new ProgressiveMesher(theFacesPerBatch);
+  }
+}
+
+// ================================================================
+// Function : getPendingRefinement
+// Purpose  :
+// ================================================================
+int OcctView::getPendingRefinement() {
+  OcctView &aViewer = Instance();
+  return aViewer.myMesher.IsNull() ? 0 : aViewer.myMesher->NbPending();
+}
+
+// ================================================================
+// Function : setLazyAssemblies
+// Purpose  :
+// ================================================================
+void OcctView::setLazyAssemblies(bool theToEnable, double theMinSize) {
+  ModelMeshParams aParams = ModelFactory::GetInstance()->MeshParams();
+  aParams.IsLazy = theToEnable;
+  ModelFactory::GetInstance()->SetMeshParams(aParams);
+
+  // placeholders already displayed are still meshed once visible
+  Instance().myPartMesher->SetMinSize(theMinSize);
+}
+
+// ================================================================
+// Function : setSlicedPresentations
+// Purpose  :
+// ================================================================
+void OcctView::setSlicedPresentations(bool theToEnable, double theBudget) {
+  ModelMeshParams aParams = ModelFactory::GetInstance()->MeshParams();
+  aParams.IsSliced = theToEnable;
+  ModelFactory::GetInstance()->SetMeshParams(aParams);
+
+  // presentations already being built keep building with the new budget
+  Instance().myPrsBuilder->SetBudget(std::max(theBudget, 1.0));
+}
+
+// ================================================================
+// Function : getBuildProgress
+// Purpose  :
+// ================================================================
+double OcctView::getBuildProgress() {
+  const Handle(SlicedMeshBuilder) &aBuilder = Instance().myPrsBuilder;
+  return aBuilder->HasPending() ? aBuilder->Progress() : -1.0;
+}
+
+// ================================================================
+// Function : setAdaptiveQuality
+// Purpose  :
+// ================================================================
+void OcctView::setAdaptiveQuality(bool theToEnable, double theFrameTime,
+                                  int theNbMsaaSamples) {
+  OcctView &aViewer = Instance();
+  aViewer.myQuality.SetEnabled(theToEnable);
+  aViewer.myQuality.SetTarget(std::max(theFrameTime, 1.0));
+  aViewer.myNbMsaaSamples = std::max(theNbMsaaSamples, 0);
+  if (aViewer.myView.IsNull()) {
+    return;
+  }
+
+  aViewer.applyRenderQuality(0);
+  aViewer.myView->Invalidate();
+  aViewer.UpdateView();
+}
+
+// ================================================================
+// Function : getRenderQuality
+// Purpose  :
+// ================================================================
+int OcctView::getRenderQuality() { return Instance().myQualityLevel; }
+
+// ================================================================
+// Function : getPendingParts
+// Purpose  :
+// ================================================================
+int OcctView::getPendingParts() {
+  return Instance().myPartMesher->NbPending();
+}
+
+// ================================================================
+// Function : enableFrameStats
+// Purpose  :
+// ================================================================
+void OcctView::enableFrameStats(bool theToCountElements,
+                                bool theToShowOverlay) {
+  OcctView &aViewer = Instance();
+  if (aViewer.myView.IsNull()) {
+    return;
+  }
+
+  aViewer.myToCountElements = theToCountElements;
+  Graphic3d_RenderingParams &aParams = aViewer.myView->ChangeRenderingParams();
+  const Graphic3d_RenderingParams::PerfCounters aCounters =
+      Graphic3d_RenderingParams::PerfCounters(
+          Graphic3d_RenderingParams::PerfCounters_Triangles |
+          Graphic3d_RenderingParams::PerfCounters_Elements);
+  aParams.CollectedStats = Graphic3d_RenderingParams::PerfCounters(
+      theToCountElements ? (aParams.CollectedStats | aCounters)
+                         : (aParams.CollectedStats & ~aCounters));
+
+  if (theToShowOverlay && aViewer.myStatsOverlay.IsNull()) {
+    aViewer.myStatsOverlay = new AIS_TextLabel();
+    aViewer.myStatsOverlay->SetText(aViewer.myFrameStats.ToString().c_str());
+    aViewer.myStatsOverlay->SetColor(Quantity_NOC_GRAY95);
+    aViewer.myStatsOverlay->SetHeight(aViewer.myTextStyle->Height());
+    aViewer.myStatsOverlay->SetFont(Font_NOF_ASCII_MONO);
+    aViewer.myStatsOverlay->SetHJustification(Graphic3d_HTA_LEFT);
+    aViewer.myStatsOverlay->SetVJustification(Graphic3d_VTA_TOP);
+    aViewer.myStatsOverlay->SetZLayer(Graphic3d_ZLayerId_TopOSD);
+    aViewer.myStatsOverlay->SetTransformPersistence(
+        new Graphic3d_TransformPers(Graphic3d_TMF_2d, Aspect_TOTP_LEFT_UPPER,
+                                    Graphic3d_Vec2i(10, 10)));
+    aViewer.Context()->Display(aViewer.myStatsOverlay, 0, -1, false);
+  } else if (!theToShowOverlay && !aViewer.myStatsOverlay.IsNull()) {
+    aViewer.Context()->Remove(aViewer.myStatsOverlay, false);
+    aViewer.myStatsOverlay.Nullify();
+  }
+  aViewer.UpdateView();
+}
+
+// ================================================================
+// Function : getFrameStats
+// Purpose  :
+// ================================================================
+std::string OcctView::getFrameStats() {
+  return Instance().myFrameStats.ToJson();
+}
+
+// ================================================================
+// Function : resetFrameStats
+// Purpose  :
+// ================================================================
+void OcctView::resetFrameStats() { Instance().myFrameStats.Reset(); }
+
+// ================================================================
+// Function : enableTracing
+// Purpose  :
+// ================================================================
+void OcctView::enableTracing(bool theToEnable) {
+  TraceRecorder::set_Enabled(theToEnable);
+}
+
+// ================================================================
+// Function : getTraceJson
+// Purpose  :
+// ================================================================
+std::string OcctView::getTraceJson() { return TraceRecorder::ToJson(); }
+
+// ================================================================
+// Function : clearTrace
+// Purpose  :
+// ================================================================
+void OcctView::clearTrace() { TraceRecorder::Clear(); }
+
+// ================================================================
+// Function : enableAllocProfiler
+// Purpose  :
+// ================================================================
+void OcctView::enableAllocProfiler(bool theToEnable) {
+  if (theToEnable && !AllocProfiler::IsAvailable()) {
+    Message::DefaultMessenger()->Send(
+        "Warning: allocation profiler is not built in", Message_Warning);
+  }
+  AllocProfiler::set_Enabled(theToEnable);
+}
+
+// ================================================================
+// Function : getAllocProfile
+// Purpose  :
+// ================================================================
+std::string OcctView::getAllocProfile() { return AllocProfiler::ToJson(); }
+
+// ================================================================
+// Function : clearAllocProfile
+// Purpose  :
+// ================================================================
+void OcctView::clearAllocProfile() { AllocProfiler::Clear(); }
+
+// ================================================================
+// Function : setMemoryBudget
+// Purpose  :
+// ================================================================
+void OcctView::setMemoryBudget(int theBudgetMb) {
+  OcctView &aViewer = Instance();
+  if (aViewer.myMemoryManager.IsNull()) {
+    aViewer.myMemoryManager = new SceneMemoryManager();
+  }
+  const Standard_Size aBudgetMb = theBudgetMb > 0 ? theBudgetMb : 0;
+  aViewer.myMemoryManager->SetBudget(aBudgetMb * 1024 * 1024);
+  aViewer.myMemoryCheckTime = 0.0;
+  aViewer.UpdateView();
+}
+
+// ================================================================
+// Function : getMemoryReport
+// Purpose  :
+// ================================================================
+std::string OcctView::getMemoryReport() {
+  OcctView &aViewer = Instance();
+  if (aViewer.myMemoryManager.IsNull()) {
+    aViewer.myMemoryManager = new SceneMemoryManager();
+  }
+  return aViewer.myMemoryManager->Report(aViewer.myObjects);
+}
+
+// ================================================================
+// Function : getLoadStats
+// Purpose  :
+// ================================================================
+std::string OcctView::getLoadStats() { return Instance().myLoadStats; }
+
+// ================================================================
+// Function : benchmarkLoad
+// Purpose  :
+// ================================================================
+std::string OcctView::benchmarkLoad(const std::string &theName,
+                                    uintptr_t theBuffer, int theDataLen,
+                                    int theNbRuns) {
+  const char *aBytes = reinterpret_cast<const char *>(theBuffer);
+  if (aBytes == nullptr || theDataLen <= 0 ||
+      !ModelLoadJob::IsSupported(theName.c_str())) {
+    return std::string();
+  }
+
+  // every run should parse and mesh the data from scratch
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  const Handle(TessellationCache) aCache = aFactory->MeshCache();
+  const Handle(GeometryRegistry) aGeometry = aFactory->Geometry();
+  aFactory->SetMeshCache(Handle(TessellationCache)());
+  aFactory->SetGeometry(Handle(GeometryRegistry)());
+
+  double aTotalTime = 0.0, aMinTime = 0.0;
+  int aNbDone = 0;
+  ModelLoadStats aStats;
+  for (int aRunIter = 0; aRunIter < theNbRuns; ++aRunIter) {
+    // job takes ownership of its buffer
+    char *aCopy = (char *)malloc(theDataLen);
+    if (aCopy == nullptr) {
+      break;
+    }
+    memcpy(aCopy, aBytes, theDataLen);
+    Handle(ModelLoadJob) aJob = new ModelLoadJob(
+        theName.c_str(), aCopy, (size_t)theDataLen, aFactory->MeshParams());
+    const double aStartTime = emscripten_get_now();
+    aJob->Execute();
+    const double aTime = emscripten_get_now() - aStartTime;
+    if (aJob->GetState() != LoadJob::State_Done) {
+      break;
+    }
+    aTotalTime += aTime;
+    aMinTime = aNbDone == 0 ? aTime : std::min(aMinTime, aTime);
+    aStats = aJob->Stats();
+    ++aNbDone;
+  }
+
+  aFactory->SetMeshCache(aCache);
+  aFactory->SetGeometry(aGeometry);
+  if (aNbDone == 0) {
+    return std::string();
+  }
+
+  std::ostringstream aResult;
+  aResult << "{\"size\":" << theDataLen << ",\"runs\":" << aNbDone
+          << ",\"mean_ms\":" << aTotalTime / aNbDone
+          << ",\"min_ms\":" << aMinTime << ",\"stages\":" << aStats.ToJson()
+          << "}";
+  return aResult.str();
+}
+
+// ================================================================
+// Function : initHeadless
+// Purpose  :
+// ================================================================
+bool OcctView::initHeadless() {
+  OcctView &aViewer = Instance();
+  if (!aViewer.myContext.IsNull()) {
+    return false;
+  }
+
+  TraceRecorder::set_ThreadName("main");
+  // structures are created by the driver without GL context,
+  // while the view without window skips redrawing
+  Handle(Aspect_DisplayConnection) aDisp;
+  Handle(OpenGl_GraphicDriver) aDriver = new OpenGl_GraphicDriver(aDisp, false);
+  Handle(V3d_Viewer) aViewer3d = new V3d_Viewer(aDriver);
+  aViewer3d->SetComputedMode(false);
+  aViewer3d->SetDefaultShadingModel(Graphic3d_TOSM_FRAGMENT);
+  aViewer3d->SetDefaultLights();
+  aViewer3d->SetLightOn();
+
+  aViewer.myTextStyle = new Prs3d_TextAspect();
+  aViewer.myView = new V3d_View(aViewer3d);
+  aViewer.myView->SetImmediateUpdate(false);
+  aViewer.myContext = new AIS_InteractiveContext(aViewer3d);
+  Message::SendInfo() << "Headless viewer initialized";
+  return true;
+}
+
+// ================================================================
+// Function : benchmarkOpen
+// Purpose  :
+// ================================================================
+std::string OcctView::benchmarkOpen(const std::string &theName,
+                                    uintptr_t theBuffer, int theDataLen,
+                                    int theNbRuns) {
+  OcctView &aViewer = Instance();
+  const char *aBytes = reinterpret_cast<const char *>(theBuffer);
+  if (aViewer.myView.IsNull() || aBytes == nullptr || theDataLen <= 0) {
+    return std::string();
+  }
+
+  // every run should parse and mesh the data from scratch
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  const Handle(TessellationCache) aCache = aFactory->MeshCache();
+  const Handle(GeometryRegistry) aGeometry = aFactory->Geometry();
+  aFactory->SetMeshCache(Handle(TessellationCache)());
+  aFactory->SetGeometry(Handle(GeometryRegistry)());
+
+  enum {
+    Stage_Parse,
+    Stage_Mesh,
+    Stage_Prs,
+    Stage_Frame,
+    Stage_Total,
+    Stage_NB
+  };
+  static const char *THE_STAGE_NAMES[Stage_NB] = {"parse", "mesh",
+                                                  "presentation", "frame",
+                                                  "total"};
+  double aMinTimes[Stage_NB] = {}, aSumTimes[Stage_NB] = {};
+  int aNbDone = 0;
+  for (int aRunIter = 0; aRunIter < theNbRuns; ++aRunIter) {
+    // openFromMemory() takes ownership of its buffer
+    char *aCopy = (char *)malloc(theDataLen);
+    if (aCopy == nullptr) {
+      break;
+    }
+    memcpy(aCopy, aBytes, theDataLen);
+    removeObject(theName);
+
+    const double aStartTime = emscripten_get_now();
+    if (!openFromMemory(theName, reinterpret_cast<uintptr_t>(aCopy),
+                        theDataLen, true)) {
+      break;
+    }
+    const double aLoadTime = emscripten_get_now() - aStartTime;
+    aViewer.redrawView();
+    const double aTotalTime = emscripten_get_now() - aStartTime;
+
+    // stage statistics are in seconds, presentation covers the rest of load
+    const ModelLoadStats &aStats = aViewer.myLastStats;
+    double aTimes[Stage_NB];
+    aTimes[Stage_Parse] = (aStats.ReadTime + aStats.TransferTime) * 1000.0;
+    aTimes[Stage_Mesh] = aStats.MeshTime * 1000.0;
+    aTimes[Stage_Prs] =
+        std::max(aLoadTime - aTimes[Stage_Parse] - aTimes[Stage_Mesh], 0.0);
+    aTimes[Stage_Frame] = aTotalTime - aLoadTime;
+    aTimes[Stage_Total] = aTotalTime;
+    for (int aStageIter = 0; aStageIter < Stage_NB; ++aStageIter) {
+      aSumTimes[aStageIter] += aTimes[aStageIter];
+      aMinTimes[aStageIter] = aNbDone == 0 ? aTimes[aStageIter]
+                                           : std::min(aMinTimes[aStageIter],
+                                                      aTimes[aStageIter]);
+    }
+    ++aNbDone;
+  }
+
+  aFactory->SetMeshCache(aCache);
+  aFactory->SetGeometry(aGeometry);
+  if (aNbDone == 0) {
+    return std::string();
+  }
+
+  // peak is the maximum footprint of the heap since startup
+  OSD_MemInfo aMemInfo(false);
+  aMemInfo.SetActive(OSD_MemInfo::MemHeapUsage, true);
+  aMemInfo.SetActive(OSD_MemInfo::MemWorkingSetPeak, true);
+  aMemInfo.Update();
+
+  std::ostringstream aResult;
+  aResult << "{\"size\":" << theDataLen << ",\"runs\":" << aNbDone
+          << ",\"headless\":"
+          << (aViewer.myView->Window().IsNull() ? "true" : "false")
+          << ",\"triangles\":" << aViewer.myLastStats.NbTriangles
+          << ",\"stages\":{";
+  for (int aStageIter = 0; aStageIter < Stage_NB; ++aStageIter) {
+    aResult << (aStageIter == 0 ? "" : ",") << "\""
+            << THE_STAGE_NAMES[aStageIter] << "\":{\"min_ms\":"
+            << aMinTimes[aStageIter]
+            << ",\"mean_ms\":" << aSumTimes[aStageIter] / aNbDone << "}";
+  }
+  aResult << "},\"heap_mb\":"
+          << aMemInfo.ValuePreciseMiB(OSD_MemInfo::MemHeapUsage)
+          << ",\"heap_peak_mb\":"
+          << aMemInfo.ValuePreciseMiB(OSD_MemInfo::MemWorkingSetPeak) << "}";
+  return aResult.str();
+}
+
+// ================================================================
+// Function : setLoadStats
+// Purpose  :
+// ================================================================
+void OcctView::setLoadStats(const std::string &theName,
+                            const ModelLoadStats &theStats) {
+  myLastStats = theStats;
+  myLoadStats = theStats.ToJson();
+  Message::SendInfo() << "Loading " << theName.c_str() << ": "
+                      << theStats.ToString().c_str();
+}
+
+// ================================================================
+// Function : cancelLoad
+// Purpose  :
+// ================================================================
+bool OcctView::cancelLoad(int theJobId) {
+  OcctView &aViewer = Instance();
+  return !aViewer.myLoadQueue.IsNull() &&
+         aViewer.myLoadQueue->Cancel(theJobId);
+}
+
+// ================================================================
+// Function : getLoadProgress
+// Purpose  :
+// ================================================================
+double OcctView::getLoadProgress(int theJobId) {
+  OcctView &aViewer = Instance();
+  return aViewer.myLoadQueue.IsNull()
+             ? -1.0
+             : aViewer.myLoadQueue->Progress(theJobId);
+}
+
+// ================================================================
+// Function : enableTessellationCache
+// Purpose  :
+// ================================================================
+void OcctView::enableTessellationCache(const std::string &thePath,
+                                       int theMaxSizeMb) {
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  if (theMaxSizeMb <= 0) {
+    aFactory->SetMeshCache(Handle(TessellationCache)());
+    return;
+  }
+
+  // mount persistent storage and populate it from IndexedDB;
+  // entries become available once asynchronous sync is completed
+  EM_ASM(
+      {
+        var aPath = UTF8ToString($0);
+        try {
+          FS.mkdirTree(aPath);
+          FS.mount(IDBFS, {}, aPath);
+        } catch (theErr) {
+          // already mounted
+        }
+        FS.syncfs(true, function(theErr) {
+          if (theErr) {
+            console.warn('Tessellation cache load failed: ' + theErr);
+          }
+        });
+      },
+      thePath.c_str());
+
+  Handle(TessellationCacheStorage) aStorage = new IdbfsCacheStorage(thePath);
+  aFactory->SetMeshCache(
+      new TessellationCache(aStorage, uint64_t(theMaxSizeMb) * 1024 * 1024));
+  Message::SendInfo() << "Tessellation cache enabled at " << thePath.c_str()
+                      << " (" << theMaxSizeMb << " MiB)";
+}
+
 void OcctView::testAction() {
   removeAllObjects();
 
@@ -836,29 +2394,52 @@ bool OcctView::openBRepFromMemory(const std::string &theName,
   removeObject(theName);
 
   OcctView &aViewer = Instance();
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  ModelLoadStats aStats;
+  NCollection_Sequence<Handle(AIS_InteractiveObject)> aPresentations;
+  std::string aModelKey;
+  NCollection_Sequence<TopoDS_Shape> aCachedShapes;
   TopoDS_Shape aShape;
-  BRep_Builder aBuilder;
-  bool isLoaded = false;
   {
     char *aRawData = reinterpret_cast<char *>(theBuffer);
-    Standard_ArrayStreamBuffer aStreamBuffer(aRawData, theDataLen);
-    std::istream aStream(&aStreamBuffer);
-    BRepTools::Read(aShape, aStream, aBuilder);
+    if (aFactory->FindSharedModel(aRawData, theDataLen,
+                                  aFactory->MeshParams(), aPresentations,
+                                  aModelKey)) {
+      // geometry of the same data is already in the scene
+    } else if (aFactory->FindCachedMesh(aRawData, theDataLen,
+                                        aFactory->MeshParams(), aCachedShapes,
+                                        aModelKey, &aStats)) {
+      aShape = aCachedShapes.First();
+    } else {
+      Standard_ArrayStreamBuffer aStreamBuffer(aRawData, theDataLen);
+      std::istream aStream(&aStreamBuffer);
+      aShape =
+          aFactory->LoadFromBRep(aStream, Message_ProgressRange(), &aStats);
+    }
     if (theToFree) {
       free(aRawData);
     }
-    isLoaded = true;
-  }
-  if (!isLoaded) {
-    return false;
   }
+  if (aPresentations.IsEmpty()) {
+    if (aShape.IsNull()) {
+      return false;
+    }
 
-  Handle(AIS_Shape) aShapePrs = new AIS_Shape(aShape);
-  if (!theName.empty()) {
-    aViewer.myObjects.Add(theName.c_str(), aShapePrs);
+    // binary BRep may come with triangulation, which is used as is
+    if (aCachedShapes.IsEmpty() && !ModelFactory::IsTriangulated(aShape)) {
+      aFactory->Triangulate(aShape, aFactory->MeshParams().FirstPass(),
+                            Message_ProgressRange(), &aStats);
+      if (!aFactory->MeshParams().IsProgressive) {
+        NCollection_Sequence<TopoDS_Shape> aShapes;
+        aShapes.Append(aShape);
+        aFactory->StoreCachedMesh(aModelKey, aShapes);
+      }
+    }
+    aPresentations.Append(aFactory->InstantiateShape(aShape));
+    aFactory->StoreSharedModel(aModelKey, aPresentations);
   }
-  aShapePrs->SetMaterial(Graphic3d_NameOfMaterial_Silver);
-  aViewer.Context()->Display(aShapePrs, AIS_Shaded, 0, false);
+  aViewer.setLoadStats(theName, aStats);
+  aViewer.AddObjects(theName.c_str(), aPresentations, AIS_Shaded);
   aViewer.View()->FitAll(0.01, false);
   aViewer.UpdateView();
 
@@ -869,7 +2450,7 @@ bool OcctView::openBRepFromMemory(const std::string &theName,
 }
 
 // ================================================================
-// Function : openBRepFromMemory
+// Function : openSTEPFromMemory
 // Purpose  :
 // ================================================================
 bool OcctView::openSTEPFromMemory(const std::string &theName,
@@ -878,49 +2459,33 @@ bool OcctView::openSTEPFromMemory(const std::string &theName,
   removeObject(theName);
 
   OcctView &aViewer = Instance();
-  bool isLoaded = false;
+  ModelFactory *aFactory = ModelFactory::GetInstance();
+  ModelLoadStats aStats;
+  NCollection_Sequence<Handle(AIS_InteractiveObject)> aPresentations;
+  std::string aModelKey;
   {
     char *aRawData = reinterpret_cast<char *>(theBuffer);
-    Standard_ArrayStreamBuffer aStreamBuffer(aRawData, theDataLen);
-    std::istream aStream(&aStreamBuffer);
-    STEPControl_Reader aReader;
-    Standard_CString name = theName.c_str();
-    auto stat = aReader.ReadStream(name, aStream);
-    if (stat == IFSelect_RetDone) {
-      bool isFailsonly = false;
-      aReader.PrintCheckLoad(isFailsonly, IFSelect_ItemsByEntity);
-
-      int aNbRoot = aReader.NbRootsForTransfer();
-      aReader.PrintCheckTransfer(isFailsonly, IFSelect_ItemsByEntity);
-      for (Standard_Integer n = 1; n <= aNbRoot; n++) {
-        Standard_Boolean ok = aReader.TransferRoot(n);
-        int aNbShap = aReader.NbShapes();
-        if (aNbShap > 0) {
-          for (int i = 1; i <= aNbShap; i++) {
-            TopoDS_Shape aShape = aReader.Shape(i);
-            Handle(AIS_Shape) aShapePrs = new AIS_Shape(aShape);
-            if (!theName.empty()) {
-              aViewer.myObjects.Add(theName.c_str(), aShapePrs);
-            }
-            aShapePrs->SetMaterial(Graphic3d_NameOfMaterial_Silver);
-            aViewer.Context()->Display(aShapePrs, AIS_Shaded, 0, false);
-          }
-        }
+    if (!aFactory->FindSharedModel(aRawData, theDataLen,
+                                   aFactory->MeshParams(), aPresentations,
+                                   aModelKey)) {
+      Handle(StepAssembly) anAssembly = aFactory->LoadAssembly(
+          aRawData, theDataLen, theName, aFactory->MeshParams(),
+          Message_ProgressRange(), &aStats, aModelKey);
+      if (!anAssembly.IsNull()) {
+        aPresentations.Append(anAssembly->CreatePresentation());
+        aFactory->StoreSharedModel(aModelKey, aPresentations);
       }
-    } else {
-      return false;
     }
-
-  read_done:
-
     if (theToFree) {
       free(aRawData);
     }
-    isLoaded = true;
   }
-  if (!isLoaded) {
+  if (aPresentations.IsEmpty()) {
     return false;
   }
+  aViewer.setLoadStats(theName, aStats);
+
+  aViewer.AddObjects(theName.c_str(), aPresentations, AIS_Shaded);
 
   aViewer.View()->FitAll(0.01, false);
   aViewer.UpdateView();
@@ -937,13 +2502,27 @@ bool OcctView::openStlFromMemory(const std::string &theName,
   removeObject(theName);
   OcctView &aViewer = Instance();
 
-  basic_membuf mb(reinterpret_cast<char *>(theBuffer), theDataLen);
-
-  std::istream is(&mb);
+  ModelLoadStats aStats;
+  Handle(Poly_Triangulation) aTriangulation;
+  {
+    basic_membuf mb(reinterpret_cast<char *>(theBuffer), theDataLen);
+    std::istream is(&mb);
+    aTriangulation = ModelFactory::GetInstance()->ReadStl(
+        is, Message_ProgressRange(), &aStats);
+  }
+  // file data is not needed anymore, release it before building presentation
+  if (theToFree) {
+    free(reinterpret_cast<char *>(theBuffer));
+  }
+  if (aTriangulation.IsNull()) {
+    Message::SendFail() << "Error: unable to load file " << theName.c_str();
+    return false;
+  }
 
-  auto mesh = ModelFactory::GetInstance()->LoadFromStl(is);
-  mesh->SetDisplayMode(MeshVS_DMF_Shading);
-  aViewer.Context()->Display(mesh, Standard_True);
+  Handle(AIS_InteractiveObject) aMesh =
+      ModelFactory::GetInstance()->InstantiateStlMesh(aTriangulation, &aStats);
+  aViewer.setLoadStats(theName, aStats);
+  aViewer.AddObject(theName.c_str(), aMesh, MeshVS_DMF_Shading);
   aViewer.View()->FitAll(0.01, false);
   aViewer.UpdateView();
 
@@ -953,6 +2532,40 @@ bool OcctView::openStlFromMemory(const std::string &theName,
   return true;
 }
 
+// ================================================================
+// Function : openMeshPackFromMemory
+// Purpose  :
+// ================================================================
+bool OcctView::openMeshPackFromMemory(const std::string &theName,
+                                      uintptr_t theBuffer, int theDataLen,
+                                      bool theToFree) {
+  removeObject(theName);
+  OcctView &aViewer = Instance();
+
+  ModelLoadStats aStats;
+  Handle(Poly_Triangulation) aTriangulation =
+      ModelFactory::GetInstance()->ReadMeshPack(
+          reinterpret_cast<const char *>(theBuffer), theDataLen, &aStats);
+  if (theToFree) {
+    free(reinterpret_cast<char *>(theBuffer));
+  }
+  if (aTriangulation.IsNull()) {
+    Message::SendFail() << "Error: unable to load file " << theName.c_str();
+    return false;
+  }
+
+  Handle(AIS_InteractiveObject) aMesh =
+      ModelFactory::GetInstance()->InstantiateStlMesh(aTriangulation, &aStats);
+  aViewer.setLoadStats(theName, aStats);
+  aViewer.AddObject(theName.c_str(), aMesh, MeshVS_DMF_Shading);
+  aViewer.View()->FitAll(0.01, false);
+  aViewer.UpdateView();
+
+  Message::DefaultMessenger()->Send(
+      TCollection_AsciiString("Loaded file ") + theName.c_str(), Message_Info);
+  return true;
+}
+
 // ================================================================
 // Function : displayGround
 // Purpose  :
@@ -1019,9 +2632,59 @@ EMSCRIPTEN_BINDINGS(OccViewerModule) {
   emscripten::function("displayObject", &OcctView::displayObject);
   emscripten::function("displayGround", &OcctView::displayGround);
   emscripten::function("openFromUrl", &OcctView::openFromUrl);
+  emscripten::function("openFromUrlStreamed", &OcctView::openFromUrlStreamed);
   emscripten::function("openFromMemory", &OcctView::openFromMemory,
                        emscripten::allow_raw_pointers());
   emscripten::function("openBRepFromMemory", &OcctView::openBRepFromMemory,
                        emscripten::allow_raw_pointers());
+  emscripten::function("openMeshPackFromMemory",
+                       &OcctView::openMeshPackFromMemory,
+                       emscripten::allow_raw_pointers());
+  emscripten::function("openFromMemoryAsync", &OcctView::openFromMemoryAsync,
+                       emscripten::allow_raw_pointers());
+  emscripten::function("beginBatchImport", &OcctView::beginBatchImport);
+  emscripten::function("addBatchItem", &OcctView::addBatchItem,
+                       emscripten::allow_raw_pointers());
+  emscripten::function("commitBatchImport", &OcctView::commitBatchImport);
+  emscripten::function("setMeshParameters", &OcctView::setMeshParameters);
+  emscripten::function("setProgressiveMeshing",
+                       &OcctView::setProgressiveMeshing);
+  emscripten::function("getPendingRefinement",
+                       &OcctView::getPendingRefinement);
+  emscripten::function("setLazyAssemblies", &OcctView::setLazyAssemblies);
+  emscripten::function("getPendingParts", &OcctView::getPendingParts);
+  emscripten::function("setSlicedPresentations",
+                       &OcctView::setSlicedPresentations);
+  emscripten::function("getBuildProgress", &OcctView::getBuildProgress);
+  emscripten::function("setAdaptiveQuality", &OcctView::setAdaptiveQuality);
+  emscripten::function("getRenderQuality", &OcctView::getRenderQuality);
+  emscripten::function("getLoadStats", &OcctView::getLoadStats);
+  emscripten::function("benchmarkLoad", &OcctView::benchmarkLoad,
+                       emscripten::allow_raw_pointers());
+  emscripten::function("initHeadless", &OcctView::initHeadless);
+  emscripten::function("benchmarkOpen", &OcctView::benchmarkOpen,
+                       emscripten::allow_raw_pointers());
+  emscripten::function("enableFrameStats", &OcctView::enableFrameStats);
+  emscripten::function("getFrameStats", &OcctView::getFrameStats);
+  emscripten::function("resetFrameStats", &OcctView::resetFrameStats);
+  emscripten::function("enableTracing", &OcctView::enableTracing);
+  emscripten::function("getTraceJson", &OcctView::getTraceJson);
+  emscripten::function("clearTrace", &OcctView::clearTrace);
+  emscripten::function("enableAllocProfiler", &OcctView::enableAllocProfiler);
+  emscripten::function("getAllocProfile", &OcctView::getAllocProfile);
+  emscripten::function("clearAllocProfile", &OcctView::clearAllocProfile);
+  emscripten::function("setMemoryBudget", &OcctView::setMemoryBudget);
+  emscripten::function("getMemoryReport", &OcctView::getMemoryReport);
+  emscripten::function("getAssemblyTree", &OcctView::getAssemblyTree);
+  emscripten::function("exportGlb", &OcctView::exportGlb);
+  emscripten::function("exportShape", &OcctView::exportShape);
+  emscripten::function("saveSceneSnapshot", &OcctView::saveSceneSnapshot);
+  emscripten::function("loadSceneSnapshot", &OcctView::loadSceneSnapshot);
+  emscripten::function("setGeometrySharing", &OcctView::setGeometrySharing);
+  emscripten::function("getGeometryStats", &OcctView::getGeometryStats);
+  emscripten::function("cancelLoad", &OcctView::cancelLoad);
+  emscripten::function("getLoadProgress", &OcctView::getLoadProgress);
+  emscripten::function("enableTessellationCache",
+                       &OcctView::enableTessellationCache);
   emscripten::function("testAction", &OcctView::testAction);
 }
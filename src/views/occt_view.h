@@ -29,6 +29,16 @@
 #include <AIS_ViewController.hxx>
 #include <V3d_View.hxx>
 
+#include "../adaptive_quality.h"
+#include "../frame_stats.h"
+#include "../lazy_part_mesher.h"
+#include "../load_job_queue.h"
+#include "../model_factory.h"
+#include "../progressive_mesher.h"
+#include "../scene_memory.h"
+#include "../sliced_mesh_builder.h"
+
+class AIS_TextLabel;
 class AIS_ViewCube;
 
 //! Sample class creating 3D Viewer within Emscripten canvas.
@@ -78,6 +88,17 @@ public: //! @name methods exported by Module
   static void openFromUrl(const std::string &theName,
                           const std::string &theModelPath);
 
+  //! Open object from the given URL decoding data while it is downloaded.
+  //! STL geometry is displayed progressively, other formats are opened
+  //! as soon as download is completed.
+  //! @param theName            [in] object name
+  //! @param theModelPath       [in] model path
+  //! @param theFacetsPerUpdate [in] number of STL facets between display
+  //!                                updates
+  static void openFromUrlStreamed(const std::string &theName,
+                                  const std::string &theModelPath,
+                                  int theFacetsPerUpdate);
+
   //! Open object from memory.
   //! @param theName    [in] object name
   //! @param theBuffer  [in] pointer to data
@@ -87,7 +108,8 @@ public: //! @name methods exported by Module
   static bool openFromMemory(const std::string &theName, uintptr_t theBuffer,
                              int theDataLen, bool theToFree);
 
-  //! Open BRep object from memory.
+  //! Open textual or binary BRep object from memory.
+  //! Triangulation stored in binary BRep is displayed without re-meshing.
   //! @param theName    [in] object name
   //! @param theBuffer  [in] pointer to data
   //! @param theDataLen [in] data length
@@ -97,6 +119,16 @@ public: //! @name methods exported by Module
                                  uintptr_t theBuffer, int theDataLen,
                                  bool theToFree);
 
+  //! Open STEP assembly, binary XCAF document (".xbf") or binary glTF
+  //! (".glb") from memory.
+  //! Names, colors and assembly structure are preserved, see
+  //! getAssemblyTree(); each unique part is displayed once and connected
+  //! to located instances.
+  //! @param theName    [in] object name
+  //! @param theBuffer  [in] pointer to data
+  //! @param theDataLen [in] data length
+  //! @param theToFree  [in] free theBuffer if set to TRUE
+  //! @return FALSE on reading error
   static bool openSTEPFromMemory(const std::string &theName,
                                  uintptr_t theBuffer, int theDataLen,
                                  bool theToFree);
@@ -104,6 +136,249 @@ public: //! @name methods exported by Module
   static bool openStlFromMemory(const std::string &theName, uintptr_t theBuffer,
                                 int theDataLen, bool theToFree);
 
+  //! Open pre-baked mesh (see MeshPack) from memory.
+  //! @param theName    [in] object name
+  //! @param theBuffer  [in] pointer to data
+  //! @param theDataLen [in] data length
+  //! @param theToFree  [in] free theBuffer if set to TRUE
+  //! @return FALSE on reading error
+  static bool openMeshPackFromMemory(const std::string &theName,
+                                     uintptr_t theBuffer, int theDataLen,
+                                     bool theToFree);
+
+  //! Open object from memory in background thread.
+  //! Object is displayed by the main loop once loading is completed.
+  //! @param theName    [in] object name
+  //! @param theBuffer  [in] pointer to data
+  //! @param theDataLen [in] data length
+  //! @param theToFree  [in] free theBuffer if set to TRUE; otherwise data
+  //!                        is copied
+  //! @return load job id or -1 on error
+  static int openFromMemoryAsync(const std::string &theName,
+                                 uintptr_t theBuffer, int theDataLen,
+                                 bool theToFree);
+
+  //! Start collecting files for batch import.
+  //! Files added since previous commit are discarded.
+  static void beginBatchImport();
+
+  //! Add file to the batch; it is not parsed until commitBatchImport().
+  //! @param theName    [in] object name
+  //! @param theBuffer  [in] pointer to data
+  //! @param theDataLen [in] data length
+  //! @param theToFree  [in] free theBuffer if set to TRUE; otherwise data
+  //!                        is copied
+  //! @return FALSE if file has unsupported format
+  static bool addBatchItem(const std::string &theName, uintptr_t theBuffer,
+                           int theDataLen, bool theToFree);
+
+  //! Start parsing and meshing of all batch files concurrently across a
+  //! worker pool; once all of them are loaded, they are displayed at once
+  //! with a single fit and redraw.
+  //! @return number of submitted files, or -1 if the previous batch is still
+  //!         being loaded
+  static int commitBatchImport();
+
+  //! Set tessellation parameters for B-Rep and STEP models loaded next.
+  //! @param theDeflection [in] linear deflection, 0 to derive it from the
+  //!                           size of each shape like AIS does
+  //! @param theAngleDeg   [in] angular deflection in degrees
+  //! @param theIsRelative [in] deflection is relative to the edge size
+  static void setMeshParameters(double theDeflection, double theAngleDeg,
+                                bool theIsRelative);
+
+  //! Enable coarse-to-fine tessellation of B-Rep and STEP models loaded next.
+  //! Coarse mesh is displayed first, then faces are refined in background
+  //! in order of their projected size on the screen.
+  //! @param theToEnable      [in] enable or disable progressive meshing
+  //! @param theFacesPerBatch [in] minimal number of faces refined at once
+  static void setProgressiveMeshing(bool theToEnable, int theFacesPerBatch);
+
+  //! Return number of faces waiting for refinement.
+  static int getPendingRefinement();
+
+  //! Enable lazy tessellation of STEP assemblies loaded next.
+  //! Parts not found in the mesh cache are displayed as bounding boxes,
+  //! then meshed in background once visible, largest on the screen first.
+  //! @param theToEnable [in] enable or disable lazy tessellation
+  //! @param theMinSize  [in] minimal projected size in pixels of meshed parts
+  static void setLazyAssemblies(bool theToEnable, double theMinSize);
+
+  //! Return number of assembly parts waiting for tessellation.
+  static int getPendingParts();
+
+  //! Configure time-sliced building of huge mesh presentations.
+  //! Presentations are built within the time budget of each frame, so that
+  //! navigation keeps working while they appear; affects models loaded
+  //! afterwards.
+  //! @param theToEnable [in] enable sliced building
+  //! @param theBudget   [in] time budget per frame in milliseconds
+  static void setSlicedPresentations(bool theToEnable, double theBudget);
+
+  //! Return progress of presentations being built in slices within [0, 1]
+  //! range, or -1 if there are none.
+  static double getBuildProgress();
+
+  //! Configure adaptive quality of navigation.
+  //! While the view is navigated, multisampling, render resolution and
+  //! culling of small objects are reduced as needed to hold the target
+  //! frame time; one full quality frame is rendered once navigation stops.
+  //! @param theToEnable      [in] enable adaptive quality
+  //! @param theFrameTime     [in] target frame time in milliseconds
+  //! @param theNbMsaaSamples [in] MSAA samples of full quality frames
+  static void setAdaptiveQuality(bool theToEnable, double theFrameTime,
+                                 int theNbMsaaSamples);
+
+  //! Return quality level of the last frame, 0 for full quality.
+  static int getRenderQuality();
+
+  //! Return timing of loading stages and triangle count of the last loaded
+  //! model as JSON string.
+  static std::string getLoadStats();
+
+  //! Load the data several times without displaying it, with mesh cache
+  //! and geometry sharing disabled, e.g. to compare load times of the same
+  //! model in different formats (ASCII or binary BRep, XBF, STEP, STL).
+  //! @param theName    [in] object name defining format by its extension
+  //! @param theBuffer  [in] pointer to data, kept by the caller
+  //! @param theDataLen [in] data length
+  //! @param theNbRuns  [in] number of loads
+  //! @return JSON object with mean and minimal load time in milliseconds
+  //!         and stages of the last load, or empty string on error
+  static std::string benchmarkLoad(const std::string &theName,
+                                   uintptr_t theBuffer, int theDataLen,
+                                   int theNbRuns);
+
+  //! Create viewer without window and WebGL context, e.g. to run benchmarks
+  //! in Node.js. Presentations are computed as usual, while redrawing has
+  //! nothing to draw into.
+  //! @return FALSE if viewer is already initialized
+  static bool initHeadless();
+
+  //! Open the data through openFromMemory() several times and redraw the
+  //! view after each load, with mesh cache and geometry sharing disabled.
+  //! The last loaded model is left displayed.
+  //! @param theName    [in] object name defining format by its extension
+  //! @param theBuffer  [in] pointer to data, kept by the caller
+  //! @param theDataLen [in] data length
+  //! @param theNbRuns  [in] number of loads
+  //! @return JSON object with minimal and mean times in milliseconds of
+  //!         parsing, tessellation, presentation and the first frame, and
+  //!         heap usage in MiB, or empty string on error
+  static std::string benchmarkOpen(const std::string &theName,
+                                   uintptr_t theBuffer, int theDataLen,
+                                   int theNbRuns);
+
+  //! Cancel background loading.
+  //! @param theJobId [in] load job id
+  //! @return FALSE if job is unknown or already completed
+  static bool cancelLoad(int theJobId);
+
+  //! Return background loading progress within [0, 1] range,
+  //! or -1 if job is unknown or already displayed.
+  //! @param theJobId [in] load job id
+  static double getLoadProgress(int theJobId);
+
+  //! Enable persistent cache of B-Rep and STEP tessellation.
+  //! Cache is kept in IDBFS mount point, so it survives page reloads;
+  //! entries are keyed by content hash of the file and mesh parameters.
+  //! @param thePath      [in] mount point of the cache directory
+  //! @param theMaxSizeMb [in] maximum cache size in MiB, 0 to disable cache
+  static void enableTessellationCache(const std::string &thePath,
+                                      int theMaxSizeMb);
+
+  //! Configure collection of per-frame statistics.
+  //! Frame timing and input latency are always collected.
+  //! @param theToCountElements [in] count rendered triangles and elements,
+  //!                                which adds a small per-frame overhead
+  //! @param theToShowOverlay   [in] show statistics on the canvas
+  static void enableFrameStats(bool theToCountElements, bool theToShowOverlay);
+
+  //! Return per-frame statistics as JSON string: counters of redraw requests,
+  //! main loop ticks and frames; percentiles of frame, event flush and render
+  //! CPU times, input-to-frame latency, frames per input burst and rendered
+  //! triangles/elements.
+  static std::string getFrameStats();
+
+  //! Clear collected frame statistics.
+  static void resetFrameStats();
+
+  //! Start or stop recording of the load pipeline timeline.
+  static void enableTracing(bool theToEnable);
+
+  //! Return recorded timeline in Chrome trace-event JSON format,
+  //! to be opened with chrome://tracing or Perfetto UI.
+  static std::string getTraceJson();
+
+  //! Drop recorded timeline events.
+  static void clearTrace();
+
+  //! Start or stop tracking of heap allocations by trace scopes.
+  //! Requires build with ALLOC_PROFILER=true.
+  static void enableAllocProfiler(bool theToEnable);
+
+  //! Return allocation count, total, live and peak bytes per trace scope
+  //! as JSON string.
+  static std::string getAllocProfile();
+
+  //! Drop allocation counters.
+  static void clearAllocProfile();
+
+  //! Set memory budget in megabytes for displayed objects, 0 for unlimited.
+  //! Least recently viewed objects exceeding the budget are reduced to a
+  //! lower level of detail and then unloaded from the viewer.
+  static void setMemoryBudget(int theBudgetMb);
+
+  //! Return memory report as JSON string: per-object triangulation, data
+  //! source, presentation and GPU buffer sizes in bytes, downgrade level
+  //! and the time object was last visible.
+  static std::string getMemoryReport();
+
+  //! Return assembly tree of the STEP object as JSON array of root nodes:
+  //! {"name", "color", "children"} for sub-assemblies and
+  //! {"name", "color", "part", "instances"} for part instances.
+  static std::string getAssemblyTree(const std::string &theName);
+
+  //! Write all scene objects into binary glTF file (GLB) of the virtual
+  //! file system, to be read e.g. with FS.readFile(). Geometry shared by
+  //! objects (see setGeometrySharing()) is written once and instanced.
+  //! @param thePath [in] output file path
+  //! @return FALSE if scene is empty or on writing error
+  static bool exportGlb(const std::string &thePath);
+
+  //! Write shapes of the scene object into file of the virtual file system,
+  //! e.g. to compare loading of one model stored in several formats.
+  //! Format is defined by the file extension: ASCII (.brep) or binary
+  //! (.bbrep) BRep with triangulation, binary XCAF document (.xbf) or
+  //! STEP (.step, .stp).
+  //! @param theName [in] object name
+  //! @param thePath [in] output file path
+  //! @return FALSE if object has no shapes or on writing error
+  static bool exportShape(const std::string &theName,
+                          const std::string &thePath);
+
+  //! Enable sharing of identical geometry between scene objects (enabled by
+  //! default). Objects are then displayed as instances of shared masters.
+  static void setGeometrySharing(bool theToShare);
+
+  //! Return numbers of shared meshes, shapes and models as JSON string.
+  static std::string getGeometryStats();
+
+  //! Write snapshot of all scene objects (see SceneSnapshot) with their
+  //! triangulations, display attributes, visibility and the camera into
+  //! the file of the virtual file system.
+  //! @param thePath [in] output file path
+  //! @return FALSE on writing error
+  static bool saveSceneSnapshot(const std::string &thePath);
+
+  //! Replace the scene by the snapshot written by saveSceneSnapshot().
+  //! @param theBuffer  [in] pointer to data
+  //! @param theDataLen [in] data length
+  //! @param theToFree  [in] free theBuffer if set to TRUE
+  //! @return FALSE if data is not a valid snapshot
+  static bool loadSceneSnapshot(uintptr_t theBuffer, int theDataLen,
+                                bool theToFree);
+
 public:
   //! Default constructor.
   OcctView();
@@ -126,7 +401,38 @@ public:
   //! Request view redrawing.
   void UpdateView();
 
+  //! Register named object and display it.
+  //! Object previously registered with the same name is removed.
+  //! @param theName     [in] object name
+  //! @param thePrs      [in] presentation
+  //! @param theDispMode [in] display mode
+  void AddObject(const TCollection_AsciiString &theName,
+                 const Handle(AIS_InteractiveObject) & thePrs,
+                 int theDispMode);
+
+  //! Register presentations of one model and display them.
+  //! The first presentation is registered as theName, the next ones as
+  //! parts of it (see objectPartName()), which are found, hidden and
+  //! removed together by name. Parts of the previous model with the same
+  //! name are removed.
+  //! @param theName     [in] object name
+  //! @param thePrsSeq   [in] presentations
+  //! @param theDispMode [in] display mode, or -1 to keep the own mode of
+  //!                         each presentation
+  void AddObjects(
+      const TCollection_AsciiString &theName,
+      const NCollection_Sequence<Handle(AIS_InteractiveObject)> &thePrsSeq,
+      int theDispMode = -1);
+
 private:
+  //! Return name of the part of the object registered by AddObjects(),
+  //! theName itself for the first one.
+  static TCollection_AsciiString
+  objectPartName(const TCollection_AsciiString &theName, int theIndex);
+
+  //! Return number of registered parts of the object, 0 if none.
+  int nbObjectParts(const TCollection_AsciiString &theName) const;
+
   //! Create window.
   void initWindow(const TCollection_AsciiString &theCanvasId);
 
@@ -142,6 +448,58 @@ private:
   //! Flush events and redraw view.
   void redrawView();
 
+  //! Return background load queue, created on first use.
+  const Handle(LoadJobQueue) & loadQueue();
+
+  //! Submit job to background load queue and start polling it.
+  //! @return job id
+  int submitLoadJob(const Handle(LoadJob) & theJob);
+
+  //! Display objects loaded in background.
+  void processCompletedJobs();
+
+  //! Submit the next batch of progressive refinement, if any.
+  void refineNextBatch();
+
+  //! Submit the next batch of visible assembly parts to mesh, if any.
+  void meshVisibleParts();
+
+  //! Build the next slice of pending presentations and show progress.
+  void buildPresentations();
+
+  //! Check background load queue for completed jobs.
+  void pollLoadJobs();
+
+  //! Run or collect jobs of the batch being loaded; commits the batch once
+  //! all of them are completed.
+  //! @return TRUE if the batch is still being loaded
+  bool pollBatchJobs();
+
+  //! Display loaded batch files within a single scene update.
+  void commitBatch();
+
+  //! Remember and report statistics of the loaded model.
+  void setLoadStats(const std::string &theName,
+                    const ModelLoadStats &theStats);
+
+  //! Return TRUE if the camera is being navigated within the current frame.
+  bool isNavigating() const;
+
+  //! Track navigation of the rendered frame and adapt quality of the next.
+  void updateRenderQuality();
+
+  //! Apply rendering parameters of the quality level to the view.
+  void applyRenderQuality(int theLevel);
+
+  //! Update on-screen statistics overlay, if enabled.
+  void updateStatsOverlay();
+
+  //! Track visibility of objects and enforce the memory budget, if set.
+  void updateMemoryBudget();
+
+  //! Release shared geometry not used by scene objects anymore.
+  void purgeGeometry();
+
   //! Handle view redraw.
   virtual void handleViewRedraw(const Handle(AIS_InteractiveContext) & theCtx,
                                 const Handle(V3d_View) & theView) override;
@@ -196,6 +554,15 @@ private:
     return ((OcctView *)theView)->redrawView();
   }
 
+  static void onRefineView(void *theView) {
+    ((OcctView *)theView)->myIsRefineQueued = false;
+    return ((OcctView *)theView)->redrawView();
+  }
+
+  static void onPollLoadJobs(void *theView) {
+    return ((OcctView *)theView)->pollLoadJobs();
+  }
+
   static EM_BOOL onMouseCallback(int theEventType,
                                  const EmscriptenMouseEvent *theEvent,
                                  void *theView) {
@@ -270,6 +637,28 @@ private:
   Handle(V3d_View) myView;                  //!< 3D view
   Handle(Prs3d_TextAspect) myTextStyle;     //!< text style for OSD elements
   Handle(AIS_ViewCube) myViewCube;          //!< view cube object
+  Handle(LoadJobQueue) myLoadQueue;         //!< background load queue
+  Handle(ProgressiveMesher) myMesher;       //!< progressive refinement
+  Handle(LazyPartMesher) myPartMesher;      //!< lazy meshing of parts
+  Handle(SlicedMeshBuilder) myPrsBuilder;   //!< sliced presentations
+  Handle(AIS_TextLabel) myBuildProgress;    //!< progress of sliced building
+  Handle(SceneMemoryManager) myMemoryManager; //!< memory budget
+  double myMemoryCheckTime; //!< time of the last memory budget check
+  NCollection_Sequence<Handle(LoadJob)> myBatchJobs; //!< pending batch import
+  NCollection_Sequence<Handle(LoadJob)> myBatchLoading; //!< batch being loaded
+  Handle(LoadJobQueue) myBatchQueue; //!< worker pool of the batch being loaded
+  int myNbBatchTaken; //!< completed jobs of the batch being loaded
+  ModelLoadStats myLastStats; //!< statistics of the last loaded model
+  std::string myLoadStats; //!< statistics of the last loaded model as JSON
+  FrameStats myFrameStats;                  //!< per-frame statistics
+  Handle(AIS_TextLabel) myStatsOverlay;     //!< frame statistics overlay
+  double myStatsOverlayTime; //!< time of the last overlay update
+  bool myToCountElements;    //!< count rendered elements within frame stats
+  AdaptiveQuality myQuality; //!< adaptive quality of navigation frames
+  int myQualityLevel;        //!< quality level applied to the view
+  int myNbMsaaSamples;       //!< MSAA samples of full quality frames
+  double myFrameRequestTime; //!< time the pending frame was first requested
+  bool myIsRefineQueued;     //!< full quality frame is scheduled
   TCollection_AsciiString myCanvasId;       //!< canvas element id on HTML page
   Graphic3d_Vec2i myWinSizeOld;
   float myDevicePixelRatio;      //!< device pixel ratio for handling high DPI
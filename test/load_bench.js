@@ -0,0 +1,381 @@
+// End-to-end load benchmark of OcctView.openFromMemory() in Node.js.
+//
+// Each model of the corpus is opened in a separate headless process, so that
+// heap peak is measured per model: parsing, tessellation, presentation and
+// the first redraw are timed by OcctView.benchmarkOpen(). Results are written
+// as JSON and compared against the stored baseline. Samples are also
+// converted by the module into other formats (OcctView.exportShape()), so
+// that load times of the same model stored in several formats are compared.
+//
+//   node test/load_bench.js [options] [model files...]
+//     --module <path>      wasm module script (js/demo_app.js)
+//     --runs <n>           loads per model (3)
+//     --out <path>         results file (load_bench.json)
+//     --baseline <path>    baseline file (test/load_bench_baseline.json)
+//     --tolerance <ratio>  allowed relative slowdown of a stage (0.25)
+//     --min-delta <ms>     slowdown below this is ignored as noise (5)
+//     --mem-tolerance <r>  allowed relative growth of heap peak (0.10)
+//     --update-baseline    store results as the new baseline
+//     --no-generated       skip generated models
+//
+// Exit code is 1 if any stage or heap peak regressed beyond tolerance.
+"use strict";
+
+const childProcess = require("child_process");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+
+const THE_ROOT_DIR = path.resolve(__dirname, "..");
+
+//! Generated models: kind, triangle count and STL flavour.
+const THE_GENERATED_MODELS = [
+  { name: "sphere-100k.stl", kind: "sphere", triangles: 100000 },
+  { name: "sphere-100k-ascii.stl", kind: "sphere", triangles: 100000, ascii: true },
+  { name: "terrain-1m.stl", kind: "terrain", triangles: 1000000 },
+];
+
+//! Models converted from a sample by the module before the benchmark.
+//! The sample itself is ASCII BRep without triangulation, so that the meshed
+//! ASCII BRep is compared with binary BRep and XBF, which store it as well.
+const THE_DERIVED_MODELS = [
+  { name: "Ball-meshed.brep", source: "Ball.brep" },
+  { name: "Ball.bbrep", source: "Ball.brep" },
+  { name: "Ball.xbf", source: "Ball.brep" },
+  { name: "Ball.step", source: "Ball.brep" },
+];
+
+// ================================================================
+// Mesh generators
+// ================================================================
+
+//! Emit triangles of UV sphere, about theNbTriangles in total.
+function emitSphere(theNbTriangles, theFacet) {
+  const aNbSegs = Math.max(Math.round(Math.sqrt(theNbTriangles / 2)), 3);
+  const aRadius = 50.0;
+  const aPoint = (theU, theV) => {
+    const aPhi = (Math.PI * theV) / aNbSegs;
+    const aTheta = (2.0 * Math.PI * theU) / aNbSegs;
+    return [
+      aRadius * Math.sin(aPhi) * Math.cos(aTheta),
+      aRadius * Math.sin(aPhi) * Math.sin(aTheta),
+      aRadius * Math.cos(aPhi),
+    ];
+  };
+  for (let aV = 0; aV < aNbSegs; ++aV) {
+    for (let aU = 0; aU < aNbSegs; ++aU) {
+      const aP00 = aPoint(aU, aV), aP10 = aPoint(aU + 1, aV);
+      const aP01 = aPoint(aU, aV + 1), aP11 = aPoint(aU + 1, aV + 1);
+      if (aV != 0) {
+        theFacet(aP00, aP01, aP10);
+      }
+      if (aV != aNbSegs - 1) {
+        theFacet(aP10, aP01, aP11);
+      }
+    }
+  }
+}
+
+//! Emit triangles of height field grid, about theNbTriangles in total.
+function emitTerrain(theNbTriangles, theFacet) {
+  const aNbCells = Math.max(Math.round(Math.sqrt(theNbTriangles / 2)), 1);
+  const aPoint = (theI, theJ) => {
+    const aX = theI * 1.0, aY = theJ * 1.0;
+    return [aX, aY, 4.0 * Math.sin(aX * 0.05) * Math.cos(aY * 0.07) +
+                    0.5 * Math.sin(aX * 0.9 + aY * 0.4)];
+  };
+  for (let aJ = 0; aJ < aNbCells; ++aJ) {
+    for (let aI = 0; aI < aNbCells; ++aI) {
+      const aP00 = aPoint(aI, aJ), aP10 = aPoint(aI + 1, aJ);
+      const aP01 = aPoint(aI, aJ + 1), aP11 = aPoint(aI + 1, aJ + 1);
+      theFacet(aP00, aP10, aP11);
+      theFacet(aP00, aP11, aP01);
+    }
+  }
+}
+
+//! Return facet normal.
+function facetNormal(theP1, theP2, theP3) {
+  const aU = [theP2[0] - theP1[0], theP2[1] - theP1[1], theP2[2] - theP1[2]];
+  const aV = [theP3[0] - theP1[0], theP3[1] - theP1[1], theP3[2] - theP1[2]];
+  const aN = [aU[1] * aV[2] - aU[2] * aV[1], aU[2] * aV[0] - aU[0] * aV[2],
+              aU[0] * aV[1] - aU[1] * aV[0]];
+  const aLen = Math.hypot(aN[0], aN[1], aN[2]) || 1.0;
+  return [aN[0] / aLen, aN[1] / aLen, aN[2] / aLen];
+}
+
+//! Generate STL file data of the model.
+function generateStl(theModel) {
+  const anEmit = theModel.kind == "terrain" ? emitTerrain : emitSphere;
+  const aFacets = [];
+  anEmit(theModel.triangles, (theP1, theP2, theP3) =>
+    aFacets.push([facetNormal(theP1, theP2, theP3), theP1, theP2, theP3]));
+
+  if (theModel.ascii) {
+    const aLines = ["solid " + theModel.kind];
+    for (const aFacet of aFacets) {
+      aLines.push(" facet normal " + aFacet[0].join(" "), "  outer loop");
+      for (let aNodeIter = 1; aNodeIter <= 3; ++aNodeIter) {
+        aLines.push("   vertex " + aFacet[aNodeIter].join(" "));
+      }
+      aLines.push("  endloop", " endfacet");
+    }
+    aLines.push("endsolid " + theModel.kind, "");
+    return Buffer.from(aLines.join("\n"), "latin1");
+  }
+
+  const aData = Buffer.alloc(84 + aFacets.length * 50);
+  aData.write("binary STL generated by load_bench", 0, "latin1");
+  aData.writeUInt32LE(aFacets.length, 80);
+  let anOffset = 84;
+  for (const aFacet of aFacets) {
+    for (const aVec of aFacet) {
+      for (let aCoord = 0; aCoord < 3; ++aCoord, anOffset += 4) {
+        aData.writeFloatLE(aVec[aCoord], anOffset);
+      }
+    }
+    anOffset += 2; // attribute byte count
+  }
+  return aData;
+}
+
+// ================================================================
+// Benchmark of a single model, run within a child process
+// ================================================================
+
+//! Open the model in headless viewer and print JSON result to stdout.
+async function runChild(theOptions, theModel) {
+  const aData = theModel.path !== undefined
+                    ? fs.readFileSync(theModel.path)
+                    : generateStl(theModel);
+  const createModule = require(path.resolve(theOptions.module));
+  const aModule = await createModule({
+    print: function (theText) {},
+    printErr: function (theText) {},
+  });
+  aModule.initHeadless();
+
+  const aBuffer = aModule._malloc(aData.length);
+  aModule.HEAPU8.set(aData, aBuffer);
+  const aJson = aModule.benchmarkOpen(theModel.name, aBuffer, aData.length,
+                                      theOptions.runs);
+  aModule._free(aBuffer);
+  if (aJson == "") {
+    process.stderr.write("Error: unable to open " + theModel.name + "\n");
+    process.exit(2);
+  }
+
+  const aResult = JSON.parse(aJson);
+  aResult.rss_peak_mb = process.resourceUsage().maxRSS / 1024.0;
+  process.stdout.write(JSON.stringify(aResult) + "\n");
+  // pending redraw callbacks would keep the process alive
+  process.exit(0);
+}
+
+//! Open the sample in headless viewer and write its shapes into
+//! theModel.path in the format defined by the file extension.
+async function runConvert(theOptions, theModel) {
+  const aData = fs.readFileSync(theModel.source);
+  const createModule = require(path.resolve(theOptions.module));
+  const aModule = await createModule({
+    print: function (theText) {},
+    printErr: function (theText) {},
+  });
+  aModule.initHeadless();
+
+  const aBuffer = aModule._malloc(aData.length);
+  aModule.HEAPU8.set(aData, aBuffer);
+  const aSourceName = path.basename(theModel.source);
+  const anOutPath = "/" + theModel.name;
+  if (!aModule.openFromMemory(aSourceName, aBuffer, aData.length, true) ||
+      !aModule.exportShape(aSourceName, anOutPath)) {
+    process.stderr.write("Error: unable to convert " + aSourceName +
+                         " into " + theModel.name + "\n");
+    process.exit(2);
+  }
+  fs.writeFileSync(theModel.path, aModule.FS.readFile(anOutPath));
+  process.exit(0);
+}
+
+// ================================================================
+// Comparison with baseline
+// ================================================================
+
+//! Return list of regressions of theResults against theBaseline.
+function compareResults(theOptions, theResults, theBaseline) {
+  const aRegressions = [];
+  for (const aName of Object.keys(theResults)) {
+    const aCur = theResults[aName], aBase = theBaseline[aName];
+    if (aBase === undefined) {
+      continue;
+    }
+    for (const aStage of Object.keys(aCur.stages)) {
+      if (aBase.stages[aStage] === undefined) {
+        continue;
+      }
+      const aCurTime = aCur.stages[aStage].min_ms;
+      const aBaseTime = aBase.stages[aStage].min_ms;
+      if (aCurTime > aBaseTime * (1.0 + theOptions.tolerance) &&
+          aCurTime - aBaseTime > theOptions.minDelta) {
+        aRegressions.push(aName + ": " + aStage + " " + aCurTime.toFixed(1) +
+                          " ms against " + aBaseTime.toFixed(1) + " ms");
+      }
+    }
+    if (aCur.heap_peak_mb >
+        aBase.heap_peak_mb * (1.0 + theOptions.memTolerance)) {
+      aRegressions.push(aName + ": heap peak " + aCur.heap_peak_mb.toFixed(1) +
+                        " MiB against " + aBase.heap_peak_mb.toFixed(1) +
+                        " MiB");
+    }
+  }
+  return aRegressions;
+}
+
+// ================================================================
+// Main
+// ================================================================
+
+//! Parse command line.
+function parseOptions(theArgs) {
+  const anOptions = {
+    module: path.join(THE_ROOT_DIR, "js", "demo_app.js"),
+    runs: 3,
+    out: "load_bench.json",
+    baseline: path.join(THE_ROOT_DIR, "test", "load_bench_baseline.json"),
+    tolerance: 0.25,
+    minDelta: 5.0,
+    memTolerance: 0.10,
+    updateBaseline: false,
+    generated: true,
+    child: null,
+    convert: null,
+    files: [],
+  };
+  for (let anArgIter = 0; anArgIter < theArgs.length; ++anArgIter) {
+    const anArg = theArgs[anArgIter];
+    const aNext = () => theArgs[++anArgIter];
+    switch (anArg) {
+      case "--module": anOptions.module = aNext(); break;
+      case "--runs": anOptions.runs = Math.max(parseInt(aNext()), 1); break;
+      case "--out": anOptions.out = aNext(); break;
+      case "--baseline": anOptions.baseline = aNext(); break;
+      case "--tolerance": anOptions.tolerance = parseFloat(aNext()); break;
+      case "--min-delta": anOptions.minDelta = parseFloat(aNext()); break;
+      case "--mem-tolerance": anOptions.memTolerance = parseFloat(aNext()); break;
+      case "--update-baseline": anOptions.updateBaseline = true; break;
+      case "--no-generated": anOptions.generated = false; break;
+      case "--child": anOptions.child = JSON.parse(aNext()); break;
+      case "--convert": anOptions.convert = JSON.parse(aNext()); break;
+      default: anOptions.files.push(anArg); break;
+    }
+  }
+  return anOptions;
+}
+
+//! Convert samples into derived models within temporary directory.
+//! Return list of converted models.
+function convertModels(theOptions, theTmpDir) {
+  const aModels = [];
+  for (const aDerived of THE_DERIVED_MODELS) {
+    const aModel = {
+      name: aDerived.name,
+      source: path.join(THE_ROOT_DIR, "test", "samples", aDerived.source),
+      path: path.join(theTmpDir, aDerived.name),
+    };
+    const aChild = childProcess.spawnSync(
+        process.execPath,
+        [__filename, "--module", theOptions.module, "--convert",
+         JSON.stringify(aModel)],
+        { encoding: "utf8" });
+    if (aChild.status !== 0) {
+      process.stderr.write(aModel.name + ": conversion failed\n" +
+                           (aChild.stderr || ""));
+      continue;
+    }
+    aModels.push({ name: aModel.name, path: aModel.path });
+  }
+  return aModels;
+}
+
+//! Run every model of the corpus in a child process and check results.
+function runCorpus(theOptions) {
+  const aTmpDir = fs.mkdtempSync(path.join(os.tmpdir(), "load_bench-"));
+  const aCorpus = [
+    { name: "Ball.brep",
+      path: path.join(THE_ROOT_DIR, "test", "samples", "Ball.brep") },
+  ];
+  const aDerived = convertModels(theOptions, aTmpDir);
+  aCorpus.push(...aDerived);
+  for (const aFile of theOptions.files) {
+    aCorpus.push({ name: path.basename(aFile), path: path.resolve(aFile) });
+  }
+  if (theOptions.generated) {
+    aCorpus.push(...THE_GENERATED_MODELS);
+  }
+
+  const aResults = {};
+  let isFailed = aDerived.length != THE_DERIVED_MODELS.length;
+  for (const aModel of aCorpus) {
+    const aChild = childProcess.spawnSync(
+        process.execPath,
+        [__filename, "--module", theOptions.module, "--runs",
+         String(theOptions.runs), "--child", JSON.stringify(aModel)],
+        { encoding: "utf8", maxBuffer: 16 * 1024 * 1024 });
+    if (aChild.status !== 0) {
+      process.stderr.write(aModel.name + ": failed\n" + (aChild.stderr || ""));
+      isFailed = true;
+      continue;
+    }
+    const aResult = JSON.parse(aChild.stdout.trim().split("\n").pop());
+    aResults[aModel.name] = aResult;
+    const aStages = Object.keys(aResult.stages)
+                        .map((theStage) => theStage + " " +
+                             aResult.stages[theStage].min_ms.toFixed(1))
+                        .join(", ");
+    console.log(aModel.name + ": " + aResult.triangles + " triangles, " +
+                aStages + " ms, heap peak " +
+                aResult.heap_peak_mb.toFixed(1) + " MiB");
+  }
+  fs.rmSync(aTmpDir, { recursive: true, force: true });
+
+  const aReport = {
+    date: new Date().toISOString(),
+    node: process.version,
+    runs: theOptions.runs,
+    results: aResults,
+  };
+  fs.writeFileSync(theOptions.out, JSON.stringify(aReport, null, 2) + "\n");
+
+  if (theOptions.updateBaseline) {
+    fs.writeFileSync(theOptions.baseline,
+                     JSON.stringify(aReport, null, 2) + "\n");
+    console.log("Baseline stored to " + theOptions.baseline);
+  } else if (fs.existsSync(theOptions.baseline)) {
+    const aBaseline = JSON.parse(fs.readFileSync(theOptions.baseline, "utf8"));
+    const aRegressions = compareResults(theOptions, aResults,
+                                        aBaseline.results);
+    for (const aRegression of aRegressions) {
+      console.log("REGRESSION " + aRegression);
+    }
+    const aMissing = Object.keys(aResults).filter(
+        (theName) => aBaseline.results[theName] === undefined);
+    if (aMissing.length > 0) {
+      console.log("No baseline for " + aMissing.join(", ") +
+                  ", run with --update-baseline to store one");
+    }
+    isFailed = isFailed || aRegressions.length > 0;
+  } else {
+    console.log("No baseline at " + theOptions.baseline +
+                ", run with --update-baseline to store one");
+  }
+  process.exit(isFailed ? 1 : 0);
+}
+
+const THE_OPTIONS = parseOptions(process.argv.slice(2));
+if (THE_OPTIONS.child !== null) {
+  runChild(THE_OPTIONS, THE_OPTIONS.child);
+} else if (THE_OPTIONS.convert !== null) {
+  runConvert(THE_OPTIONS, THE_OPTIONS.convert);
+} else {
+  runCorpus(THE_OPTIONS);
+}